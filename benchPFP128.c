@@ -0,0 +1,648 @@
+//===-- benchPFP128.c - benchmark the pfp128.h functions -----*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+//
+// Measure the cost of each of the functions which pfp128.h shims, of the
+// arithmetic and comparison functions, of the fused functions (sincos,
+// sinhcosh and csincos), of the complex arithmetic in pfp128_complex.h, of
+// an FFT from pfp128_fft.h, of a polynomial from pfp128_poly.h, of random
+// numbers from pfp128_random.h, of sorting with pfp128_sort.h, and of
+// strtoFP128, FP128_snprintf, FP128_to_chars and FP128_from_chars.
+// The functions come from the FOREACH lists in pfp128.h, so anything added
+// there is benchmarked too.
+//
+// For each function we report two things
+//   throughput: the time per call when the calls are independent, so that
+//               the machine can overlap them,
+//   latency:    the time per call when each call's argument depends on the
+//               result of the previous one (the dependency is carried
+//               through a couple of integer operations, which are included),
+// as ns/op, ops/s and, on x86_64, time stamp counter (reference) cycles/op.
+// The arguments are spread over a range which is representative for each
+// function (see ranges below).
+//
+// Usage: benchPFP128 [-j] [-t ms] [function ...]
+//   -j        print JSON rather than CSV
+//   -t ms     run each measurement for at least this long (default 20ms)
+//   function  only benchmark these functions (e.g. "sin add strtoFP128")
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define PFP128_KEEP_FUNCTION_LISTS 1
+#include "pfp128.h"
+
+#if (__x86_64__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+// Expand a macro and convert the result into a string
+#define STRINGIFY1(...) #__VA_ARGS__
+#define STRINGIFY(...) STRINGIFY1(__VA_ARGS__)
+#if defined(__cray__)
+#define COMPILER_NAME "Cray: " __VERSION__
+#elif defined(__INTEL_COMPILER)
+#define COMPILER_NAME                                                          \
+  "Intel: " STRINGIFY(__INTEL_COMPILER) "v" STRINGIFY(                         \
+      __INTEL_COMPILER_BUILD_DATE)
+#elif defined(__clang__)
+#define COMPILER_NAME                                                          \
+  "LLVM: " STRINGIFY(__clang_major__) ":" STRINGIFY(                           \
+      __clang_minor__) ":" STRINGIFY(__clang_patchlevel__)
+#elif defined(__GNUC__)
+#define COMPILER_NAME "GCC: " __VERSION__
+#else
+#define COMPILER_NAME "Unknown compiler"
+#endif
+
+static volatile uint64_t volatileZero = 0;
+static volatile uint64_t sink;
+
+// The arguments. Each benchmark loops over N of them.
+enum { N = 1024, STRING_LENGTH = 64 };
+static FP128 realIn[3][N];
+static COMPLEX_FP128 complexIn[3][N];
+static int intIn[N];
+static char const *stringIn[N];
+static FP128 *realPtrIn[N];
+static int *intPtrIn[N];
+// Space for the strings and for results returned through pointers.
+static char strings[N][STRING_LENGTH];
+static FP128 realOut[N];
+static int intOut[N];
+
+// The arguments of type T for argument k (only real and complex arguments
+// differ between argument positions). We add volatileZero so that the
+// compiler can't tell that the passes over the arguments in the throughput
+// kernels compute the same thing.
+#define BENCH_INPUT(T, k)                                                      \
+  (_Generic((T *)0,                                                            \
+       FP128 *: realIn[k],                                                     \
+       COMPLEX_FP128 *: complexIn[k],                                          \
+       int *: intIn,                                                           \
+       char const **: stringIn,                                                \
+       FP128 **: realPtrIn,                                                    \
+       int **: intPtrIn) +                                                     \
+   volatileZero)
+
+// Some bits of a result, so that the compiler can't discard the calls, and
+// we can make the next argument depend on them.
+static inline uint64_t bitsOfReal(FP128 x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+static inline uint64_t bitsOfComplex(COMPLEX_FP128 x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+static inline uint64_t bitsOfInt(int x) { return (uint64_t)x; }
+static inline uint64_t bitsOfLong(long x) { return (uint64_t)x; }
+static inline uint64_t bitsOfLongLong(long long x) { return (uint64_t)x; }
+#define BENCH_BITS(x)                                                          \
+  _Generic((x),                                                                \
+      FP128: bitsOfReal,                                                       \
+      COMPLEX_FP128: bitsOfComplex,                                            \
+      int: bitsOfInt,                                                          \
+      long: bitsOfLong,                                                        \
+      long long: bitsOfLongLong)(x)
+
+// Make *x depend on d, which is always zero (but the compiler doesn't know
+// that), without changing its value.
+static inline void dependReal(FP128 *x, uint64_t d) {
+  uint64_t bits;
+  memcpy(&bits, x, sizeof(bits));
+  bits |= d;
+  memcpy(x, &bits, sizeof(bits));
+}
+static inline void dependComplex(COMPLEX_FP128 *x, uint64_t d) {
+  uint64_t bits;
+  memcpy(&bits, x, sizeof(bits));
+  bits |= d;
+  memcpy(x, &bits, sizeof(bits));
+}
+static inline void dependInt(int *x, uint64_t d) { *x |= (int)d; }
+static inline void dependString(char const **x, uint64_t d) { *x += d; }
+static inline void dependRealPtr(FP128 **x, uint64_t d) { *x += d; }
+static inline void dependIntPtr(int **x, uint64_t d) { *x += d; }
+#define BENCH_DEPEND(x, d)                                                     \
+  _Generic(&(x),                                                               \
+      FP128 *: dependReal,                                                     \
+      COMPLEX_FP128 *: dependComplex,                                          \
+      int *: dependInt,                                                        \
+      char const **: dependString,                                             \
+      FP128 **: dependRealPtr,                                                 \
+      int **: dependIntPtr)(&(x), d)
+
+
+// The benchmark kernels; each runs over the N arguments reps times.
+// clang-format off
+#define BenchUnary(basename, restype, argtype)                          \
+static uint64_t basename##Throughput(long reps) {                       \
+  uint64_t bits = 0;                                                    \
+  for (long r = 0; r < reps; r++) {                                     \
+    argtype const *in = BENCH_INPUT(argtype, 0);                        \
+    for (int i = 0; i < N; i++)                                         \
+      bits += BENCH_BITS(basename##FP128(in[i]));                       \
+  }                                                                     \
+  return bits;                                                          \
+}                                                                       \
+static uint64_t basename##Latency(long reps) {                          \
+  argtype const *in = BENCH_INPUT(argtype, 0);                          \
+  uint64_t const zero = volatileZero;                                   \
+  uint64_t dep = 0;                                                     \
+  for (long r = 0; r < reps; r++)                                       \
+    for (int i = 0; i < N; i++) {                                       \
+      argtype x = in[i];                                                \
+      BENCH_DEPEND(x, dep);                                             \
+      dep = BENCH_BITS(basename##FP128(x)) & zero;                      \
+    }                                                                   \
+  return dep;                                                           \
+}
+
+#define BenchBinary(basename, restype, at1, at2)                        \
+static uint64_t basename##Throughput(long reps) {                       \
+  uint64_t bits = 0;                                                    \
+  for (long r = 0; r < reps; r++) {                                     \
+    at1 const *in1 = BENCH_INPUT(at1, 0);                               \
+    at2 const *in2 = BENCH_INPUT(at2, 1);                               \
+    for (int i = 0; i < N; i++)                                         \
+      bits += BENCH_BITS(basename##FP128(in1[i], in2[i]));              \
+  }                                                                     \
+  return bits;                                                          \
+}                                                                       \
+static uint64_t basename##Latency(long reps) {                          \
+  at1 const *in1 = BENCH_INPUT(at1, 0);                                 \
+  at2 const *in2 = BENCH_INPUT(at2, 1);                                 \
+  uint64_t const zero = volatileZero;                                   \
+  uint64_t dep = 0;                                                     \
+  for (long r = 0; r < reps; r++)                                       \
+    for (int i = 0; i < N; i++) {                                       \
+      at1 x = in1[i];                                                   \
+      BENCH_DEPEND(x, dep);                                             \
+      dep = BENCH_BITS(basename##FP128(x, in2[i])) & zero;              \
+    }                                                                   \
+  return dep;                                                           \
+}
+
+#define BenchTernary(basename, restype, at1, at2, at3)                  \
+static uint64_t basename##Throughput(long reps) {                       \
+  uint64_t bits = 0;                                                    \
+  for (long r = 0; r < reps; r++) {                                     \
+    at1 const *in1 = BENCH_INPUT(at1, 0);                               \
+    at2 const *in2 = BENCH_INPUT(at2, 1);                               \
+    at3 const *in3 = BENCH_INPUT(at3, 2);                               \
+    for (int i = 0; i < N; i++)                                         \
+      bits += BENCH_BITS(basename##FP128(in1[i], in2[i], in3[i]));      \
+  }                                                                     \
+  return bits;                                                          \
+}                                                                       \
+static uint64_t basename##Latency(long reps) {                          \
+  at1 const *in1 = BENCH_INPUT(at1, 0);                                 \
+  at2 const *in2 = BENCH_INPUT(at2, 1);                                 \
+  at3 const *in3 = BENCH_INPUT(at3, 2);                                 \
+  uint64_t const zero = volatileZero;                                   \
+  uint64_t dep = 0;                                                     \
+  for (long r = 0; r < reps; r++)                                       \
+    for (int i = 0; i < N; i++) {                                       \
+      at1 x = in1[i];                                                   \
+      BENCH_DEPEND(x, dep);                                             \
+      dep = BENCH_BITS(basename##FP128(x, in2[i], in3[i])) & zero;      \
+    }                                                                   \
+  return dep;                                                           \
+}
+
+// The operators have two FP128 arguments.
+#define BenchOperator(basename, operator)                               \
+  BenchBinary(basename, , FP128, FP128)
+
+FOREACH_UNARY_FUNCTION(BenchUnary)
+FOREACH_BINARY_FUNCTION(BenchBinary)
+FOREACH_TERNARY_FUNCTION(BenchTernary)
+FOREACH_ARITHMETIC_OPERATOR(BenchOperator)
+FOREACH_COMPARISON_OPERATOR(BenchOperator)
+// clang-format on
+
+// Conversion to and from text.
+static FP128 strtoNoEndFP128(char const *s) { return strtoFP128(s, 0); }
+BenchUnary(strtoNoEnd, FP128, char const *)
+
+// Each call writes x to the string s, and returns its length.
+#define BenchPrint(name, CALL)                                          \
+  static uint64_t name##Throughput(long reps) {                         \
+    uint64_t bits = 0;                                                  \
+    for (long r = 0; r < reps; r++) {                                   \
+      FP128 const *in = realIn[0] + volatileZero;                       \
+      for (int i = 0; i < N; i++) {                                     \
+        char *s = strings[i];                                           \
+        FP128 x = in[i];                                                \
+        bits += (uint64_t)(CALL);                                       \
+      }                                                                 \
+    }                                                                   \
+    return bits;                                                        \
+  }                                                                     \
+  static uint64_t name##Latency(long reps) {                            \
+    uint64_t const zero = volatileZero;                                 \
+    uint64_t dep = 0;                                                   \
+    for (long r = 0; r < reps; r++)                                     \
+      for (int i = 0; i < N; i++) {                                     \
+        char *s = strings[i] + dep;                                     \
+        FP128 x = realIn[0][i];                                         \
+        dependReal(&x, dep);                                            \
+        dep = (uint64_t)(CALL) & zero;                                  \
+      }                                                                 \
+    return dep;                                                         \
+  }
+
+#define PRINT_FORMAT "%.36" FP128_FMT_TAG "g"
+BenchPrint(snprintf, FP128_snprintf(s, STRING_LENGTH, PRINT_FORMAT, x))
+
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define HAVE_TO_CHARS 1
+#include "pfp128_charconv.h"
+BenchPrint(toChars, FP128_to_chars(s, s + STRING_LENGTH, x,
+                                   FP128_CHARS_GENERAL) - s)
+BenchPrint(toCharsPrecision,
+           FP128_to_chars_precision(s, s + STRING_LENGTH, x,
+                                    FP128_CHARS_GENERAL, 36) - s)
+static FP128 fromCharsFP128(char const *s) {
+  FP128 v = FP128_from_double(0.0);
+  FP128_from_chars(s, s + strlen(s), &v);
+  return v;
+}
+BenchUnary(fromChars, FP128, char const *)
+#endif
+
+// The fused functions, with both results' bits combined into one value.
+static FP128 combineReal(FP128 a, FP128 b) {
+  uint64_t bits = bitsOfReal(b);
+  dependReal(&a, bits);
+  return a;
+}
+static COMPLEX_FP128 combineComplex(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  uint64_t bits = bitsOfComplex(b);
+  dependComplex(&a, bits);
+  return a;
+}
+static FP128 sincosBothFP128(FP128 x) {
+  FP128 s, c;
+  sincosFP128(x, &s, &c);
+  return combineReal(s, c);
+}
+static FP128 sinhcoshBothFP128(FP128 x) {
+  FP128 s, c;
+  sinhcoshFP128(x, &s, &c);
+  return combineReal(s, c);
+}
+static COMPLEX_FP128 csincosBothFP128(COMPLEX_FP128 z) {
+  COMPLEX_FP128 s, c;
+  csincosFP128(z, &s, &c);
+  return combineComplex(s, c);
+}
+BenchUnary(sincosBoth, FP128, FP128)
+BenchUnary(sinhcoshBoth, FP128, FP128)
+BenchUnary(csincosBoth, COMPLEX_FP128, COMPLEX_FP128)
+
+// The limited range complex arithmetic, and (other than for double-double,
+// where there are no complex operators) the compiler's.
+#include "pfp128_complex.h"
+BenchBinary(cmul, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128)
+BenchBinary(cdiv, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128)
+BenchBinary(cdivScaled, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128)
+BenchTernary(cfma, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128)
+#if (!PFP128_IS_DD)
+static COMPLEX_FP128 cmulOperatorFP128(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  return a * b;
+}
+static COMPLEX_FP128 cdivOperatorFP128(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  return a / b;
+}
+BenchBinary(cmulOperator, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128)
+BenchBinary(cdivOperator, COMPLEX_FP128, COMPLEX_FP128, COMPLEX_FP128)
+#endif
+
+// A forward FFT of the N complex arguments, so the time per op is the time
+// per value. Each transform is a single call, so there's no separate latency.
+#include "pfp128_fft.h"
+static uint64_t fftThroughput(long reps) {
+  static FP128_FFT_PLAN *plan;
+  static COMPLEX_FP128 out[N];
+  if (!plan)
+    plan = FP128_fft_plan(N);
+  uint64_t bits = 0;
+  for (long r = 0; r < reps; r++) {
+    FP128_fft(plan, complexIn[0] + volatileZero, out, FP128_FFT_FORWARD);
+    bits += bitsOfComplex(out[r % N]);
+  }
+  return bits;
+}
+
+// The degree 16 Taylor polynomial of exp from pfp128_poly.h, at one value
+// and over the N arguments (so the time per op is the time per value).
+#include "pfp128_poly.h"
+static FP128 expTaylor[17];
+static FP128 const *expTaylorCoefficients(void) {
+  if (!eqFP128(expTaylor[0], FP128_CONST(1.0))) {
+    expTaylor[0] = FP128_CONST(1.0);
+    for (int k = 1; k <= 16; k++)
+      expTaylor[k] = divFP128(expTaylor[k - 1], FP128_from_ll(k));
+  }
+  return expTaylor;
+}
+static FP128 poly16FP128(FP128 x) {
+  return polyEvalFP128(expTaylorCoefficients(), 16, x);
+}
+BenchUnary(poly16, FP128, FP128)
+static uint64_t poly16ArrayThroughput(long reps) {
+  FP128 const *c = expTaylorCoefficients();
+  uint64_t bits = 0;
+  for (long r = 0; r < reps; r++) {
+    polyEvalFP128_n(c, 16, realIn[0] + volatileZero, realOut, N);
+    bits += bitsOfReal(realOut[r % N]);
+  }
+  return bits;
+}
+
+// Filling the N outputs with random values from pfp128_random.h (so the
+// time per op is the time per value).
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define HAVE_RANDOM 1
+#include "pfp128_random.h"
+static uint64_t uniformArrayThroughput(long reps) {
+  FP128_RANDOM r;
+  FP128_random_init(&r, volatileZero, 0);
+  uint64_t bits = 0;
+  for (long i = 0; i < reps; i++) {
+    FP128_random_uniform_n(&r, realOut, N);
+    bits += bitsOfReal(realOut[i % N]);
+  }
+  return bits;
+}
+static uint64_t normalArrayThroughput(long reps) {
+  FP128_RANDOM r;
+  FP128_random_init(&r, volatileZero, 0);
+  uint64_t bits = 0;
+  for (long i = 0; i < reps; i++) {
+    FP128_random_normal_n(&r, realOut, N);
+    bits += bitsOfReal(realOut[i % N]);
+  }
+  return bits;
+}
+
+// Sorting a copy of the N inputs with pfp128_sort.h (the time per op is
+// the time per element, copy included).
+#include "pfp128_sort.h"
+static uint64_t sortArrayThroughput(long reps) {
+  uint64_t bits = 0;
+  for (long i = 0; i < reps; i++) {
+    memcpy(realOut, realIn[0] + volatileZero, sizeof(realOut));
+    sortFP128(realOut, N);
+    bits += bitsOfReal(realOut[i % N]);
+  }
+  return bits;
+}
+#endif
+
+typedef struct {
+  char const *name;
+  uint64_t (*throughput)(long);
+  uint64_t (*latency)(long);
+} Benchmark;
+
+// clang-format off
+#define BenchEntry(basename, ...)                                       \
+  {#basename, basename##Throughput, basename##Latency},
+// clang-format on
+
+static Benchmark const benchmarks[] = {
+    FOREACH_ARITHMETIC_OPERATOR(BenchEntry)
+    FOREACH_COMPARISON_OPERATOR(BenchEntry)
+    FOREACH_UNARY_FUNCTION(BenchEntry)
+    FOREACH_BINARY_FUNCTION(BenchEntry)
+    FOREACH_TERNARY_FUNCTION(BenchEntry)
+    {"cmul", cmulThroughput, cmulLatency},
+    {"cdiv", cdivThroughput, cdivLatency},
+    {"cdivScaled", cdivScaledThroughput, cdivScaledLatency},
+    {"cfma", cfmaThroughput, cfmaLatency},
+#if (!PFP128_IS_DD)
+    {"complex*", cmulOperatorThroughput, cmulOperatorLatency},
+    {"complex/", cdivOperatorThroughput, cdivOperatorLatency},
+#endif
+    {"fft", fftThroughput, fftThroughput},
+    {"poly16", poly16Throughput, poly16Latency},
+    {"poly16_n", poly16ArrayThroughput, poly16ArrayThroughput},
+#if (HAVE_RANDOM)
+    {"random_uniform_n", uniformArrayThroughput, uniformArrayThroughput},
+    {"random_normal_n", normalArrayThroughput, normalArrayThroughput},
+    {"sort_n", sortArrayThroughput, sortArrayThroughput},
+#endif
+    {"strtoFP128", strtoNoEndThroughput, strtoNoEndLatency},
+    {"sincos", sincosBothThroughput, sincosBothLatency},
+    {"sinhcosh", sinhcoshBothThroughput, sinhcoshBothLatency},
+    {"csincos", csincosBothThroughput, csincosBothLatency},
+    {"FP128_snprintf", snprintfThroughput, snprintfLatency},
+#if (HAVE_TO_CHARS)
+    {"FP128_to_chars", toCharsThroughput, toCharsLatency},
+    {"FP128_to_chars_precision", toCharsPrecisionThroughput,
+     toCharsPrecisionLatency},
+    {"FP128_from_chars", fromCharsThroughput, fromCharsLatency},
+#endif
+};
+
+// The ranges from which we choose arguments, where the default (-10, 10)
+// isn't sensible. Complex arguments use the range for both parts.
+typedef struct {
+  char const *name;
+  int arg;
+  double lo, hi;
+} Range;
+
+static Range const ranges[] = {
+    {"div", 1, 0.5, 2.0},        {"acos", 0, -1.0, 1.0},
+    {"asin", 0, -1.0, 1.0},      {"atanh", 0, -0.99, 0.99},
+    {"acosh", 0, 1.0, 1000.0},   {"cosh", 0, -40.0, 40.0},
+    {"sinh", 0, -40.0, 40.0},    {"exp", 0, -40.0, 40.0},
+    {"sinhcosh", 0, -40.0, 40.0},
+    {"expm1", 0, -40.0, 40.0},   {"log", 0, 0.001, 1000.0},
+    {"log10", 0, 0.001, 1000.0}, {"log2", 0, 0.001, 1000.0},
+    {"log1p", 0, -0.5, 1000.0},  {"sqrt", 0, 0.0, 1.0e6},
+    {"cbrt", 0, -1.0e6, 1.0e6},  {"lgamma", 0, 0.5, 100.0},
+    {"tgamma", 0, 0.5, 50.0},    {"pow", 0, 0.5, 2.0},
+    {"pow", 1, -20.0, 20.0},     {"cpow", 0, -2.0, 2.0},
+    {"cpow", 1, -2.0, 2.0},      {"ldexp", 1, -20.0, 20.0},
+    {"fmod", 1, 0.5, 3.0},       {"remainder", 1, 0.5, 3.0},
+    {"remquo", 1, 0.5, 3.0},     {"strtoFP128", 0, -1.0e10, 1.0e10},
+    {"FP128_from_chars", 0, -1.0e10, 1.0e10},
+};
+
+static void findRange(char const *name, int arg, double *lo, double *hi) {
+  *lo = -10.0;
+  *hi = 10.0;
+  for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+    if (ranges[i].arg == arg && strcmp(ranges[i].name, name) == 0) {
+      *lo = ranges[i].lo;
+      *hi = ranges[i].hi;
+    }
+}
+
+// A fixed pseudo-random sequence, so that runs are comparable.
+static uint64_t randomState = 0x9e3779b97f4a7c15ull;
+static double randomUniform(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 7;
+  randomState ^= randomState << 17;
+  return (double)(randomState >> 11) * 0x1.0p-53;
+}
+
+// A value in [lo, hi) with all of the FP128 mantissa bits in use.
+static FP128 randomFP128(double lo, double hi) {
+  double x = lo + (hi - lo) * randomUniform();
+  FP128 low = FP128_from_double(ldexp(x * randomUniform(), -53));
+  return addFP128(FP128_from_double(x), low);
+}
+
+static void setArguments(char const *name) {
+  double lo, hi;
+  for (int k = 0; k < 3; k++) {
+    findRange(name, k, &lo, &hi);
+    for (int i = 0; i < N; i++) {
+      realIn[k][i] = randomFP128(lo, hi);
+      complexIn[k][i] = CMPLXFP128(randomFP128(lo, hi), randomFP128(lo, hi));
+    }
+  }
+  findRange(name, 1, &lo, &hi);
+  for (int i = 0; i < N; i++) {
+    intIn[i] = (int)(lo + (hi - lo) * randomUniform());
+    realPtrIn[i] = &realOut[i];
+    intPtrIn[i] = &intOut[i];
+    stringIn[i] = strings[i];
+    if (strcmp(name, "nan") == 0)
+      snprintf(strings[i], STRING_LENGTH, "%d", i);
+    else
+      FP128_snprintf(strings[i], STRING_LENGTH, PRINT_FORMAT, realIn[0][i]);
+  }
+}
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + 1.0e-9 * (double)t.tv_nsec;
+}
+
+static uint64_t ticks(void) {
+#if (HAVE_TSC)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static int json = 0;
+static int rows = 0;
+static double minTime = 0.02;
+
+// Time a kernel, and print the result. We choose a repeat count which
+// takes at least minTime, then take the best of three runs.
+static void measure(char const *name, char const *kind,
+                    uint64_t (*kernel)(long)) {
+  long reps = 1;
+  double elapsed;
+  for (;;) {
+    double start = now();
+    sink ^= kernel(reps);
+    elapsed = now() - start;
+    if (elapsed >= minTime)
+      break;
+    reps = elapsed < minTime / 16 ? reps * 16
+                                  : (long)(reps * 1.1 * minTime / elapsed) + 1;
+  }
+  double best = elapsed;
+  uint64_t bestTicks = 0;
+  for (int trial = 0; trial < 3; trial++) {
+    uint64_t startTicks = ticks();
+    double start = now();
+    sink ^= kernel(reps);
+    elapsed = now() - start;
+    uint64_t elapsedTicks = ticks() - startTicks;
+    if (trial == 0 || elapsed < best) {
+      best = elapsed;
+      bestTicks = elapsedTicks;
+    }
+  }
+
+  double ops = (double)reps * N;
+  double ns = 1.0e9 * best / ops;
+  char cycles[32] = "";
+  if (HAVE_TSC)
+    snprintf(cycles, sizeof(cycles), "%.2f", (double)bestTicks / ops);
+  if (json)
+    printf("%s  {\"compiler\": \"%s\", \"backend\": \"%s\", \"function\": "
+           "\"%s\", \"kind\": \"%s\", \"ns_per_op\": %.3f, \"ops_per_s\": "
+           "%.0f, \"ref_cycles_per_op\": %s}",
+           rows ? ",\n" : "", COMPILER_NAME, PFP128_BACKEND_NAME, name, kind,
+           ns, 1.0e9 / ns, HAVE_TSC ? cycles : "null");
+  else
+    printf("\"%s\",%s,%s,%s,%.3f,%.0f,%s\n", COMPILER_NAME, PFP128_BACKEND_NAME,
+           name, kind, ns, 1.0e9 / ns, cycles);
+  fflush(stdout);
+  rows++;
+}
+
+static int selected(char const *name, int argc, char **argv) {
+  int any = 0;
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') {
+      if (argv[i][1] == 't')
+        i++;
+      continue;
+    }
+    any = 1;
+    if (strcmp(argv[i], name) == 0)
+      return 1;
+  }
+  return !any;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0) {
+      json = 1;
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      minTime = atof(argv[++i]) / 1000.0;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Usage: %s [-j] [-t ms] [function ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (json)
+    printf("[\n");
+  else
+    printf("compiler,backend,function,kind,ns_per_op,ops_per_s,"
+           "ref_cycles_per_op\n");
+  for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+    if (!selected(benchmarks[b].name, argc, argv))
+      continue;
+    setArguments(benchmarks[b].name);
+    measure(benchmarks[b].name, "throughput", benchmarks[b].throughput);
+    measure(benchmarks[b].name, "latency", benchmarks[b].latency);
+  }
+  if (json)
+    printf("\n]\n");
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+//===-- libpfp128.c - The compiled library, with CPU dispatch -*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+//
+// The out of line functions declared in pfp128_lib.h, each of which is just
+// the inline version from the headers. Build it with "make lib", which
+// makes libpfp128.a and libpfp128.so, and (with -DPFP128_BACKEND=DD)
+// libpfp128dd.a and libpfp128dd.so.
+//
+// On x86_64 Linux this is compiled three times:
+//   -DPFP128_LIB_LEVEL=v3 -march=x86-64-v3   the functions, named ..._v3,
+//   -DPFP128_LIB_LEVEL=v4 -march=x86-64-v4   the functions, named ..._v4,
+//   -DPFP128_LIB_LEVELS=1                    the baseline functions, and
+//                                            the dispatcher,
+// where the dispatcher makes each public name an ifunc, whose resolver
+// (run by the loader, once) chooses the version for the highest level the
+// CPU supports. Since the whole translation unit is compiled for the level,
+// so is everything the functions use. The versions are all hidden (rather
+// than static), so that the tests, linked with the static library, can
+// call each of them. Elsewhere it is compiled once, and the functions are
+// the public ones.
+//
+// LIBFLAGS are added when compiling it, so "make lib LIBFLAGS=-fopenmp"
+// gives a library whose loops run in parallel once n reaches
+// PFP128_OMP_THRESHOLD (a program using it then needs -fopenmp when it
+// links too).
+//
+#define PFP128_LIB_BUILD 1
+#include "pfp128_lib.h"
+
+#if (PFP128_LIB_LEVELS || defined(PFP128_LIB_LEVEL)) &&                        \
+    !(defined(__GNUC__) && defined(__x86_64__) && defined(__linux__))
+#error The per level versions need GCC or Clang on x86_64 Linux.
+#endif
+
+#define PFP128_LIB_STR_(x) #x
+#define PFP128_LIB_STR(x) PFP128_LIB_STR_(x)
+
+#if (defined(PFP128_LIB_LEVEL))
+#define PFP128_LIB_VERSION(name) PFP128_LIB_LEVEL_NAME(name, PFP128_LIB_LEVEL)
+#define PFP128_LIB_LINKAGE __attribute__((visibility("hidden")))
+#elif (PFP128_LIB_LEVELS)
+#define PFP128_LIB_VERSION(name) PFP128_LIB_LEVEL_NAME(name, default)
+#define PFP128_LIB_LINKAGE __attribute__((visibility("hidden")))
+#else
+#define PFP128_LIB_VERSION(name) PFP128_LIB_NAME(name)
+#define PFP128_LIB_LINKAGE
+#endif
+
+#define PFP128_LIB_DEFINE(restype, name, params, args)                         \
+  PFP128_LIB_LINKAGE restype PFP128_LIB_VERSION(name) params {                 \
+    return name args;                                                          \
+  }
+#define PFP128_LIB_DEFINE_VOID(restype, name, params, args)                    \
+  PFP128_LIB_LINKAGE restype PFP128_LIB_VERSION(name) params { name args; }
+
+FOREACH_LIB_FUNCTION(PFP128_LIB_DEFINE)
+FOREACH_LIB_VOID_FUNCTION(PFP128_LIB_DEFINE_VOID)
+
+#undef PFP128_LIB_DEFINE
+#undef PFP128_LIB_DEFINE_VOID
+
+#if (!defined(PFP128_LIB_LEVEL))
+#if (PFP128_LIB_LEVELS)
+#include <cpuid.h>
+
+// The highest level the CPU supports: all of the level's features (those
+// of x86-64-v2 as well), and the OS saving the AVX (and AVX-512) registers.
+// We read CPUID ourselves since resolvers run before constructors (so
+// before __builtin_cpu_supports is set up), and older versions of clang's
+// __builtin_cpu_supports can't check lzcnt, movbe or f16c.
+int PFP128_LIB_NAME(FP128_lib_level)(void) {
+  unsigned a, b, c, d, features7 = 0, c7, extended = 0;
+  if (!__get_cpuid(1, &a, &b, &c, &d))
+    return 0;
+  if (!__get_cpuid_count(7, 0, &a, &features7, &c7, &d))
+    features7 = 0;
+  if (!__get_cpuid(0x80000001, &a, &b, &extended, &d))
+    extended = 0;
+  unsigned v3 = bit_SSE3 | bit_SSSE3 | bit_SSE4_1 | bit_SSE4_2 | bit_POPCNT |
+                bit_CMPXCHG16B | bit_AVX | bit_FMA | bit_F16C | bit_MOVBE |
+                bit_OSXSAVE;
+  unsigned v3Leaf7 = bit_AVX2 | bit_BMI | bit_BMI2;
+  unsigned v3Extended = bit_LAHF_LM | bit_LZCNT;
+  if ((c & v3) != v3 || (features7 & v3Leaf7) != v3Leaf7 ||
+      (extended & v3Extended) != v3Extended)
+    return 0;
+  // XCR0: the SSE and AVX state (bits 1 and 2), and the AVX-512 state
+  // (bits 5 to 7).
+  unsigned xcr0, xcr0High;
+  __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+  (void)xcr0High;
+  if ((xcr0 & 0x6) != 0x6)
+    return 0;
+  unsigned v4Leaf7 =
+      bit_AVX512F | bit_AVX512BW | bit_AVX512CD | bit_AVX512DQ | bit_AVX512VL;
+  return (features7 & v4Leaf7) == v4Leaf7 && (xcr0 & 0xe6) == 0xe6 ? 4 : 3;
+}
+
+// clang-format off
+#define PFP128_LIB_DISPATCH(restype, name, params, args)                \
+  static restype (*PFP128_LIB_LEVEL_NAME(name, resolve)(void))         \
+      params {                                                          \
+    switch (PFP128_LIB_NAME(FP128_lib_level)()) {                       \
+    case 4:                                                             \
+      return PFP128_LIB_LEVEL_NAME(name, v4);                           \
+    case 3:                                                             \
+      return PFP128_LIB_LEVEL_NAME(name, v3);                           \
+    default:                                                            \
+      return PFP128_LIB_LEVEL_NAME(name, default);                      \
+    }                                                                   \
+  }                                                                     \
+  restype PFP128_LIB_NAME(name) params __attribute__((ifunc(            \
+      PFP128_LIB_STR(PFP128_LIB_LEVEL_NAME(name, resolve)))));
+// clang-format on
+
+FOREACH_LIB_FUNCTION(PFP128_LIB_DISPATCH)
+FOREACH_LIB_VOID_FUNCTION(PFP128_LIB_DISPATCH)
+#undef PFP128_LIB_DISPATCH
+#endif
+
+char const *PFP128_LIB_NAME(FP128_lib_isa)(void) {
+#if (PFP128_LIB_LEVELS)
+  switch (PFP128_LIB_NAME(FP128_lib_level)()) {
+  case 4:
+    return "x86-64-v4";
+  case 3:
+    return "x86-64-v3";
+  }
+#endif
+  return "default";
+}
+#endif
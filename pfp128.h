@@ -22,6 +22,59 @@
 #include <float.h>
 #include <math.h>
 
+// Backend selection.
+// By default FP128 is the platform's native IEEE 128b type (or as close as we
+// can get to it), chosen by the target checks below. Compiling with
+// -DPFP128_BACKEND=DD instead makes FP128 a double-double pair (see
+// pfp128_dd.h), which gives ~106 bits of precision at a fraction of the cost
+// of software emulated binary128 arithmetic.
+#define PFP128_BACKEND_ID_NATIVE 1
+#define PFP128_BACKEND_ID_DD 2
+#define PFP128_BACKEND_ID_(backend) PFP128_BACKEND_ID_##backend
+#define PFP128_BACKEND_ID(backend) PFP128_BACKEND_ID_(backend)
+#if (!defined(PFP128_BACKEND))
+#define PFP128_BACKEND NATIVE
+#endif
+#if (PFP128_BACKEND_ID(PFP128_BACKEND) == PFP128_BACKEND_ID_DD)
+#define PFP128_IS_DD 1
+#define PFP128_BACKEND_NAME "double-double"
+#elif (PFP128_BACKEND_ID(PFP128_BACKEND) == PFP128_BACKEND_ID_NATIVE)
+#define PFP128_IS_DD 0
+#define PFP128_BACKEND_NAME "native"
+#else
+#error PFP128_BACKEND must be NATIVE or DD.
+#endif
+
+#if (PFP128_IS_DD)
+#if (PFP128_SHOW_CONFIG)
+#warning Invoked with PFP128_SHOW_CONFIG: PFP128_BACKEND=DD
+#endif
+#include "pfp128_dd.h"
+
+// A pair of doubles, so the arithmetic operators can't be used on these;
+// use addFP128, mulFP128 and friends (below) instead.
+typedef FP128DD FP128;
+typedef COMPLEX_FP128DD COMPLEX_FP128;
+
+#define FP128_CONST(val) DD_CONST(val)
+#define FP128Name(function) function##dd
+#define FP128_FMT_TAG "Q"
+// Handles the Q tag itself, and passes everything else to snprintf.
+#define FP128_snprintf dd_snprintf
+
+static inline FP128 strtoFP128(char const *s, char **sp) {
+  return strtodd(s, sp);
+}
+
+#if (PFP128_SHOW_CONFIG)
+#warning FP128 is FP128DD (double-double)
+#warning FP128_CONST => DD_CONST
+#warning FP128 function suffix is dd
+#warning FP128_FMT_TAG is Q
+#warning FP128_snprintf => dd_snprintf
+#warning strtoFP128 => strtodd
+#endif
+
 // Architecture neutral C standard stuff, which we hope will catch what is going
 // on! The compiler supports the IEC 559 specification, however, that does not
 // actually require support for the 128b type. So we check whether the property
@@ -30,8 +83,8 @@
 
 // Zeroed out for now, since although GCC sets this on x86_64, linux,
 // the foof128 function names are not present in libm :-(
-#if (0 && ((defined(__STDC_IEC_60559_TYPES__) || defined(__STDC_IEC_559__)) && \
-           defined(FLT128_MAX)))
+#elif (0 && ((defined(__STDC_IEC_60559_TYPES__) || defined(__STDC_IEC_559__)) && \
+             defined(FLT128_MAX)))
 #if (PFP128_SHOW_CONFIG)
 #warning __STDC_IEC_60559_TYPES__ or __STDC_IEC_559__ defined with FLT128_MAX
 #endif
@@ -148,6 +201,22 @@ static inline FP128 strtoFP128(char const *s, char **sp) {
 }
 #endif
 
+// Optionally replace the compiler's out of line soft-float calls for the
+// basic arithmetic with the inlinable implementation in pfp128_soft.h.
+// That only makes sense when FP128 is really IEEE binary128 (the
+// double-double backend's arithmetic is already inline).
+#if (PFP128_INLINE_ARITHMETIC && !PFP128_IS_DD)
+#if (FP128_IS_LONGDOUBLE && LDBL_MANT_DIG != 113)
+#error PFP128_INLINE_ARITHMETIC needs FP128 to be IEEE binary128.
+#endif
+#if (PFP128_SHOW_CONFIG)
+#warning PFP128_INLINE_ARITHMETIC => arithmetic from pfp128_soft.h
+#endif
+// (pfp128_soft.h also provides FP128_to_sq and FP128_from_sq.)
+#include "pfp128_soft.h"
+#define PFP128_USE_SOFT_ARITHMETIC 1
+#endif
+
 // From here on the code is common no matter what the underlying implementation.
 // So if you're adding more functions do it here.
 
@@ -156,6 +225,36 @@ static inline FP128 strtoFP128(char const *s, char **sp) {
 
 // clang-format really messes up the multiple line macro definitions :-(
 // clang-format off
+#if (PFP128_PROFILE)
+// Count the calls, time them, and classify the first argument (see
+// pfp128_profile.h, which is included once the function lists exist).
+#define CreateUnaryShim(basename, restype, argtype)                     \
+static inline restype basename ## FP128(argtype arg) {                  \
+  int argClass = PFP128_PROFILE_CLASS(arg);                            \
+  uint64_t start = pfp128_profile_ticks();                              \
+  restype result = FP128Name(basename)(arg);                            \
+  pfp128_profile_count(PFP128_PROFILE_ID_ ## basename, argClass, start); \
+  return result;                                                        \
+}
+
+#define CreateBinaryShim(basename, restype, at1, at2)                   \
+static inline restype basename ## FP128(at1 arg1, at2 arg2) {           \
+  int argClass = PFP128_PROFILE_CLASS(arg1);                           \
+  uint64_t start = pfp128_profile_ticks();                              \
+  restype result = FP128Name(basename)(arg1, arg2);                     \
+  pfp128_profile_count(PFP128_PROFILE_ID_ ## basename, argClass, start); \
+  return result;                                                        \
+}
+
+#define CreateTernaryShim(basename, restype, at1, at2, at3)             \
+static inline restype basename ## FP128(at1 arg1, at2 arg2, at3 arg3) { \
+  int argClass = PFP128_PROFILE_CLASS(arg1);                           \
+  uint64_t start = pfp128_profile_ticks();                              \
+  restype result = FP128Name(basename)(arg1, arg2, arg3);               \
+  pfp128_profile_count(PFP128_PROFILE_ID_ ## basename, argClass, start); \
+  return result;                                                        \
+}
+#else
 #define CreateUnaryShim(basename, restype, argtype)	\
 static inline restype basename ## FP128(argtype arg) {	\
   return FP128Name(basename)(arg);			\
@@ -172,7 +271,11 @@ static inline restype basename ## FP128(at1 arg1, at2 arg2) {	\
 static inline restype basename ## FP128(at1 arg1, at2 arg2, at3 arg3) { \
   return FP128Name(basename)(arg1, arg2, arg3);				\
 }
+#endif
 
+// The FOREACH lists are #undef'd at the end of the header unless you define
+// PFP128_KEEP_FUNCTION_LISTS to 1, so that code which wants to do something
+// for every function (as benchPFP128.c does) can use them too.
 #define FOREACH_UNARY_FUNCTION(op)              \
   op(acos, FP128, FP128)                        \
   op(acosh, FP128, FP128)                       \
@@ -238,12 +341,14 @@ static inline restype basename ## FP128(at1 arg1, at2 arg2, at3 arg3) { \
 // If you need it, and have it, then add it in the obvious way.
 // op(exp2, FP128, FP128)			
 
-FOREACH_UNARY_FUNCTION(CreateUnaryShim)
-
-// Functions with two arguments
+// Functions with two arguments (those whose last argument is somewhere to
+// put a second result are also listed on their own, since their batched
+// versions are written out below rather than generated)
 #define FOREACH_BINARY_FUNCTION(op)                     \
+  FOREACH_BINARY_VALUE_FUNCTION(op)                     \
+  FOREACH_BINARY_POINTER_FUNCTION(op)
+#define FOREACH_BINARY_VALUE_FUNCTION(op)               \
   op(ldexp, FP128, FP128, int)                          \
-  op(modf, FP128, FP128, FP128 *)                       \
   op(nextafter, FP128, FP128, FP128)                    \
   op(pow, FP128, FP128, FP128)                          \
   op(remainder, FP128, FP128, FP128)                    \
@@ -254,20 +359,376 @@ FOREACH_UNARY_FUNCTION(CreateUnaryShim)
   op(fmax, FP128, FP128, FP128)                         \
   op(fmin, FP128, FP128, FP128)                         \
   op(fmod, FP128, FP128, FP128)                         \
-  op(frexp, FP128, FP128, int *)                        \
   op(hypot, FP128, FP128, FP128)
-
-FOREACH_BINARY_FUNCTION(CreateBinaryShim)
+#define FOREACH_BINARY_POINTER_FUNCTION(op)             \
+  op(modf, FP128, FP128, FP128 *)                       \
+  op(frexp, FP128, FP128, int *)
 
 // Functions with three arguments
 #define FOREACH_TERNARY_FUNCTION(op)            \
-  op(remquo, FP128, FP128, FP128, int *)        \
+  FOREACH_TERNARY_VALUE_FUNCTION(op)            \
+  FOREACH_TERNARY_POINTER_FUNCTION(op)
+#define FOREACH_TERNARY_VALUE_FUNCTION(op)      \
   op(fma, FP128, FP128, FP128, FP128)
+#define FOREACH_TERNARY_POINTER_FUNCTION(op)    \
+  op(remquo, FP128, FP128, FP128, int *)
 
+#if (PFP128_PROFILE)
+#if (PFP128_SHOW_CONFIG)
+#warning PFP128_PROFILE => the function shims are profiled (pfp128_profile.h)
+#endif
+#include "pfp128_profile.h"
+#endif
+
+FOREACH_UNARY_FUNCTION(CreateUnaryShim)
+FOREACH_BINARY_FUNCTION(CreateBinaryShim)
 FOREACH_TERNARY_FUNCTION(CreateTernaryShim)
 
+// Arithmetic and comparison.
+// With a native backend these are just the C operators (or, with
+// PFP128_INLINE_ARITHMETIC, the inline versions from pfp128_soft.h), but the
+// double-double backend's FP128 is a struct, so code which wants to work with
+// either backend must use these functions rather than the operators.
+#define FOREACH_ARITHMETIC_OPERATOR(op)         \
+  op(add, +)                                    \
+  op(sub, -)                                    \
+  op(mul, *)                                    \
+  op(div, /)
+
+#define FOREACH_COMPARISON_OPERATOR(op)         \
+  op(eq, ==)                                    \
+  op(ne, !=)                                    \
+  op(lt, <)                                     \
+  op(le, <=)                                    \
+  op(gt, >)                                     \
+  op(ge, >=)
+
+#if (PFP128_IS_DD)
+#define CreateArithmeticShim(basename, operator)                \
+static inline FP128 basename ## FP128(FP128 arg1, FP128 arg2) { \
+  return FP128Name(basename)(arg1, arg2);                       \
+}
+#define CreateComparisonShim(basename, operator)              \
+static inline int basename ## FP128(FP128 arg1, FP128 arg2) { \
+  return FP128Name(basename)(arg1, arg2);                     \
+}
+#elif (PFP128_USE_SOFT_ARITHMETIC)
+#define CreateArithmeticShim(basename, operator)                \
+static inline FP128 basename ## FP128(FP128 arg1, FP128 arg2) { \
+  return FP128_from_sq(basename ## sq(FP128_to_sq(arg1),        \
+                                      FP128_to_sq(arg2)));      \
+}
+#define CreateComparisonShim(basename, operator)              \
+static inline int basename ## FP128(FP128 arg1, FP128 arg2) { \
+  return basename ## sq(FP128_to_sq(arg1), FP128_to_sq(arg2)); \
+}
+#else
+#define CreateArithmeticShim(basename, operator)                \
+static inline FP128 basename ## FP128(FP128 arg1, FP128 arg2) { \
+  return arg1 operator arg2;                                    \
+}
+#define CreateComparisonShim(basename, operator)              \
+static inline int basename ## FP128(FP128 arg1, FP128 arg2) { \
+  return arg1 operator arg2;                                  \
+}
+#endif
+
+FOREACH_ARITHMETIC_OPERATOR(CreateArithmeticShim)
+FOREACH_COMPARISON_OPERATOR(CreateComparisonShim)
 // clang-format on
 
+#if (PFP128_IS_DD)
+static inline FP128 negFP128(FP128 arg) { return negdd(arg); }
+
+// Conversions to and from the standard types.
+static inline FP128 FP128_from_double(double d) { return dd_from_double(d); }
+static inline double FP128_to_double(FP128 arg) { return dd_to_double(arg); }
+static inline FP128 FP128_from_ll(long long v) { return dd_from_ll(v); }
+// Truncates towards zero, as a C cast would.
+static inline long long FP128_to_ll(FP128 arg) { return dd_to_ll(arg); }
+
+// Classification
+static inline int isnanFP128(FP128 arg) { return isnandd(arg); }
+static inline int isinfFP128(FP128 arg) { return isinfdd(arg); }
+static inline int isfiniteFP128(FP128 arg) { return isfinitedd(arg); }
+static inline int signbitFP128(FP128 arg) { return signbitdd(arg); }
+
+static inline COMPLEX_FP128 CMPLXFP128(FP128 re, FP128 im) {
+  return dd_cmake(re, im);
+}
+#else
+static inline FP128 negFP128(FP128 arg) { return -arg; }
+
+#if (PFP128_USE_SOFT_ARITHMETIC)
+static inline FP128 FP128_from_double(double d) {
+  return FP128_from_sq(sq_from_double(d));
+}
+static inline double FP128_to_double(FP128 arg) {
+  return sq_to_double(FP128_to_sq(arg));
+}
+static inline FP128 FP128_from_ll(long long v) {
+  return FP128_from_sq(sq_from_ll(v));
+}
+static inline long long FP128_to_ll(FP128 arg) {
+  return sq_to_ll(FP128_to_sq(arg));
+}
+#else
+static inline FP128 FP128_from_double(double d) { return d; }
+static inline double FP128_to_double(FP128 arg) { return (double)arg; }
+static inline FP128 FP128_from_ll(long long v) { return v; }
+static inline long long FP128_to_ll(FP128 arg) { return (long long)arg; }
+#endif
+
+// We avoid the generic macros from math.h, since not every C library's
+// version of them understands __float128.
+static inline int isnanFP128(FP128 arg) { return arg != arg; }
+static inline int isinfFP128(FP128 arg) {
+  return FP128Name(fabs)(arg) == (FP128)HUGE_VAL;
+}
+static inline int isfiniteFP128(FP128 arg) {
+  return FP128Name(fabs)(arg) < (FP128)HUGE_VAL;
+}
+static inline int signbitFP128(FP128 arg) {
+  return FP128Name(copysign)(FP128_CONST(1.0), arg) < 0;
+}
+
+// The C standard guarantees that a complex value has the same layout as
+// an array of two reals.
+static inline COMPLEX_FP128 CMPLXFP128(FP128 re, FP128 im) {
+  union {
+    FP128 parts[2];
+    COMPLEX_FP128 z;
+  } u = {{re, im}};
+  return u.z;
+}
+#endif
+
+// Optionally replace exp, log, log2, log10, pow, sin and cos with the faster,
+// but less accurate, versions in pfp128_fast.h (which #defines the names to
+// be its functions, so this has to come before the batched versions).
+#if (PFP128_FAST_MATH)
+#if (PFP128_SHOW_CONFIG)
+#warning PFP128_FAST_MATH => exp, log, pow, sin, cos... from pfp128_fast.h
+#endif
+#include "pfp128_fast.h"
+#endif
+
+// Fused functions, which compute two results for about the price of one.
+// sincosFP128 shares the argument reduction between sin and cos.
+static inline void sincosFP128(FP128 x, FP128 *s, FP128 *c) {
+#if (PFP128_FAST_MATH)
+  sincosFP128_fast(x, s, c);
+#elif (PFP128_IS_DD || !FP128_IS_LONGDOUBLE)
+  FP128Name(sincos)(x, s, c);
+#else
+  // sincosl is a GNU extension, but compilers combine these into it where
+  // it exists.
+  *s = sinFP128(x);
+  *c = cosFP128(x);
+#endif
+}
+
+// sinh and cosh from one expm1: with e = exp(|x|) - 1,
+// sinh(|x|) = (e + e / (e + 1)) / 2 and cosh(x) = ((e + 1) + 1 / (e + 1)) / 2.
+static inline void sinhcoshFP128(FP128 x, FP128 *sh, FP128 *ch) {
+  FP128 em = expm1FP128(fabsFP128(x));
+  if (!isfiniteFP128(em)) {
+    // NaN, or exp overflows (before sinh and cosh do).
+    *sh = sinhFP128(x);
+    *ch = coshFP128(x);
+    return;
+  }
+  FP128 half = FP128_from_double(0.5), e = addFP128(em, FP128_from_double(1.0));
+  FP128 s = mulFP128(half, addFP128(em, divFP128(em, e)));
+  *sh = signbitFP128(x) ? negFP128(s) : s;
+  *ch = mulFP128(half, addFP128(e, divFP128(FP128_from_double(1.0), e)));
+}
+
+// csin and ccos from one sincos and one sinhcosh of the parts:
+// sin(x + iy) = sin x cosh y + i cos x sinh y, and
+// cos(x + iy) = cos x cosh y - i sin x sinh y.
+static inline void csincosFP128(COMPLEX_FP128 z, COMPLEX_FP128 *s,
+                                COMPLEX_FP128 *c) {
+  FP128 x = crealFP128(z), y = cimagFP128(z), sx, cx, shy, chy;
+  sinhcoshFP128(y, &shy, &chy);
+  if (!isfiniteFP128(x) || !isfiniteFP128(chy) ||
+      eqFP128(y, FP128_from_double(0.0))) {
+    // Leave the special cases (C99 Annex G) to the library.
+    *s = csinFP128(z);
+    *c = ccosFP128(z);
+    return;
+  }
+  sincosFP128(x, &sx, &cx);
+  *s = CMPLXFP128(mulFP128(sx, chy), mulFP128(cx, shy));
+  *c = CMPLXFP128(mulFP128(cx, chy), negFP128(mulFP128(sx, shy)));
+}
+// clang-format off
+
+// Batched (array) versions of all of the shims above.
+// For each function foo we also generate
+//   fooFP128_n  (in, out, n)  which applies foo elementwise to n values, and
+//   fooFP128_ns (in, instride, out, outstride, n) which does the same on
+//               strided data (strides are in elements, not bytes).
+// Binary and ternary functions take one input array per argument, and also
+// have forms in which some arguments are broadcast scalars. The suffix says
+// which arguments are (v)ectors and which are (s)calars, so
+//   powFP128_nvs(x, two, out, n)         computes out[i] = pow(x[i], two)
+//   fmaFP128_nsvv(a, x, y, out, n)       computes out[i] = fma(a, x[i], y[i])
+// The functions which return a second result through a pointer (frexp,
+// modf and remquo) have just the _n form, in which that argument is an
+// array for the n second results instead:
+//   frexpFP128_n(x, exp, out, n)         out[i] = frexp(x[i], &exp[i])
+//   modfFP128_n(x, ip, out, n)           out[i] = modf(x[i], &ip[i])
+//   remquoFP128_n(x, y, quo, out, n)     out[i] = remquo(x[i], y[i], &quo[i])
+//
+// If the code is compiled with OpenMP enabled the loops are parallelised
+// once n reaches PFP128_OMP_THRESHOLD (which you can override before including
+// this header; setting it very large disables the parallel path).
+#include <stddef.h>
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_PARALLEL_LOOP                                                   \
+  _Pragma("omp parallel for schedule(static) if (n >= PFP128_OMP_THRESHOLD)")
+#else
+#define PFP128_PARALLEL_LOOP
+#endif
+
+#define CreateUnaryBatch(basename, restype, argtype)                    \
+static inline void basename ## FP128_n(argtype const *in, restype *out, \
+                                       size_t n) {                      \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(in[i]);                                    \
+}                                                                       \
+static inline void basename ## FP128_ns(argtype const *in,              \
+                                        ptrdiff_t instride,             \
+                                        restype *out,                   \
+                                        ptrdiff_t outstride, size_t n) { \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[(ptrdiff_t)i * outstride] =                                     \
+      basename ## FP128(in[(ptrdiff_t)i * instride]);                   \
+}
+
+#define CreateBinaryBatch(basename, restype, at1, at2)                  \
+static inline void basename ## FP128_n(at1 const *a1, at2 const *a2,    \
+                                       restype *out, size_t n) {        \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], a2[i]);                           \
+}                                                                       \
+static inline void basename ## FP128_ns(at1 const *a1, ptrdiff_t s1,    \
+                                        at2 const *a2, ptrdiff_t s2,    \
+                                        restype *out, ptrdiff_t so,     \
+                                        size_t n) {                     \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[(ptrdiff_t)i * so] = basename ## FP128(a1[(ptrdiff_t)i * s1],   \
+                                               a2[(ptrdiff_t)i * s2]);  \
+}                                                                       \
+static inline void basename ## FP128_nsv(at1 a1, at2 const *a2,         \
+                                         restype *out, size_t n) {      \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1, a2[i]);                              \
+}                                                                       \
+static inline void basename ## FP128_nvs(at1 const *a1, at2 a2,         \
+                                         restype *out, size_t n) {      \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], a2);                              \
+}
+
+#define CreateTernaryBatch(basename, restype, at1, at2, at3)            \
+static inline void basename ## FP128_n(at1 const *a1, at2 const *a2,    \
+                                       at3 const *a3, restype *out,     \
+                                       size_t n) {                      \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], a2[i], a3[i]);                    \
+}                                                                       \
+static inline void basename ## FP128_ns(at1 const *a1, ptrdiff_t s1,    \
+                                        at2 const *a2, ptrdiff_t s2,    \
+                                        at3 const *a3, ptrdiff_t s3,    \
+                                        restype *out, ptrdiff_t so,     \
+                                        size_t n) {                     \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[(ptrdiff_t)i * so] = basename ## FP128(a1[(ptrdiff_t)i * s1],   \
+                                               a2[(ptrdiff_t)i * s2],   \
+                                               a3[(ptrdiff_t)i * s3]);  \
+}                                                                       \
+static inline void basename ## FP128_nsvv(at1 a1, at2 const *a2,        \
+                                          at3 const *a3, restype *out,  \
+                                          size_t n) {                   \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1, a2[i], a3[i]);                       \
+}                                                                       \
+static inline void basename ## FP128_nvsv(at1 const *a1, at2 a2,        \
+                                          at3 const *a3, restype *out,  \
+                                          size_t n) {                   \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], a2, a3[i]);                       \
+}                                                                       \
+static inline void basename ## FP128_nvvs(at1 const *a1, at2 const *a2, \
+                                          at3 a3, restype *out,         \
+                                          size_t n) {                   \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], a2[i], a3);                       \
+}
+
+FOREACH_UNARY_FUNCTION(CreateUnaryBatch)
+FOREACH_BINARY_VALUE_FUNCTION(CreateBinaryBatch)
+FOREACH_TERNARY_VALUE_FUNCTION(CreateTernaryBatch)
+
+// The second results go to an array of their own. (Broadcasting the pointer
+// would have every element write to the same place.)
+#define CreateBinaryPointerBatch(basename, restype, at1, at2)           \
+static inline void basename ## FP128_n(at1 const *a1, at2 a2,           \
+                                       restype *out, size_t n) {        \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], &a2[i]);                          \
+}
+
+#define CreateTernaryPointerBatch(basename, restype, at1, at2, at3)     \
+static inline void basename ## FP128_n(at1 const *a1, at2 const *a2,    \
+                                       at3 a3, restype *out,            \
+                                       size_t n) {                      \
+  PFP128_PARALLEL_LOOP                                                  \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a1[i], a2[i], &a3[i]);                   \
+}
+
+FOREACH_BINARY_POINTER_FUNCTION(CreateBinaryPointerBatch)
+FOREACH_TERNARY_POINTER_FUNCTION(CreateTernaryPointerBatch)
+
+#define CreateArithmeticBatch(basename, operator)       \
+  CreateBinaryBatch(basename, FP128, FP128, FP128)
+
+FOREACH_ARITHMETIC_OPERATOR(CreateArithmeticBatch)
+
+// clang-format on
+
+// Batched fused functions: out1[i] and out2[i] are the two results for in[i].
+#define CreateFusedBatch(basename, restype, argtype)                           \
+  static inline void basename##FP128_n(argtype const *in, restype *out1,       \
+                                       restype *out2, size_t n) {              \
+    PFP128_PARALLEL_LOOP                                                       \
+    for (size_t i = 0; i < n; i++)                                             \
+      basename##FP128(in[i], &out1[i], &out2[i]);                              \
+  }
+
+CreateFusedBatch(sincos, FP128, FP128)
+CreateFusedBatch(sinhcosh, FP128, FP128)
+CreateFusedBatch(csincos, COMPLEX_FP128, COMPLEX_FP128)
+#undef CreateFusedBatch
+
 // Constants
 // I have no idea why there is the inconsistency in naming between these
 // constants which have the type at the front, and the others which have the
@@ -276,6 +737,22 @@ FOREACH_TERNARY_FUNCTION(CreateTernaryShim)
 // Properties of the type
 // Since the whole point is that this header is giving us IEEE 128b float we can
 // put the actual values in here and not bother to delegate.
+#if (PFP128_IS_DD)
+// Except that double-double is not IEEE 128b float! It has roughly twice
+// double's precision, but only double's exponent range. FP128_MIN is the
+// smallest value for which the low part is still a normal double.
+#define FP128_MAX PFP128_DD_MAKE(DBL_MAX, 0x1.fffffffffffffp+969)
+#define FP128_MIN PFP128_DD_MAKE(0x1p-969, 0.0)
+#define FP128_EPSILON PFP128_DD_MAKE(0x1p-104, 0.0)
+#define FP128_DENORM_MIN PFP128_DD_MAKE(0x1p-1074, 0.0)
+#define FP128_MANT_DIG 106
+#define FP128_MIN_EXP (-968)
+#define FP128_MAX_EXP 1024
+#define FP128_DIG 31
+#define FP128_MIN_10_EXP (-291)
+#define FP128_MAX_10_EXP 308
+#define HUGE_VALFP128 HUGE_VALdd
+#else
 #define FP128_MAX FP128_CONST(1.18973149535723176508575932662800702e4932)
 #define FP128_MIN FP128_CONST(3.36210314311209350626267781732175260e-4932)
 #define FP128_EPSILON FP128_CONST(1.92592994438723585305597794258492732e-34)
@@ -287,7 +764,8 @@ FOREACH_TERNARY_FUNCTION(CreateTernaryShim)
 #define FP128_DIG 33
 #define FP128_MIN_10_EXP (-4931)
 #define FP128_MAX_10_EXP 4932
-#define HUGE_VALFP128 FP128Name(HUGE_VAL)
+#define HUGE_VALFP128 ((FP128)HUGE_VAL)
+#endif
 
 // Properties of mathematics; we delegate here just for simplicity.
 #define M_E_FP128 FP128_CONST(2.718281828459045235360287471352662498) /* e */
@@ -319,11 +797,35 @@ FOREACH_TERNARY_FUNCTION(CreateTernaryShim)
 // Cleanliness
 #undef FP128_IS_LONGDOUBLE
 #undef FP128Name
+#if (!PFP128_KEEP_FUNCTION_LISTS)
 #undef FOREACH_UNARY_FUNCTION
 #undef FOREACH_BINARY_FUNCTION
+#undef FOREACH_BINARY_VALUE_FUNCTION
+#undef FOREACH_BINARY_POINTER_FUNCTION
 #undef FOREACH_TERNARY_FUNCTION
+#undef FOREACH_TERNARY_VALUE_FUNCTION
+#undef FOREACH_TERNARY_POINTER_FUNCTION
+#endif
 #undef CreateUnaryShim
 #undef CreateBinaryShim
 #undef CreateTernaryShim
+#undef CreateUnaryBatch
+#undef CreateBinaryBatch
+#undef CreateTernaryBatch
+#undef CreateBinaryPointerBatch
+#undef CreateTernaryPointerBatch
+#if (!PFP128_KEEP_FUNCTION_LISTS)
+#undef FOREACH_ARITHMETIC_OPERATOR
+#undef FOREACH_COMPARISON_OPERATOR
+#endif
+#undef CreateArithmeticShim
+#undef CreateComparisonShim
+#undef PFP128_USE_SOFT_ARITHMETIC
+#undef CreateArithmeticBatch
+#undef PFP128_BACKEND_ID_NATIVE
+#undef PFP128_BACKEND_ID_DD
+#undef PFP128_BACKEND_ID_
+#undef PFP128_BACKEND_ID
+#undef PFP128_PARALLEL_LOOP
 
 #endif // Header monotonicity
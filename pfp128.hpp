@@ -0,0 +1,287 @@
+//===-- pfp128.hpp - C++ value class for FP128 ---------------*- C++ -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * A C++ value type, pfp128::fp128, wrapping whichever FP128 pfp128.h has
+ * chosen, with the usual operators, all of pfp128.h's functions as overloads
+ * with the <cmath> names (pfp128::sin, pfp128::fma, ...; argument dependent
+ * lookup finds them, so plain sin(x) works), and std::numeric_limits.
+ *
+ * A product is not rounded until we know what's done with it, so that
+ *   a * b + c,  c + a * b,  a * b - c,  a * b + c * d,  a * b - c * d
+ * and "sum += a[i] * b[i]" each become a single fmaFP128 (with the other
+ * product, if there is one, rounded first). That's one rounding and one
+ * call fewer than doing the multiply and add separately. (With the native
+ * backend the fused operations use pfp128_soft.h's fmasq.) The product is an
+ * expression object (pfp128::fp128_product) which turns into an fp128
+ * wherever one is needed, so the only thing to beware of is
+ *   auto p = a * b;
+ * which keeps the unevaluated product rather than an fp128.
+ *
+ * This needs the function lists from pfp128.h, which pfp128.h removes
+ * unless PFP128_KEEP_FUNCTION_LISTS is 1. So include pfp128.hpp before any
+ * direct include of pfp128.h (it defines the macro itself), or else define
+ * PFP128_KEEP_FUNCTION_LISTS to 1 before the first include of pfp128.h.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_HPP_INCLUDED_))
+#define _PFP128_HPP_INCLUDED_ 1
+
+#if (!defined(PFP128_KEEP_FUNCTION_LISTS))
+#define PFP128_KEEP_FUNCTION_LISTS 1
+#endif
+#include "pfp128.h"
+#if (!defined(FOREACH_UNARY_FUNCTION))
+#error pfp128.hpp needs pfp128.h included with PFP128_KEEP_FUNCTION_LISTS
+#endif
+
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+#if (!PFP128_IS_DD && defined(__SIZEOF_INT128__) &&                           \
+     (defined(__x86_64__) || LDBL_MANT_DIG == 113))
+#include "pfp128_soft.h"
+#define PFP128_HPP_SOFT_FMA 1
+#endif
+
+namespace pfp128 {
+
+// libquadmath's fmaq is very slow (about 1us on x86_64, against 40ns for a
+// multiply and an add), so when FP128 is binary128 we use pfp128_soft.h's
+// fmasq, which is also correctly rounded, and faster than the multiply and
+// add. This hides the C fmaFP128 from everything in the namespace.
+#if (PFP128_HPP_SOFT_FMA)
+inline FP128 fmaFP128(FP128 a, FP128 b, FP128 c) {
+  return FP128_from_sq(fmasq(FP128_to_sq(a), FP128_to_sq(b), FP128_to_sq(c)));
+}
+#else
+using ::fmaFP128;
+#endif
+
+struct fp128_product;
+
+class fp128 {
+public:
+  FP128 v;
+
+  fp128() = default;
+  constexpr fp128(FP128 x) : v(x) {}
+  fp128(double d) : v(FP128_from_double(d)) {}
+  fp128(float f) : v(FP128_from_double(f)) {}
+  // long double may have more bits than double (it has 64 on x86_64), so
+  // convert it in two parts.
+  fp128(long double x) {
+    double hi = (double)x;
+    v = addFP128(FP128_from_double(hi), FP128_from_double((double)(x - hi)));
+  }
+  template <typename T,
+            typename std::enable_if<
+                std::is_integral<T>::value && std::is_signed<T>::value,
+                int>::type = 0>
+  fp128(T i) : v(FP128_from_ll((long long)i)) {}
+  // Unsigned values may not fit in a long long, so convert the two 32 bit
+  // halves, each exactly, and add them (which is exact too).
+  template <typename T,
+            typename std::enable_if<
+                std::is_integral<T>::value && std::is_unsigned<T>::value,
+                int>::type = 0>
+  fp128(T i) {
+    unsigned long long u = i;
+    v = addFP128(FP128_from_double((double)(u >> 32) * 0x1p32),
+                 FP128_from_double((double)(u & 0xffffffffu)));
+  }
+
+  explicit operator double() const { return FP128_to_double(v); }
+  explicit operator long long() const { return FP128_to_ll(v); }
+  constexpr FP128 value() const { return v; }
+
+  fp128 &operator+=(fp128 x) { return *this = addFP128(v, x.v); }
+  fp128 &operator-=(fp128 x) { return *this = subFP128(v, x.v); }
+  fp128 &operator*=(fp128 x) { return *this = mulFP128(v, x.v); }
+  fp128 &operator/=(fp128 x) { return *this = divFP128(v, x.v); }
+  inline fp128 &operator+=(fp128_product const &p);
+  inline fp128 &operator-=(fp128_product const &p);
+};
+
+static_assert(sizeof(fp128) == sizeof(FP128), "fp128 should be just an FP128");
+
+// a * b, not yet rounded.
+struct fp128_product {
+  fp128 a, b;
+  operator fp128() const { return mulFP128(a.v, b.v); }
+};
+
+inline fp128 operator+(fp128 x) { return x; }
+inline fp128 operator-(fp128 x) { return negFP128(x.v); }
+inline fp128 operator+(fp128 x, fp128 y) { return addFP128(x.v, y.v); }
+inline fp128 operator-(fp128 x, fp128 y) { return subFP128(x.v, y.v); }
+inline fp128 operator/(fp128 x, fp128 y) { return divFP128(x.v, y.v); }
+inline fp128_product operator*(fp128 x, fp128 y) { return {x, y}; }
+
+// Fusing the products into the additions. Negating one of the factors is
+// exact, so -(a * b) is still a product.
+inline fp128_product operator-(fp128_product const &p) { return {-p.a, p.b}; }
+inline fp128 operator+(fp128_product const &p, fp128 c) {
+  return fmaFP128(p.a.v, p.b.v, c.v);
+}
+inline fp128 operator+(fp128 c, fp128_product const &p) {
+  return fmaFP128(p.a.v, p.b.v, c.v);
+}
+inline fp128 operator-(fp128_product const &p, fp128 c) {
+  return fmaFP128(p.a.v, p.b.v, negFP128(c.v));
+}
+inline fp128 operator-(fp128 c, fp128_product const &p) {
+  return fmaFP128(negFP128(p.a.v), p.b.v, c.v);
+}
+inline fp128 operator+(fp128_product const &p, fp128_product const &q) {
+  return p + fp128(q);
+}
+inline fp128 operator-(fp128_product const &p, fp128_product const &q) {
+  return p - fp128(q);
+}
+// A product of three or more rounds all but the last.
+inline fp128_product operator*(fp128_product const &p, fp128 x) {
+  return {fp128(p), x};
+}
+inline fp128_product operator*(fp128 x, fp128_product const &p) {
+  return {x, fp128(p)};
+}
+inline fp128_product operator*(fp128_product const &p,
+                               fp128_product const &q) {
+  return {fp128(p), fp128(q)};
+}
+
+inline fp128 &fp128::operator+=(fp128_product const &p) {
+  return *this = p + *this;
+}
+inline fp128 &fp128::operator-=(fp128_product const &p) {
+  return *this = *this - p;
+}
+
+inline bool operator==(fp128 x, fp128 y) { return eqFP128(x.v, y.v); }
+inline bool operator!=(fp128 x, fp128 y) { return neFP128(x.v, y.v); }
+inline bool operator<(fp128 x, fp128 y) { return ltFP128(x.v, y.v); }
+inline bool operator<=(fp128 x, fp128 y) { return leFP128(x.v, y.v); }
+inline bool operator>(fp128 x, fp128 y) { return gtFP128(x.v, y.v); }
+inline bool operator>=(fp128 x, fp128 y) { return geFP128(x.v, y.v); }
+
+inline bool isnan(fp128 x) { return isnanFP128(x.v); }
+inline bool isinf(fp128 x) { return isinfFP128(x.v); }
+inline bool isfinite(fp128 x) { return isfiniteFP128(x.v); }
+inline bool signbit(fp128 x) { return signbitFP128(x.v); }
+
+// The functions take and return fp128 where the C functions have FP128
+// (and fp128 * for FP128 *), and leave the other types alone.
+namespace detail {
+template <typename T> struct wrap {
+  typedef T type;
+};
+template <> struct wrap<FP128> {
+  typedef fp128 type;
+};
+template <> struct wrap<FP128 *> {
+  typedef fp128 *type;
+};
+inline FP128 unwrap(fp128 x) { return x.v; }
+inline FP128 *unwrap(fp128 *p) { return p ? &p->v : nullptr; }
+template <typename T> inline T unwrap(T x) { return x; }
+} // namespace detail
+
+// clang-format off
+#define CreateUnaryOverload(basename, restype, at1)                     \
+inline detail::wrap<restype>::type basename(                            \
+    detail::wrap<at1>::type arg1) {                                     \
+  return basename ## FP128(detail::unwrap(arg1));                       \
+}
+#define CreateBinaryOverload(basename, restype, at1, at2)               \
+inline detail::wrap<restype>::type basename(                            \
+    detail::wrap<at1>::type arg1, detail::wrap<at2>::type arg2) {       \
+  return basename ## FP128(detail::unwrap(arg1), detail::unwrap(arg2)); \
+}
+#define CreateTernaryOverload(basename, restype, at1, at2, at3)         \
+inline detail::wrap<restype>::type basename(                            \
+    detail::wrap<at1>::type arg1, detail::wrap<at2>::type arg2,         \
+    detail::wrap<at3>::type arg3) {                                     \
+  return basename ## FP128(detail::unwrap(arg1), detail::unwrap(arg2),  \
+                           detail::unwrap(arg3));                       \
+}
+
+FOREACH_UNARY_FUNCTION(CreateUnaryOverload)
+FOREACH_BINARY_FUNCTION(CreateBinaryOverload)
+FOREACH_TERNARY_FUNCTION(CreateTernaryOverload)
+
+#undef CreateUnaryOverload
+#undef CreateBinaryOverload
+#undef CreateTernaryOverload
+// clang-format on
+
+inline fp128 abs(fp128 x) { return fabsFP128(x.v); }
+
+// The fused functions, which return both results through pointers.
+inline void sincos(fp128 x, fp128 *s, fp128 *c) {
+  sincosFP128(x.v, &s->v, &c->v);
+}
+inline void sinhcosh(fp128 x, fp128 *sh, fp128 *ch) {
+  sinhcoshFP128(x.v, &sh->v, &ch->v);
+}
+inline void csincos(COMPLEX_FP128 z, COMPLEX_FP128 *s, COMPLEX_FP128 *c) {
+  csincosFP128(z, s, c);
+}
+
+inline std::ostream &operator<<(std::ostream &os, fp128 x) {
+  char buffer[64];
+  FP128_snprintf(buffer, sizeof(buffer), "%.*" FP128_FMT_TAG "g",
+                 (int)os.precision(), x.v);
+  return os << buffer;
+}
+
+} // namespace pfp128
+
+namespace std {
+template <> class numeric_limits<pfp128::fp128> {
+public:
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed = true;
+  static constexpr bool is_integer = false;
+  static constexpr bool is_exact = false;
+  static constexpr bool has_infinity = true;
+  static constexpr bool has_quiet_NaN = true;
+  static constexpr bool has_signaling_NaN = false;
+  static constexpr float_denorm_style has_denorm = denorm_present;
+  static constexpr bool has_denorm_loss = false;
+  static constexpr float_round_style round_style = round_to_nearest;
+  static constexpr bool is_iec559 = !PFP128_IS_DD;
+  static constexpr bool is_bounded = true;
+  static constexpr bool is_modulo = false;
+  static constexpr int digits = FP128_MANT_DIG;
+  static constexpr int digits10 = FP128_DIG;
+  // ceil(1 + digits * log10(2))
+  static constexpr int max_digits10 = PFP128_IS_DD ? 33 : 36;
+  static constexpr int radix = 2;
+  static constexpr int min_exponent = FP128_MIN_EXP;
+  static constexpr int min_exponent10 = FP128_MIN_10_EXP;
+  static constexpr int max_exponent = FP128_MAX_EXP;
+  static constexpr int max_exponent10 = FP128_MAX_10_EXP;
+  static constexpr bool traps = false;
+  static constexpr bool tinyness_before = false;
+
+  static pfp128::fp128 min() noexcept { return FP128_MIN; }
+  static pfp128::fp128 max() noexcept { return FP128_MAX; }
+  static pfp128::fp128 lowest() noexcept { return negFP128(FP128_MAX); }
+  static pfp128::fp128 epsilon() noexcept { return FP128_EPSILON; }
+  static pfp128::fp128 round_error() noexcept { return 0.5; }
+  static pfp128::fp128 infinity() noexcept { return HUGE_VALFP128; }
+  static pfp128::fp128 quiet_NaN() noexcept {
+    return subFP128(HUGE_VALFP128, HUGE_VALFP128);
+  }
+  static pfp128::fp128 signaling_NaN() noexcept { return quiet_NaN(); }
+  static pfp128::fp128 denorm_min() noexcept { return FP128_DENORM_MIN; }
+};
+} // namespace std
+
+#endif // Header monotonicity
@@ -0,0 +1,282 @@
+//===-- pfp128_acc.h - Exact accumulation of FP128 values ----*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * An exact accumulator for sums of FP128 (and double) values, so that sums
+ * can be computed in parallel with a result which doesn't depend on the
+ * number of threads or the order in which the values are added.
+ *
+ * An FP128_ACC is a fixed point number (Kulisch's "long accumulator") wide
+ * enough to hold any binary128 value, from the smallest subnormal, 2^-16494,
+ * to beyond the largest, with 146 bits to spare for carries. Adding a value
+ * to it is exact, so the sum is the exact sum however it was computed, and
+ * is only rounded (correctly, to nearest even) by FP128_acc_round.
+ *
+ *   FP128_ACC acc;
+ *   FP128_acc_init(&acc);
+ *   FP128_acc_add(&acc, v);           // or FP128_acc_add_n(&acc, x, n),
+ *                                     // or FP128_acc_add_d(&acc, d)
+ *   FP128_acc_merge(&acc, &other);    // acc += other
+ *   FP128 sum = FP128_acc_round(&acc);
+ *
+ * The usual pattern is for each thread to accumulate its share of the
+ * values in its own FP128_ACC, and then to merge them, in any order.
+ *
+ * The number is held as 32 bit digits in 64 bit words, so that adding a
+ * value just adds to (or subtracts from) five words, without propagating
+ * carries; the carries are propagated ("normalised") every 2^30 additions,
+ * and when the value is rounded. An accumulator is about 8KB.
+ *
+ * Infinities and NaNs are remembered separately, and give the same result
+ * as IEEE addition: NaN if there were any NaNs, or infinities of both signs,
+ * otherwise the infinity. An exact zero sum is +0. With the double-double
+ * backend both parts of each value are added, and the result is the
+ * correctly rounded double-double (other than for results close to the
+ * bottom of double's range).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_ACC_H_INCLUDED_))
+#define _PFP128_ACC_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_soft.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_acc.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+// Digit d has weight 2^(32 * d - PFP128_ACC_BIAS), so the least significant
+// bit is that of the smallest binary128 subnormal, and binary128's largest
+// finite value is in digit 1027.
+#define PFP128_ACC_DIGITS 1032
+#define PFP128_ACC_BIAS 16494
+// Normalise once the digits could be this many times 2^32 (leaving plenty
+// of room before int64_t overflows).
+#define PFP128_ACC_MAX_PENDING (1u << 30)
+
+typedef struct {
+  int64_t digit[PFP128_ACC_DIGITS];
+  // A bound on the magnitude of the digits, in units of 2^32.
+  uint32_t pending;
+  // Non-zero if there have been NaNs, +infinities or -infinities.
+  int nan, posInf, negInf;
+} FP128_ACC;
+
+static inline void FP128_acc_init(FP128_ACC *acc) {
+  memset(acc, 0, sizeof(*acc));
+  acc->pending = 1;
+}
+
+// Propagate the carries, so that all of the digits other than the top one
+// are in [0, 2^32). The top one holds the sign.
+static inline void pfp128_acc_normalise(FP128_ACC *acc) {
+  int64_t carry = 0;
+  for (int d = 0; d < PFP128_ACC_DIGITS - 1; d++) {
+    int64_t v = acc->digit[d] + carry;
+    acc->digit[d] = v & 0xffffffff;
+    carry = v >> 32; // (Arithmetic shift, so this is floor(v / 2^32).)
+  }
+  acc->digit[PFP128_ACC_DIGITS - 1] += carry;
+  acc->pending = 1;
+}
+
+// Add (or subtract, if negative) sig * 2^(pos - PFP128_ACC_BIAS), where sig
+// has at most 113 bits.
+static inline void pfp128_acc_add_bits(FP128_ACC *acc, int negative,
+                                       sq_u128 sig, int pos) {
+  if (acc->pending >= PFP128_ACC_MAX_PENDING)
+    pfp128_acc_normalise(acc);
+  acc->pending++;
+  int d = pos >> 5, shift = pos & 31;
+  sq_u128 low = sig << shift;
+  uint64_t high = shift ? (uint64_t)(sig >> (128 - shift)) : 0;
+  int64_t parts[5] = {(int64_t)(uint32_t)low, (int64_t)(uint32_t)(low >> 32),
+                      (int64_t)(uint32_t)(low >> 64),
+                      (int64_t)(uint32_t)(low >> 96), (int64_t)high};
+  // Conditionally negate without a branch, since the signs are random.
+  int64_t mask = -(int64_t)(negative != 0);
+  for (int i = 0; i < 5; i++)
+    acc->digit[d + i] += (parts[i] ^ mask) - mask;
+}
+
+static inline void FP128_acc_add_d(FP128_ACC *acc, double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  int exp = (int)(bits >> 52) & 0x7ff;
+  uint64_t sig = bits & ((1ull << 52) - 1);
+  if (exp == 0x7ff) {
+    if (sig)
+      acc->nan = 1;
+    else if (bits >> 63)
+      acc->negInf = 1;
+    else
+      acc->posInf = 1;
+    return;
+  }
+  if (exp == 0) {
+    if (!sig)
+      return;
+    exp = 1;
+  } else {
+    sig |= 1ull << 52;
+  }
+  // v = sig * 2^(exp - 1075).
+  pfp128_acc_add_bits(acc, (int)(bits >> 63), sig,
+                      exp - 1075 + PFP128_ACC_BIAS);
+}
+
+static inline void FP128_acc_add(FP128_ACC *acc, FP128 v) {
+#if (PFP128_IS_DD)
+  FP128_acc_add_d(acc, v.hi);
+  if (isfinite(v.hi))
+    FP128_acc_add_d(acc, v.lo);
+#else
+  sq_u128 bits = FP128_to_sq(v).bits;
+  int exp = (int)(bits >> 112) & SQ_EXP_MAX;
+  sq_u128 sig = bits & SQ_MANT_MASK;
+  if (exp == SQ_EXP_MAX) {
+    if (sig)
+      acc->nan = 1;
+    else if (bits >> 127)
+      acc->negInf = 1;
+    else
+      acc->posInf = 1;
+    return;
+  }
+  if (exp == 0) {
+    if (!sig)
+      return;
+    exp = 1;
+  } else {
+    sig |= SQ_IMPLICIT_BIT;
+  }
+  // v = sig * 2^(exp - 16383 - 112), and 16383 + 112 = PFP128_ACC_BIAS - 1.
+  pfp128_acc_add_bits(acc, (int)(bits >> 127), sig, exp - 1);
+#endif
+}
+
+static inline void FP128_acc_add_n(FP128_ACC *acc, FP128 const *x, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    FP128_acc_add(acc, x[i]);
+}
+
+// acc += other.
+static inline void FP128_acc_merge(FP128_ACC *acc, FP128_ACC const *other) {
+  if (acc->pending + other->pending >= PFP128_ACC_MAX_PENDING)
+    pfp128_acc_normalise(acc);
+  for (int d = 0; d < PFP128_ACC_DIGITS; d++)
+    acc->digit[d] += other->digit[d];
+  acc->pending += other->pending;
+  acc->nan |= other->nan;
+  acc->posInf |= other->posInf;
+  acc->negInf |= other->negInf;
+}
+
+// Negate a normalised accumulator (leaving it normalised).
+static inline void pfp128_acc_negate(FP128_ACC *acc) {
+  for (int d = 0; d < PFP128_ACC_DIGITS; d++)
+    acc->digit[d] = -acc->digit[d];
+  pfp128_acc_normalise(acc);
+}
+
+// The position of the most significant bit of a normalised, non-negative,
+// accumulator, or -1 if it's zero.
+static inline int pfp128_acc_top(FP128_ACC const *acc) {
+  for (int d = PFP128_ACC_DIGITS - 1; d >= 0; d--)
+    if (acc->digit[d])
+      return 32 * d + 63 - __builtin_clzll((uint64_t)acc->digit[d]);
+  return -1;
+}
+
+// Bits [pos, pos + 128) of a normalised, non-negative, accumulator (pos may
+// be negative), with the lowest bit set if any of the bits below them are.
+static inline sq_u128 pfp128_acc_bits(FP128_ACC const *acc, int pos) {
+  sq_u128 r = 0;
+  int sticky = 0;
+  for (int d = 0; d < PFP128_ACC_DIGITS; d++) {
+    int shift = 32 * d - pos;
+    sq_u128 v = (sq_u128)(uint64_t)acc->digit[d];
+    if (shift <= -32)
+      sticky |= v != 0;
+    else if (shift < 0)
+      r |= v >> -shift, sticky |= (v << (128 + shift)) != 0;
+    else if (shift < 128)
+      r |= v << shift;
+  }
+  return r | (sq_u128)sticky;
+}
+
+#if (PFP128_IS_DD)
+// The magnitude of a normalised, non-negative, accumulator, correctly
+// rounded to double (other than for subnormal results).
+static inline double pfp128_acc_round_double(FP128_ACC const *acc) {
+  int top = pfp128_acc_top(acc);
+  if (top < 0)
+    return 0.0;
+  // The top 63 bits, with a sticky bit, convert to double with the right
+  // rounding.
+  uint64_t bits = (uint64_t)(pfp128_acc_bits(acc, top - 62) & ~(uint64_t)0);
+  return ldexp((double)bits, top - 62 - PFP128_ACC_BIAS);
+}
+#endif
+
+// Round the sum to FP128 (which normalises the accumulator, but doesn't
+// change its value).
+static inline FP128 FP128_acc_round(FP128_ACC *acc) {
+  if (acc->nan || (acc->posInf && acc->negInf))
+    return FP128_from_sq(sq_make(SQ_DEFAULT_NAN_BITS));
+  if (acc->posInf || acc->negInf)
+    return FP128_from_sq(
+        sq_make(SQ_INF_BITS | (acc->negInf ? SQ_SIGN_BIT : 0)));
+  pfp128_acc_normalise(acc);
+  int negative = acc->digit[PFP128_ACC_DIGITS - 1] < 0;
+  if (negative)
+    pfp128_acc_negate(acc);
+#if (PFP128_IS_DD)
+  // The high part, then the low part by rounding what's left.
+  double hi = pfp128_acc_round_double(acc), lo = 0.0;
+  if (isfinite(hi)) {
+    FP128_acc_add_d(acc, -hi);
+    pfp128_acc_normalise(acc);
+    int loNegative = acc->digit[PFP128_ACC_DIGITS - 1] < 0;
+    if (loNegative)
+      pfp128_acc_negate(acc);
+    lo = pfp128_acc_round_double(acc);
+    if (loNegative) {
+      lo = -lo;
+      pfp128_acc_negate(acc);
+    }
+    FP128_acc_add_d(acc, hi);
+    pfp128_acc_normalise(acc);
+  }
+  FP128 r = negative ? dd_make(-hi, -lo) : dd_make(hi, lo);
+#else
+  int top = pfp128_acc_top(acc);
+  FP128SQ r = sq_make(0);
+  if (top >= 0) {
+    // The top 116 bits, so the leading one is at bit 115, as sq_round_pack
+    // wants, with a sticky bit.
+    sq_u128 sig = pfp128_acc_bits(acc, top - 115);
+    r = sq_round_pack(negative ? SQ_SIGN_BIT : 0,
+                      top - PFP128_ACC_BIAS + SQ_BIAS, sig);
+  }
+#endif
+  if (negative)
+    pfp128_acc_negate(acc);
+#if (PFP128_IS_DD)
+  return r;
+#else
+  return FP128_from_sq(r);
+#endif
+}
+
+#endif // Header monotonicity
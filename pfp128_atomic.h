@@ -0,0 +1,238 @@
+//===-- pfp128_atomic.h - Atomic operations on FP128 values --*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Lock-free atomic updates of FP128 values in memory, so that many threads
+ * can add into shared bins (e.g. of a histogram) without a mutex.
+ *
+ *   FP128 old = atomicAddFP128(&bin, v);   // bin += v, returning the old bin
+ *   atomicMinFP128(&lo, v);                // lo = fmin(lo, v)
+ *   atomicMaxFP128(&hi, v);                // hi = fmax(hi, v)
+ *   atomicCompareExchangeFP128(&slot, &expected, desired);
+ *   FP128 now = atomicLoadFP128(&bin);
+ *   atomicStoreFP128(&bin, v);
+ *
+ * They are all built on a 16 byte compare-and-swap: cmpxchg16b on x86_64,
+ * and CASP (if the target has the LSE atomics, e.g. -march=armv8.1-a) or an
+ * LDAXP/STLXP loop on AArch64. Elsewhere we use the compiler's 16 byte
+ * __atomic builtins, which may need -latomic, and may use a lock. All of
+ * the operations are sequentially consistent.
+ *
+ * The values must be 16 byte aligned. __float128 always is, but the
+ * double-double FP128 is only 8 byte aligned, so declare shared values with
+ * PFP128_ATOMIC_ALIGN (e.g. "FP128 PFP128_ATOMIC_ALIGN bins[64];") or
+ * allocate them with aligned_alloc. Since x86_64 needs write access for a
+ * 16 byte atomic read, atomicLoadFP128 can't be used on read-only memory.
+ *
+ * When every thread is adding into the same value the cache line holding
+ * it becomes the bottleneck, however it's updated. FP128_STRIPED spreads
+ * the additions over PFP128_ATOMIC_STRIPES values, each in its own cache
+ * line, chosen by a hint such as the thread number:
+ *
+ *   FP128_STRIPED total;
+ *   FP128_striped_init(&total);
+ *   FP128_striped_add(&total, omp_get_thread_num(), v);
+ *   FP128 sum = FP128_striped_sum(&total);
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_ATOMIC_H_INCLUDED_))
+#define _PFP128_ATOMIC_H_INCLUDED_ 1
+
+#include "pfp128.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if (!defined(__SIZEOF_INT128__))
+#error pfp128_atomic.h needs a compiler with unsigned __int128.
+#endif
+_Static_assert(sizeof(FP128) == 16, "pfp128_atomic.h needs a 16 byte FP128");
+
+#define PFP128_ATOMIC_ALIGN __attribute__((aligned(16)))
+
+typedef unsigned __int128 pfp128_atomic_u128;
+
+static inline pfp128_atomic_u128 pfp128_atomic_bits(FP128 v) {
+  pfp128_atomic_u128 bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+static inline FP128 pfp128_atomic_value(pfp128_atomic_u128 bits) {
+  FP128 v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// If *p == *expected, set *p = desired and return 1; otherwise set
+// *expected = *p and return 0.
+static inline int pfp128_atomic_cas(pfp128_atomic_u128 *p,
+                                    pfp128_atomic_u128 *expected,
+                                    pfp128_atomic_u128 desired) {
+#if (defined(__x86_64__))
+  uint64_t lo = (uint64_t)*expected, hi = (uint64_t)(*expected >> 64);
+  unsigned char ok;
+  __asm__ __volatile__("lock cmpxchg16b %1\n\tsete %0"
+                       : "=q"(ok), "+m"(*p), "+a"(lo), "+d"(hi)
+                       : "b"((uint64_t)desired), "c"((uint64_t)(desired >> 64))
+                       : "memory", "cc");
+  *expected = ((pfp128_atomic_u128)hi << 64) | lo;
+  return ok;
+#elif (defined(__aarch64__) && defined(__ARM_FEATURE_ATOMICS) &&             \
+       !defined(__AARCH64EB__))
+  // CASP needs even/odd register pairs, so we have to choose them.
+  uint64_t oldLo = (uint64_t)*expected, oldHi = (uint64_t)(*expected >> 64);
+  register uint64_t x0 __asm__("x0") = oldLo;
+  register uint64_t x1 __asm__("x1") = oldHi;
+  register uint64_t x2 __asm__("x2") = (uint64_t)desired;
+  register uint64_t x3 __asm__("x3") = (uint64_t)(desired >> 64);
+  __asm__ __volatile__("caspal x0, x1, x2, x3, %2"
+                       : "+r"(x0), "+r"(x1), "+Q"(*p)
+                       : "r"(x2), "r"(x3)
+                       : "memory");
+  *expected = ((pfp128_atomic_u128)x1 << 64) | x0;
+  return x0 == oldLo && x1 == oldHi;
+#elif (defined(__aarch64__) && !defined(__AARCH64EB__))
+  // A pair of exclusive loads is only atomic if the matching store
+  // succeeds, so when the comparison fails we store back what we loaded
+  // (as the compilers do), to be sure that what we return wasn't torn.
+  uint64_t oldLo = (uint64_t)*expected, oldHi = (uint64_t)(*expected >> 64);
+  uint64_t lo, hi;
+  uint32_t failed;
+  __asm__ __volatile__("1:\n\t"
+                       "ldaxp %0, %1, %3\n\t"
+                       "cmp %0, %4\n\t"
+                       "ccmp %1, %5, #0, eq\n\t"
+                       "b.ne 2f\n\t"
+                       "stlxp %w2, %6, %7, %3\n\t"
+                       "cbnz %w2, 1b\n\t"
+                       "b 3f\n"
+                       "2:\n\t"
+                       "stlxp %w2, %0, %1, %3\n\t"
+                       "cbnz %w2, 1b\n"
+                       "3:"
+                       : "=&r"(lo), "=&r"(hi), "=&r"(failed), "+Q"(*p)
+                       : "r"(oldLo), "r"(oldHi), "r"((uint64_t)desired),
+                         "r"((uint64_t)(desired >> 64))
+                       : "memory", "cc");
+  *expected = ((pfp128_atomic_u128)hi << 64) | lo;
+  return lo == oldLo && hi == oldHi;
+#else
+  return __atomic_compare_exchange_n(p, expected, desired, 0, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST);
+#endif
+}
+
+// A first guess at the value in *p, for a compare-and-swap loop to check:
+// the halves are read atomically, but not necessarily together.
+static inline pfp128_atomic_u128 pfp128_atomic_guess(FP128 *p) {
+  uint64_t const *half = (uint64_t const *)p;
+  uint64_t first = __atomic_load_n(&half[0], __ATOMIC_RELAXED);
+  uint64_t second = __atomic_load_n(&half[1], __ATOMIC_RELAXED);
+  return ((pfp128_atomic_u128)second << 64) | first;
+}
+
+// If *p is bitwise equal to *expected set it to desired and return 1,
+// otherwise set *expected to *p and return 0. (So, as with C11's
+// atomic_compare_exchange_strong, -0 doesn't match +0, and a NaN matches
+// the same NaN.)
+static inline int atomicCompareExchangeFP128(FP128 *p, FP128 *expected,
+                                             FP128 desired) {
+  pfp128_atomic_u128 old = pfp128_atomic_bits(*expected);
+  int ok = pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old,
+                             pfp128_atomic_bits(desired));
+  *expected = pfp128_atomic_value(old);
+  return ok;
+}
+
+static inline FP128 atomicLoadFP128(FP128 *p) {
+  pfp128_atomic_u128 old = pfp128_atomic_guess(p);
+  // Swapping the value for itself either succeeds, or tells us what it is.
+  pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old, old);
+  return pfp128_atomic_value(old);
+}
+
+static inline void atomicStoreFP128(FP128 *p, FP128 v) {
+  pfp128_atomic_u128 old = pfp128_atomic_guess(p);
+  while (!pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old,
+                            pfp128_atomic_bits(v)))
+    ;
+}
+
+// *p += v, returning the previous value of *p.
+static inline FP128 atomicAddFP128(FP128 *p, FP128 v) {
+  pfp128_atomic_u128 old = pfp128_atomic_guess(p);
+  while (!pfp128_atomic_cas(
+      (pfp128_atomic_u128 *)p, &old,
+      pfp128_atomic_bits(addFP128(pfp128_atomic_value(old), v))))
+    ;
+  return pfp128_atomic_value(old);
+}
+
+// *p = fminFP128(*p, v), returning the previous value of *p.
+static inline FP128 atomicMinFP128(FP128 *p, FP128 v) {
+  pfp128_atomic_u128 old = pfp128_atomic_guess(p);
+  for (;;) {
+    FP128 current = pfp128_atomic_value(old);
+    if (isnanFP128(v) || (!isnanFP128(current) && !ltFP128(v, current))) {
+      // The guess may have been torn, so check it.
+      if (pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old, old))
+        return current;
+    } else if (pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old,
+                                 pfp128_atomic_bits(v))) {
+      return current;
+    }
+  }
+}
+
+// *p = fmaxFP128(*p, v), returning the previous value of *p.
+static inline FP128 atomicMaxFP128(FP128 *p, FP128 v) {
+  pfp128_atomic_u128 old = pfp128_atomic_guess(p);
+  for (;;) {
+    FP128 current = pfp128_atomic_value(old);
+    if (isnanFP128(v) || (!isnanFP128(current) && !gtFP128(v, current))) {
+      if (pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old, old))
+        return current;
+    } else if (pfp128_atomic_cas((pfp128_atomic_u128 *)p, &old,
+                                 pfp128_atomic_bits(v))) {
+      return current;
+    }
+  }
+}
+
+#if (!defined(PFP128_ATOMIC_STRIPES))
+#define PFP128_ATOMIC_STRIPES 16
+#endif
+
+typedef struct {
+  struct {
+    FP128 value;
+    char padding[64 - sizeof(FP128)];
+  } __attribute__((aligned(64))) stripe[PFP128_ATOMIC_STRIPES];
+} FP128_STRIPED;
+
+static inline void FP128_striped_init(FP128_STRIPED *s) {
+  for (int i = 0; i < PFP128_ATOMIC_STRIPES; i++)
+    s->stripe[i].value = FP128_from_double(0.0);
+}
+
+// Add v to the stripe chosen by hint (e.g. the thread number).
+static inline void FP128_striped_add(FP128_STRIPED *s, unsigned hint,
+                                     FP128 v) {
+  atomicAddFP128(&s->stripe[hint % PFP128_ATOMIC_STRIPES].value, v);
+}
+
+// The sum of the stripes. (This is only the final total once all of the
+// threads adding to it have finished.)
+static inline FP128 FP128_striped_sum(FP128_STRIPED *s) {
+  FP128 sum = atomicLoadFP128(&s->stripe[0].value);
+  for (int i = 1; i < PFP128_ATOMIC_STRIPES; i++)
+    sum = addFP128(sum, atomicLoadFP128(&s->stripe[i].value));
+  return sum;
+}
+
+#endif // Header monotonicity
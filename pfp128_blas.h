@@ -0,0 +1,433 @@
+//===-- pfp128_blas.h - Dense linear algebra in FP128 ---------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * A subset of the BLAS for FP128, with the usual arguments, other than that
+ * matrices are row-major (element (i, j) of A is A[i * lda + j]):
+ *
+ *   FP128_dot(n, x, incx, y, incy)           x . y
+ *   FP128_nrm2(n, x, incx)                   ||x||
+ *   FP128_axpy(n, alpha, x, incx, y, incy)   y += alpha x
+ *   FP128_scal(n, alpha, x, incx)            x *= alpha
+ *   FP128_gemv(trans, m, n, alpha, A, lda, x, incx, beta, y, incy)
+ *                                            y = alpha op(A) x + beta y
+ *   FP128_trsv(uplo, trans, diag, n, A, lda, x, incx)
+ *                                            x = op(A)^-1 x
+ *   FP128_gemm(transA, transB, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc)
+ *                                            C = alpha op(A) op(B) + beta C
+ *   FP128_trsm(side, uplo, trans, diag, m, n, alpha, A, lda, B, ldb)
+ *                                            B = alpha op(A)^-1 B, or
+ *                                            B = alpha B op(A)^-1
+ *
+ * where op(A) is A or its transpose. As in the BLAS, a negative increment
+ * runs through the vector backwards, and if beta is zero C (or y) isn't
+ * read, so it needn't be initialised. FP128_gemm and FP128_trsm return -1
+ * if they can't allocate their packing buffers, otherwise 0.
+ *
+ * FP128_dot and FP128_nrm2 use pfp128_reduce.h, so are accurate to about
+ * an ulp. Everything else is built on one multiply-add, c + a * b, which
+ * is fmasq from pfp128_soft.h when FP128 is binary128 (rounding once, and
+ * faster than the libgcc multiply and add, which are calls), or a
+ * double-double multiply and add (much quicker than fmaFP128, whose
+ * extra care about overflow we don't need).
+ *
+ * Since each of those costs far more than a load, the point of the
+ * blocking is to keep the multiply-adds independent rather than to save
+ * memory traffic. FP128_gemm packs panels of op(A) (scaled by alpha) and
+ * op(B) into contiguous blocks, in the style of Goto and van de Geijn, and
+ * a micro-kernel updates a PFP128_BLAS_MR by PFP128_BLAS_NR block of C at
+ * once, whose multiply-adds can all be in flight together. FP128_gemv
+ * works on four rows at once in the same way, and FP128_trsm solves
+ * blocks of PFP128_BLAS_KC rows, updating the rest of B with FP128_gemm.
+ *
+ * With OpenMP the level 1 and 2 functions run in parallel once n (or m * n)
+ * reaches PFP128_OMP_THRESHOLD, as do FP128_gemm's blocks and FP128_trsm's
+ * columns (or rows).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_BLAS_H_INCLUDED_))
+#define _PFP128_BLAS_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_reduce.h"
+#include "pfp128_soft.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+typedef enum {
+  FP128_BLAS_NO_TRANS = 0,
+  FP128_BLAS_TRANS = 1
+} FP128_BLAS_TRANSPOSE;
+typedef enum { FP128_BLAS_UPPER = 0, FP128_BLAS_LOWER = 1 } FP128_BLAS_UPLO;
+typedef enum { FP128_BLAS_NON_UNIT = 0, FP128_BLAS_UNIT = 1 } FP128_BLAS_DIAG;
+typedef enum { FP128_BLAS_LEFT = 0, FP128_BLAS_RIGHT = 1 } FP128_BLAS_SIDE;
+
+// The micro-kernel's block of C, and the depth and height of the packed
+// panels.
+#if (!defined(PFP128_BLAS_MR))
+#define PFP128_BLAS_MR 4
+#endif
+#if (!defined(PFP128_BLAS_NR))
+#define PFP128_BLAS_NR 4
+#endif
+#if (!defined(PFP128_BLAS_KC))
+#define PFP128_BLAS_KC 256
+#endif
+#if (!defined(PFP128_BLAS_MC))
+#define PFP128_BLAS_MC 64
+#endif
+
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_BLAS_PRAGMA(x) _Pragma(#x)
+#define PFP128_BLAS_LOOP                                                       \
+  PFP128_BLAS_PRAGMA(omp parallel for schedule(static)                         \
+                     if (total >= PFP128_OMP_THRESHOLD))
+#define PFP128_BLAS_DYNAMIC_LOOP                                               \
+  PFP128_BLAS_PRAGMA(omp parallel for schedule(dynamic)                        \
+                     if (total >= PFP128_OMP_THRESHOLD))
+#else
+// (Without OpenMP the loops just use total, so that it isn't unused.)
+#define PFP128_BLAS_LOOP (void)total;
+#define PFP128_BLAS_DYNAMIC_LOOP (void)total;
+#endif
+
+// The arithmetic: pfp128_soft.h's with binary128, otherwise double-double's.
+static inline FP128 pfp128_blas_madd(FP128 c, FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return addFP128(c, mulFP128(a, b));
+#else
+  return FP128_from_sq(fmasq(FP128_to_sq(a), FP128_to_sq(b), FP128_to_sq(c)));
+#endif
+}
+
+static inline FP128 pfp128_blas_add(FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return addFP128(a, b);
+#else
+  return FP128_from_sq(addsq(FP128_to_sq(a), FP128_to_sq(b)));
+#endif
+}
+
+static inline FP128 pfp128_blas_mul(FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return mulFP128(a, b);
+#else
+  return FP128_from_sq(mulsq(FP128_to_sq(a), FP128_to_sq(b)));
+#endif
+}
+
+static inline FP128 pfp128_blas_div(FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return divFP128(a, b);
+#else
+  return FP128_from_sq(divsq(FP128_to_sq(a), FP128_to_sq(b)));
+#endif
+}
+
+static inline int pfp128_blas_is(FP128 a, double d) {
+  return eqFP128(a, FP128_from_double(d));
+}
+
+// Where a vector with a negative increment starts.
+static inline ptrdiff_t pfp128_blas_start(size_t n, ptrdiff_t inc) {
+  return inc < 0 ? (1 - (ptrdiff_t)n) * inc : 0;
+}
+
+// Level 1.
+static inline FP128 FP128_dot(size_t n, FP128 const *x, ptrdiff_t incx,
+                              FP128 const *y, ptrdiff_t incy) {
+  if (incx == 1 && incy == 1)
+    return dotFP128_n(x, y, n);
+  x += pfp128_blas_start(n, incx);
+  y += pfp128_blas_start(n, incy);
+  return pfp128_reduce_dot_strided(x, incx, y, incy, n);
+}
+
+static inline FP128 FP128_nrm2(size_t n, FP128 const *x, ptrdiff_t incx) {
+  if (incx == 1)
+    return normFP128_n(x, n);
+  x += pfp128_blas_start(n, incx);
+  return pfp128_reduce_norm_strided(x, incx, n);
+}
+
+static inline void FP128_axpy(size_t n, FP128 alpha, FP128 const *x,
+                              ptrdiff_t incx, FP128 *y, ptrdiff_t incy) {
+  if (pfp128_blas_is(alpha, 0.0))
+    return;
+  x += pfp128_blas_start(n, incx);
+  y += pfp128_blas_start(n, incy);
+  size_t total = n;
+  PFP128_BLAS_LOOP
+  for (size_t i = 0; i < n; i++) {
+    FP128 *yi = y + (ptrdiff_t)i * incy;
+    *yi = pfp128_blas_madd(*yi, alpha, x[(ptrdiff_t)i * incx]);
+  }
+}
+
+static inline void FP128_scal(size_t n, FP128 alpha, FP128 *x,
+                              ptrdiff_t incx) {
+  x += pfp128_blas_start(n, incx);
+  size_t total = n;
+  PFP128_BLAS_LOOP
+  for (size_t i = 0; i < n; i++)
+    x[(ptrdiff_t)i * incx] = pfp128_blas_mul(alpha, x[(ptrdiff_t)i * incx]);
+}
+
+// Level 2.
+// acc[t] += sum over j < n of a[t * ra + j * ca] * x[j * incx], for t < r
+// (<= 4). A single sum is split four ways so that it isn't one long chain
+// of dependent multiply-adds.
+static inline void pfp128_blas_dots(size_t r, size_t n, FP128 const *a,
+                                    ptrdiff_t ra, ptrdiff_t ca,
+                                    FP128 const *x, ptrdiff_t incx,
+                                    FP128 *acc) {
+  FP128 s[4];
+  size_t j = 0;
+  if (r == 1) {
+    FP128 zero = FP128_from_double(0.0);
+    s[0] = acc[0];
+    s[1] = s[2] = s[3] = zero;
+    for (; j + 4 <= n; j += 4)
+      for (int t = 0; t < 4; t++)
+        s[t] = pfp128_blas_madd(s[t], a[(ptrdiff_t)(j + t) * ca],
+                                x[(ptrdiff_t)(j + t) * incx]);
+    for (; j < n; j++)
+      s[0] = pfp128_blas_madd(s[0], a[(ptrdiff_t)j * ca],
+                              x[(ptrdiff_t)j * incx]);
+    acc[0] = pfp128_blas_add(pfp128_blas_add(s[0], s[1]),
+                             pfp128_blas_add(s[2], s[3]));
+    return;
+  }
+  for (size_t t = 0; t < r; t++)
+    s[t] = acc[t];
+  for (; j < n; j++) {
+    FP128 xj = x[(ptrdiff_t)j * incx];
+    FP128 const *aj = a + (ptrdiff_t)j * ca;
+    for (size_t t = 0; t < r; t++)
+      s[t] = pfp128_blas_madd(s[t], aj[(ptrdiff_t)t * ra], xj);
+  }
+  for (size_t t = 0; t < r; t++)
+    acc[t] = s[t];
+}
+
+static inline void FP128_gemv(FP128_BLAS_TRANSPOSE trans, size_t m, size_t n,
+                              FP128 alpha, FP128 const *A, size_t lda,
+                              FP128 const *x, ptrdiff_t incx, FP128 beta,
+                              FP128 *y, ptrdiff_t incy) {
+  // op(A) is rows by cols, and row i of it is A + i * ra, with its elements
+  // ca apart.
+  size_t rows = trans ? n : m, cols = trans ? m : n;
+  ptrdiff_t ra = trans ? 1 : (ptrdiff_t)lda, ca = trans ? (ptrdiff_t)lda : 1;
+  x += pfp128_blas_start(cols, incx);
+  y += pfp128_blas_start(rows, incy);
+  int noBeta = pfp128_blas_is(beta, 0.0), unitBeta = pfp128_blas_is(beta, 1.0);
+  size_t total = rows * cols, blocks = (rows + 3) / 4;
+  PFP128_BLAS_LOOP
+  for (size_t b = 0; b < blocks; b++) {
+    size_t i = 4 * b, r = rows - i < 4 ? rows - i : 4;
+    FP128 acc[4];
+    for (size_t t = 0; t < r; t++)
+      acc[t] = FP128_from_double(0.0);
+    pfp128_blas_dots(r, cols, A + (ptrdiff_t)i * ra, ra, ca, x, incx, acc);
+    for (size_t t = 0; t < r; t++) {
+      FP128 *yi = y + (ptrdiff_t)(i + t) * incy;
+      FP128 v = pfp128_blas_mul(alpha, acc[t]);
+      *yi = noBeta     ? v
+            : unitBeta ? pfp128_blas_add(*yi, v)
+                       : pfp128_blas_madd(v, beta, *yi);
+    }
+  }
+}
+
+static inline void FP128_trsv(FP128_BLAS_UPLO uplo, FP128_BLAS_TRANSPOSE trans,
+                              FP128_BLAS_DIAG diag, size_t n, FP128 const *A,
+                              size_t lda, FP128 *x, ptrdiff_t incx) {
+  ptrdiff_t ra = trans ? 1 : (ptrdiff_t)lda, ca = trans ? (ptrdiff_t)lda : 1;
+  x += pfp128_blas_start(n, incx);
+  // Transposing swaps upper and lower.
+  int lower = (uplo == FP128_BLAS_LOWER) != (trans == FP128_BLAS_TRANS);
+  for (size_t k = 0; k < n; k++) {
+    size_t i = lower ? k : n - 1 - k;
+    FP128 const *row = A + (ptrdiff_t)i * ra;
+    // x[i] -= the sum of op(A)[i][j] x[j] over the solved j.
+    size_t j0 = lower ? 0 : i + 1, len = lower ? i : n - 1 - i;
+    FP128 acc = negFP128(x[(ptrdiff_t)i * incx]);
+    pfp128_blas_dots(1, len, row + (ptrdiff_t)j0 * ca, 0, ca,
+                     x + (ptrdiff_t)j0 * incx, incx, &acc);
+    acc = negFP128(acc);
+    if (diag == FP128_BLAS_NON_UNIT)
+      acc = pfp128_blas_div(acc, row[(ptrdiff_t)i * ca]);
+    x[(ptrdiff_t)i * incx] = acc;
+  }
+}
+
+// Level 3.
+// Pack rows [i0, i0 + mc) and columns [p0, p0 + kc) of op(A), times alpha,
+// into panels of MR rows, each stored column by column (zero padded).
+static inline void pfp128_blas_pack_a(FP128 *Ap, FP128 const *A, size_t lda,
+                                      int trans, size_t i0, size_t mc,
+                                      size_t p0, size_t kc, FP128 alpha,
+                                      int unitAlpha) {
+  FP128 zero = FP128_from_double(0.0);
+  for (size_t ir = 0; ir < mc; ir += PFP128_BLAS_MR)
+    for (size_t p = 0; p < kc; p++)
+      for (size_t t = 0; t < PFP128_BLAS_MR; t++) {
+        size_t i = i0 + ir + t, q = p0 + p;
+        FP128 v = zero;
+        if (ir + t < mc) {
+          v = trans ? A[q * lda + i] : A[i * lda + q];
+          if (!unitAlpha)
+            v = pfp128_blas_mul(alpha, v);
+        }
+        *Ap++ = v;
+      }
+}
+
+// Pack rows [p0, p0 + kc) of op(B) into panels of NR columns, each stored
+// row by row (zero padded).
+static inline void pfp128_blas_pack_b(FP128 *Bp, FP128 const *B, size_t ldb,
+                                      int trans, size_t p0, size_t kc,
+                                      size_t n) {
+  FP128 zero = FP128_from_double(0.0);
+  for (size_t jr = 0; jr < n; jr += PFP128_BLAS_NR)
+    for (size_t p = 0; p < kc; p++)
+      for (size_t t = 0; t < PFP128_BLAS_NR; t++) {
+        size_t j = jr + t, q = p0 + p;
+        *Bp++ = j >= n ? zero : trans ? B[j * ldb + q] : B[q * ldb + j];
+      }
+}
+
+// C[0..mr)[0..nr) += the product of an A panel and a B panel.
+static inline void pfp128_blas_kernel(size_t kc, FP128 const *Ap,
+                                      FP128 const *Bp, FP128 *C, size_t ldc,
+                                      size_t mr, size_t nr) {
+  FP128 c[PFP128_BLAS_MR][PFP128_BLAS_NR];
+  for (size_t i = 0; i < PFP128_BLAS_MR; i++)
+    for (size_t j = 0; j < PFP128_BLAS_NR; j++)
+      c[i][j] = i < mr && j < nr ? C[i * ldc + j] : FP128_from_double(0.0);
+  for (size_t p = 0; p < kc; p++) {
+    for (size_t i = 0; i < PFP128_BLAS_MR; i++)
+      for (size_t j = 0; j < PFP128_BLAS_NR; j++)
+        c[i][j] = pfp128_blas_madd(c[i][j], Ap[i], Bp[j]);
+    Ap += PFP128_BLAS_MR;
+    Bp += PFP128_BLAS_NR;
+  }
+  for (size_t i = 0; i < mr; i++)
+    for (size_t j = 0; j < nr; j++)
+      C[i * ldc + j] = c[i][j];
+}
+
+static inline int FP128_gemm(FP128_BLAS_TRANSPOSE transA,
+                             FP128_BLAS_TRANSPOSE transB, size_t m, size_t n,
+                             size_t k, FP128 alpha, FP128 const *A, size_t lda,
+                             FP128 const *B, size_t ldb, FP128 beta, FP128 *C,
+                             size_t ldc) {
+  if (m == 0 || n == 0)
+    return 0;
+  if (!pfp128_blas_is(beta, 1.0)) {
+    int noBeta = pfp128_blas_is(beta, 0.0);
+    size_t total = m * n;
+    PFP128_BLAS_LOOP
+    for (size_t i = 0; i < m; i++)
+      for (size_t j = 0; j < n; j++)
+        C[i * ldc + j] = noBeta ? FP128_from_double(0.0)
+                                : pfp128_blas_mul(beta, C[i * ldc + j]);
+  }
+  if (k == 0 || pfp128_blas_is(alpha, 0.0))
+    return 0;
+  int unitAlpha = pfp128_blas_is(alpha, 1.0);
+  size_t np = (n + PFP128_BLAS_NR - 1) / PFP128_BLAS_NR;
+  size_t mp = (m + PFP128_BLAS_MR - 1) / PFP128_BLAS_MR;
+  size_t kc0 = k < PFP128_BLAS_KC ? k : PFP128_BLAS_KC;
+  FP128 *Bp = (FP128 *)malloc(np * PFP128_BLAS_NR * kc0 * sizeof(FP128));
+  FP128 *Ap = (FP128 *)malloc(mp * PFP128_BLAS_MR * kc0 * sizeof(FP128));
+  if (!Bp || !Ap) {
+    free(Bp);
+    free(Ap);
+    return -1;
+  }
+  for (size_t p0 = 0; p0 < k; p0 += PFP128_BLAS_KC) {
+    size_t kc = k - p0 < PFP128_BLAS_KC ? k - p0 : PFP128_BLAS_KC;
+    pfp128_blas_pack_b(Bp, B, ldb, transB, p0, kc, n);
+    pfp128_blas_pack_a(Ap, A, lda, transA, 0, m, p0, kc, alpha, unitAlpha);
+    // The blocks of MC rows by NR columns of C are independent.
+    size_t rowBlocks = (m + PFP128_BLAS_MC - 1) / PFP128_BLAS_MC;
+    size_t total = m * n * kc;
+    PFP128_BLAS_DYNAMIC_LOOP
+    for (size_t b = 0; b < rowBlocks * np; b++) {
+      size_t i0 = (b / np) * PFP128_BLAS_MC, jr = (b % np) * PFP128_BLAS_NR;
+      size_t iEnd = m - i0 < PFP128_BLAS_MC ? m : i0 + PFP128_BLAS_MC;
+      size_t nr = n - jr < PFP128_BLAS_NR ? n - jr : PFP128_BLAS_NR;
+      for (size_t ir = i0; ir < iEnd; ir += PFP128_BLAS_MR) {
+        size_t mr = m - ir < PFP128_BLAS_MR ? m - ir : PFP128_BLAS_MR;
+        pfp128_blas_kernel(kc, Ap + ir * kc, Bp + jr * kc, C + ir * ldc + jr,
+                           ldc, mr, nr);
+      }
+    }
+  }
+  free(Bp);
+  free(Ap);
+  return 0;
+}
+
+static inline int FP128_trsm(FP128_BLAS_SIDE side, FP128_BLAS_UPLO uplo,
+                             FP128_BLAS_TRANSPOSE trans, FP128_BLAS_DIAG diag,
+                             size_t m, size_t n, FP128 alpha, FP128 const *A,
+                             size_t lda, FP128 *B, size_t ldb) {
+  if (m == 0 || n == 0)
+    return 0;
+  if (!pfp128_blas_is(alpha, 1.0)) {
+    size_t total = m * n;
+    PFP128_BLAS_LOOP
+    for (size_t i = 0; i < m; i++)
+      FP128_scal(n, alpha, B + i * ldb, 1);
+  }
+  if (side == FP128_BLAS_RIGHT) {
+    // Each row x of X op(A) = B is op(A)^T x = b.
+    FP128_BLAS_TRANSPOSE flip = trans ? FP128_BLAS_NO_TRANS : FP128_BLAS_TRANS;
+    size_t total = m * n * n;
+    PFP128_BLAS_DYNAMIC_LOOP
+    for (size_t i = 0; i < m; i++)
+      FP128_trsv(uplo, flip, diag, n, A, lda, B + i * ldb, 1);
+    return 0;
+  }
+  // Solve for KC rows of X at a time (each column on its own), and subtract
+  // their contribution from the remaining rows of B with FP128_gemm. op(A)'s
+  // element (i, j) is at A + i * ra + j * ca.
+  size_t ra = trans ? 1 : lda, ca = trans ? lda : 1;
+  int lower = (uplo == FP128_BLAS_LOWER) != (trans == FP128_BLAS_TRANS);
+  FP128 minusOne = FP128_from_double(-1.0), one = FP128_from_double(1.0);
+  for (size_t done = 0; done < m; done += PFP128_BLAS_KC) {
+    size_t kb = m - done < PFP128_BLAS_KC ? m - done : PFP128_BLAS_KC;
+    // The rows [k0, k0 + kb), working down for lower and up for upper.
+    size_t k0 = lower ? done : m - done - kb;
+    FP128 const *Akk = A + k0 * ra + k0 * ca;
+    size_t total = kb * kb * n;
+    PFP128_BLAS_DYNAMIC_LOOP
+    for (size_t j = 0; j < n; j++)
+      FP128_trsv(uplo, trans, diag, kb, Akk, lda, B + k0 * ldb + j,
+                 (ptrdiff_t)ldb);
+    // The rows still to do are [k0 + kb, m) for lower, [0, k0) for upper.
+    size_t r0 = lower ? k0 + kb : 0, rows = lower ? m - k0 - kb : k0;
+    if (rows > 0 &&
+        FP128_gemm(trans, FP128_BLAS_NO_TRANS, rows, n, kb, minusOne,
+                   A + r0 * ra + k0 * ca, lda, B + k0 * ldb, ldb, one,
+                   B + r0 * ldb, ldb) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+#undef PFP128_BLAS_PRAGMA
+#undef PFP128_BLAS_LOOP
+#undef PFP128_BLAS_DYNAMIC_LOOP
+
+#endif // Header monotonicity
@@ -0,0 +1,1332 @@
+//===-- pfp128_charconv.h - Conversion between FP128 and text
+//-------------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Conversion of FP128 values to and from decimal text in the style of C++'s
+ * std::to_chars and std::from_chars, without varargs, locales or memory
+ * allocation.
+ *
+ * FP128_to_chars produces the shortest string which reads back as the same
+ * value (which for binary128 never has more than 36 significant digits),
+ * FP128_to_chars_precision the correctly rounded result that printf's %e, %f
+ * or %g would give, and FP128_to_chars_n formats a whole array.
+ *
+ * The output is written to [first, last), is not NUL terminated, and the
+ * functions return a pointer to the end of what they wrote, or NULL if it
+ * didn't fit (in which case the contents of the buffer are unspecified).
+ *
+ * Everything is done on the binary128 bit pattern with exact (multiple
+ * precision integer) arithmetic, so the results are the same whichever
+ * compiler and backend are in use. With the double-double backend the
+ * value is first rounded to binary128.
+ *
+ * The shortest digits are found as in Ryu (Ulf Adams, "Ryu: fast
+ * float-to-string conversion", PLDI 2018), but rather than using tables of
+ * powers of five, which would be large for binary128's exponent range, we
+ * compute the scaled values exactly. For values between about 1e-19 and 1e35
+ * that only needs 128 bit integers; otherwise we use big integers, whose
+ * size, and so the cost, grows with the magnitude of the decimal exponent.
+ *
+ * FP128_from_chars reads a correctly rounded value from [first, last),
+ * which needn't be NUL terminated, and FP128_from_chars_n reads a whole
+ * array of them (optionally in parallel with OpenMP).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_CHARCONV_H_INCLUDED_))
+#define _PFP128_CHARCONV_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_soft.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_charconv.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+typedef enum {
+  FP128_CHARS_SCIENTIFIC = 1, // d.ddde+dd, as %e.
+  FP128_CHARS_FIXED = 2,      // ddd.ddd, as %f.
+  FP128_CHARS_GENERAL = 3     // Whichever is shorter, or as %g with a precision.
+} FP128_CHARS_FORMAT;
+
+// Enough space for the shortest scientific or general form of any value,
+// e.g. "-1.23456789012345678901234567890123456e-4932".
+#define FP128_CHARS_MAX 48
+
+// Multiple precision unsigned integers, with 32 bit limbs, least significant
+// first, and no leading zero limbs (so zero has n == 0). The largest values
+// we need are about 2^11750 (the scaled significand of the smallest
+// subnormal), plus a limb for the division.
+#define PFP128_BIG_LIMBS 384
+
+typedef struct {
+  int n;
+  uint32_t w[PFP128_BIG_LIMBS];
+} pfp128_big;
+
+static inline void pfp128_big_trim(pfp128_big *a) {
+  while (a->n > 0 && a->w[a->n - 1] == 0)
+    a->n--;
+}
+
+static inline void pfp128_big_set_u128(pfp128_big *a, sq_u128 v) {
+  a->n = 0;
+  while (v) {
+    a->w[a->n++] = (uint32_t)v;
+    v >>= 32;
+  }
+}
+
+static inline void pfp128_big_mul_u32(pfp128_big *a, uint32_t m) {
+  uint64_t carry = 0;
+  for (int i = 0; i < a->n; i++) {
+    carry += (uint64_t)a->w[i] * m;
+    a->w[i] = (uint32_t)carry;
+    carry >>= 32;
+  }
+  if (carry)
+    a->w[a->n++] = (uint32_t)carry;
+}
+
+static inline void pfp128_big_mul_pow5(pfp128_big *a, int n) {
+  static uint32_t const pow5[13] = {1,       5,        25,        125,
+                                    625,     3125,     15625,     78125,
+                                    390625,  1953125,  9765625,   48828125,
+                                    244140625};
+  for (; n >= 13; n -= 13)
+    pfp128_big_mul_u32(a, 1220703125); // 5^13
+  if (n)
+    pfp128_big_mul_u32(a, pow5[n]);
+}
+
+static inline void pfp128_big_shl(pfp128_big *a, int bits) {
+  if (a->n == 0 || bits == 0)
+    return;
+  int limbs = bits / 32;
+  bits %= 32;
+  if (bits) {
+    a->w[a->n] = 0;
+    for (int i = a->n; i > 0; i--)
+      a->w[i] = (a->w[i] << bits) | (a->w[i - 1] >> (32 - bits));
+    a->w[0] <<= bits;
+    a->n += a->w[a->n] != 0;
+  }
+  if (limbs) {
+    memmove(a->w + limbs, a->w, a->n * sizeof(uint32_t));
+    memset(a->w, 0, limbs * sizeof(uint32_t));
+    a->n += limbs;
+  }
+}
+
+// r = a * x.
+static inline void pfp128_big_mul_u128(pfp128_big *r, pfp128_big const *a,
+                                       sq_u128 x) {
+  uint32_t xw[4] = {(uint32_t)x, (uint32_t)(x >> 32), (uint32_t)(x >> 64),
+                    (uint32_t)(x >> 96)};
+  int xn = 4;
+  while (xn > 0 && xw[xn - 1] == 0)
+    xn--;
+  r->n = a->n + xn;
+  memset(r->w, 0, r->n * sizeof(uint32_t));
+  for (int j = 0; j < xn; j++) {
+    uint64_t carry = 0;
+    for (int i = 0; i < a->n; i++) {
+      carry += (uint64_t)a->w[i] * xw[j] + r->w[i + j];
+      r->w[i + j] = (uint32_t)carry;
+      carry >>= 32;
+    }
+    r->w[a->n + j] = (uint32_t)carry;
+  }
+  pfp128_big_trim(r);
+}
+
+// Return a >> bits, which must be less than 2^128, leaving the bits shifted
+// out in a.
+static inline sq_u128 pfp128_big_shr_rem(pfp128_big *a, int bits) {
+  int limb = bits / 32, shift = bits % 32;
+  sq_u128 q = 0;
+  for (int i = a->n - 1; i > limb; i--)
+    q = (q << 32) | a->w[i];
+  if (limb < a->n)
+    q = (q << (32 - shift)) | (a->w[limb] >> shift);
+  else
+    q = 0;
+  if (a->n > limb) {
+    a->w[limb] &= (uint32_t)((1ull << shift) - 1);
+    a->n = limb + 1;
+  }
+  pfp128_big_trim(a);
+  return q;
+}
+
+// Return a / b, which must be less than 2^128, leaving the remainder in a.
+// b must be normalised (have the top bit of its top limb set). This is
+// Knuth's Algorithm D (TAOCP volume 2, 4.3.1).
+static inline sq_u128 pfp128_big_divmod(pfp128_big *a, pfp128_big const *b) {
+  int n = b->n;
+  if (a->n < n)
+    return 0;
+  sq_u128 q = 0;
+  uint32_t const *v = b->w;
+  uint32_t *u = a->w;
+  u[a->n] = 0;
+  for (int j = a->n - n; j >= 0; j--) {
+    uint64_t top = ((uint64_t)u[j + n] << 32) | u[j + n - 1];
+    uint64_t qhat = top / v[n - 1];
+    uint64_t rhat = top % v[n - 1];
+    while ((qhat >> 32) ||
+           (n > 1 && qhat * v[n - 2] > ((rhat << 32) | u[j + n - 2]))) {
+      qhat--;
+      rhat += v[n - 1];
+      if (rhat >> 32)
+        break;
+    }
+    // u[j .. j + n] -= qhat * v.
+    uint64_t carry = 0;
+    int64_t borrow = 0;
+    for (int i = 0; i < n; i++) {
+      uint64_t p = qhat * v[i] + carry;
+      carry = p >> 32;
+      int64_t t = (int64_t)u[i + j] - (int64_t)(uint32_t)p + borrow;
+      u[i + j] = (uint32_t)t;
+      borrow = t < 0 ? -1 : 0;
+    }
+    int64_t t = (int64_t)u[j + n] - (int64_t)carry + borrow;
+    u[j + n] = (uint32_t)t;
+    if (t < 0) {
+      // The estimate was one too large; add v back.
+      qhat--;
+      carry = 0;
+      for (int i = 0; i < n; i++) {
+        carry += (uint64_t)u[i + j] + v[i];
+        u[i + j] = (uint32_t)carry;
+        carry >>= 32;
+      }
+      u[j + n] += (uint32_t)carry;
+    }
+    q = (q << 32) | qhat;
+  }
+  pfp128_big_trim(a);
+  return q;
+}
+
+// A finite non-zero value m * 2^e, scaled so that we can find the decimal
+// digits of x * 2^e / 10^q for several x as floor(x * scale / den).
+typedef struct {
+  pfp128_big scale, den, rem;
+  int denShift; // If den is 2^denShift we shift rather than dividing.
+} pfp128_chars_scaled;
+
+static inline void pfp128_chars_scale(pfp128_chars_scaled *s, int e, int q) {
+  int t = e - q;
+  pfp128_big_set_u128(&s->scale, 1);
+  pfp128_big_set_u128(&s->den, 1);
+  if (q < 0)
+    pfp128_big_mul_pow5(&s->scale, -q);
+  else
+    pfp128_big_mul_pow5(&s->den, q);
+  if (q > 0) {
+    // Normalise den for the division, scaling the numerator to match.
+    if (t < 0)
+      pfp128_big_shl(&s->den, -t);
+    int norm = __builtin_clz(s->den.w[s->den.n - 1]);
+    pfp128_big_shl(&s->den, norm);
+    pfp128_big_shl(&s->scale, (t > 0 ? t : 0) + norm);
+    s->denShift = -1;
+  } else if (t > 0) {
+    pfp128_big_shl(&s->scale, t);
+    s->denShift = 0;
+  } else {
+    s->denShift = -t;
+  }
+}
+
+// The next quotient, leaving the remainder in s->rem.
+static inline sq_u128 pfp128_chars_quotient(pfp128_chars_scaled *s) {
+  if (s->denShift >= 0)
+    return pfp128_big_shr_rem(&s->rem, s->denShift);
+  return pfp128_big_divmod(&s->rem, &s->den);
+}
+
+static inline sq_u128 pfp128_chars_divide(pfp128_chars_scaled *s, sq_u128 x) {
+  pfp128_big_mul_u128(&s->rem, &s->scale, x);
+  return pfp128_chars_quotient(s);
+}
+
+// floor(log10(2^b)), for |b| < 16600.
+static inline int pfp128_chars_log10_pow2(int b) {
+  return (int)(((int64_t)b * 1292913986) >> 32);
+}
+
+// v / 10^19, setting *rem to the remainder. We shift out the factor of 2^19
+// and then multiply by the reciprocal of 5^19 (as in Granlund and
+// Montgomery, "Division by invariant integers using multiplication", PLDI
+// 1994), which is much quicker than dividing.
+static inline sq_u128 pfp128_chars_div_e19(sq_u128 v, uint64_t *rem) {
+  sq_u128 const m = ((sq_u128)0x3b07929f6da5ull << 64) | 0x58694acc7a78f41cull;
+  sq_u128 hi, lo;
+  sq_mul_wide(v >> 19, m, &hi, &lo); // ceil(2^154 / 5^19)
+  sq_u128 q = hi >> 26;
+  *rem = (uint64_t)(v - q * 10000000000000000000ull);
+  return q;
+}
+
+static uint64_t const pfp128_chars_pow10[20] = {1ull,
+                                                10ull,
+                                                100ull,
+                                                1000ull,
+                                                10000ull,
+                                                100000ull,
+                                                1000000ull,
+                                                10000000ull,
+                                                100000000ull,
+                                                1000000000ull,
+                                                10000000000ull,
+                                                100000000000ull,
+                                                1000000000000ull,
+                                                10000000000000ull,
+                                                100000000000000ull,
+                                                1000000000000000ull,
+                                                10000000000000000ull,
+                                                100000000000000000ull,
+                                                1000000000000000000ull,
+                                                10000000000000000000ull};
+
+static char const pfp128_chars_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Write exactly n decimal digits of v (with leading zeros) to out.
+static inline void pfp128_chars_u64_n(char *out, uint64_t v, int n) {
+  for (; n >= 2; n -= 2) {
+    memcpy(out + n - 2, pfp128_chars_pairs + 2 * (v % 100), 2);
+    v /= 100;
+  }
+  if (n)
+    out[0] = (char)('0' + v % 10);
+}
+
+static inline int pfp128_chars_u64_len(uint64_t v) {
+  int n = 1;
+  while (n < 20 && v >= pfp128_chars_pow10[n])
+    n++;
+  return n;
+}
+
+// Write the decimal digits of v to out, returning how many there are.
+static inline int pfp128_chars_u128(char *out, sq_u128 v) {
+  char buf[40];
+  char *p = buf + sizeof(buf);
+  while (v >> 64) {
+    uint64_t r;
+    v = pfp128_chars_div_e19(v, &r);
+    p -= 19;
+    pfp128_chars_u64_n(p, r, 19);
+  }
+  int n = pfp128_chars_u64_len((uint64_t)v);
+  p -= n;
+  pfp128_chars_u64_n(p, (uint64_t)v, n);
+  n = (int)(buf + sizeof(buf) - p);
+  memcpy(out, p, n);
+  return n;
+}
+
+// Split a finite non-zero value into m * 2^e, returning the sign. *tight is
+// set if the gap to the next smaller value is half that to the next larger
+// one (m is a power of two, but not the smallest normal).
+static inline int pfp128_chars_unpack(FP128SQ b, sq_u128 *m, int *e,
+                                      int *tight) {
+  int biased = (int)((b.bits >> 112) & SQ_EXP_MAX);
+  sq_u128 mant = b.bits & SQ_MANT_MASK;
+  if (biased == 0) {
+    *m = mant;
+    *e = 1 - SQ_BIAS - 112;
+  } else {
+    *m = mant | SQ_IMPLICIT_BIT;
+    *e = biased - SQ_BIAS - 112;
+  }
+  *tight = mant == 0 && biased > 1;
+  return (int)(b.bits >> 127);
+}
+
+// Add one in the last place of the digits in [first, last) (which may
+// include a '.'), returning 1 if they were all nines (and are now zeros).
+static inline int pfp128_chars_increment(char *first, char *last) {
+  while (last != first) {
+    --last;
+    if (*last == '.')
+      continue;
+    if (*last != '9') {
+      ++*last;
+      return 0;
+    }
+    *last = '0';
+  }
+  return 1;
+}
+
+static uint64_t const pfp128_chars_pow5[28] = {
+    1ull,
+    5ull,
+    25ull,
+    125ull,
+    625ull,
+    3125ull,
+    15625ull,
+    78125ull,
+    390625ull,
+    1953125ull,
+    9765625ull,
+    48828125ull,
+    244140625ull,
+    1220703125ull,
+    6103515625ull,
+    30517578125ull,
+    152587890625ull,
+    762939453125ull,
+    3814697265625ull,
+    19073486328125ull,
+    95367431640625ull,
+    476837158203125ull,
+    2384185791015625ull,
+    11920928955078125ull,
+    59604644775390625ull,
+    298023223876953125ull,
+    1490116119384765625ull,
+    7450580596923828125ull};
+
+// 5^n for n <= 54.
+static inline sq_u128 pfp128_chars_pow5_128(int n) {
+  return (sq_u128)pfp128_chars_pow5[n < 27 ? n : 27] *
+         pfp128_chars_pow5[n < 27 ? 0 : n - 27];
+}
+
+// floor(x * y / 2^shift), which must be less than 2^128, setting *exact if
+// it is exact.
+static inline sq_u128 pfp128_chars_mul_shift(sq_u128 x, sq_u128 y, int shift,
+                                             int *exact) {
+  sq_u128 hi, lo;
+  sq_mul_wide(x, y, &hi, &lo);
+  if (shift == 0) {
+    *exact = 1;
+    return lo;
+  }
+  if (shift < 128) {
+    *exact = (lo << (128 - shift)) == 0;
+    return (hi << (128 - shift)) | (lo >> shift);
+  }
+  *exact = lo == 0 && (shift == 128 || (hi << (256 - shift)) == 0);
+  return hi >> (shift - 128);
+}
+
+// Write exactly 39 decimal digits of v (which must be less than 10^39).
+static inline void pfp128_chars_u128_39(char *out, sq_u128 v) {
+  uint64_t lo, mid;
+  v = pfp128_chars_div_e19(v, &lo);
+  v = pfp128_chars_div_e19(v, &mid);
+  out[0] = (char)('0' + (int)v);
+  pfp128_chars_u64_n(out + 1, mid, 19);
+  pfp128_chars_u64_n(out + 20, lo, 19);
+}
+
+// The shortest decimal which lies in the interval of values that round to
+// m * 2^e2. We write its digits to out (which needs room for 39) and
+// return how many there are, setting *exp10 to the power of ten by which
+// they must be multiplied.
+//
+// This is Ryu's generic algorithm, but with the bounds computed exactly,
+// and, rather than removing digits one at a time from the bounds (which for
+// 128 bit integers means a slow division each time), we find how many to
+// remove by comparing their decimal digits.
+static inline int pfp128_chars_shortest(sq_u128 m, int e2, int tight,
+                                        char *out, int *exp10) {
+  int acceptBounds = (m & 1) == 0;
+  // 2^b <= m * 2^e2 < 2^(b+1), so the value has k or k+1 integer digits,
+  // and we want 38 or so digits from the exact divisions (so that the
+  // interval is always at least a hundred units wide).
+  int b = e2 + 127 - sq_clz(m);
+  int q = pfp128_chars_log10_pow2(b) - 36;
+  int shift = q - (e2 - 2);
+  sq_u128 vr, vp, vm;
+  int vrExact, vpExact, vmExact;
+  if (q <= 0 && q >= -54 && shift >= 0) {
+    // 5^-q fits in 128 bits, and we only need to shift, so we can do this
+    // with 128 bit integers. (This covers values from about 1e-19 to 1e35.)
+    sq_u128 pow5 = pfp128_chars_pow5_128(-q);
+    vr = pfp128_chars_mul_shift(4 * m, pow5, shift, &vrExact);
+    vp = pfp128_chars_mul_shift(4 * m + 2, pow5, shift, &vpExact);
+    vm = pfp128_chars_mul_shift(4 * m - 2 + tight, pow5, shift, &vmExact);
+  } else {
+    pfp128_chars_scaled s;
+    pfp128_chars_scale(&s, e2 - 2, q);
+    vr = pfp128_chars_divide(&s, 4 * m);
+    vrExact = s.rem.n == 0;
+    vp = pfp128_chars_divide(&s, 4 * m + 2);
+    vpExact = s.rem.n == 0;
+    vm = pfp128_chars_divide(&s, 4 * m - 2 + tight);
+    vmExact = s.rem.n == 0;
+  }
+  int vrIsTrailingZeros = vrExact;
+  int vmIsTrailingZeros = acceptBounds && vmExact;
+  if (!acceptBounds && vpExact)
+    vp--;
+
+  // vp is at most 10^38, so with leading zeros they all have 39 digits.
+  enum { L = 39 };
+  char r[L], p[L], lower[L];
+  pfp128_chars_u128_39(r, vr);
+  pfp128_chars_u128_39(p, vp);
+  pfp128_chars_u128_39(lower, vm);
+  // Keep digits up to the first one in which the bounds differ; removing
+  // any more would leave them equal.
+  int n = 1;
+  while (p[n - 1] == lower[n - 1])
+    n++;
+  int lastRemovedDigit = 0;
+  for (int i = L - 1; i >= n; i--) {
+    vrIsTrailingZeros &= lastRemovedDigit == 0;
+    lastRemovedDigit = r[i] - '0';
+    vmIsTrailingZeros &= lower[i] == '0';
+  }
+  // If the lower bound is in the interval, and has trailing zeros, we can
+  // shorten it further.
+  while (vmIsTrailingZeros && n > 1 && lower[n - 1] == '0') {
+    vrIsTrailingZeros &= lastRemovedDigit == 0;
+    lastRemovedDigit = r[--n] - '0';
+  }
+  if (vrIsTrailingZeros && lastRemovedDigit == 5 && (r[n - 1] & 1) == 0)
+    lastRemovedDigit = 4; // Round half to even.
+  if ((!memcmp(r, lower, n) && (!acceptBounds || !vmIsTrailingZeros)) ||
+      lastRemovedDigit >= 5)
+    pfp128_chars_increment(r, r + n); // Can't carry out, since r[0] < '9'.
+  int first = 0, end = n;
+  while (r[first] == '0')
+    first++;
+  while (r[end - 1] == '0')
+    end--;
+  memcpy(out, r + first, end - first);
+  *exp10 = q + L - end;
+  return end - first;
+}
+
+// Writing the output.
+static inline char *pfp128_chars_special(char *p, char *last, FP128SQ b) {
+  char const *text = isnansq(b) ? "nan" : "inf";
+  if (last - p < 3)
+    return NULL;
+  memcpy(p, text, 3);
+  return p + 3;
+}
+
+// Append e+dd (with at least two digits of exponent).
+static inline char *pfp128_chars_exponent(char *p, char *last, int x) {
+  uint64_t ax = (uint64_t)(x < 0 ? -x : x);
+  int n = pfp128_chars_u64_len(ax);
+  if (n < 2)
+    n = 2;
+  if (last - p < n + 2)
+    return NULL;
+  *p++ = 'e';
+  *p++ = x < 0 ? '-' : '+';
+  pfp128_chars_u64_n(p, ax, n);
+  return p + n;
+}
+
+static inline int pfp128_chars_exponent_len(int x) {
+  int n = pfp128_chars_u64_len((uint64_t)(x < 0 ? -x : x));
+  return 2 + (n < 2 ? 2 : n);
+}
+
+// Write digits[0 .. n) * 10^exp10 in scientific or fixed form, choosing the
+// shorter for general.
+static inline char *pfp128_chars_format(char *p, char *last,
+                                        char const *digits, int n, int exp10,
+                                        FP128_CHARS_FORMAT fmt) {
+  int x = exp10 + n - 1;
+  int sciLen = n + (n > 1) + pfp128_chars_exponent_len(x);
+  int fixedLen = exp10 >= 0      ? n + exp10
+                 : n + exp10 > 0 ? n + 1
+                                 : 2 + n - (n + exp10);
+  if (fmt == FP128_CHARS_GENERAL)
+    fmt = fixedLen <= sciLen ? FP128_CHARS_FIXED : FP128_CHARS_SCIENTIFIC;
+  if (fmt == FP128_CHARS_SCIENTIFIC) {
+    if (last - p < sciLen)
+      return NULL;
+    *p++ = digits[0];
+    if (n > 1) {
+      *p++ = '.';
+      memcpy(p, digits + 1, n - 1);
+      p += n - 1;
+    }
+    return pfp128_chars_exponent(p, last, x);
+  }
+  if (last - p < fixedLen)
+    return NULL;
+  if (exp10 >= 0) {
+    memcpy(p, digits, n);
+    memset(p + n, '0', exp10);
+  } else if (n + exp10 > 0) {
+    memcpy(p, digits, n + exp10);
+    p[n + exp10] = '.';
+    memcpy(p + n + exp10 + 1, digits + n + exp10, -exp10);
+  } else {
+    p[0] = '0';
+    p[1] = '.';
+    memset(p + 2, '0', -(n + exp10));
+    memcpy(p + 2 - (n + exp10), digits, n);
+  }
+  return p + fixedLen;
+}
+
+static inline char *FP128_to_chars(char *first, char *last, FP128 v,
+                                   FP128_CHARS_FORMAT fmt) {
+  FP128SQ b = FP128_to_sq(v);
+  char *p = first;
+  if (signbitsq(b)) {
+    if (p == last)
+      return NULL;
+    *p++ = '-';
+  }
+  if (!isfinitesq(b))
+    return pfp128_chars_special(p, last, b);
+  char digits[40];
+  int n = 1, exp10 = 0;
+  if ((b.bits & SQ_ABS_MASK) == 0) {
+    digits[0] = '0';
+  } else {
+    sq_u128 m;
+    int e, tight;
+    pfp128_chars_unpack(b, &m, &e, &tight);
+    n = pfp128_chars_shortest(m, e, tight, digits, &exp10);
+  }
+  return pfp128_chars_format(p, last, digits, n, exp10, fmt);
+}
+
+// Format n values, each followed by separator unless it is '\0'.
+static inline char *FP128_to_chars_n(char *first, char *last, FP128 const *v,
+                                     size_t n, FP128_CHARS_FORMAT fmt,
+                                     char separator) {
+  for (size_t i = 0; i < n; i++) {
+    first = FP128_to_chars(first, last, v[i], fmt);
+    if (!first)
+      return NULL;
+    if (separator) {
+      if (first == last)
+        return NULL;
+      *first++ = separator;
+    }
+  }
+  return first;
+}
+
+// The decimal digits of a finite non-zero value, generated as required, for
+// the fixed precision forms.
+typedef struct {
+  pfp128_chars_scaled s;
+  char head[40]; // The leading digits, from the first division.
+  int headLen;
+  int k; // The value is in [10^k, 10^(k+1)).
+  // The positions of the last digits emitted which weren't 0 and 9.
+  int lastNonZero, lastNonNine;
+} pfp128_chars_digits;
+
+static inline void pfp128_chars_digits_init(pfp128_chars_digits *d,
+                                            sq_u128 m, int e) {
+  int q = pfp128_chars_log10_pow2(e + 127 - sq_clz(m)) - 36;
+  sq_u128 head;
+  if (q <= 0 && q >= -54 && q - e >= 0) {
+    // As in pfp128_chars_shortest, the product fits in 256 bits.
+    sq_u128 hi, lo;
+    sq_mul_wide(m, pfp128_chars_pow5_128(-q), &hi, &lo);
+    pfp128_big *rem = &d->s.rem;
+    for (int i = 0; i < 4; i++) {
+      rem->w[i] = (uint32_t)(lo >> (32 * i));
+      rem->w[i + 4] = (uint32_t)(hi >> (32 * i));
+    }
+    rem->n = 8;
+    pfp128_big_trim(rem);
+    d->s.denShift = q - e;
+    head = pfp128_chars_quotient(&d->s);
+  } else {
+    pfp128_chars_scale(&d->s, e, q);
+    head = pfp128_chars_divide(&d->s, m);
+  }
+  d->headLen = pfp128_chars_u128(d->head, head);
+  d->k = q + d->headLen - 1;
+}
+
+// Write the first count digits, skipping position gap (where the decimal
+// point goes) if that isn't negative, and return whether the digits should
+// be rounded up (half to even). If out is NULL the digits are only counted.
+static inline int pfp128_chars_emit(pfp128_chars_digits *d, char *out,
+                                    int count, int gap) {
+  char chunk[9];
+  char const *src = d->head;
+  int srcLen = d->headLen;
+  int i = 0, lastDigit = 0;
+  d->lastNonZero = d->lastNonNine = -1;
+  for (;;) {
+    for (int j = 0; j < srcLen; j++, i++) {
+      if (i == count) {
+        int roundDigit = src[j] - '0';
+        if (roundDigit != 5)
+          return roundDigit > 5;
+        int sticky = d->s.rem.n != 0;
+        for (j++; j < srcLen && !sticky; j++)
+          sticky = src[j] != '0';
+        return sticky || (lastDigit & 1);
+      }
+      lastDigit = src[j] - '0';
+      if (lastDigit != 0)
+        d->lastNonZero = i;
+      if (lastDigit != 9)
+        d->lastNonNine = i;
+      if (out)
+        out[i + (gap >= 0 && i >= gap)] = src[j];
+    }
+    if (d->s.rem.n == 0) {
+      // The value is exact, so the rest of the digits are zeros.
+      if (i < count)
+        d->lastNonNine = count - 1;
+      for (; out && i < count; i++)
+        out[i + (gap >= 0 && i >= gap)] = '0';
+      return 0;
+    }
+    // The next nine digits.
+    pfp128_big_mul_u32(&d->s.rem, 1000000000);
+    pfp128_chars_u64_n(chunk, (uint64_t)pfp128_chars_quotient(&d->s), 9);
+    src = chunk;
+    srcLen = 9;
+  }
+}
+
+// %.*e, returning the (possibly incremented by rounding) exponent in *x.
+static inline char *pfp128_chars_scientific(char *p, char *last,
+                                            pfp128_chars_digits *d,
+                                            int precision, int *x) {
+  int len = precision + 1 + (precision > 0);
+  if (last - p < len + 4)
+    return NULL;
+  *x = d->k;
+  if (precision > 0)
+    p[1] = '.';
+  if (pfp128_chars_emit(d, p, precision + 1, precision > 0 ? 1 : -1) &&
+      pfp128_chars_increment(p, p + len)) {
+    p[0] = '1';
+    ++*x;
+  }
+  return p + len;
+}
+
+// 99.9 rounded up to 00.0 becomes 100.0.
+static inline char *pfp128_chars_prepend_one(char *p, char *last, char *end) {
+  if (end == last)
+    return NULL;
+  memmove(p + 1, p, end - p);
+  p[0] = '1';
+  return end + 1;
+}
+
+// %.*f. *carry is set if rounding added a digit (so the value is now in
+// [10^(k+1), 10^(k+2))); if k >= 0 the digits are then all zeros, and the
+// caller must add the leading 1 with pfp128_chars_prepend_one.
+static inline char *pfp128_chars_fixed(char *p, char *last,
+                                       pfp128_chars_digits *d, int precision,
+                                       int *carry) {
+  int k = d->k;
+  int count = k + 1 + precision;
+  *carry = 0;
+  if (k >= 0) {
+    int len = count + (precision > 0);
+    if (last - p < len)
+      return NULL;
+    if (precision > 0)
+      p[k + 1] = '.';
+    *carry = pfp128_chars_emit(d, p, count, precision > 0 ? k + 1 : -1) &&
+             pfp128_chars_increment(p, p + len);
+    return p + len;
+  }
+  // 0.000ddd, where the first digit may be beyond the precision.
+  int len = precision > 0 ? precision + 2 : 1;
+  if (last - p < len)
+    return NULL;
+  p[0] = '0';
+  if (precision > 0) {
+    p[1] = '.';
+    memset(p + 2, '0', precision);
+  }
+  if (count >= 0 &&
+      pfp128_chars_emit(d, count ? p + len - count : NULL, count, -1)) {
+    pfp128_chars_increment(p, p + len);
+    *carry = count == 0 || p[len - count] == '0';
+  }
+  return p + len;
+}
+
+// Remove trailing zeros after a decimal point (and the point, if nothing is
+// left after it), as %g does.
+static inline char *pfp128_chars_strip(char *first, char *p) {
+  if (!memchr(first, '.', p - first))
+    return p;
+  while (p[-1] == '0')
+    p--;
+  if (p[-1] == '.')
+    p--;
+  return p;
+}
+
+// %.*g. Whether it uses the fixed or scientific form depends on the
+// exponent after rounding, which we only know once we have the digits, but
+// if rounding carries into a new digit the result is a power of ten, which
+// we can just rewrite. We write the digits and then remove trailing zeros,
+// unless the digits won't fit, in which case we first find out how many
+// will be left, and then produce only those.
+static inline char *pfp128_chars_general(char *p, char *last,
+                                         pfp128_chars_digits *d, sq_u128 m,
+                                         int e, int precision) {
+  char *first = p;
+  int k = d->k, x, carry;
+  int fixed = precision > k && k >= -4;
+  int len = !fixed   ? precision + (precision > 1) +
+                         pfp128_chars_exponent_len(k)
+            : k >= 0 ? precision + (precision > k + 1)
+                     : precision + 1 - k;
+  int digits = precision;
+  if (last - p < len) {
+    int up = pfp128_chars_emit(d, NULL, precision, -1);
+    if (up && d->lastNonNine < 0) // All nines, rounded up to 10^(k+1).
+      return pfp128_chars_format(first, last, "1", 1, k + 1,
+                                 precision > k + 1 && k + 1 >= -4
+                                     ? FP128_CHARS_FIXED
+                                     : FP128_CHARS_SCIENTIFIC);
+    digits = (up ? d->lastNonNine : d->lastNonZero) + 1;
+    pfp128_chars_digits_init(d, m, e);
+  }
+  if (fixed) {
+    p = pfp128_chars_fixed(p, last, d, digits > k + 1 ? digits - 1 - k : 0,
+                           &carry);
+    if (p && carry && precision == k + 1) {
+      // Now 10^precision, which is written in scientific form.
+      *first = '1';
+      return pfp128_chars_exponent(first + 1, last, k + 1);
+    }
+    if (!p)
+      return NULL;
+    p = pfp128_chars_strip(first, p);
+    return carry && k >= 0 ? pfp128_chars_prepend_one(first, last, p) : p;
+  }
+  p = pfp128_chars_scientific(p, last, d, digits - 1, &x);
+  if (!p)
+    return NULL;
+  if (x == -4) // Rounded up to 0.0001, which is written in fixed form.
+    return pfp128_chars_format(first, last, "1", 1, x, FP128_CHARS_FIXED);
+  return pfp128_chars_exponent(pfp128_chars_strip(first, p), last, x);
+}
+
+// The correctly rounded result that printf's %.*e (scientific), %.*f
+// (fixed) or %.*g (general) would give. A negative precision means 6, as for
+// printf.
+static inline char *FP128_to_chars_precision(char *first, char *last,
+                                             FP128 v, FP128_CHARS_FORMAT fmt,
+                                             int precision) {
+  FP128SQ b = FP128_to_sq(v);
+  char *p = first;
+  if (precision < 0)
+    precision = 6;
+  if (fmt == FP128_CHARS_GENERAL && precision == 0)
+    precision = 1;
+  if (signbitsq(b)) {
+    if (p == last)
+      return NULL;
+    *p++ = '-';
+  }
+  if (!isfinitesq(b))
+    return pfp128_chars_special(p, last, b);
+  if ((b.bits & SQ_ABS_MASK) == 0) {
+    if (fmt == FP128_CHARS_GENERAL)
+      precision = 0;
+    int len = 1 + (precision > 0) + precision;
+    if (last - p < len)
+      return NULL;
+    p[0] = '0';
+    if (precision > 0) {
+      p[1] = '.';
+      memset(p + 2, '0', precision);
+    }
+    p += len;
+    return fmt == FP128_CHARS_SCIENTIFIC ? pfp128_chars_exponent(p, last, 0)
+                                         : p;
+  }
+  sq_u128 m;
+  int e, tight, x;
+  pfp128_chars_unpack(b, &m, &e, &tight);
+  pfp128_chars_digits d;
+  pfp128_chars_digits_init(&d, m, e);
+  switch (fmt) {
+  case FP128_CHARS_SCIENTIFIC:
+    p = pfp128_chars_scientific(p, last, &d, precision, &x);
+    return p ? pfp128_chars_exponent(p, last, x) : NULL;
+  case FP128_CHARS_FIXED: {
+    char *end = pfp128_chars_fixed(p, last, &d, precision, &x);
+    return end && x && d.k >= 0 ? pfp128_chars_prepend_one(p, last, end)
+                                : end;
+  }
+  default:
+    return pfp128_chars_general(p, last, &d, m, e, precision);
+  }
+}
+
+// Reading.
+//
+// We read up to 38 significant digits (which fit in 128 bits) into w, so
+// that the value is w * 10^e10, plus possibly some digits we dropped, and
+// find a 128 bit approximation to it (as in Daniel Lemire, "Number parsing
+// at a gigabyte per second", Software: Practice and Experience 51(8), 2021,
+// but with 128 bit rather than 64 bit products). The powers of ten are
+// 10^(e10 mod 32), which is exact, times some of 10^(+-32 * 2^i), each
+// rounded down to 128 bits, so the approximation is below the value, and by
+// less than 17 * 2^-127 of it. If the two ends of the range it may be in
+// round to the same binary128 value we're done; otherwise (rarely) we
+// compare the digits with those of the half way point between the two
+// candidates.
+typedef struct {
+  uint64_t hi, lo;
+  int exp;   // 10^n is approximately (hi:lo) * 2^exp.
+  int exact; // If it is exactly.
+} pfp128_chars_power;
+
+static pfp128_chars_power const pfp128_chars_powers[16] = {
+    {0x9dc5ada82b70b59dull, 0xf020000000000000ull, -21, 1}, // 10^32
+    {0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull, 85, 0},  // 10^64
+    {0x93ba47c980e98cdfull, 0xc66f336c36b10137ull, 298, 0}, // 10^128
+    {0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull, 723, 0}, // 10^256
+    {0xe319a0aea60e91c6ull, 0xcc655c54bc5058f8ull, 1573, 0},  // 10^512
+    {0xc976758681750c17ull, 0x650d3d28f18b50ceull, 3274, 0},  // 10^1024
+    {0x9e8b3b5dc53d5de4ull, 0xa74d28ce329ace52ull, 6676, 0},  // 10^2048
+    {0xc46052028a20979aull, 0xc94c153f804a4a92ull, 13479, 0}, // 10^4096
+    {0xcfb11ead453994baull, 0x67de18eda5814af2ull, -234, 0},  // 10^-32
+    {0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull, -340, 0},  // 10^-64
+    {0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull, -553, 0},  // 10^-128
+    {0xc0314325637a1939ull, 0xfa911155fefb5308ull, -978, 0},  // 10^-256
+    {0x9049ee32db23d21cull, 0x7132d332e3f204d4ull, -1828, 0}, // 10^-512
+    {0xa2a682a5da57c0bdull, 0x87a601586bd3f698ull, -3529, 0}, // 10^-1024
+    {0xceae534f34362de4ull, 0x492512d4f2ead2cbull, -6931, 0}, // 10^-2048
+    {0xa6dd04c8d2ce9fdeull, 0x2de38123a1c3cffcull, -13734, 0}}; // 10^-4096
+
+// The top 128 bits of x * y (both of which have their top bit set),
+// adding to *exp the power of two by which they must be multiplied, and
+// clearing *exact if any of the bits we dropped were set.
+static inline sq_u128 pfp128_chars_mul_norm(sq_u128 x, sq_u128 y, int *exp,
+                                            int *exact) {
+  sq_u128 hi, lo;
+  sq_mul_wide(x, y, &hi, &lo);
+  if (!(hi >> 127)) {
+    hi = (hi << 1) | (lo >> 127);
+    lo <<= 1;
+    --*exp;
+  }
+  *exp += 128;
+  *exact &= lo == 0;
+  return hi;
+}
+
+// Compare the decimal digits in [p, end) (the first of which is not zero,
+// and which may include a '.'), which are multiplied by the power of ten
+// that puts the value in [10^k, 10^(k+1)), with m * 2^e.
+static inline int pfp128_chars_compare(char const *p, char const *end, int k,
+                                       sq_u128 m, int e) {
+  pfp128_chars_digits d;
+  pfp128_chars_digits_init(&d, m, e);
+  if (k != d.k)
+    return k < d.k ? -1 : 1;
+  char chunk[9];
+  char const *src = d.head;
+  int srcLen = d.headLen;
+  for (;;) {
+    for (int j = 0; j < srcLen; j++, p++) {
+      if (p != end && *p == '.')
+        p++;
+      if (p == end) {
+        // Any more non-zero digits make m * 2^e larger.
+        int more = d.s.rem.n != 0;
+        for (; j < srcLen && !more; j++)
+          more = src[j] != '0';
+        return -more;
+      }
+      if (*p != src[j])
+        return *p < src[j] ? -1 : 1;
+    }
+    if (d.s.rem.n == 0) {
+      for (; p != end; p++)
+        if (*p != '0' && *p != '.')
+          return 1;
+      return 0;
+    }
+    pfp128_big_mul_u32(&d.s.rem, 1000000000);
+    pfp128_chars_u64_n(chunk, (uint64_t)pfp128_chars_quotient(&d.s), 9);
+    src = chunk;
+    srcLen = 9;
+  }
+}
+
+// The length of the case insensitive match of word at p, or 0.
+static inline int pfp128_chars_match(char const *p, char const *last,
+                                     char const *word) {
+  int n = 0;
+  for (; word[n]; n++)
+    if (last - p <= n || (p[n] | 0x20) != word[n])
+      return 0;
+  return n;
+}
+
+static inline int pfp128_chars_isdigit(char c) {
+  return (unsigned)(c - '0') < 10;
+}
+
+static inline char const *pfp128_chars_special_in(char const *p,
+                                                  char const *last,
+                                                  sq_u128 sign, FP128SQ *out) {
+  int n;
+  if ((n = pfp128_chars_match(p, last, "infinity")) ||
+      (n = pfp128_chars_match(p, last, "inf"))) {
+    *out = sq_make(sign | SQ_INF_BITS);
+    return p + n;
+  }
+  if (!pfp128_chars_match(p, last, "nan"))
+    return NULL;
+  *out = sq_make(sign | SQ_INF_BITS | SQ_QUIET_BIT);
+  p += 3;
+  // An optional (n-char-sequence), which we ignore.
+  if (p != last && *p == '(') {
+    char const *q = p + 1;
+    while (q != last && (pfp128_chars_isdigit(*q) || *q == '_' ||
+                         (unsigned)((*q | 0x20) - 'a') < 26))
+      q++;
+    if (q != last && *q == ')')
+      p = q + 1;
+  }
+  return p;
+}
+
+// The first 38 significant digits, as two 19 digit halves (which is
+// quicker than using 128 bit arithmetic for each digit), and whether any of
+// those after them weren't zero.
+typedef struct {
+  uint64_t high, low;
+  int n, truncated;
+} pfp128_chars_acc;
+
+// Whether the 8 characters in v are all digits, and their value. (See
+// Lemire's article above.)
+static inline int pfp128_chars_all_digits8(uint64_t v) {
+  return !(((v + 0x4646464646464646ull) | (v - 0x3030303030303030ull)) &
+           0x8080808080808080ull);
+}
+static inline uint64_t pfp128_chars_digits8(uint64_t v) {
+  v -= 0x3030303030303030ull;
+  v = v * 10 + (v >> 8);
+  return (((v & 0x000000ff000000ffull) * (100 + (1000000ull << 32))) +
+          (((v >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32)))) >>
+         32;
+}
+
+// Read a run of digits (the first of which, if we have none yet, is not
+// zero) into acc, returning a pointer to the character after them.
+static inline char const *pfp128_chars_read_digits(char const *p,
+                                                   char const *last,
+                                                   pfp128_chars_acc *acc) {
+  for (;;) {
+    int n = acc->n;
+    if (last - p >= 8 && (n <= 11 || (n >= 19 && n <= 30))) {
+      uint64_t v;
+      memcpy(&v, p, 8);
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+      v = __builtin_bswap64(v);
+#endif
+      if (pfp128_chars_all_digits8(v)) {
+        uint64_t *half = n < 19 ? &acc->high : &acc->low;
+        *half = *half * 100000000 + pfp128_chars_digits8(v);
+        acc->n = n + 8;
+        p += 8;
+        continue;
+      }
+    }
+    if (p == last || !pfp128_chars_isdigit(*p))
+      return p;
+    int digit = *p++ - '0';
+    if (n < 19)
+      acc->high = acc->high * 10 + digit;
+    else if (n < 38)
+      acc->low = acc->low * 10 + digit;
+    else
+      acc->truncated |= digit;
+    acc->n = n + (n < 38);
+  }
+}
+
+// FP128_from_chars, but giving the binary128 value.
+static inline char const *pfp128_chars_parse(char const *first,
+                                             char const *last, FP128SQ *out) {
+  char const *p = first;
+  sq_u128 sign = 0;
+  if (p != last && (*p == '-' || *p == '+'))
+    sign = *p++ == '-' ? SQ_SIGN_BIT : 0;
+  if (p != last && ((*p | 0x20) == 'i' || (*p | 0x20) == 'n'))
+    return pfp128_chars_special_in(p, last, sign, out);
+
+  // The value is 0.ddd * 10^decExp, where the ddd start at sig.
+  char const *sig = NULL, *start = p;
+  pfp128_chars_acc acc = {0, 0, 0, 0};
+  while (p != last && *p == '0')
+    p++;
+  char const *integer = p;
+  p = pfp128_chars_read_digits(p, last, &acc);
+  ptrdiff_t decExp = p - integer;
+  if (acc.n)
+    sig = integer;
+  int any = p != start;
+  if (p != last && *p == '.') {
+    char const *fraction = ++p;
+    if (!sig) {
+      while (p != last && *p == '0')
+        p++;
+      decExp = fraction - p;
+      if (p != last && pfp128_chars_isdigit(*p))
+        sig = p;
+    }
+    p = pfp128_chars_read_digits(p, last, &acc);
+    any |= p != fraction;
+  }
+  if (!any)
+    return NULL;
+  char const *digitsEnd = p;
+  if (p != last && (*p | 0x20) == 'e') {
+    char const *q = p + 1;
+    int negative = 0;
+    if (q != last && (*q == '-' || *q == '+'))
+      negative = *q++ == '-';
+    if (q != last && pfp128_chars_isdigit(*q)) {
+      // Large enough to take any value out of range.
+      ptrdiff_t x = 0;
+      for (; q != last && pfp128_chars_isdigit(*q); q++)
+        if (x < 100000)
+          x = x * 10 + (*q - '0');
+      decExp += negative ? -x : x;
+      p = q;
+    }
+  }
+
+  // The value is in [10^(decExp-1), 10^decExp).
+  if (!sig || decExp <= -4966) {
+    *out = sq_make(sign);
+    return p;
+  }
+  if (decExp > 4933) {
+    *out = sq_make(sign | SQ_INF_BITS);
+    return p;
+  }
+  int nw = acc.n, truncated = acc.truncated;
+  sq_u128 w = nw <= 19
+                  ? acc.high
+                  : (sq_u128)acc.high * pfp128_chars_pow10[nw - 19] + acc.low;
+  int e10 = (int)decExp - nw;
+  int r = e10 & 31, j = (e10 - r) / 32;
+  int shift = sq_clz(w), bexp = -shift, exact = !truncated;
+  sq_u128 x = w << shift;
+  if (r) {
+    sq_u128 t = pfp128_chars_pow5_128(r);
+    int c = sq_clz(t);
+    x = pfp128_chars_mul_norm(x, t << c, &bexp, &exact);
+    bexp += r - c;
+  }
+  pfp128_chars_power const *pw = pfp128_chars_powers + (j < 0 ? 8 : 0);
+  for (unsigned n = j < 0 ? -j : j; n; n >>= 1, pw++) {
+    if (n & 1) {
+      x = pfp128_chars_mul_norm(x, ((sq_u128)pw->hi << 64) | pw->lo, &bexp,
+                                &exact);
+      bexp += pw->exp;
+      exact &= pw->exact;
+    }
+  }
+
+  // The value is in [x, x + err] * 2^bexp.
+  int32_t exp = bexp + 127 + SQ_BIAS;
+  FP128SQ lo = sq_round_pack(sign, exp, sq_shr_sticky(x, 12));
+  sq_u128 err = truncated ? 80 : 40;
+  if (exact || (lo.bits & SQ_ABS_MASK) == SQ_INF_BITS ||
+      (x <= ~(sq_u128)0 - err &&
+       sq_round_pack(sign, exp, sq_shr_sticky(x + err, 12)).bits == lo.bits)) {
+    *out = lo;
+    return p;
+  }
+  // It's lo or the next value up, depending on which side of the half way
+  // point between them it is.
+  sq_u128 a = lo.bits & SQ_ABS_MASK, m = a & SQ_MANT_MASK;
+  int be = (int)(a >> 112);
+  if (be)
+    m |= SQ_IMPLICIT_BIT;
+  int c = pfp128_chars_compare(sig, digitsEnd, (int)decExp - 1, 2 * m + 1,
+                               (be ? be : 1) - SQ_BIAS - 113);
+  if (c > 0 || (c == 0 && (m & 1)))
+    a++;
+  *out = sq_make(sign | a);
+  return p;
+}
+
+// Read a value from [first, last), returning a pointer to the character
+// after it, or NULL if there isn't one there (in which case *out is not
+// changed). The syntax is that of strtod, without leading white space or
+// hexadecimal: an optional sign, then digits with an optional decimal point
+// and exponent, inf, infinity, nan or nan(chars) (in any case). The result
+// is correctly rounded (to nearest, ties to even), including when it
+// overflows or underflows.
+static inline char const *FP128_from_chars(char const *first,
+                                           char const *last, FP128 *out) {
+  FP128SQ b;
+  char const *p = pfp128_chars_parse(first, last, &b);
+  if (p)
+    *out = FP128_from_sq(b);
+  return p;
+}
+
+static inline int pfp128_chars_is_separator(char c) {
+  return c == ' ' || c == ',' || (c >= '\t' && c <= '\r');
+}
+
+static inline size_t pfp128_chars_parse_n(char const *p, char const *last,
+                                          FP128 *out, size_t n,
+                                          char const **end) {
+  size_t i = 0;
+  for (;;) {
+    while (p != last && pfp128_chars_is_separator(*p))
+      p++;
+    if (p == last || i == n)
+      break;
+    FP128SQ b;
+    char const *q = pfp128_chars_parse(p, last, &b);
+    if (!q || (q != last && !pfp128_chars_is_separator(*q)))
+      break;
+    out[i++] = FP128_from_sq(b);
+    p = q;
+  }
+  *end = p;
+  return i;
+}
+
+// If the code is compiled with OpenMP enabled FP128_from_chars_n splits
+// buffers of at least this many bytes into PFP128_CHARS_CHUNKS pieces, and
+// reads them in parallel.
+#if (defined(_OPENMP))
+#if (!defined(PFP128_FROM_CHARS_OMP_THRESHOLD))
+#define PFP128_FROM_CHARS_OMP_THRESHOLD 65536
+#endif
+#define PFP128_CHARS_CHUNKS 64
+
+static inline size_t pfp128_chars_parse_n_parallel(char const *first,
+                                                   char const *last,
+                                                   FP128 *out, size_t n,
+                                                   char const **end) {
+  // Split at separators, so that no value is split, then count the values
+  // in each chunk to find where its values go.
+  char const *start[PFP128_CHARS_CHUNKS + 1], *stop[PFP128_CHARS_CHUNKS];
+  size_t count[PFP128_CHARS_CHUNKS], offset[PFP128_CHARS_CHUNKS],
+      done[PFP128_CHARS_CHUNKS];
+  size_t len = (size_t)(last - first);
+  start[0] = first;
+  start[PFP128_CHARS_CHUNKS] = last;
+  for (int c = 1; c < PFP128_CHARS_CHUNKS; c++) {
+    char const *p = first + len / PFP128_CHARS_CHUNKS * c;
+    if (p < start[c - 1])
+      p = start[c - 1];
+    while (p != last && !pfp128_chars_is_separator(*p))
+      p++;
+    start[c] = p;
+  }
+  _Pragma("omp parallel for schedule(static)")
+  for (int c = 0; c < PFP128_CHARS_CHUNKS; c++) {
+    size_t values = 0;
+    int inValue = 0;
+    for (char const *p = start[c]; p != start[c + 1]; p++) {
+      int isValue = !pfp128_chars_is_separator(*p);
+      values += isValue & !inValue;
+      inValue = isValue;
+    }
+    count[c] = values;
+  }
+  size_t total = 0;
+  for (int c = 0; c < PFP128_CHARS_CHUNKS; c++) {
+    offset[c] = total;
+    total += count[c];
+    if (offset[c] >= n)
+      count[c] = 0;
+    else if (count[c] > n - offset[c])
+      count[c] = n - offset[c];
+  }
+  _Pragma("omp parallel for schedule(dynamic)")
+  for (int c = 0; c < PFP128_CHARS_CHUNKS; c++)
+    done[c] = count[c] ? pfp128_chars_parse_n(start[c], start[c + 1],
+                                              out + offset[c], count[c],
+                                              &stop[c])
+                       : 0;
+
+  // Stop at the first chunk which had a problem, or has the n'th value.
+  total = 0;
+  for (int c = 0; c < PFP128_CHARS_CHUNKS; c++) {
+    if (!count[c])
+      continue;
+    total += done[c];
+    if (done[c] < count[c]) {
+      *end = stop[c];
+      return total;
+    }
+    if (total == n)
+      break;
+  }
+  char const *p = first;
+  for (int c = 0; c < PFP128_CHARS_CHUNKS; c++)
+    if (count[c])
+      p = stop[c];
+  while (p != last && pfp128_chars_is_separator(*p))
+    p++;
+  *end = p;
+  return total;
+}
+#endif
+
+// Read up to n values, separated by white space or commas, from
+// [first, last) into out, returning how many were read. Reading stops at
+// the end of the buffer, after n values, or at something which isn't a
+// value (or is a value followed by something other than a separator);
+// *end (if end isn't NULL) is set to where it stopped, after any
+// separators, so that you can carry on from there.
+//
+// A value which runs up to last is accepted, so if you're reading a stream
+// in blocks, only give it the part of each block up to the last separator.
+static inline size_t FP128_from_chars_n(char const *first, char const *last,
+                                        FP128 *out, size_t n,
+                                        char const **end) {
+  char const *stop;
+  size_t done;
+#if (defined(_OPENMP))
+  if (last - first >= PFP128_FROM_CHARS_OMP_THRESHOLD)
+    done = pfp128_chars_parse_n_parallel(first, last, out, n, &stop);
+  else
+#endif
+    done = pfp128_chars_parse_n(first, last, out, n, &stop);
+  if (end)
+    *end = stop;
+  return done;
+}
+
+#endif // Header monotonicity
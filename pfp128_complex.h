@@ -0,0 +1,233 @@
+//===-- pfp128_complex.h - Fast complex arithmetic on COMPLEX_FP128 -*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Complex multiplication and division with the textbook formulae, as if
+ * CX_LIMITED_RANGE were on:
+ *
+ *   cmulFP128(a, b)        a * b
+ *   cdivFP128(a, b)        a / b
+ *   cdivScaledFP128(a, b)  a / b, for any size of b
+ *   cfmaFP128(a, b, c)     a * b + c
+ *
+ * The compiler's * and / on complex values call __multc3 and __divtc3,
+ * which recover the infinities and NaNs that the formulae get wrong; these
+ * don't, so cmulFP128 can give a NaN where __multc3 would give an infinity,
+ * and cdivFP128 overflows or underflows if |b|^2 does (so when |b| is above
+ * about 1e2466 with binary128, or 1e154 with double-double, or below the
+ * reciprocals of those). cdivScaledFP128 first scales b by a power of two so
+ * that |b| is about one, which costs a little more.
+ *
+ * When FP128 is binary128 each a * b + c * d is computed exactly and
+ * rounded once (with dot2sq from pfp128_soft.h), which is both faster than
+ * two products and a sum, and more accurate: the parts of cmulFP128 are
+ * correctly rounded, and those of cdivFP128 within about 1.5 ulp. cfmaFP128
+ * likewise rounds each part of a * b + c once (with dot2addsq), so it is a
+ * true fused multiply-add. With double-double it is the multiply and then
+ * the add.
+ *
+ * There are array versions in the style of pfp128.h's batched functions:
+ *
+ *   cmulFP128_n(a, b, out, n)      out[i] = a[i] * b[i]
+ *   cmulFP128_nsv(a, b, out, n)    out[i] = a * b[i]
+ *   cdivFP128_n(a, b, out, n)      out[i] = a[i] / b[i]
+ *   cdivScaledFP128_n(a, b, out, n)
+ *   cfmaFP128_n(a, b, c, out, n)   out[i] = a[i] * b[i] + c[i]
+ *   cfmaFP128_nsvv(a, x, y, out, n)  out[i] = a * x[i] + y[i]
+ *
+ * which run in parallel with OpenMP once n reaches PFP128_OMP_THRESHOLD.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_COMPLEX_H_INCLUDED_))
+#define _PFP128_COMPLEX_H_INCLUDED_ 1
+
+#include "pfp128.h"
+
+#include <stddef.h>
+
+#if (!PFP128_IS_DD && defined(__SIZEOF_INT128__) &&                           \
+     (defined(__x86_64__) || LDBL_MANT_DIG == 113))
+#include "pfp128_soft.h"
+#define PFP128_COMPLEX_SOFT 1
+#endif
+
+// a * b + c * d
+static inline FP128 pfp128_complex_dot2(FP128 a, FP128 b, FP128 c, FP128 d) {
+#if (PFP128_COMPLEX_SOFT)
+  return FP128_from_sq(dot2sq(FP128_to_sq(a), FP128_to_sq(b), FP128_to_sq(c),
+                              FP128_to_sq(d)));
+#else
+  return addFP128(mulFP128(a, b), mulFP128(c, d));
+#endif
+}
+
+// a * b + c * d + e
+static inline FP128 pfp128_complex_dot2add(FP128 a, FP128 b, FP128 c, FP128 d,
+                                           FP128 e) {
+#if (PFP128_COMPLEX_SOFT)
+  return FP128_from_sq(dot2addsq(FP128_to_sq(a), FP128_to_sq(b),
+                                 FP128_to_sq(c), FP128_to_sq(d),
+                                 FP128_to_sq(e)));
+#else
+  return addFP128(pfp128_complex_dot2(a, b, c, d), e);
+#endif
+}
+
+// With binary128 we use pfp128_soft.h's inline arithmetic for the rest too.
+static inline FP128 pfp128_complex_add(FP128 a, FP128 b) {
+#if (PFP128_COMPLEX_SOFT)
+  return FP128_from_sq(addsq(FP128_to_sq(a), FP128_to_sq(b)));
+#else
+  return addFP128(a, b);
+#endif
+}
+
+static inline FP128 pfp128_complex_mul(FP128 a, FP128 b) {
+#if (PFP128_COMPLEX_SOFT)
+  return FP128_from_sq(mulsq(FP128_to_sq(a), FP128_to_sq(b)));
+#else
+  return mulFP128(a, b);
+#endif
+}
+
+static inline FP128 pfp128_complex_div(FP128 a, FP128 b) {
+#if (PFP128_COMPLEX_SOFT)
+  return FP128_from_sq(divsq(FP128_to_sq(a), FP128_to_sq(b)));
+#else
+  return divFP128(a, b);
+#endif
+}
+
+static inline COMPLEX_FP128 cmulFP128(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  FP128 ar = crealFP128(a), ai = cimagFP128(a);
+  FP128 br = crealFP128(b), bi = cimagFP128(b);
+  return CMPLXFP128(pfp128_complex_dot2(ar, br, negFP128(ai), bi),
+                    pfp128_complex_dot2(ar, bi, ai, br));
+}
+
+static inline COMPLEX_FP128 cfmaFP128(COMPLEX_FP128 a, COMPLEX_FP128 b,
+                                      COMPLEX_FP128 c) {
+  FP128 ar = crealFP128(a), ai = cimagFP128(a);
+  FP128 br = crealFP128(b), bi = cimagFP128(b);
+  return CMPLXFP128(
+      pfp128_complex_dot2add(ar, br, negFP128(ai), bi, crealFP128(c)),
+      pfp128_complex_dot2add(ar, bi, ai, br, cimagFP128(c)));
+}
+
+static inline COMPLEX_FP128 cdivFP128(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  FP128 ar = crealFP128(a), ai = cimagFP128(a);
+  FP128 br = crealFP128(b), bi = cimagFP128(b);
+  FP128 d = pfp128_complex_dot2(br, br, bi, bi);
+  return CMPLXFP128(
+      pfp128_complex_div(pfp128_complex_dot2(ar, br, ai, bi), d),
+      pfp128_complex_div(pfp128_complex_dot2(ai, br, negFP128(ar), bi), d));
+}
+
+// Set *scale to a power of two, 2^-e, which brings the larger part of b to
+// about one. Multiplying by it is exact, and much quicker than ldexp. We
+// give up (returning 0) on zeros, infinities and NaNs, and where 2^-e isn't
+// a normal number, which leaves only very large or very small b.
+static inline int pfp128_complex_scale(FP128 br, FP128 bi, FP128 *scale) {
+#if (PFP128_COMPLEX_SOFT)
+  sq_u128 r = FP128_to_sq(br).bits & SQ_ABS_MASK;
+  sq_u128 i = FP128_to_sq(bi).bits & SQ_ABS_MASK;
+  int32_t e = (int32_t)((r > i ? r : i) >> 112);
+  if (e == 0 || e >= SQ_EXP_MAX - 1)
+    return 0;
+  *scale = FP128_from_sq(sq_make((sq_u128)(2 * SQ_BIAS - e) << 112));
+  return 1;
+#elif (PFP128_IS_DD)
+  double m = fmax(fabs(br.hi), fabs(bi.hi));
+  if (!(m >= DBL_MIN && m <= 0x1p1022))
+    return 0;
+  *scale = dd_make(ldexp(1.0, -ilogb(m)), 0.0);
+  return 1;
+#else
+  FP128 big = gtFP128(fabsFP128(br), fabsFP128(bi)) ? br : bi;
+  if (!isfiniteFP128(big) || eqFP128(big, FP128_from_double(0.0)))
+    return 0;
+  int e = ilogbFP128(big);
+  if (e < FP128_MIN_EXP || e >= FP128_MAX_EXP - 1)
+    return 0;
+  *scale = ldexpFP128(FP128_from_double(1.0), -e);
+  return 1;
+#endif
+}
+
+static inline COMPLEX_FP128 cdivScaledFP128(COMPLEX_FP128 a,
+                                            COMPLEX_FP128 b) {
+  FP128 br = crealFP128(b), bi = cimagFP128(b), scale;
+  if (pfp128_complex_scale(br, bi, &scale)) {
+    // a / b = (a / (b * 2^-e)) * 2^-e.
+    COMPLEX_FP128 q = cdivFP128(a, CMPLXFP128(pfp128_complex_mul(br, scale),
+                                              pfp128_complex_mul(bi, scale)));
+    return CMPLXFP128(pfp128_complex_mul(crealFP128(q), scale),
+                      pfp128_complex_mul(cimagFP128(q), scale));
+  }
+  FP128 big = gtFP128(fabsFP128(br), fabsFP128(bi)) ? br : bi;
+  if (!isfiniteFP128(big) || eqFP128(big, FP128_from_double(0.0)))
+    return cdivFP128(a, b);
+  int e = ilogbFP128(big);
+  COMPLEX_FP128 q =
+      cdivFP128(a, CMPLXFP128(ldexpFP128(br, -e), ldexpFP128(bi, -e)));
+  return CMPLXFP128(ldexpFP128(crealFP128(q), -e),
+                    ldexpFP128(cimagFP128(q), -e));
+}
+
+// The array versions.
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_COMPLEX_LOOP                                                    \
+  _Pragma("omp parallel for schedule(static) if (n >= PFP128_OMP_THRESHOLD)")
+#else
+#define PFP128_COMPLEX_LOOP
+#endif
+
+// clang-format off
+#define CreateComplexBatch(basename)                                    \
+static inline void basename ## FP128_n(COMPLEX_FP128 const *a,          \
+                                       COMPLEX_FP128 const *b,          \
+                                       COMPLEX_FP128 *out, size_t n) {  \
+  PFP128_COMPLEX_LOOP                                                   \
+  for (size_t i = 0; i < n; i++)                                        \
+    out[i] = basename ## FP128(a[i], b[i]);                             \
+}
+
+CreateComplexBatch(cmul)
+CreateComplexBatch(cdiv)
+CreateComplexBatch(cdivScaled)
+#undef CreateComplexBatch
+// clang-format on
+
+static inline void cmulFP128_nsv(COMPLEX_FP128 a, COMPLEX_FP128 const *b,
+                                 COMPLEX_FP128 *out, size_t n) {
+  PFP128_COMPLEX_LOOP
+  for (size_t i = 0; i < n; i++)
+    out[i] = cmulFP128(a, b[i]);
+}
+
+static inline void cfmaFP128_n(COMPLEX_FP128 const *a, COMPLEX_FP128 const *b,
+                               COMPLEX_FP128 const *c, COMPLEX_FP128 *out,
+                               size_t n) {
+  PFP128_COMPLEX_LOOP
+  for (size_t i = 0; i < n; i++)
+    out[i] = cfmaFP128(a[i], b[i], c[i]);
+}
+
+static inline void cfmaFP128_nsvv(COMPLEX_FP128 a, COMPLEX_FP128 const *x,
+                                  COMPLEX_FP128 const *y, COMPLEX_FP128 *out,
+                                  size_t n) {
+  PFP128_COMPLEX_LOOP
+  for (size_t i = 0; i < n; i++)
+    out[i] = cfmaFP128(a, x[i], y[i]);
+}
+
+#undef PFP128_COMPLEX_LOOP
+
+#endif // Header monotonicity
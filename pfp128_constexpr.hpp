@@ -0,0 +1,329 @@
+//===-- pfp128_constexpr.hpp - Compile time binary128 constants -*- C++ -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * IEEE binary128 arithmetic which can be done at compile time, and a _q
+ * literal, so that tables of constants (quadrature weights, polynomial
+ * coefficients, ...) can be computed by the compiler and placed in read-only
+ * data, rather than being built at startup with strtoFP128 and libquadmath.
+ *
+ *   using namespace pfp128::literals;
+ *   static constexpr pfp128::fp128 weights[] = {
+ *     1_q / 3_q, 4_q / 3_q, sqrt(2_q) / 2_q, 0.1_q,
+ *   };
+ *
+ * A literal is a pfp128::binary128, which has constexpr +, -, *, /,
+ * comparisons, sqrt and fma (using pfp128_soft.h's functions, which are
+ * constexpr in C++14), and converts to pfp128::fp128 (at compile time too).
+ * The literal is converted from all of its digits, so it is correctly
+ * rounded, and the arithmetic is correctly rounded, so with the native
+ * backend the results are bit identical to those computed at run time.
+ * With the double-double backend the constants are computed in binary128
+ * and then split into two doubles, as FP128_CONST does.
+ *
+ * Decimal (1.5e-3_q), hexadecimal (0x1.8p-3_q) and integer (42_q) literals
+ * are all accepted. Each literal is evaluated by the compiler even when it's
+ * not used in a constant expression.
+ *
+ * This needs C++14, and a compiler with __builtin_bit_cast (GCC 11, Clang 9
+ * or later).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_CONSTEXPR_HPP_INCLUDED_))
+#define _PFP128_CONSTEXPR_HPP_INCLUDED_ 1
+
+#include "pfp128.hpp"
+#include "pfp128_soft.h"
+
+#include <stdint.h>
+
+#if (!SQ_HAVE_CONSTEXPR)
+#error pfp128_constexpr.hpp needs C++14 and __builtin_bit_cast.
+#endif
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_constexpr.hpp needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+namespace pfp128 {
+
+class binary128 {
+public:
+  FP128SQ q;
+
+  constexpr binary128() : q{0} {}
+  constexpr explicit binary128(FP128SQ x) : q(x) {}
+  constexpr binary128(int i) : q(sq_from_ll(i)) {}
+  constexpr binary128(long long i) : q(sq_from_ll(i)) {}
+  constexpr binary128(double d) : q(sq_from_double(d)) {}
+
+  constexpr operator fp128() const {
+#if (PFP128_IS_DD)
+    // Split into two doubles, as DD_CONST does.
+    double hi = sq_to_double(q);
+    if (!isfinitesq(sq_from_double(hi)))
+      return PFP128_DD_MAKE(hi, 0.0);
+    return PFP128_DD_MAKE(hi, sq_to_double(subsq(q, sq_from_double(hi))));
+#else
+    return __builtin_bit_cast(FP128, q.bits);
+#endif
+  }
+};
+
+constexpr binary128 operator+(binary128 x) { return x; }
+constexpr binary128 operator-(binary128 x) { return binary128(negsq(x.q)); }
+constexpr binary128 operator+(binary128 x, binary128 y) {
+  return binary128(addsq(x.q, y.q));
+}
+constexpr binary128 operator-(binary128 x, binary128 y) {
+  return binary128(subsq(x.q, y.q));
+}
+constexpr binary128 operator*(binary128 x, binary128 y) {
+  return binary128(mulsq(x.q, y.q));
+}
+constexpr binary128 operator/(binary128 x, binary128 y) {
+  return binary128(divsq(x.q, y.q));
+}
+constexpr bool operator==(binary128 x, binary128 y) { return eqsq(x.q, y.q); }
+constexpr bool operator!=(binary128 x, binary128 y) { return nesq(x.q, y.q); }
+constexpr bool operator<(binary128 x, binary128 y) { return ltsq(x.q, y.q); }
+constexpr bool operator<=(binary128 x, binary128 y) { return lesq(x.q, y.q); }
+constexpr bool operator>(binary128 x, binary128 y) { return gtsq(x.q, y.q); }
+constexpr bool operator>=(binary128 x, binary128 y) { return gesq(x.q, y.q); }
+
+constexpr binary128 sqrt(binary128 x) { return binary128(sqrtsq(x.q)); }
+constexpr binary128 fabs(binary128 x) { return binary128(fabssq(x.q)); }
+constexpr binary128 fma(binary128 x, binary128 y, binary128 z) {
+  return binary128(fmasq(x.q, y.q, z.q));
+}
+
+namespace detail {
+// Enough for the exact value of any literal we convert (see parse_decimal).
+#define PFP128_CONSTEXPR_WORDS 264
+#define PFP128_CONSTEXPR_MAX_DIGITS 800
+
+// A non-negative integer, with its words least significant first.
+struct bignum {
+  uint64_t w[PFP128_CONSTEXPR_WORDS] = {};
+  int n = 0; // The number of words in use.
+};
+
+// b = b * m + a.
+constexpr void bignum_mul_add(bignum &b, uint64_t m, uint64_t a) {
+  sq_u128 carry = a;
+  for (int i = 0; i < b.n; i++) {
+    carry += (sq_u128)b.w[i] * m;
+    b.w[i] = (uint64_t)carry;
+    carry >>= 64;
+  }
+  if (carry)
+    b.w[b.n++] = (uint64_t)carry;
+}
+
+// b = floor(b / d), returning whether the remainder is non-zero.
+constexpr bool bignum_div(bignum &b, uint64_t d) {
+  sq_u128 rem = 0;
+  for (int i = b.n - 1; i >= 0; i--) {
+    sq_u128 cur = (rem << 64) | b.w[i];
+    b.w[i] = (uint64_t)(cur / d);
+    rem = cur % d;
+  }
+  while (b.n > 0 && b.w[b.n - 1] == 0)
+    b.n--;
+  return rem != 0;
+}
+
+constexpr void bignum_shl(bignum &b, int bits) {
+  int words = bits / 64, shift = bits % 64;
+  for (int i = b.n - 1 + words + 1; i >= 0; i--) {
+    int from = i - words;
+    uint64_t hi = from >= 0 && from < b.n ? b.w[from] : 0;
+    uint64_t lo = from >= 1 && from - 1 < b.n ? b.w[from - 1] : 0;
+    b.w[i] = shift ? (hi << shift) | (lo >> (64 - shift)) : hi;
+  }
+  b.n += words + 1;
+  while (b.n > 0 && b.w[b.n - 1] == 0)
+    b.n--;
+}
+
+// The position of the most significant bit, or -1 if b is zero.
+constexpr int bignum_top(bignum const &b) {
+  if (b.n == 0)
+    return -1;
+  uint64_t top = b.w[b.n - 1];
+  return 64 * (b.n - 1) + 63 - __builtin_clzll(top);
+}
+
+// The bits [pos, pos + 128) of b (pos >= 0), with the lowest set if any of
+// the bits below them are.
+constexpr sq_u128 bignum_bits(bignum const &b, int pos) {
+  sq_u128 r = 0;
+  bool sticky = false;
+  for (int i = 0; i < b.n; i++) {
+    int shift = 64 * i - pos;
+    sq_u128 v = b.w[i];
+    if (shift <= -64)
+      sticky = sticky || v != 0;
+    else if (shift < 0)
+      r |= v >> -shift, sticky = sticky || (uint64_t)(v << (64 + shift)) != 0;
+    else if (shift < 128)
+      r |= v << shift;
+  }
+  return r | (sq_u128)sticky;
+}
+
+// Round b * 2^exp2 (and a bit more, if sticky) to binary128.
+constexpr FP128SQ bignum_round(bignum const &b, int32_t exp2, bool sticky) {
+  int top = bignum_top(b);
+  if (top < 0)
+    return sq_make(0);
+  // sq_round_pack wants the leading bit at 115.
+  sq_u128 sig = top >= 115 ? bignum_bits(b, top - 115)
+                           : bignum_bits(b, 0) << (115 - top);
+  int64_t exp = (int64_t)exp2 + top + SQ_BIAS;
+  if (exp >= SQ_EXP_MAX)
+    return sq_make(SQ_INF_BITS);
+  if (exp < -200)
+    exp = -200; // Far enough down that it rounds to zero.
+  return sq_round_pack(0, (int32_t)exp, sig | (sq_u128)sticky);
+}
+
+constexpr int digit_value(char c) {
+  return c >= '0' && c <= '9'   ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                : -1;
+}
+
+// A hexadecimal, octal or binary literal (after its prefix), which may be
+// a hexadecimal floating point literal.
+constexpr FP128SQ parse_radix(char const *s, int radix) {
+  int bitsPerDigit = radix == 16 ? 4 : radix == 8 ? 3 : 1;
+  bignum b;
+  int32_t exp2 = 0;
+  bool fraction = false, sticky = false;
+  for (; *s && *s != 'p' && *s != 'P'; s++) {
+    if (*s == '.') {
+      fraction = true;
+    } else if (*s != '\'') {
+      // Beyond the precision we need, only whether the digits are zero
+      // matters.
+      if (bignum_top(b) > 256) {
+        sticky = sticky || digit_value(*s) != 0;
+        exp2 += bitsPerDigit;
+      } else {
+        bignum_mul_add(b, (uint64_t)radix, (uint64_t)digit_value(*s));
+      }
+      if (fraction)
+        exp2 -= bitsPerDigit;
+    }
+  }
+  if (*s) {
+    s++;
+    bool negative = *s == '-';
+    if (*s == '-' || *s == '+')
+      s++;
+    int32_t e = 0;
+    for (; *s; s++)
+      if (e < 100000)
+        e = 10 * e + (*s - '0');
+    exp2 += negative ? -e : e;
+  }
+  return bignum_round(b, exp2, sticky);
+}
+
+// A decimal literal, digits * 10^exp10 = digits * 5^exp10 * 2^exp10.
+constexpr FP128SQ parse_decimal(char const *s) {
+  bignum b;
+  int32_t exp10 = 0, digits = 0;
+  bool fraction = false, sticky = false;
+  for (; *s && *s != 'e' && *s != 'E'; s++) {
+    if (*s == '.') {
+      fraction = true;
+    } else if (*s != '\'') {
+      int d = *s - '0';
+      // Beyond 800 significant digits only whether they are zero matters,
+      // since there are far more than enough bits.
+      if (digits >= PFP128_CONSTEXPR_MAX_DIGITS) {
+        sticky = sticky || d != 0;
+        exp10++;
+      } else if (digits > 0 || d != 0) {
+        bignum_mul_add(b, 10, (uint64_t)d);
+        digits++;
+      }
+      if (fraction)
+        exp10--;
+    }
+  }
+  if (*s) {
+    s++;
+    bool negative = *s == '-';
+    if (*s == '-' || *s == '+')
+      s++;
+    int32_t e = 0;
+    for (; *s; s++)
+      if (e < 100000)
+        e = 10 * e + (*s - '0');
+    exp10 += negative ? -e : e;
+  }
+  if (digits == 0)
+    return sq_make(0);
+  // The value is in [10^(digits + exp10 - 1), 10^(digits + exp10)), so we can
+  // see when it's out of range without computing it.
+  if (digits + exp10 > 4933)
+    return sq_make(SQ_INF_BITS);
+  if (digits + exp10 < -4966)
+    return sq_make(0);
+  uint64_t const pow5_27 = 7450580596923828125ull; // 5^27
+  int32_t m = exp10 >= 0 ? exp10 : -exp10;
+  uint64_t rest = 1; // 5^(m % 27)
+  for (int32_t i = 0; i < m % 27; i++)
+    rest *= 5;
+  if (exp10 >= 0) {
+    for (; m >= 27; m -= 27)
+      bignum_mul_add(b, pow5_27, 0);
+    bignum_mul_add(b, rest, 0);
+    return bignum_round(b, exp10, sticky);
+  }
+  // Divide by 5^m, after shifting up far enough that the quotient still has
+  // more than the 116 bits we need. floor(floor(x / a) / b) is
+  // floor(x / (a * b)), so dividing in pieces is exact, and the result is
+  // inexact if any of the divisions were.
+  int32_t shift = m * 2322 / 1000 + 122 - bignum_top(b); // log2(5) < 2.322
+  if (shift < 0)
+    shift = 0;
+  bignum_shl(b, shift);
+  for (; m >= 27; m -= 27)
+    sticky = bignum_div(b, pow5_27) || sticky;
+  sticky = bignum_div(b, rest) || sticky;
+  return bignum_round(b, exp10 - shift, sticky);
+}
+
+constexpr FP128SQ parse_literal(char const *s) {
+  if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    return parse_radix(s + 2, 16);
+  if (s[0] == '0' && (s[1] == 'b' || s[1] == 'B'))
+    return parse_radix(s + 2, 2);
+  bool decimal = s[0] != '0';
+  for (char const *p = s; *p; p++)
+    decimal = decimal || *p == '.' || *p == 'e' || *p == 'E';
+  // An integer with a leading zero is octal, as in C++.
+  return decimal ? parse_decimal(s) : parse_radix(s, 8);
+}
+} // namespace detail
+
+namespace literals {
+template <char... digits> constexpr binary128 operator""_q() {
+  constexpr char text[] = {digits..., '\0'};
+  // (Initialising a constexpr variable forces compile time evaluation.)
+  constexpr FP128SQ value = detail::parse_literal(text);
+  return binary128(value);
+}
+} // namespace literals
+
+} // namespace pfp128
+
+#endif // Header monotonicity
@@ -0,0 +1,2312 @@
+//===-- pfp128_dd.h - Double-double implementation of the FP128 interfaces
+//--------------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * A double-double ("DD") implementation of the maths library functions that
+ * pfp128.h shims. A value is the unevaluated sum of two doubles, hi + lo, with
+ * |lo| <= ulp(hi)/2, so we get 106 bits of mantissa (rather than the 113 of
+ * IEEE binary128) but only the exponent range of double. In exchange all of
+ * the arithmetic is done in hardware double precision, which is an order of
+ * magnitude faster than the soft-float binary128 routines.
+ *
+ * You should not normally include this directly; pfp128.h includes it when
+ * PFP128_BACKEND is DD. The functions are named as in the C library with a
+ * "dd" suffix (sindd, cexpdd, ...) so that pfp128.h can map onto them in the
+ * same way that it maps onto the q and l suffixed functions.
+ *
+ * The basic algorithms are those of the QD library (Hida, Li and Bailey,
+ * "Library for Double-Double and Quad-Double Arithmetic").
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_DD_H_INCLUDED_))
+#define _PFP128_DD_H_INCLUDED_ 1
+
+#include <ctype.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The error free transformations below rely on every double operation being
+// rounded to double, and on the compiler not re-associating anything.
+// (FLT_EVAL_METHOD is 16 when only _Float16 is evaluated more widely.)
+#if (defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0 && FLT_EVAL_METHOD != 16)
+#warning pfp128_dd.h needs FLT_EVAL_METHOD == 0 (e.g. SSE2 rather than x87)
+#endif
+#if (defined(__FAST_MATH__))
+#warning pfp128_dd.h will give wrong answers when compiled with -ffast-math
+#endif
+
+typedef struct {
+  double hi, lo;
+} FP128DD;
+
+typedef struct {
+  FP128DD re, im;
+} COMPLEX_FP128DD;
+
+static inline FP128DD dd_make(double hi, double lo) {
+  FP128DD r;
+  r.hi = hi;
+  r.lo = lo;
+  return r;
+}
+
+static inline COMPLEX_FP128DD dd_cmake(FP128DD re, FP128DD im) {
+  COMPLEX_FP128DD r;
+  r.re = re;
+  r.im = im;
+  return r;
+}
+
+static inline FP128DD strtodd(char const *s, char **sp);
+
+// A constant expression, so that it can be used in static initialisers.
+#if (defined(__cplusplus))
+#define PFP128_DD_MAKE(hi, lo) (FP128DD{(hi), (lo)})
+#else
+#define PFP128_DD_MAKE(hi, lo) ((FP128DD){(hi), (lo)})
+#endif
+
+// Constants are split into their hi and lo parts at compile time if we have a
+// wider type in which to write the literal; otherwise we have to parse the
+// string at run time.
+#if (defined(__LONG_DOUBLE_IEEE128__) ||                                       \
+     (__aarch64__ && !(__APPLE__ && __MACH__)) || __riscv)
+#define PFP128_DD_WIDE(val) val##L
+#elif (__x86_64__)
+#define PFP128_DD_WIDE(val) val##Q
+#endif
+
+#if (defined(PFP128_DD_WIDE))
+#define DD_CONST(val)                                                          \
+  PFP128_DD_MAKE((double)PFP128_DD_WIDE(val),                                  \
+                 (double)(PFP128_DD_WIDE(val) -                                \
+                          (double)PFP128_DD_WIDE(val)))
+#else
+#define DD_CONST(val) strtodd(#val, (char **)0)
+#endif
+
+#define HUGE_VALdd PFP128_DD_MAKE(HUGE_VAL, 0.0)
+
+// Error free transformations.
+// s + e == a + b exactly, provided |a| >= |b|.
+static inline FP128DD dd_quick_two_sum(double a, double b) {
+  double s = a + b;
+  return dd_make(s, b - (s - a));
+}
+
+// s + e == a + b exactly.
+static inline FP128DD dd_two_sum(double a, double b) {
+  double s = a + b;
+  double bb = s - a;
+  return dd_make(s, (a - (s - bb)) + (b - bb));
+}
+
+// p + e == a * b exactly.
+#if (defined(FP_FAST_FMA))
+static inline FP128DD dd_two_prod(double a, double b) {
+  double p = a * b;
+  return dd_make(p, fma(a, b, -p));
+}
+#else
+// Without a hardware fma we use Dekker's algorithm, which needs Veltkamp's
+// split of each argument into two 26 bit halves.
+static inline void dd_split(double a, double *hi, double *lo) {
+  double const splitter = 134217729.0; // 2^27 + 1
+  if (fabs(a) > 6.69692879491417e+299) { // 2^996; avoid overflow
+    a *= 3.7252902984619140625e-09;      // 2^-28
+    double t = splitter * a;
+    *hi = t - (t - a);
+    *lo = a - *hi;
+    *hi *= 268435456.0; // 2^28
+    *lo *= 268435456.0;
+  } else {
+    double t = splitter * a;
+    *hi = t - (t - a);
+    *lo = a - *hi;
+  }
+}
+
+static inline FP128DD dd_two_prod(double a, double b) {
+  double ah, al, bh, bl;
+  double p = a * b;
+  dd_split(a, &ah, &al);
+  dd_split(b, &bh, &bl);
+  return dd_make(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+}
+#endif
+
+// Basic arithmetic.
+// Non-finite values are always returned as {x, 0}, and we are careful to
+// preserve the sign of zero.
+static inline FP128DD dd_from_double(double a) { return dd_make(a, 0.0); }
+static inline double dd_to_double(FP128DD a) { return a.hi + a.lo; }
+
+static inline FP128DD negdd(FP128DD a) { return dd_make(-a.hi, -a.lo); }
+
+static inline FP128DD adddd(FP128DD a, FP128DD b) {
+  FP128DD s = dd_two_sum(a.hi, b.hi);
+  if (!isfinite(s.hi))
+    return dd_make(s.hi, 0.0);
+  FP128DD t = dd_two_sum(a.lo, b.lo);
+  s.lo += t.hi;
+  s = dd_quick_two_sum(s.hi, s.lo);
+  s.lo += t.lo;
+  s = dd_quick_two_sum(s.hi, s.lo);
+  if (s.hi == 0.0)
+    return dd_make(a.hi + b.hi, 0.0);
+  return s;
+}
+
+static inline FP128DD subdd(FP128DD a, FP128DD b) {
+  return adddd(a, negdd(b));
+}
+
+static inline FP128DD dd_add_d(FP128DD a, double b) {
+  FP128DD s = dd_two_sum(a.hi, b);
+  if (!isfinite(s.hi))
+    return dd_make(s.hi, 0.0);
+  s.lo += a.lo;
+  s = dd_quick_two_sum(s.hi, s.lo);
+  if (s.hi == 0.0)
+    return dd_make(a.hi + b, 0.0);
+  return s;
+}
+
+static inline FP128DD muldd(FP128DD a, FP128DD b) {
+  FP128DD p = dd_two_prod(a.hi, b.hi);
+  if (!isfinite(p.hi) || p.hi == 0.0)
+    return dd_make(p.hi, 0.0);
+  p.lo += a.hi * b.lo + a.lo * b.hi;
+  return dd_quick_two_sum(p.hi, p.lo);
+}
+
+static inline FP128DD dd_mul_d(FP128DD a, double b) {
+  FP128DD p = dd_two_prod(a.hi, b);
+  if (!isfinite(p.hi) || p.hi == 0.0)
+    return dd_make(p.hi, 0.0);
+  p.lo += a.lo * b;
+  return dd_quick_two_sum(p.hi, p.lo);
+}
+
+static inline FP128DD dd_sqr(FP128DD a) {
+  FP128DD p = dd_two_prod(a.hi, a.hi);
+  if (!isfinite(p.hi) || p.hi == 0.0)
+    return dd_make(p.hi, 0.0);
+  p.lo += 2.0 * a.hi * a.lo;
+  p.lo += a.lo * a.lo;
+  return dd_quick_two_sum(p.hi, p.lo);
+}
+
+static inline FP128DD divdd(FP128DD a, FP128DD b) {
+  double q1 = a.hi / b.hi;
+  if (!isfinite(q1) || q1 == 0.0)
+    return dd_make(q1, 0.0);
+  FP128DD r = subdd(a, dd_mul_d(b, q1));
+  double q2 = r.hi / b.hi;
+  r = subdd(r, dd_mul_d(b, q2));
+  double q3 = r.hi / b.hi;
+  return dd_add_d(dd_quick_two_sum(q1, q2), q3);
+}
+
+static inline FP128DD dd_div_d(FP128DD a, double b) {
+  double q1 = a.hi / b;
+  if (!isfinite(q1) || q1 == 0.0)
+    return dd_make(q1, 0.0);
+  FP128DD p = dd_two_prod(q1, b);
+  FP128DD s = dd_two_sum(a.hi, -p.hi);
+  s.lo -= p.lo;
+  s.lo += a.lo;
+  double q2 = (s.hi + s.lo) / b;
+  return dd_quick_two_sum(q1, q2);
+}
+
+// Comparison and classification.
+static inline int eqdd(FP128DD a, FP128DD b) {
+  return a.hi == b.hi && a.lo == b.lo;
+}
+static inline int nedd(FP128DD a, FP128DD b) { return !eqdd(a, b); }
+static inline int ltdd(FP128DD a, FP128DD b) {
+  return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+static inline int ledd(FP128DD a, FP128DD b) {
+  return a.hi < b.hi || (a.hi == b.hi && a.lo <= b.lo);
+}
+static inline int gtdd(FP128DD a, FP128DD b) { return ltdd(b, a); }
+static inline int gedd(FP128DD a, FP128DD b) { return ledd(b, a); }
+
+static inline int isnandd(FP128DD a) { return isnan(a.hi); }
+static inline int isinfdd(FP128DD a) { return isinf(a.hi); }
+static inline int isfinitedd(FP128DD a) { return isfinite(a.hi); }
+static inline int signbitdd(FP128DD a) { return signbit(a.hi) != 0; }
+
+// Conversions to and from integers.
+static inline FP128DD dd_from_ll(long long v) {
+  // Both halves are exact in a double, and so is their sum in a DD.
+  long long h = v / 4294967296LL;
+  long long l = v - h * 4294967296LL;
+  return dd_two_sum((double)h * 4294967296.0, (double)l);
+}
+
+static inline FP128DD dd_from_u64(uint64_t v) {
+  return dd_two_sum((double)(v >> 32) * 4294967296.0,
+                    (double)(v & 0xffffffffu));
+}
+
+static inline FP128DD truncdd(FP128DD a);
+
+// Convert with truncation, as a cast would. Out of range values give
+// LLONG_MIN, which is what x86_64 hardware does.
+static inline long long dd_to_ll(FP128DD a) {
+  FP128DD t = truncdd(a);
+  if (!(t.hi >= -0x1p63 && t.hi <= 0x1p63))
+    return LLONG_MIN;
+  if (t.hi == 0x1p63)
+    return t.lo < 0.0 ? (LLONG_MAX + (long long)t.lo) + 1 : LLONG_MIN;
+  if (t.hi == -0x1p63)
+    return t.lo >= 0.0 ? LLONG_MIN + (long long)t.lo : LLONG_MIN;
+  return (long long)t.hi + (long long)t.lo;
+}
+
+// Sign manipulation.
+static inline FP128DD fabsdd(FP128DD a) {
+  return signbit(a.hi) ? negdd(a) : a;
+}
+
+static inline FP128DD copysigndd(FP128DD a, FP128DD b) {
+  return (signbit(a.hi) != 0) != (signbit(b.hi) != 0) ? negdd(a) : a;
+}
+
+static inline FP128DD fdimdd(FP128DD a, FP128DD b) {
+  if (isnan(a.hi) || isnan(b.hi))
+    return dd_make(a.hi + b.hi, 0.0);
+  return gtdd(a, b) ? subdd(a, b) : dd_make(0.0, 0.0);
+}
+
+static inline FP128DD fmaxdd(FP128DD a, FP128DD b) {
+  if (isnan(a.hi))
+    return b;
+  if (isnan(b.hi))
+    return a;
+  return ltdd(a, b) ? b : a;
+}
+
+static inline FP128DD fmindd(FP128DD a, FP128DD b) {
+  if (isnan(a.hi))
+    return b;
+  if (isnan(b.hi))
+    return a;
+  return ltdd(b, a) ? b : a;
+}
+
+// Rounding to integers.
+// If hi is not an integer then lo is too small to move the answer past an
+// integer, so only hi matters. Otherwise hi is already an integer and we only
+// need to round lo.
+static inline FP128DD floordd(FP128DD a) {
+  double hi = floor(a.hi);
+  if (hi != a.hi)
+    return dd_make(hi, 0.0);
+  return dd_quick_two_sum(hi, floor(a.lo));
+}
+
+static inline FP128DD ceildd(FP128DD a) {
+  double hi = ceil(a.hi);
+  if (hi != a.hi)
+    return dd_make(hi, 0.0);
+  return dd_quick_two_sum(hi, ceil(a.lo));
+}
+
+static inline FP128DD truncdd(FP128DD a) {
+  return a.hi >= 0.0 ? floordd(a) : ceildd(a);
+}
+
+// Is an integer valued DD odd?
+static inline int dd_is_odd(FP128DD a) {
+  return (fmod(a.hi, 2.0) != 0.0) != (fmod(a.lo, 2.0) != 0.0);
+}
+
+// Round half away from zero.
+static inline FP128DD rounddd(FP128DD a) {
+  if (!isfinite(a.hi))
+    return a;
+  FP128DD t = truncdd(a);
+  FP128DD f = fabsdd(subdd(a, t));
+  if (gedd(f, dd_make(0.5, 0.0)))
+    t = dd_add_d(t, copysign(1.0, a.hi));
+  return t.hi == 0.0 ? dd_make(copysign(0.0, a.hi), 0.0) : t;
+}
+
+// Round half to even. We assume the default rounding mode.
+static inline FP128DD rintdd(FP128DD a) {
+  if (!isfinite(a.hi))
+    return a;
+  FP128DD t = floordd(a);
+  FP128DD f = subdd(a, t);
+  int c = f.hi == 0.5 ? (f.lo > 0.0) - (f.lo < 0.0) : (f.hi > 0.5 ? 1 : -1);
+  if (c > 0 || (c == 0 && dd_is_odd(t)))
+    t = dd_add_d(t, 1.0);
+  return t.hi == 0.0 ? dd_make(copysign(0.0, a.hi), 0.0) : t;
+}
+
+static inline FP128DD nearbyintdd(FP128DD a) { return rintdd(a); }
+static inline long long llrintdd(FP128DD a) { return dd_to_ll(rintdd(a)); }
+static inline long lrintdd(FP128DD a) { return (long)llrintdd(a); }
+static inline long long llrounddd(FP128DD a) {
+  return dd_to_ll(rounddd(a));
+}
+static inline long lrounddd(FP128DD a) { return (long)llrounddd(a); }
+
+// Exponent manipulation.
+static inline FP128DD ldexpdd(FP128DD a, int n) {
+  return dd_make(ldexp(a.hi, n), ldexp(a.lo, n));
+}
+
+static inline int ilogbdd(FP128DD a) {
+  int e = ilogb(a.hi);
+  if (a.hi == 0.0 || !isfinite(a.hi))
+    return e;
+  // A power of two with a negative tail is just below that power.
+  if (fabs(a.hi) == ldexp(1.0, e) && (a.lo != 0.0) &&
+      (signbit(a.lo) != signbit(a.hi)))
+    return e - 1;
+  return e;
+}
+
+static inline FP128DD logbdd(FP128DD a) {
+  if (a.hi == 0.0 || !isfinite(a.hi))
+    return dd_make(logb(a.hi), 0.0);
+  return dd_make((double)ilogbdd(a), 0.0);
+}
+
+static inline FP128DD frexpdd(FP128DD a, int *e) {
+  if (a.hi == 0.0 || !isfinite(a.hi)) {
+    *e = 0;
+    return a;
+  }
+  *e = ilogbdd(a) + 1;
+  return ldexpdd(a, -*e);
+}
+
+static inline FP128DD modfdd(FP128DD a, FP128DD *ip) {
+  *ip = truncdd(a);
+  if (isinf(a.hi))
+    return dd_make(copysign(0.0, a.hi), 0.0);
+  FP128DD f = subdd(a, *ip);
+  return f.hi == 0.0 ? dd_make(copysign(0.0, a.hi), 0.0) : f;
+}
+
+static inline FP128DD nextafterdd(FP128DD a, FP128DD b) {
+  if (isnan(a.hi) || isnan(b.hi))
+    return dd_make(a.hi + b.hi, 0.0);
+  if (eqdd(a, b))
+    return b;
+  double step = a.hi == 0.0 ? DBL_TRUE_MIN
+                            : fmax(ldexp(1.0, ilogbdd(a) - 105), DBL_TRUE_MIN);
+  return dd_add_d(a, ltdd(a, b) ? step : -step);
+}
+
+// Remainders.
+// Reduce |x| modulo |y| in chunks of up to 26 bits of quotient at a time,
+// keeping the bottom three bits of the quotient for remquo.
+static inline FP128DD dd_fmod_core(FP128DD x, FP128DD y, int *quo) {
+  FP128DD r = fabsdd(x);
+  FP128DD ay = fabsdd(y);
+  int q = 0;
+  while (gedd(r, ay)) {
+    int k = ilogbdd(r) - ilogbdd(ay);
+    k = k > 26 ? k - 26 : 0;
+    FP128DD t = ldexpdd(ay, k);
+    double n = floor(r.hi / t.hi);
+    if (n < 1.0)
+      n = 1.0;
+    r = subdd(r, dd_two_prod(n, t.hi));
+    r = subdd(r, dd_two_prod(n, t.lo));
+    while (r.hi < 0.0) {
+      r = adddd(r, t);
+      n -= 1.0;
+    }
+    if (k < 3)
+      q += (int)fmod(n, 8.0) << k;
+  }
+  *quo = q & 7;
+  return r;
+}
+
+static inline FP128DD fmoddd(FP128DD x, FP128DD y) {
+  int q;
+  if (isnan(x.hi) || isnan(y.hi) || isinf(x.hi) || y.hi == 0.0)
+    return dd_make(NAN, 0.0);
+  if (isinf(y.hi))
+    return x;
+  FP128DD r = dd_fmod_core(x, y, &q);
+  return r.hi == 0.0 ? dd_make(copysign(0.0, x.hi), 0.0) : copysigndd(r, x);
+}
+
+static inline FP128DD remquodd(FP128DD x, FP128DD y, int *quo) {
+  int q;
+  *quo = 0;
+  if (isnan(x.hi) || isnan(y.hi) || isinf(x.hi) || y.hi == 0.0)
+    return dd_make(NAN, 0.0);
+  if (isinf(y.hi))
+    return x;
+  FP128DD ay = fabsdd(y);
+  FP128DD r = dd_fmod_core(x, y, &q);
+  FP128DD r2 = ldexpdd(r, 1);
+  if (gtdd(r2, ay) || (eqdd(r2, ay) && (q & 1))) {
+    r = subdd(r, ay);
+    q++;
+  }
+  q &= 7;
+  *quo = (signbit(x.hi) != 0) != (signbit(y.hi) != 0) ? -q : q;
+  return r.hi == 0.0 ? dd_make(copysign(0.0, x.hi), 0.0)
+                     : (signbit(x.hi) ? negdd(r) : r);
+}
+
+static inline FP128DD remainderdd(FP128DD x, FP128DD y) {
+  int q;
+  return remquodd(x, y, &q);
+}
+
+// Constants which we need in more than one place.
+#define PFP128_DD_PI PFP128_DD_MAKE(3.141592653589793, 1.2246467991473532e-16)
+#define PFP128_DD_PI_2 PFP128_DD_MAKE(1.5707963267948966, 6.123233995736766e-17)
+#define PFP128_DD_PI_4 PFP128_DD_MAKE(0.7853981633974483, 3.061616997868383e-17)
+#define PFP128_DD_3PI_4 PFP128_DD_MAKE(2.356194490192345, 9.184850993605148e-17)
+#define PFP128_DD_2_PI                                                         \
+  PFP128_DD_MAKE(0.6366197723675814, -3.935735335036497e-17)
+#define PFP128_DD_LN2 PFP128_DD_MAKE(0.6931471805599453, 2.3190468138462996e-17)
+#define PFP128_DD_LOG2E                                                        \
+  PFP128_DD_MAKE(1.4426950408889634, 2.0355273740931033e-17)
+#define PFP128_DD_LOG10E                                                       \
+  PFP128_DD_MAKE(0.4342944819032518, 1.098319650216765e-17)
+#define PFP128_DD_1_SQRTPI                                                     \
+  PFP128_DD_MAKE(0.5641895835477563, 7.66772980658294e-18)
+#define PFP128_DD_2_SQRTPI                                                     \
+  PFP128_DD_MAKE(1.1283791670955126, 1.533545961316588e-17)
+#define PFP128_DD_HALF_LN_2PI                                                  \
+  PFP128_DD_MAKE(0.9189385332046728, -3.8782941580672414e-17)
+#define PFP128_DD_LN_PI PFP128_DD_MAKE(1.1447298858494002, 1.0265951162707826e-17)
+// 1 - Euler's gamma
+#define PFP128_DD_1_GAMMA                                                      \
+  PFP128_DD_MAKE(0.42278433509846713, 4.942915152430645e-18)
+
+// 1/n! for n = 3..31
+static const FP128DD dd_inv_fact[] = {
+  {0.16666666666666666, 9.25185853854297e-18}, /* 1/3! */
+  {0.041666666666666664, 2.3129646346357427e-18}, /* 1/4! */
+  {0.008333333333333333, 1.1564823173178714e-19}, /* 1/5! */
+  {0.001388888888888889, -5.300543954373577e-20}, /* 1/6! */
+  {0.0001984126984126984, 1.7209558293420705e-22}, /* 1/7! */
+  {2.48015873015873e-05, 2.1511947866775882e-23}, /* 1/8! */
+  {2.7557319223985893e-06, -1.858393274046472e-22}, /* 1/9! */
+  {2.755731922398589e-07, 2.3767714622250297e-23}, /* 1/10! */
+  {2.505210838544172e-08, -1.448814070935912e-24}, /* 1/11! */
+  {2.08767569878681e-09, -1.20734505911326e-25}, /* 1/12! */
+  {1.6059043836821613e-10, 1.2585294588752098e-26}, /* 1/13! */
+  {1.1470745597729725e-11, 2.0655512752830745e-28}, /* 1/14! */
+  {7.647163731819816e-13, 7.03872877733453e-30}, /* 1/15! */
+  {4.779477332387385e-14, 4.399205485834081e-31}, /* 1/16! */
+  {2.8114572543455206e-15, 1.6508842730861433e-31}, /* 1/17! */
+  {1.5619206968586225e-16, 1.1910679660273754e-32}, /* 1/18! */
+  {8.22063524662433e-18, 2.2141894119604265e-34}, /* 1/19! */
+  {4.110317623312165e-19, 1.4412973378659527e-36}, /* 1/20! */
+  {1.9572941063391263e-20, -1.3643503830087908e-36}, /* 1/21! */
+  {8.896791392450574e-22, -7.911402614872376e-38}, /* 1/22! */
+  {3.868170170630684e-23, -8.843177655482344e-40}, /* 1/23! */
+  {1.6117375710961184e-24, -3.6846573564509766e-41}, /* 1/24! */
+  {6.446950284384474e-26, -1.9330404233703465e-42}, /* 1/25! */
+  {2.4795962632247976e-27, -1.2953730964765229e-43}, /* 1/26! */
+  {9.183689863795546e-29, 1.4303150396787322e-45}, /* 1/27! */
+  {3.279889237069838e-30, 1.5117542744029879e-46}, /* 1/28! */
+  {1.1309962886447716e-31, 1.0498015412959506e-47}, /* 1/29! */
+  {3.7699876288159054e-33, 2.5870347832750324e-49}, /* 1/30! */
+  {1.216125041553518e-34, 5.586290567888806e-51}, /* 1/31! */
+};
+
+// Roots and related functions.
+static inline FP128DD sqrtdd(FP128DD a) {
+  if (a.hi <= 0.0 || !isfinite(a.hi))
+    return dd_make(a.hi == 0.0 ? a.hi : sqrt(a.hi), 0.0);
+  // One Newton step from the double precision result.
+  double y = sqrt(a.hi);
+  FP128DD d = subdd(a, dd_two_prod(y, y));
+  return dd_quick_two_sum(y, d.hi / (2.0 * y));
+}
+
+static inline FP128DD cbrtdd(FP128DD a) {
+  if (a.hi == 0.0 || !isfinite(a.hi))
+    return dd_make(cbrt(a.hi), 0.0);
+  double y = cbrt(a.hi);
+  FP128DD y3 = dd_mul_d(dd_two_prod(y, y), y);
+  return subdd(dd_from_double(y), dd_div_d(subdd(y3, a), 3.0 * y * y));
+}
+
+static inline FP128DD hypotdd(FP128DD a, FP128DD b) {
+  if (isinf(a.hi) || isinf(b.hi))
+    return dd_make(HUGE_VAL, 0.0);
+  if (isnan(a.hi) || isnan(b.hi))
+    return dd_make(a.hi + b.hi, 0.0);
+  a = fabsdd(a);
+  b = fabsdd(b);
+  if (a.hi == 0.0)
+    return b;
+  if (b.hi == 0.0)
+    return a;
+  // Scale to avoid overflow and underflow in the squares.
+  int e = ilogb(fmax(a.hi, b.hi));
+  a = ldexpdd(a, -e);
+  b = ldexpdd(b, -e);
+  return ldexpdd(sqrtdd(adddd(dd_sqr(a), dd_sqr(b))), e);
+}
+
+// The product is formed exactly (as four doubles) before the addition.
+static inline FP128DD fmadd(FP128DD a, FP128DD b, FP128DD c) {
+  FP128DD p = dd_two_prod(a.hi, b.hi);
+  if (!isfinite(p.hi) || !isfinite(c.hi))
+    return dd_make(fma(a.hi, b.hi, c.hi), 0.0);
+  FP128DD t = adddd(dd_two_prod(a.hi, b.lo), dd_two_prod(a.lo, b.hi));
+  t = dd_add_d(t, a.lo * b.lo);
+  return adddd(adddd(p, c), t);
+}
+
+// Exponentials and logarithms.
+// expm1 for |x| <= 0.5: scale down by 2^9, sum the Taylor series, and then
+// undo the scaling using expm1(2y) = expm1(y) * (expm1(y) + 2).
+static inline FP128DD dd_expm1_core(FP128DD x) {
+  FP128DD r = ldexpdd(x, -9);
+  FP128DD p = dd_inv_fact[8]; // 1/11!
+  for (int i = 7; i >= 0; i--)
+    p = adddd(muldd(p, r), dd_inv_fact[i]);
+  p = dd_add_d(muldd(p, r), 0.5);
+  FP128DD s = adddd(r, muldd(dd_sqr(r), p));
+  for (int i = 0; i < 9; i++)
+    s = muldd(s, dd_add_d(s, 2.0));
+  return s;
+}
+
+static inline FP128DD expdd(FP128DD a) {
+  // ln(2) in three parts, so that k * ln2 is very accurate.
+  double const ln2_0 = 0.6931471805599453, ln2_1 = 2.3190468138462996e-17,
+               ln2_2 = 5.707708438416212e-34;
+  if (isnan(a.hi))
+    return a;
+  if (a.hi > 709.782712893384)
+    return dd_make(HUGE_VAL, 0.0);
+  if (a.hi < -745.2)
+    return dd_make(0.0, 0.0);
+  if (a.hi == 0.0)
+    return dd_make(1.0, 0.0);
+  double k = nearbyint(a.hi * 1.4426950408889634);
+  FP128DD r = subdd(a, dd_two_prod(k, ln2_0));
+  r = subdd(r, dd_two_prod(k, ln2_1));
+  r = dd_add_d(r, -k * ln2_2);
+  return ldexpdd(dd_add_d(dd_expm1_core(r), 1.0), (int)k);
+}
+
+static inline FP128DD expm1dd(FP128DD a) {
+  if (isnan(a.hi) || a.hi == 0.0)
+    return a;
+  if (fabs(a.hi) <= 0.5)
+    return dd_expm1_core(a);
+  // Outside that range there is at most one bit of cancellation.
+  return dd_add_d(expdd(a), -1.0);
+}
+
+// expm1 of a double with |y| <= 0.35 straight from its Taylor series. The
+// squarings in dd_expm1_core each cost a little accuracy, and every bit in
+// log1p shows up in pow.
+static inline FP128DD dd_expm1_series(double y) {
+  FP128DD p = dd_inv_fact[21]; // 1/24!
+  for (int i = 20; i >= 0; i--)
+    p = adddd(dd_mul_d(p, y), dd_inv_fact[i]);
+  p = dd_add_d(dd_mul_d(p, y), 0.5);
+  return dd_add_d(dd_mul_d(dd_mul_d(p, y), y), y);
+}
+
+// log1p for small u: one Newton step from the double precision result,
+// arranged so that the correction keeps full relative accuracy.
+static inline FP128DD dd_log1p_core(FP128DD u) {
+  double y0 = log1p(u.hi);
+  if (y0 == 0.0)
+    return u;
+  FP128DD em = dd_expm1_series(y0);
+  FP128DD corr = divdd(subdd(u, em), dd_add_d(em, 1.0));
+  return dd_add_d(corr, y0);
+}
+
+static inline FP128DD logdd(FP128DD a) {
+  if (isnan(a.hi))
+    return a;
+  if (a.hi < 0.0)
+    return dd_make(NAN, 0.0);
+  if (a.hi == 0.0)
+    return dd_make(-HUGE_VAL, 0.0);
+  if (isinf(a.hi))
+    return a;
+  // a = m * 2^e with m in [sqrt(1/2), sqrt(2))
+  int e = ilogbdd(a);
+  FP128DD m = ldexpdd(a, -e);
+  if (m.hi > 1.4142135623730951) {
+    m = ldexpdd(m, -1);
+    e++;
+  }
+  FP128DD r = dd_log1p_core(dd_add_d(m, -1.0));
+  if (e == 0)
+    return r;
+  return adddd(r, dd_mul_d(PFP128_DD_LN2, (double)e));
+}
+
+static inline FP128DD log1pdd(FP128DD u) {
+  if (isnan(u.hi) || u.hi == 0.0)
+    return u;
+  if (u.hi < -1.0)
+    return dd_make(NAN, 0.0);
+  if (u.hi == -1.0 && u.lo == 0.0)
+    return dd_make(-HUGE_VAL, 0.0);
+  if (u.hi >= -0.29 && u.hi <= 0.41)
+    return dd_log1p_core(u);
+  return logdd(dd_add_d(u, 1.0));
+}
+
+static inline FP128DD log2dd(FP128DD a) {
+  // Exact for powers of two.
+  if (a.lo == 0.0 && a.hi > 0.0 && isfinite(a.hi)) {
+    int e;
+    if (frexp(a.hi, &e) == 0.5)
+      return dd_make((double)(e - 1), 0.0);
+  }
+  FP128DD l = logdd(a);
+  return isfinite(l.hi) ? muldd(l, PFP128_DD_LOG2E) : l;
+}
+
+static inline FP128DD log10dd(FP128DD a) {
+  // Exact for the powers of ten which are exact doubles.
+  if (a.lo == 0.0 && a.hi >= 1.0 && a.hi <= 1e22) {
+    double p = 1.0;
+    for (int k = 0; k <= 22; k++, p *= 10.0)
+      if (a.hi == p)
+        return dd_make((double)k, 0.0);
+  }
+  FP128DD l = logdd(a);
+  return isfinite(l.hi) ? muldd(l, PFP128_DD_LOG10E) : l;
+}
+
+// exp(y log(x)) for finite x > 0. Rounding y log(x) to a DD would lose about
+// log2|y log(x)| bits, so with x = m 2^e we take the multiple of ln2 out of
+// y e, which is exact, and only round what is left.
+static inline FP128DD dd_exp_ylogx(FP128DD x, FP128DD y) {
+  double const ln2_2 = 5.707708438416212e-34;
+  int e = ilogbdd(x);
+  FP128DD m = ldexpdd(x, -e);
+  if (m.hi > 1.4142135623730951) {
+    m = ldexpdd(m, -1);
+    e++;
+  }
+  FP128DD l = dd_log1p_core(dd_add_d(m, -1.0));
+  double est = y.hi * ((double)e + l.hi * 1.4426950408889634);
+  if (est > 1030.0)
+    return dd_make(HUGE_VAL, 0.0);
+  if (est < -1130.0)
+    return dd_make(0.0, 0.0);
+  // y log(x) = k ln2 + r with r = v ln2 + y l, so |r| <= ~ln2/2.
+  double k = nearbyint(est);
+  FP128DD v = dd_add_d(dd_two_prod(y.hi, (double)e), -k);
+  v = adddd(v, dd_two_prod(y.lo, (double)e));
+  FP128DD r = adddd(muldd(v, PFP128_DD_LN2), muldd(y, l));
+  r = dd_add_d(r, v.hi * ln2_2);
+  return ldexpdd(dd_add_d(dd_expm1_core(r), 1.0), (int)k);
+}
+
+static inline int dd_is_integer(FP128DD a) {
+  return isfinite(a.hi) && eqdd(a, floordd(a));
+}
+
+static inline FP128DD powdd(FP128DD x, FP128DD y) {
+  FP128DD const one = dd_make(1.0, 0.0);
+  // The special cases, in the order in which C99 F.9.4.4 lists them.
+  if (y.hi == 0.0 || eqdd(x, one))
+    return one;
+  if (isnan(x.hi) || isnan(y.hi))
+    return dd_make(x.hi + y.hi, 0.0);
+  int yint = dd_is_integer(y);
+  int yodd = yint && fabs(y.hi) < 0x1p106 && dd_is_odd(y);
+  if (x.hi == 0.0) {
+    if (y.hi < 0.0)
+      return dd_make(yodd ? copysign(HUGE_VAL, x.hi) : HUGE_VAL, 0.0);
+    return dd_make(yodd ? x.hi : 0.0, 0.0);
+  }
+  if (isinf(y.hi)) {
+    double ax = fabs(x.hi);
+    if (ax == 1.0 && x.lo == 0.0)
+      return one;
+    return dd_make(((ax < 1.0 || (ax == 1.0 && signbit(x.lo) != 0)) ==
+                    (y.hi < 0.0))
+                       ? HUGE_VAL
+                       : 0.0,
+                   0.0);
+  }
+  if (isinf(x.hi)) {
+    double r = y.hi < 0.0 ? 0.0 : HUGE_VAL;
+    return dd_make((x.hi < 0.0 && yodd) ? -r : r, 0.0);
+  }
+  if (x.hi < 0.0 && !yint)
+    return dd_make(NAN, 0.0);
+  // Small integer powers by repeated squaring.
+  if (yint && fabs(y.hi) <= 64.0) {
+    int n = (int)fabs(y.hi);
+    FP128DD r = one, b = x;
+    for (; n; n >>= 1) {
+      if (n & 1)
+        r = muldd(r, b);
+      b = dd_sqr(b);
+    }
+    return y.hi < 0.0 ? divdd(one, r) : r;
+  }
+  FP128DD r = dd_exp_ylogx(fabsdd(x), y);
+  return (x.hi < 0.0 && yodd) ? negdd(r) : r;
+}
+
+// Trigonometric functions.
+// 2/pi in 32 bit words, most significant first, for the Payne-Hanek argument
+// reduction of very large arguments.
+static const uint32_t dd_two_over_pi[] = {
+  0xa2f9836e, 0x4e441529, 0xfc2757d1, 0xf534ddc0, 0xdb629599, 0x3c439041,
+  0xfe5163ab, 0xdebbc561, 0xb7246e3a, 0x424dd2e0, 0x06492eea, 0x09d1921c,
+  0xfe1deb1c, 0xb129a73e, 0xe88235f5, 0x2ebb4484, 0xe99c7026, 0xb45f7e41,
+  0x3991d639, 0x835339f4, 0x9c845f8b, 0xbdf9283b, 0x1ff897ff, 0xde05980f,
+  0xef2f118b, 0x5a0a6d1f, 0x6d367ecf, 0x27cb09b7, 0x4f463f66, 0x9e5fea2d,
+  0x7527bac7, 0xebe5f17b, 0x3d0739f7, 0x8a5292ea, 0x6bfb5fb1, 0x1f8d5d08,
+  0x56033046, 0xfc7b6bab, 0xf0cfbc20, 0x9af4361d, 0xa9e39161, 0x5ee61b08,
+  0x6599855f, 0x14a06840, 0x8dffd880, 0x4d732731, 0x06061556, 0xca73a8c9,
+  0x60e27bc0, 0x8c6b47c4, 0x19c367cd, 0xdce8092a,
+};
+
+// Extract the 32 bits starting at bit pos of the 416 bit integer p (which has
+// its least significant word first). Bits outside p are zero.
+static inline uint32_t dd_pio2_bits(uint32_t const *p, int pos) {
+  if (pos <= -32 || pos >= 416)
+    return 0;
+  int w = (pos + 32) / 32 - 1;
+  int b = pos - 32 * w;
+  uint64_t lo = (w >= 0) ? p[w] : 0;
+  uint64_t hi = (w + 1 < 13) ? p[w + 1] : 0;
+  return (uint32_t)(((hi << 32) | lo) >> b);
+}
+
+// Payne-Hanek reduction of one double: add v * 2/pi (mod 8) to the fixed
+// point number acc, which has three integer bits in acc[0] and 256 fractional
+// bits in acc[1..8], most significant first. Working in integers means that
+// the parts of a DD argument cancel exactly.
+static inline void dd_pio2_accumulate(uint32_t *acc, double v) {
+  if (v == 0.0)
+    return;
+  int e;
+  double m = frexp(fabs(v), &e);
+  uint64_t mi = (uint64_t)ldexp(m, 53);
+  uint32_t ml = (uint32_t)mi, mh = (uint32_t)(mi >> 32);
+  // v = mi * 2^E. Words of 2/pi before k0 only contribute multiples of 8, and
+  // those after the eleventh less than 2^-260.
+  int E = e - 53;
+  int k0 = E >= 3 ? (E - 3) / 32 : 0;
+  uint32_t w[11], p[13];
+  for (int i = 0; i < 11; i++)
+    w[i] = dd_two_over_pi[k0 + 10 - i];
+  uint64_t carry = 0;
+  for (int i = 0; i < 11; i++) {
+    uint64_t t = (uint64_t)w[i] * ml + carry;
+    p[i] = (uint32_t)t;
+    carry = t >> 32;
+  }
+  p[11] = (uint32_t)carry;
+  carry = 0;
+  for (int i = 0; i < 11; i++) {
+    uint64_t t = (uint64_t)w[i] * mh + p[i + 1] + carry;
+    p[i + 1] = (uint32_t)t;
+    carry = t >> 32;
+  }
+  p[12] = (uint32_t)carry;
+  // The product has S fractional bits.
+  int S = 32 * (k0 + 11) - E;
+  uint32_t f[9];
+  for (int i = 0; i < 9; i++)
+    f[i] = dd_pio2_bits(p, S - 32 * i);
+  // Add f, or its two's complement, to acc.
+  uint32_t const flip = v < 0.0 ? 0xffffffffu : 0;
+  carry = v < 0.0;
+  for (int i = 8; i >= 0; i--) {
+    uint64_t t = (uint64_t)acc[i] + (f[i] ^ flip) + carry;
+    acc[i] = (uint32_t)t;
+    carry = t >> 32;
+  }
+  acc[0] &= 7;
+}
+
+// Reduce a so that a = r + q * pi/2 with |r| <= ~pi/4. The error in r is
+// about 2^-104 relative to r itself, even when a is very close to a multiple
+// of pi/2.
+static inline FP128DD dd_rem_pio2(FP128DD a, int *q) {
+  // pi/2 in five parts for the Cody-Waite reduction.
+  double const p0 = 1.5707963267948966, p1 = 6.123233995736766e-17,
+               p2 = -1.4973849048591698e-33, p3 = 5.562271104316826e-50,
+               p4 = 2.836115989820158e-66;
+  if (fabs(a.hi) <= 0.7853981633974483) {
+    *q = 0;
+    return a;
+  }
+  if (fabs(a.hi) < 0x1p30) {
+    double k = nearbyint(a.hi * 0.6366197723675814);
+    FP128DD r = subdd(a, dd_two_prod(k, p0));
+    r = subdd(r, dd_two_prod(k, p1));
+    r = subdd(r, dd_two_prod(k, p2));
+    r = subdd(r, dd_two_prod(k, p3));
+    r = dd_add_d(r, -k * p4);
+    *q = (int)k & 3;
+    return r;
+  }
+  uint32_t acc[9] = {0};
+  dd_pio2_accumulate(acc, a.hi);
+  dd_pio2_accumulate(acc, a.lo);
+  int quadrant = (int)acc[0];
+  int negate = (acc[1] >> 31) != 0;
+  if (negate) {
+    // The fraction is >= 1/2, so use f - 1 = -(1 - f), computing 1 - f in
+    // integers to avoid cancellation.
+    quadrant++;
+    uint64_t c = 1;
+    for (int i = 8; i >= 1; i--) {
+      uint64_t t = (uint64_t)(uint32_t)~acc[i] + c;
+      acc[i] = (uint32_t)t;
+      c = t >> 32;
+    }
+  }
+  FP128DD f = dd_make(0.0, 0.0);
+  for (int i = 8; i >= 1; i--)
+    f = dd_add_d(f, ldexp((double)acc[i], -32 * i));
+  if (negate)
+    f = negdd(f);
+  *q = quadrant & 3;
+  return dd_add_d(muldd(f, PFP128_DD_PI_2), f.hi * p2);
+}
+
+// sin and cos by their Taylor series for |x| <= pi/4.
+static inline FP128DD dd_sin_taylor(FP128DD x) {
+  if (x.hi == 0.0)
+    return x;
+  FP128DD x2 = dd_sqr(x);
+  FP128DD p = dd_inv_fact[26]; // 1/29!
+  for (int k = 13; k >= 1; k--) {
+    FP128DD c = dd_inv_fact[2 * k - 2]; // 1/(2k+1)!
+    p = adddd(muldd(p, x2), (k & 1) ? negdd(c) : c);
+  }
+  return adddd(x, muldd(muldd(x, x2), p));
+}
+
+static inline FP128DD dd_cos_taylor(FP128DD x) {
+  FP128DD x2 = dd_sqr(x);
+  FP128DD p = dd_inv_fact[25]; // 1/28!
+  for (int k = 13; k >= 2; k--) {
+    FP128DD c = dd_inv_fact[2 * k - 3]; // 1/(2k)!
+    p = adddd(muldd(p, x2), (k & 1) ? negdd(c) : c);
+  }
+  FP128DD r = dd_add_d(negdd(ldexpdd(x2, -1)), 1.0);
+  return adddd(r, muldd(dd_sqr(x2), p));
+}
+
+static inline void dd_sincos(FP128DD a, FP128DD *s, FP128DD *c) {
+  if (!isfinite(a.hi)) {
+    *s = *c = dd_make(a.hi - a.hi, 0.0);
+    return;
+  }
+  int q;
+  FP128DD r = dd_rem_pio2(a, &q);
+  FP128DD sr = dd_sin_taylor(r), cr = dd_cos_taylor(r);
+  switch (q) {
+  case 0:
+    *s = sr;
+    *c = cr;
+    break;
+  case 1:
+    *s = cr;
+    *c = negdd(sr);
+    break;
+  case 2:
+    *s = negdd(sr);
+    *c = negdd(cr);
+    break;
+  default:
+    *s = negdd(cr);
+    *c = sr;
+    break;
+  }
+}
+
+static inline FP128DD sindd(FP128DD a) {
+  FP128DD s, c;
+  dd_sincos(a, &s, &c);
+  return s;
+}
+
+static inline FP128DD cosdd(FP128DD a) {
+  FP128DD s, c;
+  dd_sincos(a, &s, &c);
+  return c;
+}
+
+// Both from one argument reduction.
+static inline void sincosdd(FP128DD a, FP128DD *s, FP128DD *c) {
+  dd_sincos(a, s, c);
+}
+
+static inline FP128DD tandd(FP128DD a) {
+  FP128DD s, c;
+  dd_sincos(a, &s, &c);
+  return divdd(s, c);
+}
+
+static inline FP128DD atan2dd(FP128DD y, FP128DD x) {
+  if (isnan(x.hi) || isnan(y.hi))
+    return dd_make(x.hi + y.hi, 0.0);
+  // The special cases from C99 F.9.1.4
+  if (y.hi == 0.0)
+    return signbit(x.hi) ? copysigndd(PFP128_DD_PI, y)
+                         : dd_make(y.hi, 0.0);
+  if (x.hi == 0.0)
+    return copysigndd(PFP128_DD_PI_2, y);
+  if (isinf(y.hi)) {
+    if (isinf(x.hi))
+      return copysigndd(x.hi > 0.0 ? PFP128_DD_PI_4 : PFP128_DD_3PI_4, y);
+    return copysigndd(PFP128_DD_PI_2, y);
+  }
+  if (isinf(x.hi))
+    return x.hi > 0.0 ? dd_make(copysign(0.0, y.hi), 0.0)
+                      : copysigndd(PFP128_DD_PI, y);
+  // One Newton step from the double result:
+  // atan2(y, x) = t + atan((y cos t - x sin t) / (x cos t + y sin t))
+  // and the correction is small enough that atan(d) == d to DD precision.
+  int e = ilogb(fmax(fabs(x.hi), fabs(y.hi)));
+  x = ldexpdd(x, -e);
+  y = ldexpdd(y, -e);
+  double t = atan2(y.hi, x.hi);
+  FP128DD s, c;
+  dd_sincos(dd_from_double(t), &s, &c);
+  FP128DD num = subdd(muldd(y, c), muldd(x, s));
+  FP128DD den = adddd(muldd(x, c), muldd(y, s));
+  return dd_add_d(divdd(num, den), t);
+}
+
+static inline FP128DD atandd(FP128DD a) {
+  return atan2dd(a, dd_make(1.0, 0.0));
+}
+
+static inline FP128DD asindd(FP128DD a) {
+  if (fabs(a.hi) > 1.0 || (fabs(a.hi) == 1.0 && a.lo * a.hi > 0.0))
+    return dd_make(NAN, 0.0);
+  FP128DD c = sqrtdd(muldd(dd_add_d(negdd(a), 1.0), dd_add_d(a, 1.0)));
+  return atan2dd(a, c);
+}
+
+static inline FP128DD acosdd(FP128DD a) {
+  if (fabs(a.hi) > 1.0 || (fabs(a.hi) == 1.0 && a.lo * a.hi > 0.0))
+    return dd_make(NAN, 0.0);
+  FP128DD s = sqrtdd(muldd(dd_add_d(negdd(a), 1.0), dd_add_d(a, 1.0)));
+  return atan2dd(s, a);
+}
+
+// Hyperbolic functions.
+static inline FP128DD sinhdd(FP128DD a) {
+  if (a.hi == 0.0 || !isfinite(a.hi))
+    return a;
+  FP128DD ax = fabsdd(a), r;
+  if (ax.hi > 709.0) {
+    // exp(|a|) would overflow before sinh does.
+    FP128DD e = expdd(ldexpdd(ax, -1));
+    r = muldd(e, ldexpdd(e, -1));
+  } else {
+    FP128DD em = expm1dd(ax);
+    r = ldexpdd(adddd(em, divdd(em, dd_add_d(em, 1.0))), -1);
+  }
+  return signbit(a.hi) ? negdd(r) : r;
+}
+
+static inline FP128DD coshdd(FP128DD a) {
+  if (isnan(a.hi))
+    return a;
+  FP128DD ax = fabsdd(a);
+  if (ax.hi > 709.0) {
+    FP128DD e = expdd(ldexpdd(ax, -1));
+    return muldd(e, ldexpdd(e, -1));
+  }
+  FP128DD e = expdd(ax);
+  return ldexpdd(adddd(e, divdd(dd_make(1.0, 0.0), e)), -1);
+}
+
+static inline FP128DD tanhdd(FP128DD a) {
+  if (isnan(a.hi) || a.hi == 0.0)
+    return a;
+  FP128DD r;
+  if (fabs(a.hi) > 40.0) {
+    r = dd_make(1.0, 0.0);
+  } else {
+    FP128DD em = expm1dd(ldexpdd(fabsdd(a), 1));
+    r = divdd(em, dd_add_d(em, 2.0));
+  }
+  return signbit(a.hi) ? negdd(r) : r;
+}
+
+static inline FP128DD asinhdd(FP128DD a) {
+  if (a.hi == 0.0 || !isfinite(a.hi))
+    return a;
+  FP128DD ax = fabsdd(a), r;
+  if (ax.hi > 1e30) {
+    r = adddd(logdd(ax), PFP128_DD_LN2);
+  } else {
+    FP128DD a2 = dd_sqr(ax);
+    FP128DD w = dd_add_d(sqrtdd(dd_add_d(a2, 1.0)), 1.0);
+    r = log1pdd(adddd(ax, divdd(a2, w)));
+  }
+  return signbit(a.hi) ? negdd(r) : r;
+}
+
+static inline FP128DD acoshdd(FP128DD a) {
+  if (isnan(a.hi))
+    return a;
+  if (a.hi < 1.0 || (a.hi == 1.0 && a.lo < 0.0))
+    return dd_make(NAN, 0.0);
+  if (a.hi > 1e30)
+    return adddd(logdd(a), PFP128_DD_LN2);
+  FP128DD t = dd_add_d(a, -1.0);
+  return log1pdd(adddd(t, sqrtdd(adddd(ldexpdd(t, 1), dd_sqr(t)))));
+}
+
+static inline FP128DD atanhdd(FP128DD a) {
+  if (isnan(a.hi) || a.hi == 0.0)
+    return a;
+  FP128DD ax = fabsdd(a), r;
+  if (ax.hi > 1.0 || (ax.hi == 1.0 && ax.lo > 0.0))
+    return dd_make(NAN, 0.0);
+  if (ax.hi == 1.0 && ax.lo == 0.0) {
+    r = dd_make(HUGE_VAL, 0.0);
+  } else {
+    r = ldexpdd(log1pdd(divdd(ldexpdd(ax, 1), dd_add_d(negdd(ax), 1.0))),
+                -1);
+  }
+  return signbit(a.hi) ? negdd(r) : r;
+}
+
+// Error functions.
+// erfc at the anchor points 0.5, 0.75, ... 4.0
+static const FP128DD dd_erfc_anchor[] = {
+  {0.4795001221869535, -1.900077467916287e-17}, /* erfc(0.5) */
+  {0.28884436634648486, 8.536743514828927e-18}, /* erfc(0.75) */
+  {0.15729920705028513, -2.954563826510312e-18}, /* erfc(1.0) */
+  {0.07709987174354177, -3.3360693261863044e-19}, /* erfc(1.25) */
+  {0.033894853524689274, -8.274380778554473e-19}, /* erfc(1.5) */
+  {0.013328328780817557, -6.145085778436527e-19}, /* erfc(1.75) */
+  {0.004677734981047266, -3.8794238326641256e-19}, /* erfc(2.0) */
+  {0.0014627165866811518, -6.81920077729474e-20}, /* erfc(2.25) */
+  {0.0004069520174449589, 2.080297158010754e-20}, /* erfc(2.5) */
+  {0.00010062192211963683, 6.262545538413354e-21}, /* erfc(2.75) */
+  {2.209049699858544e-05, 1.5563377960343457e-22}, /* erfc(3.0) */
+  {4.302779463675122e-06, -1.1949933093530682e-22}, /* erfc(3.25) */
+  {7.430983723414128e-07, -3.117067749063089e-23}, /* erfc(3.5) */
+  {1.1372725656979665e-07, -3.707590374501806e-25}, /* erfc(3.75) */
+  {1.541725790028002e-08, -1.1417872168371026e-24}, /* erfc(4.0) */
+};
+
+static inline FP128DD erfcdd(FP128DD a);
+
+// exp(-x^2), with x^2 split exactly so that rounding it costs nothing.
+static inline FP128DD dd_exp_msq(FP128DD x) {
+  FP128DD p = dd_two_prod(x.hi, x.hi);
+  FP128DD q = dd_add_d(dd_two_prod(2.0 * x.hi, x.lo), x.lo * x.lo);
+  return muldd(expdd(negdd(p)), expdd(negdd(q)));
+}
+
+static inline FP128DD erfdd(FP128DD a) {
+  if (isnan(a.hi) || a.hi == 0.0)
+    return a;
+  FP128DD ax = fabsdd(a), r;
+  if (ax.hi < 0.5) {
+    // erf(x) = 2/sqrt(pi) * sum (-1)^n x^(2n+1) / (n! (2n+1))
+    FP128DD mx2 = negdd(dd_sqr(ax));
+    FP128DD t = ax, s = ax;
+    for (int n = 1; n < 60; n++) {
+      t = dd_div_d(muldd(t, mx2), (double)n);
+      FP128DD term = dd_div_d(t, (double)(2 * n + 1));
+      s = adddd(s, term);
+      if (fabs(term.hi) < 1e-34 * fabs(s.hi))
+        break;
+    }
+    r = muldd(s, PFP128_DD_2_SQRTPI);
+  } else {
+    r = dd_add_d(negdd(erfcdd(ax)), 1.0);
+  }
+  return signbit(a.hi) ? negdd(r) : r;
+}
+
+static inline FP128DD erfcdd(FP128DD a) {
+  if (isnan(a.hi))
+    return a;
+  if (a.hi < 0.5) {
+    if (a.hi > -0.5)
+      return dd_add_d(negdd(erfdd(a)), 1.0);
+    return dd_add_d(negdd(erfcdd(negdd(a))), 2.0);
+  }
+  if (a.hi >= 27.3)
+    return dd_make(0.0, 0.0);
+  if (a.hi < 4.125) {
+    // Taylor series about the nearest anchor x0; with h = x - x0,
+    // erfc(x) = erfc(x0) - 2/sqrt(pi) exp(-x0^2) h sum u_k / (k+1)
+    // where u_k h^-k are the Taylor coefficients of exp(-2 x0 h - h^2).
+    int i = (int)nearbyint(4.0 * a.hi);
+    double x0 = 0.25 * i;
+    FP128DD h = dd_add_d(a, -x0);
+    FP128DD h2 = dd_sqr(h);
+    FP128DD u0 = dd_make(0.0, 0.0), u1 = dd_make(1.0, 0.0);
+    FP128DD s = u1;
+    for (int k = 0; k < 60; k++) {
+      FP128DD u2 = dd_div_d(adddd(dd_mul_d(muldd(h, u1), -2.0 * x0),
+                                  dd_mul_d(muldd(h2, u0), -2.0)),
+                            (double)(k + 1));
+      FP128DD term = dd_div_d(u2, (double)(k + 2));
+      s = adddd(s, term);
+      if (fabs(term.hi) < 1e-34 * fabs(s.hi))
+        break;
+      u0 = u1;
+      u1 = u2;
+    }
+    FP128DD c = muldd(expdd(dd_from_double(-x0 * x0)), PFP128_DD_2_SQRTPI);
+    return subdd(dd_erfc_anchor[i - 2], muldd(muldd(c, h), s));
+  }
+  // The continued fraction
+  // erfc(x) = exp(-x^2)/sqrt(pi) / (x + (1/2)/(x + 1/(x + (3/2)/(x + ...))))
+  int n = (int)(16.0 + 1600.0 / (a.hi * a.hi));
+  FP128DD t = a;
+  for (int k = n; k >= 1; k--)
+    t = adddd(a, dd_div_d(divdd(dd_from_double((double)k), t), 2.0));
+  return divdd(muldd(dd_exp_msq(a), PFP128_DD_1_SQRTPI), t);
+}
+
+// Gamma functions.
+// (zeta(k) - 1) / k for k = 2..56
+static const FP128DD dd_zeta_m1_over_k[] = {
+  {0.3224670334241132, 1.520336175199238e-17}, /* (zeta(2)-1)/2 */
+  {0.0673523010531981, -6.87667631175899e-18}, /* (zeta(3)-1)/3 */
+  {0.020580808427784546, 1.4629392512775695e-18}, /* (zeta(4)-1)/4 */
+  {0.007385551028673986, -4.1051370891788617e-19}, /* (zeta(5)-1)/5 */
+  {0.0028905103307415234, -7.357950161901912e-20}, /* (zeta(6)-1)/6 */
+  {0.001192753911703261, -4.1747852352514e-20}, /* (zeta(7)-1)/7 */
+  {0.0005096695247430425, -2.780354175057013e-20}, /* (zeta(8)-1)/8 */
+  {0.00022315475845357939, -6.032078299350848e-21}, /* (zeta(9)-1)/9 */
+  {9.945751278180853e-05, 2.734261130690314e-21}, /* (zeta(10)-1)/10 */
+  {4.492623673813314e-05, -3.4577848248512954e-22}, /* (zeta(11)-1)/11 */
+  {2.050721277567069e-05, 4.864174577619616e-22}, /* (zeta(12)-1)/12 */
+  {9.439488275268397e-06, -8.111985879973243e-22}, /* (zeta(13)-1)/13 */
+  {4.374866789907488e-06, -3.7021851137962053e-22}, /* (zeta(14)-1)/14 */
+  {2.039215753801366e-06, 4.70891370095011e-23}, /* (zeta(15)-1)/15 */
+  {9.55141213040742e-07, 4.798512617588967e-23}, /* (zeta(16)-1)/16 */
+  {4.492469198764566e-07, -1.4219340578032317e-23}, /* (zeta(17)-1)/17 */
+  {2.1207184805554665e-07, 1.2243193613787666e-23}, /* (zeta(18)-1)/18 */
+  {1.0043224823968099e-07, 5.246728062732248e-24}, /* (zeta(19)-1)/19 */
+  {4.7698101693639804e-08, 1.6747349659198183e-24}, /* (zeta(20)-1)/20 */
+  {2.2711094608943164e-08, 1.406065812811299e-24}, /* (zeta(21)-1)/21 */
+  {1.0838659214896955e-08, -5.018242148804151e-25}, /* (zeta(22)-1)/22 */
+  {5.183475041970047e-09, 1.0891302535635231e-26}, /* (zeta(23)-1)/23 */
+  {2.4836745438024785e-09, -1.5805048837932932e-25}, /* (zeta(24)-1)/24 */
+  {1.1921401405860912e-09, 5.269861418993634e-26}, /* (zeta(25)-1)/25 */
+  {5.731367241678862e-10, -2.3810866578223724e-26}, /* (zeta(26)-1)/26 */
+  {2.7595228851242334e-10, -2.107257883073299e-26}, /* (zeta(27)-1)/27 */
+  {1.330476437424449e-10, 6.614614775208236e-27}, /* (zeta(28)-1)/28 */
+  {6.4229645638381e-11, 4.232176684861536e-27}, /* (zeta(29)-1)/29 */
+  {3.1044247747322276e-11, -2.8715350933450543e-27}, /* (zeta(30)-1)/30 */
+  {1.5021384080754142e-11, 5.063470614908766e-28}, /* (zeta(31)-1)/31 */
+  {7.275974480239079e-12, 4.879514445370743e-28}, /* (zeta(32)-1)/32 */
+  {3.527742476575915e-12, 1.8425514965961343e-29}, /* (zeta(33)-1)/33 */
+  {1.711991790559618e-12, -6.994387860952799e-29}, /* (zeta(34)-1)/34 */
+  {8.315385841420285e-13, -1.5951572809733943e-29}, /* (zeta(35)-1)/35 */
+  {4.04220052528944e-13, -1.2672480151835454e-29}, /* (zeta(36)-1)/36 */
+  {1.9664756310966165e-13, -4.0719036606056276e-30}, /* (zeta(37)-1)/37 */
+  {9.573630387838556e-14, 1.9773509309959252e-30}, /* (zeta(38)-1)/38 */
+  {4.6640760264283744e-14, -2.186282283713084e-30}, /* (zeta(39)-1)/39 */
+  {2.2737369600659724e-14, -9.672147869269828e-31}, /* (zeta(40)-1)/40 */
+  {1.1091399470834522e-14, -1.5933072002908932e-31}, /* (zeta(41)-1)/41 */
+  {5.413659156725363e-15, -1.5927035621801034e-31}, /* (zeta(42)-1)/42 */
+  {2.643880017860995e-15, 1.4241594083885883e-31}, /* (zeta(43)-1)/43 */
+  {1.2918959062789966e-15, 7.958358891271392e-32}, /* (zeta(44)-1)/44 */
+  {6.315935504198448e-16, 4.148627969335702e-32}, /* (zeta(45)-1)/45 */
+  {3.089316266963393e-16, -2.3015827891156758e-32}, /* (zeta(46)-1)/46 */
+  {1.5117930628108198e-16, -9.801548779944268e-33}, /* (zeta(47)-1)/47 */
+  {7.40148685695232e-17, 2.7887551301987538e-33}, /* (zeta(48)-1)/48 */
+  {3.625218048120654e-17, -8.9292739029864e-34}, /* (zeta(49)-1)/49 */
+  {1.7763568421861633e-17, -1.4422619123578226e-33}, /* (zeta(50)-1)/50 */
+  {8.70763157479179e-18, 3.644715586331977e-34}, /* (zeta(51)-1)/51 */
+  {4.270088559227004e-18, 3.0259314536119503e-35}, /* (zeta(52)-1)/52 */
+  {2.0947604247944643e-18, 1.0921968389106116e-34}, /* (zeta(53)-1)/53 */
+  {1.0279842823787928e-18, 2.6221378142312554e-35}, /* (zeta(54)-1)/54 */
+  {5.046468294792953e-19, -2.8769870355097727e-35}, /* (zeta(55)-1)/55 */
+  {2.4781763945937917e-19, -1.285787675046427e-35}, /* (zeta(56)-1)/56 */
+};
+
+// B2k / (2k (2k - 1)) for the Stirling series.
+static const FP128DD dd_stirling[] = {
+  {0.08333333333333333, 4.625929269271485e-18}, /* B2/(2*1) */
+  {-0.002777777777777778, 1.0601087908747154e-19}, /* B4/(4*3) */
+  {0.0007936507936507937, 6.883823317368282e-22}, /* B6/(6*5) */
+  {-0.0005952380952380953, 5.36938218754726e-20}, /* B8/(8*7) */
+  {0.0008417508417508417, 3.6870174889237694e-20}, /* B10/(10*9) */
+  {-0.0019175269175269176, 1.0675702776872475e-19}, /* B12/(12*11) */
+  {0.00641025641025641, 2.2240044563805217e-19}, /* B14/(14*13) */
+  {-0.029550653594771242, 4.861760957508855e-19}, /* B16/(16*15) */
+  {0.17964437236883057, -6.401600482710946e-19}, /* B18/(18*17) */
+  {-1.3924322169059011, 1.5837056989230303e-17}, /* B20/(20*19) */
+  {13.402864044168393, -6.154114101993966e-16}, /* B22/(22*21) */
+  {-156.84828462600203, 9.391823141715389e-15}, /* B24/(24*23) */
+  {2193.1033333333335, -1.3339255626002948e-13}, /* B26/(26*25) */
+  {-36108.77125372499, 5.897583353514365e-13}, /* B28/(28*27) */
+  {691472.268851313, 2.5585296305158e-11}, /* B30/(30*29) */
+  {-15238221.539407415, -8.76774522490625e-10}, /* B32/(32*31) */
+  {382900751.39141417, -2.4082684757733585e-08}, /* B34/(34*33) */
+  {-10882266035.784391, 3.141830930219749e-07}, /* B36/(36*35) */
+  {347320283765.00226, -6.048528997747748e-06}, /* B38/(38*37) */
+};
+
+// lgamma(2 + e) for |e| <= 1/2 from
+// lgamma(2 + e) = (1 - gamma) e + sum_{k>=2} (-1)^k (zeta(k) - 1)/k e^k
+static inline FP128DD dd_lgamma2(FP128DD e) {
+  int const n = sizeof(dd_zeta_m1_over_k) / sizeof(dd_zeta_m1_over_k[0]);
+  FP128DD p = dd_zeta_m1_over_k[n - 1];
+  if (!(n & 1))
+    p = negdd(p); // (-1)^k with k = n + 1
+  for (int i = n - 2; i >= 0; i--) {
+    FP128DD c = dd_zeta_m1_over_k[i]; // k = i + 2
+    p = adddd(muldd(p, e), (i & 1) ? negdd(c) : c);
+  }
+  return adddd(muldd(e, PFP128_DD_1_GAMMA), muldd(dd_sqr(e), p));
+}
+
+// The tail of Stirling's series, sum B2k / (2k (2k - 1) x^(2k - 1)), for
+// x >= 25.
+static inline FP128DD dd_stirling_tail(FP128DD x) {
+  FP128DD rx = divdd(dd_make(1.0, 0.0), x);
+  FP128DD rx2 = dd_sqr(rx);
+  FP128DD s = dd_make(0.0, 0.0);
+  for (int k = 15; k >= 0; k--)
+    s = adddd(muldd(s, rx2), dd_stirling[k]);
+  return muldd(s, rx);
+}
+
+// Stirling's series for lgamma(x), x >= 25.
+static inline FP128DD dd_lgamma_stirling(FP128DD x) {
+  FP128DD r = subdd(muldd(dd_add_d(x, -0.5), logdd(x)), x);
+  r = adddd(r, PFP128_DD_HALF_LN_2PI);
+  if (!isfinite(r.hi) || x.hi > 1e17)
+    return r;
+  return adddd(r, dd_stirling_tail(x));
+}
+
+// Stirling's series for gamma(x), 25 <= x <= 171.7. Taking exp of lgamma
+// would lose the bits of its large integer part, so we use
+// gamma(x) = t (t e^-x) sqrt(2 pi) e^s with t = x^((x - 1/2) / 2).
+static inline FP128DD dd_tgamma_stirling(FP128DD x) {
+  FP128DD t = dd_exp_ylogx(x, ldexpdd(dd_add_d(x, -0.5), -1));
+  FP128DD u = muldd(t, expdd(negdd(x)));
+  FP128DD s = expdd(adddd(PFP128_DD_HALF_LN_2PI, dd_stirling_tail(x)));
+  return muldd(muldd(t, u), s);
+}
+
+// sin(pi x), with the multiple of two removed exactly first.
+static inline FP128DD dd_sinpi(FP128DD x) {
+  FP128DD n = rintdd(x);
+  FP128DD s = sindd(muldd(subdd(x, n), PFP128_DD_PI));
+  return dd_is_odd(n) ? negdd(s) : s;
+}
+
+static inline FP128DD lgammadd(FP128DD x) {
+  if (isnan(x.hi))
+    return x;
+  if (isinf(x.hi))
+    return dd_make(HUGE_VAL, 0.0);
+  if (x.hi <= 0.0 && dd_is_integer(x))
+    return dd_make(HUGE_VAL, 0.0);
+  if (x.hi < 0.5) {
+    // Reflection: lgamma(x) = log(pi / |sin(pi x)|) - lgamma(1 - x), and as
+    // in tgammadd lgamma(1 - x) = log(-x) + lgamma(-x) below -1/2.
+    FP128DD s = fabsdd(dd_sinpi(x));
+    FP128DD g = x.hi <= -0.5
+                    ? adddd(logdd(negdd(x)), lgammadd(negdd(x)))
+                    : lgammadd(dd_add_d(negdd(x), 1.0));
+    return subdd(subdd(PFP128_DD_LN_PI, logdd(s)), g);
+  }
+  if (x.hi < 1.5) {
+    FP128DD e = dd_add_d(x, -1.0);
+    return subdd(dd_lgamma2(e), log1pdd(e));
+  }
+  if (x.hi < 2.5)
+    return dd_lgamma2(dd_add_d(x, -2.0));
+  if (x.hi < 25.0) {
+    FP128DD y = x, p = dd_make(1.0, 0.0);
+    while (y.hi >= 2.5) {
+      y = dd_add_d(y, -1.0);
+      p = muldd(p, y);
+    }
+    return adddd(dd_lgamma2(dd_add_d(y, -2.0)), logdd(p));
+  }
+  return dd_lgamma_stirling(x);
+}
+
+static inline FP128DD tgammadd(FP128DD x) {
+  if (isnan(x.hi))
+    return x;
+  if (isinf(x.hi))
+    return dd_make(x.hi > 0.0 ? x.hi : NAN, 0.0);
+  if (x.hi == 0.0)
+    return dd_make(copysign(HUGE_VAL, x.hi), 0.0);
+  if (x.hi < 0.0 && dd_is_integer(x))
+    return dd_make(NAN, 0.0);
+  if (x.hi > 171.7)
+    return dd_make(HUGE_VAL, 0.0);
+  if (x.hi < 0.5) {
+    // Reflection: gamma(x) = pi / (sin(pi x) gamma(1 - x)). Below -1/2 we
+    // use gamma(1 - x) = -x gamma(-x), since 1 - x may round but -x is exact.
+    FP128DD g = x.hi <= -0.5 ? muldd(negdd(x), tgammadd(negdd(x)))
+                             : tgammadd(dd_add_d(negdd(x), 1.0));
+    return divdd(PFP128_DD_PI, muldd(dd_sinpi(x), g));
+  }
+  if (x.hi < 1.5) {
+    FP128DD e = dd_add_d(x, -1.0);
+    return divdd(expdd(dd_lgamma2(e)), x);
+  }
+  if (x.hi < 2.5)
+    return expdd(dd_lgamma2(dd_add_d(x, -2.0)));
+  if (x.hi < 25.0) {
+    FP128DD y = x, p = dd_make(1.0, 0.0);
+    while (y.hi >= 2.5) {
+      y = dd_add_d(y, -1.0);
+      p = muldd(p, y);
+    }
+    return muldd(expdd(dd_lgamma2(dd_add_d(y, -2.0))), p);
+  }
+  return dd_tgamma_stirling(x);
+}
+
+static inline FP128DD nandd(char const *tag) {
+  return dd_make(nan(tag), 0.0);
+}
+
+// Complex functions.
+static inline FP128DD crealdd(COMPLEX_FP128DD z) { return z.re; }
+static inline FP128DD cimagdd(COMPLEX_FP128DD z) { return z.im; }
+static inline COMPLEX_FP128DD conjdd(COMPLEX_FP128DD z) {
+  return dd_cmake(z.re, negdd(z.im));
+}
+
+static inline COMPLEX_FP128DD cprojdd(COMPLEX_FP128DD z) {
+  if (isinf(z.re.hi) || isinf(z.im.hi))
+    return dd_cmake(dd_make(HUGE_VAL, 0.0),
+                    dd_make(copysign(0.0, z.im.hi), 0.0));
+  return z;
+}
+
+static inline FP128DD cabsdd(COMPLEX_FP128DD z) { return hypotdd(z.re, z.im); }
+static inline FP128DD cargdd(COMPLEX_FP128DD z) { return atan2dd(z.im, z.re); }
+
+static inline COMPLEX_FP128DD dd_cmul(COMPLEX_FP128DD a, COMPLEX_FP128DD b) {
+  return dd_cmake(subdd(muldd(a.re, b.re), muldd(a.im, b.im)),
+                  adddd(muldd(a.re, b.im), muldd(a.im, b.re)));
+}
+
+static inline COMPLEX_FP128DD dd_cdiv(COMPLEX_FP128DD a, COMPLEX_FP128DD b) {
+  // Scale b so that |b| ~ 1 to avoid spurious overflow.
+  int e = ilogb(fmax(fabs(b.re.hi), fabs(b.im.hi)));
+  FP128DD br = ldexpdd(b.re, -e), bi = ldexpdd(b.im, -e);
+  FP128DD d = adddd(dd_sqr(br), dd_sqr(bi));
+  FP128DD re = adddd(muldd(a.re, br), muldd(a.im, bi));
+  FP128DD im = subdd(muldd(a.im, br), muldd(a.re, bi));
+  return dd_cmake(ldexpdd(divdd(re, d), -e), ldexpdd(divdd(im, d), -e));
+}
+
+static inline COMPLEX_FP128DD cexpdd(COMPLEX_FP128DD z) {
+  if (z.im.hi == 0.0)
+    return dd_cmake(expdd(z.re), z.im);
+  FP128DD s, c, e;
+  dd_sincos(z.im, &s, &c);
+  if (z.re.hi > 709.0) {
+    // Avoid overflowing exp when the product would not.
+    e = expdd(ldexpdd(z.re, -1));
+    return dd_cmake(muldd(muldd(e, c), e), muldd(muldd(e, s), e));
+  }
+  e = expdd(z.re);
+  return dd_cmake(muldd(e, c), muldd(e, s));
+}
+
+// log(1 + z), accurate when z is small.
+static inline COMPLEX_FP128DD dd_clog1p(COMPLEX_FP128DD z) {
+  FP128DD re = ldexpdd(
+      log1pdd(adddd(ldexpdd(z.re, 1), adddd(dd_sqr(z.re), dd_sqr(z.im)))), -1);
+  return dd_cmake(re, atan2dd(z.im, dd_add_d(z.re, 1.0)));
+}
+
+static inline COMPLEX_FP128DD clogdd(COMPLEX_FP128DD z) {
+  FP128DD ax = fabsdd(z.re), ay = fabsdd(z.im), re;
+  if (ltdd(ax, ay)) {
+    FP128DD t = ax;
+    ax = ay;
+    ay = t;
+  }
+  if (isinf(ax.hi)) {
+    re = dd_make(HUGE_VAL, 0.0);
+  } else if (ax.hi >= 0.5 && ax.hi <= 2.0) {
+    // Near the unit circle use log1p((ax - 1)(ax + 1) + ay^2) / 2
+    FP128DD t = muldd(dd_add_d(ax, -1.0), dd_add_d(ax, 1.0));
+    re = ldexpdd(log1pdd(adddd(t, dd_sqr(ay))), -1);
+  } else {
+    re = logdd(hypotdd(ax, ay));
+  }
+  return dd_cmake(re, atan2dd(z.im, z.re));
+}
+
+static inline COMPLEX_FP128DD csqrtdd(COMPLEX_FP128DD z) {
+  FP128DD const zero = dd_make(0.0, 0.0);
+  if (isinf(z.im.hi))
+    return dd_cmake(dd_make(HUGE_VAL, 0.0), z.im);
+  if (isnan(z.re.hi) || isnan(z.im.hi))
+    return dd_cmake(dd_make(NAN, 0.0), dd_make(NAN, 0.0));
+  if (isinf(z.re.hi)) {
+    if (z.re.hi > 0.0)
+      return dd_cmake(z.re, copysigndd(zero, z.im));
+    return dd_cmake(zero, copysigndd(fabsdd(z.re), z.im));
+  }
+  if (z.re.hi == 0.0 && z.im.hi == 0.0)
+    return dd_cmake(zero, z.im);
+  // t = sqrt((|x| + |z|) / 2), computed with scaling to avoid overflow.
+  int e = ilogb(fmax(fabs(z.re.hi), fabs(z.im.hi)));
+  e -= e & 1;
+  FP128DD x = ldexpdd(z.re, -e), y = ldexpdd(z.im, -e);
+  FP128DD t = sqrtdd(ldexpdd(adddd(fabsdd(x), hypotdd(x, y)), -1));
+  FP128DD u = dd_div_d(divdd(fabsdd(y), t), 2.0);
+  t = ldexpdd(t, e / 2);
+  u = ldexpdd(u, e / 2);
+  if (x.hi >= 0.0)
+    return dd_cmake(t, copysigndd(u, z.im));
+  return dd_cmake(u, copysigndd(t, z.im));
+}
+
+static inline COMPLEX_FP128DD cpowdd(COMPLEX_FP128DD z, COMPLEX_FP128DD w) {
+  if (z.re.hi == 0.0 && z.im.hi == 0.0) {
+    if (w.re.hi == 0.0 && w.im.hi == 0.0)
+      return dd_cmake(dd_make(1.0, 0.0), dd_make(0.0, 0.0));
+    return dd_cmake(dd_make(0.0, 0.0), dd_make(0.0, 0.0));
+  }
+  return cexpdd(dd_cmul(w, clogdd(z)));
+}
+
+static inline COMPLEX_FP128DD csinhdd(COMPLEX_FP128DD z) {
+  FP128DD s, c;
+  if (z.im.hi == 0.0)
+    return dd_cmake(sinhdd(z.re), z.im);
+  dd_sincos(z.im, &s, &c);
+  return dd_cmake(muldd(sinhdd(z.re), c), muldd(coshdd(z.re), s));
+}
+
+static inline COMPLEX_FP128DD ccoshdd(COMPLEX_FP128DD z) {
+  FP128DD s, c;
+  if (z.im.hi == 0.0)
+    return dd_cmake(coshdd(z.re),
+                    dd_make((signbit(z.re.hi) != 0) != (signbit(z.im.hi) != 0)
+                                ? -0.0
+                                : 0.0,
+                            0.0));
+  dd_sincos(z.im, &s, &c);
+  return dd_cmake(muldd(coshdd(z.re), c), muldd(sinhdd(z.re), s));
+}
+
+// sin(z) = -i sinh(iz), cos(z) = cosh(iz)
+static inline COMPLEX_FP128DD csindd(COMPLEX_FP128DD z) {
+  COMPLEX_FP128DD r = csinhdd(dd_cmake(negdd(z.im), z.re));
+  return dd_cmake(r.im, negdd(r.re));
+}
+
+static inline COMPLEX_FP128DD ccosdd(COMPLEX_FP128DD z) {
+  return ccoshdd(dd_cmake(negdd(z.im), z.re));
+}
+
+// Kahan's algorithm for tanh(x + iy), with t = tan(y), s = sinh(x),
+// beta = 1 + t^2 and rho = sqrt(1 + s^2):
+// tanh(x + iy) = (beta rho s + i t) / (1 + beta s^2)
+static inline COMPLEX_FP128DD ctanhdd(COMPLEX_FP128DD z) {
+  if (isnan(z.re.hi) || isnan(z.im.hi))
+    return dd_cmake(dd_make(NAN, 0.0), dd_make(NAN, 0.0));
+  if (fabs(z.re.hi) > 40.0) {
+    // Im = sin(2y) / (cosh(2x) + cos(2y)) ~ 4 sin(y) cos(y) exp(-2|x|)
+    FP128DD s, c;
+    dd_sincos(z.im, &s, &c);
+    FP128DD im = ldexpdd(muldd(muldd(s, c),
+                               expdd(ldexpdd(negdd(fabsdd(z.re)), 1))),
+                         2);
+    return dd_cmake(dd_make(copysign(1.0, z.re.hi), 0.0), im);
+  }
+  FP128DD t = tandd(z.im);
+  FP128DD beta = dd_add_d(dd_sqr(t), 1.0);
+  FP128DD s = sinhdd(z.re);
+  FP128DD rho = sqrtdd(dd_add_d(dd_sqr(s), 1.0));
+  FP128DD den = dd_add_d(muldd(beta, dd_sqr(s)), 1.0);
+  return dd_cmake(divdd(muldd(muldd(beta, rho), s), den), divdd(t, den));
+}
+
+// tan(z) = -i tanh(iz)
+static inline COMPLEX_FP128DD ctandd(COMPLEX_FP128DD z) {
+  COMPLEX_FP128DD r = ctanhdd(dd_cmake(negdd(z.im), z.re));
+  return dd_cmake(r.im, negdd(r.re));
+}
+
+// asinh(z) = log(z + sqrt(z^2 + 1)), computed in the right half plane (using
+// asinh(-z) = -asinh(z)) as log1p(z + z^2 / (1 + sqrt(1 + z^2))).
+static inline COMPLEX_FP128DD casinhdd(COMPLEX_FP128DD z) {
+  if (isnan(z.re.hi) || isnan(z.im.hi))
+    return dd_cmake(dd_make(NAN, 0.0), dd_make(NAN, 0.0));
+  int neg = signbit(z.re.hi) != 0;
+  if (neg)
+    z = dd_cmake(negdd(z.re), negdd(z.im));
+  COMPLEX_FP128DD r;
+  if (fmax(z.re.hi, fabs(z.im.hi)) > 1e150) {
+    r = clogdd(z);
+    r.re = adddd(r.re, PFP128_DD_LN2);
+  } else {
+    COMPLEX_FP128DD z2 = dd_cmul(z, z);
+    COMPLEX_FP128DD w =
+        csqrtdd(dd_cmake(dd_add_d(z2.re, 1.0), z2.im));
+    w.re = dd_add_d(w.re, 1.0);
+    COMPLEX_FP128DD q = dd_cdiv(z2, w);
+    r = dd_clog1p(dd_cmake(adddd(z.re, q.re), adddd(z.im, q.im)));
+  }
+  if (neg)
+    r = dd_cmake(negdd(r.re), negdd(r.im));
+  return r;
+}
+
+// asin(z) = -i asinh(iz)
+static inline COMPLEX_FP128DD casindd(COMPLEX_FP128DD z) {
+  COMPLEX_FP128DD r = casinhdd(dd_cmake(negdd(z.im), z.re));
+  return dd_cmake(r.im, negdd(r.re));
+}
+
+// acos(z) = pi/2 - asin(z), but use the real function on the real segment
+// where that would lose accuracy near 1.
+static inline COMPLEX_FP128DD cacosdd(COMPLEX_FP128DD z) {
+  if (z.im.hi == 0.0 && fabs(z.re.hi) <= 1.0)
+    return dd_cmake(acosdd(z.re), negdd(z.im));
+  COMPLEX_FP128DD r = casindd(z);
+  return dd_cmake(subdd(PFP128_DD_PI_2, r.re), negdd(r.im));
+}
+
+// acosh(z) = log(z + sqrt(z + 1) sqrt(z - 1))
+static inline COMPLEX_FP128DD cacoshdd(COMPLEX_FP128DD z) {
+  COMPLEX_FP128DD a = csqrtdd(dd_cmake(dd_add_d(z.re, 1.0), z.im));
+  COMPLEX_FP128DD b = csqrtdd(dd_cmake(dd_add_d(z.re, -1.0), z.im));
+  COMPLEX_FP128DD p = dd_cmul(a, b);
+  return clogdd(dd_cmake(adddd(z.re, p.re), adddd(z.im, p.im)));
+}
+
+// atanh(z) = (log1p(4x / ((1 - x)^2 + y^2)) / 4,
+//             atan2(2y, (1 - x)(1 + x) - y^2) / 2)
+// but away from zero, where the log1p argument can approach -1, we use
+// log(((1 + x)^2 + y^2) / ((1 - x)^2 + y^2)) / 4 for the real part.
+static inline COMPLEX_FP128DD catanhdd(COMPLEX_FP128DD z) {
+  FP128DD x = z.re, y = z.im;
+  FP128DD omx = dd_add_d(negdd(x), 1.0);
+  FP128DD y2 = dd_sqr(y);
+  FP128DD d = adddd(dd_sqr(omx), y2);
+  FP128DD re;
+  if (fabs(x.hi) < 0.5)
+    re = ldexpdd(log1pdd(divdd(ldexpdd(x, 2), d)), -2);
+  else
+    re = ldexpdd(
+        subdd(logdd(adddd(dd_sqr(dd_add_d(x, 1.0)), y2)), logdd(d)), -2);
+  FP128DD im = ldexpdd(
+      atan2dd(ldexpdd(y, 1),
+              subdd(muldd(omx, dd_add_d(x, 1.0)), y2)),
+      -1);
+  return dd_cmake(re, im);
+}
+
+// atan(z) = -i atanh(iz)
+static inline COMPLEX_FP128DD catandd(COMPLEX_FP128DD z) {
+  COMPLEX_FP128DD r = catanhdd(dd_cmake(negdd(z.im), z.re));
+  return dd_cmake(r.im, negdd(r.re));
+}
+
+// Conversion from text.
+// 10^n for n = 0..31, then 10^32, 10^64, 10^128 and 10^256.
+static const FP128DD dd_pow10_table[] = {
+  {1.0, 0.0},
+  {10.0, 0.0},
+  {100.0, 0.0},
+  {1000.0, 0.0},
+  {10000.0, 0.0},
+  {100000.0, 0.0},
+  {1000000.0, 0.0},
+  {10000000.0, 0.0},
+  {100000000.0, 0.0},
+  {1000000000.0, 0.0},
+  {10000000000.0, 0.0},
+  {100000000000.0, 0.0},
+  {1000000000000.0, 0.0},
+  {10000000000000.0, 0.0},
+  {100000000000000.0, 0.0},
+  {1000000000000000.0, 0.0},
+  {1e+16, 0.0},
+  {1e+17, 0.0},
+  {1e+18, 0.0},
+  {1e+19, 0.0},
+  {1e+20, 0.0},
+  {1e+21, 0.0},
+  {1e+22, 0.0},
+  {1e+23, 8388608.0},
+  {1e+24, 16777216.0},
+  {1e+25, -905969664.0},
+  {1e+26, -4764729344.0},
+  {1e+27, -13287555072.0},
+  {1e+28, 416880263168.0},
+  {1e+29, 8566849142784.0},
+  {1e+30, -19884624838656.0},
+  {1e+31, 364103705034752.0},
+  {1e+32, -5366162204393472.0}, /* 1e32 */
+  {1e+64, -2.1320419009454396e+47}, /* 1e64 */
+  {1e+128, -7.51744869165182e+111}, /* 1e128 */
+  {1e+256, -3.012765990014054e+239}, /* 1e256 */
+};
+
+// 10^n for 0 <= n <= 308 (larger values overflow).
+static inline FP128DD dd_pow10(int n) {
+  FP128DD r = dd_pow10_table[n & 31];
+  for (int i = 0; i < 4; i++)
+    if (n & (32 << i))
+      r = muldd(r, dd_pow10_table[32 + i]);
+  return r;
+}
+
+// Scale v by 10^n.
+static inline FP128DD dd_scale10(FP128DD v, int n) {
+  if (v.hi == 0.0)
+    return v;
+  if (n > 0) {
+    while (n > 308) {
+      v = muldd(v, dd_pow10(308));
+      n -= 308;
+    }
+    return muldd(v, dd_pow10(n));
+  }
+  // Divide, rather than multiplying by an inexact reciprocal.
+  while (n < -300) {
+    v = divdd(v, dd_pow10(300));
+    n += 300;
+  }
+  return divdd(v, dd_pow10(-n));
+}
+
+// Parse the hexadecimal form (after the "0x").
+static inline FP128DD dd_parse_hex(char const *s, char const **end) {
+  FP128DD v = dd_make(0.0, 0.0);
+  int digits = 0, exp2 = 0, any = 0, seen_point = 0;
+  for (;; s++) {
+    int d;
+    if (*s == '.' && !seen_point) {
+      seen_point = 1;
+      continue;
+    }
+    if (!isxdigit((unsigned char)*s))
+      break;
+    d = isdigit((unsigned char)*s) ? *s - '0'
+                                   : tolower((unsigned char)*s) - 'a' + 10;
+    any = 1;
+    if (digits < 27) {
+      // 27 hex digits is 108 bits, more than we can hold.
+      if (v.hi != 0.0 || d != 0)
+        digits++;
+      v = dd_add_d(dd_mul_d(v, 16.0), (double)d);
+      if (seen_point)
+        exp2 -= 4;
+    } else if (!seen_point) {
+      exp2 += 4;
+    }
+  }
+  if (!any) {
+    *end = 0;
+    return v;
+  }
+  if ((*s == 'p' || *s == 'P')) {
+    char *pend;
+    long e = strtol(s + 1, &pend, 10);
+    if (pend != s + 1) {
+      s = pend;
+      exp2 += e > 100000 ? 100000 : (e < -100000 ? -100000 : (int)e);
+    }
+  }
+  *end = s;
+  // Split the scaling so that intermediate values do not overflow.
+  if (exp2 < -1000 && v.hi != 0.0) {
+    v = ldexpdd(v, -1000);
+    exp2 += 1000;
+  }
+  return ldexpdd(v, exp2);
+}
+
+static inline FP128DD strtodd(char const *s, char **sp) {
+  char const *p = s;
+  int neg = 0;
+  FP128DD v;
+
+  while (isspace((unsigned char)*p))
+    p++;
+  if (*p == '+' || *p == '-')
+    neg = *p++ == '-';
+
+  if (tolower((unsigned char)p[0]) == 'i' &&
+      tolower((unsigned char)p[1]) == 'n' &&
+      tolower((unsigned char)p[2]) == 'f') {
+    p += 3;
+    char const *rest = "inity";
+    int i = 0;
+    while (rest[i] && tolower((unsigned char)p[i]) == rest[i])
+      i++;
+    if (!rest[i])
+      p += i;
+    v = dd_make(HUGE_VAL, 0.0);
+  } else if (tolower((unsigned char)p[0]) == 'n' &&
+             tolower((unsigned char)p[1]) == 'a' &&
+             tolower((unsigned char)p[2]) == 'n') {
+    p += 3;
+    if (*p == '(') {
+      char const *q = p + 1;
+      while (isalnum((unsigned char)*q) || *q == '_')
+        q++;
+      if (*q == ')')
+        p = q + 1;
+    }
+    v = dd_make(NAN, 0.0);
+  } else if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    char const *end;
+    v = dd_parse_hex(p + 2, &end);
+    // "0x" with no digits is just the "0".
+    p = end ? end : p + 1;
+  } else {
+    // Collect up to 36 significant digits in two 18 digit integers.
+    uint64_t part[2] = {0, 0};
+    int ndig[2] = {0, 0}, sig = 0, exp10 = 0, any = 0, seen_point = 0;
+    for (;; p++) {
+      if (*p == '.' && !seen_point) {
+        seen_point = 1;
+        continue;
+      }
+      if (!isdigit((unsigned char)*p))
+        break;
+      any = 1;
+      if (sig == 0 && *p == '0') {
+        if (seen_point)
+          exp10--;
+        continue;
+      }
+      if (sig < 36) {
+        int i = sig / 18;
+        part[i] = part[i] * 10 + (uint64_t)(*p - '0');
+        ndig[i]++;
+        sig++;
+        if (seen_point)
+          exp10--;
+      } else if (!seen_point) {
+        exp10++;
+      }
+    }
+    if (!any) {
+      if (sp)
+        *sp = (char *)s;
+      return dd_make(0.0, 0.0);
+    }
+    if (*p == 'e' || *p == 'E') {
+      char *pend;
+      long e = strtol(p + 1, &pend, 10);
+      if (pend != p + 1) {
+        p = pend;
+        exp10 += e > 100000 ? 100000 : (e < -100000 ? -100000 : (int)e);
+      }
+    }
+    v = dd_from_u64(part[0]);
+    if (ndig[1]) {
+      v = adddd(dd_mul_d(v, dd_pow10_table[ndig[1]].hi),
+                dd_from_u64(part[1]));
+    }
+    // Anything beyond these limits overflows or underflows anyway.
+    if (exp10 > 400)
+      exp10 = 400;
+    if (exp10 < -400)
+      exp10 = -400;
+    if (v.hi != 0.0) {
+      v = dd_scale10(v, exp10);
+      if (isinf(v.hi) || v.hi == 0.0)
+        errno = ERANGE;
+    }
+  }
+  if (sp)
+    *sp = (char *)p;
+  return neg ? negdd(v) : v;
+}
+
+// Conversion to text.
+// We provide an snprintf which understands the same 'Q' length modifier as
+// quadmath_snprintf (so that FP128_FMT_TAG is the same), and passes
+// everything else on to the C library.
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t len;
+} dd_out;
+
+static inline void dd_putc(dd_out *o, char c) {
+  if (o->len + 1 < o->size)
+    o->buf[o->len] = c;
+  o->len++;
+}
+
+static inline void dd_putn(dd_out *o, char c, int n) {
+  for (; n > 0; n--)
+    dd_putc(o, c);
+}
+
+static inline void dd_puts(dd_out *o, char const *s) {
+  for (; *s; s++)
+    dd_putc(o, *s);
+}
+
+typedef struct {
+  int left, plus, space, alt, zero, width, prec;
+  char conv;
+} dd_spec;
+
+// The decimal digits of a value, d[0] being at 10^e.
+#define PFP128_DD_MAX_DIGITS 40
+typedef struct {
+  char d[PFP128_DD_MAX_DIGITS + 1];
+  int nd, e;
+} dd_decimal;
+
+// Generate PFP128_DD_MAX_DIGITS digits of a finite v > 0; only the first 32
+// or so are significant.
+static inline void dd_to_decimal(FP128DD v, dd_decimal *r) {
+  int digit[PFP128_DD_MAX_DIGITS + 1];
+  int e = (int)floor(log10(v.hi));
+  // Keep clear of overflow in 10^-e for subnormal values.
+  if (e < -290) {
+    v = dd_scale10(v, 32);
+    e += 32;
+    r->e = e - 32;
+  } else {
+    r->e = e;
+  }
+  FP128DD m = dd_scale10(v, -e);
+  // The estimate of e may be off by one.
+  if (m.hi >= 10.0) {
+    m = dd_div_d(m, 10.0);
+    r->e++;
+  } else if (m.hi < 1.0) {
+    m = dd_mul_d(m, 10.0);
+    r->e--;
+  }
+  for (int i = 0; i <= PFP128_DD_MAX_DIGITS; i++) {
+    double d = floor(m.hi);
+    digit[i] = (int)d;
+    m = dd_mul_d(dd_add_d(m, -d), 10.0);
+  }
+  // Fix up any digits that are out of range because of rounding in m.
+  for (int i = PFP128_DD_MAX_DIGITS; i > 0; i--) {
+    while (digit[i] < 0) {
+      digit[i] += 10;
+      digit[i - 1]--;
+    }
+    while (digit[i] > 9) {
+      digit[i] -= 10;
+      digit[i - 1]++;
+    }
+  }
+  for (int i = 0; i <= PFP128_DD_MAX_DIGITS; i++)
+    r->d[i] = (char)digit[i];
+  r->nd = PFP128_DD_MAX_DIGITS;
+  if (digit[0] > 9) {
+    // Carried out of the top; shift everything down.
+    memmove(&r->d[1], &r->d[0], PFP128_DD_MAX_DIGITS);
+    r->d[0] = 1;
+    r->d[1] -= 10;
+    r->e++;
+  }
+}
+
+// Round to n significant digits (n may be <= 0, when the result is either zero
+// or a single 1 in the position below the leading digit).
+static inline void dd_round_decimal(dd_decimal *r, int n) {
+  if (n >= r->nd)
+    return;
+  if (n < 0) {
+    r->nd = 0;
+    return;
+  }
+  int up = r->d[n] >= 5;
+  r->nd = n;
+  if (!up)
+    return;
+  int i = n - 1;
+  for (; i >= 0; i--) {
+    if (r->d[i] < 9) {
+      r->d[i]++;
+      break;
+    }
+    r->d[i] = 0;
+  }
+  if (i < 0) {
+    // All nines (or nothing kept); becomes a 1 in the next place up.
+    r->d[0] = 1;
+    r->nd = n > 0 ? n : 1;
+    for (int j = 1; j < r->nd; j++)
+      r->d[j] = 0;
+    r->e++;
+  }
+}
+
+static inline char dd_digit(dd_decimal const *r, int i) {
+  return (char)('0' + ((i >= 0 && i < r->nd) ? r->d[i] : 0));
+}
+
+// The body of %f (without sign or padding).
+static inline void dd_emit_f(dd_out *o, dd_decimal const *r, int prec,
+                             int alt) {
+  if (r->nd == 0 || r->e < 0) {
+    dd_putc(o, '0');
+  } else {
+    for (int i = 0; i <= r->e; i++)
+      dd_putc(o, dd_digit(r, i));
+  }
+  if (prec > 0 || alt)
+    dd_putc(o, '.');
+  for (int j = 1; j <= prec; j++)
+    dd_putc(o, r->nd == 0 ? '0' : dd_digit(r, r->e + j));
+}
+
+// The body of %e (without sign or padding).
+static inline void dd_emit_e(dd_out *o, dd_decimal const *r, int prec,
+                             int alt, char conv) {
+  int e = r->nd == 0 ? 0 : r->e;
+  char ebuf[16];
+  dd_putc(o, dd_digit(r, 0));
+  if (prec > 0 || alt)
+    dd_putc(o, '.');
+  for (int j = 1; j <= prec; j++)
+    dd_putc(o, dd_digit(r, j));
+  snprintf(ebuf, sizeof(ebuf), "%c%c%02d", conv, e < 0 ? '-' : '+',
+           e < 0 ? -e : e);
+  dd_puts(o, ebuf);
+}
+
+// Format one value, with no padding.
+static inline void dd_format_body(dd_out *o, FP128DD v, dd_spec const *sp,
+                                  int zeros) {
+  int upper = isupper((unsigned char)sp->conv);
+  char conv = (char)tolower((unsigned char)sp->conv);
+  int prec = sp->prec;
+
+  if (signbit(v.hi))
+    dd_putc(o, '-');
+  else if (sp->plus)
+    dd_putc(o, '+');
+  else if (sp->space)
+    dd_putc(o, ' ');
+  if (!isfinite(v.hi)) {
+    dd_puts(o, isnan(v.hi) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf"));
+    return;
+  }
+  v = fabsdd(v);
+
+  if (conv == 'a') {
+    // Hexadecimal: 0x1.hhhh...p+d with up to 28 hex digits (112 bits).
+    int e = v.hi == 0.0 ? 0 : ilogbdd(v);
+    FP128DD m = ldexpdd(v, -e);
+    int hex[29], n = 0;
+    for (int i = 0; i < 29; i++) {
+      double d = floor(m.hi);
+      if (d > 15.0)
+        d = 15.0;
+      hex[i] = (int)d;
+      m = dd_mul_d(dd_add_d(m, -d), 16.0);
+      if (d != 0.0 && i > 0)
+        n = i;
+    }
+    if (prec >= 0 && prec < n) {
+      // Round to prec hex digits.
+      int up = hex[prec + 1] >= 8;
+      n = prec;
+      for (int i = prec; up && i >= 0; i--) {
+        hex[i]++;
+        up = hex[i] == 16 && i > 0;
+        if (up)
+          hex[i] = 0;
+      }
+      if (hex[0] == 2) {
+        hex[0] = 1;
+        e++;
+      }
+    } else if (prec > n) {
+      n = prec;
+    }
+    char const *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char ebuf[16];
+    dd_puts(o, upper ? "0X" : "0x");
+    dd_putn(o, '0', zeros);
+    dd_putc(o, digits[hex[0]]);
+    if (n > 0 || sp->alt)
+      dd_putc(o, '.');
+    for (int i = 1; i <= n; i++)
+      dd_putc(o, i < 29 ? digits[hex[i]] : '0');
+    snprintf(ebuf, sizeof(ebuf), "%c%+d", upper ? 'P' : 'p', e);
+    dd_puts(o, ebuf);
+    return;
+  }
+
+  dd_putn(o, '0', zeros);
+  if (prec < 0)
+    prec = 6;
+  dd_decimal r;
+  if (v.hi == 0.0) {
+    r.nd = 0;
+    r.e = 0;
+  } else {
+    dd_to_decimal(v, &r);
+  }
+  char ec = upper ? 'E' : 'e';
+  if (conv == 'f') {
+    if (r.nd)
+      dd_round_decimal(&r, r.e + 1 + prec);
+    dd_emit_f(o, &r, prec, sp->alt);
+  } else if (conv == 'e') {
+    if (r.nd)
+      dd_round_decimal(&r, prec + 1);
+    dd_emit_e(o, &r, prec, sp->alt, ec);
+  } else {
+    // %g: P significant digits, in whichever style C99 7.19.6.1 says.
+    int P = prec == 0 ? 1 : prec;
+    if (r.nd)
+      dd_round_decimal(&r, P);
+    int X = r.nd ? r.e : 0;
+    // Unless we have '#', trailing zeros are removed, so find the last
+    // non-zero digit.
+    int last = r.nd - 1;
+    while (last > 0 && r.d[last] == 0)
+      last--;
+    if (last < 0)
+      last = 0;
+    if (P > X && X >= -4) {
+      int fprec = P - 1 - X;
+      if (!sp->alt && last - X < fprec)
+        fprec = last - X > 0 ? last - X : 0;
+      dd_emit_f(o, &r, fprec, sp->alt);
+    } else {
+      int eprec = P - 1;
+      if (!sp->alt && last < eprec)
+        eprec = last;
+      dd_emit_e(o, &r, eprec, sp->alt, ec);
+    }
+  }
+}
+
+static inline void dd_format(dd_out *o, FP128DD v, dd_spec const *sp) {
+  // Format once to find the length, then again with the padding.
+  char scratch[1];
+  dd_out count = {scratch, 0, 0};
+  dd_format_body(&count, v, sp, 0);
+  int pad = sp->width > (int)count.len ? sp->width - (int)count.len : 0;
+  if (sp->left) {
+    dd_format_body(o, v, sp, 0);
+    dd_putn(o, ' ', pad);
+  } else if (sp->zero && isfinite(v.hi)) {
+    dd_format_body(o, v, sp, pad);
+  } else {
+    dd_putn(o, ' ', pad);
+    dd_format_body(o, v, sp, 0);
+  }
+}
+
+static inline int dd_vsnprintf(char *buf, size_t size, char const *fmt,
+                               va_list ap) {
+  dd_out o = {buf, size, 0};
+  while (*fmt) {
+    if (*fmt != '%') {
+      dd_putc(&o, *fmt++);
+      continue;
+    }
+    char const *start = fmt++;
+    if (*fmt == '%') {
+      dd_putc(&o, '%');
+      fmt++;
+      continue;
+    }
+    dd_spec sp = {0, 0, 0, 0, 0, 0, -1, 0};
+    for (;; fmt++) {
+      if (*fmt == '-')
+        sp.left = 1;
+      else if (*fmt == '+')
+        sp.plus = 1;
+      else if (*fmt == ' ')
+        sp.space = 1;
+      else if (*fmt == '#')
+        sp.alt = 1;
+      else if (*fmt == '0')
+        sp.zero = 1;
+      else
+        break;
+    }
+    if (*fmt == '*') {
+      sp.width = va_arg(ap, int);
+      if (sp.width < 0) {
+        sp.left = 1;
+        sp.width = -sp.width;
+      }
+      fmt++;
+    } else {
+      while (isdigit((unsigned char)*fmt))
+        sp.width = 10 * sp.width + (*fmt++ - '0');
+    }
+    if (*fmt == '.') {
+      fmt++;
+      sp.prec = 0;
+      if (*fmt == '*') {
+        sp.prec = va_arg(ap, int);
+        fmt++;
+      } else {
+        while (isdigit((unsigned char)*fmt))
+          sp.prec = 10 * sp.prec + (*fmt++ - '0');
+      }
+    }
+    // Length modifiers; we only need to know enough to fetch the argument.
+    char len[3] = {0, 0, 0};
+    while (*fmt && strchr("hlLqjztQ", *fmt) && len[1] == 0)
+      len[len[0] ? 1 : 0] = *fmt++;
+    sp.conv = *fmt;
+    if (!*fmt)
+      break;
+    fmt++;
+    if (len[0] == 'Q' && strchr("fFeEgGaA", sp.conv)) {
+      dd_format(&o, va_arg(ap, FP128DD), &sp);
+      continue;
+    }
+    // Anything else goes to the C library, one conversion at a time, with
+    // the '*'s replaced by their values.
+    char sub[64], piece[512];
+    int n = 0;
+    if (sp.prec >= 0)
+      snprintf(sub, sizeof(sub), "%%%s%s%s%s%s%d.%d%s%c",
+                   sp.left ? "-" : "", sp.plus ? "+" : "", sp.space ? " " : "",
+                   sp.alt ? "#" : "", sp.zero ? "0" : "", sp.width, sp.prec,
+                   len, sp.conv);
+    else
+      snprintf(sub, sizeof(sub), "%%%s%s%s%s%s%d%s%c",
+                   sp.left ? "-" : "", sp.plus ? "+" : "", sp.space ? " " : "",
+                   sp.alt ? "#" : "", sp.zero ? "0" : "", sp.width, len,
+                   sp.conv);
+    int ll = len[0] == 'l' && len[1] == 'l';
+    switch (sp.conv) {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'c':
+      if (ll || len[0] == 'q')
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, long long));
+      else if (len[0] == 'l')
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, long));
+      else if (len[0] == 'j')
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, intmax_t));
+      else if (len[0] == 'z')
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, size_t));
+      else if (len[0] == 't')
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, ptrdiff_t));
+      else
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, int));
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (len[0] == 'L')
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, long double));
+      else
+        n = snprintf(piece, sizeof(piece), sub, va_arg(ap, double));
+      break;
+    case 's': {
+      // Strings can be longer than our piece buffer, so copy them directly.
+      char const *str = va_arg(ap, char const *);
+      int slen = 0;
+      if (!str)
+        str = "(null)";
+      while (str[slen] && (sp.prec < 0 || slen < sp.prec))
+        slen++;
+      int pad = sp.width > slen ? sp.width - slen : 0;
+      if (!sp.left)
+        dd_putn(&o, ' ', pad);
+      for (int i = 0; i < slen; i++)
+        dd_putc(&o, str[i]);
+      if (sp.left)
+        dd_putn(&o, ' ', pad);
+      continue;
+    }
+    case 'p':
+      n = snprintf(piece, sizeof(piece), sub, va_arg(ap, void *));
+      break;
+    case 'n':
+      if (ll)
+        *va_arg(ap, long long *) = (long long)o.len;
+      else if (len[0] == 'l')
+        *va_arg(ap, long *) = (long)o.len;
+      else
+        *va_arg(ap, int *) = (int)o.len;
+      continue;
+    default:
+      // Not a conversion we understand; output it as it stands.
+      for (; start < fmt; start++)
+        dd_putc(&o, *start);
+      continue;
+    }
+    // A huge width could overflow the piece; pad that ourselves.
+    if (n >= (int)sizeof(piece))
+      n = (int)sizeof(piece) - 1;
+    for (int i = 0; i < n; i++)
+      dd_putc(&o, piece[i]);
+  }
+  if (size)
+    buf[o.len < size ? o.len : size - 1] = '\0';
+  return (int)o.len;
+}
+
+static inline int dd_snprintf(char *buf, size_t size, char const *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = dd_vsnprintf(buf, size, fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+#endif // Header monotonicity
@@ -0,0 +1,1130 @@
+//===-- pfp128_fast.h - Faster, less accurate, elementary functions -*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Faster versions of the most used elementary functions, for code which
+ * would rather have the result sooner than have it correctly rounded:
+ *
+ *   expFP128_fast(x)  exp2FP128_fast(x)  logFP128_fast(x)  log2FP128_fast(x)
+ *   log10FP128_fast(x)  sinFP128_fast(x)  cosFP128_fast(x)  powFP128_fast(x, y)
+ *   sincosFP128_fast(x, &s, &c)
+ *
+ * Compiling with PFP128_FAST_MATH defined to 1 (before including pfp128.h)
+ * makes expFP128, logFP128, log2FP128, log10FP128, sinFP128, cosFP128 and
+ * powFP128 (and their batched versions, and the C++ overloads) these instead,
+ * and sincosFP128 use sincosFP128_fast.
+ *
+ * The error is at most 4 ulp (and is usually under 1 ulp). With the
+ * double-double backend the argument is converted to binary128, and the
+ * binary128 result rounded to double-double, which adds about another
+ * double-double ulp.
+ *
+ * They are evaluated in 128 and 256 bit fixed point integer arithmetic,
+ * rather than in FP128. The argument is reduced with a table (exp and exp2
+ * use 2^(j/64), log uses 1/(1 + j/128), sin and cos use sin(j/64) and
+ * cos(j/64)), which leaves a small enough remainder for a short truncated
+ * Taylor series; their error bounds are easy to check, and the terms are
+ * exact fractions. pow computes y * log2(x) with about 140 bits, so that
+ * large results are still accurate.
+ *
+ * Rare arguments are passed to the usual functions: NaNs, infinities, zeros
+ * and negative numbers for log, |x| >= 2^64 for sin and cos, and anything
+ * other than a positive x, or a negative x with an integer y, for pow. The
+ * fast paths don't set errno, and exp and pow overflow to infinity and
+ * underflow to zero silently.
+ */
+// pfp128.h includes this header when PFP128_FAST_MATH is set, so include it
+// first, so that its batched functions see the macros at the end of this
+// header whichever one is included first.
+#include "pfp128.h"
+
+// Header monotonicity.
+#if (!defined(_PFP128_FAST_H_INCLUDED_))
+#define _PFP128_FAST_H_INCLUDED_ 1
+
+#include "pfp128_soft.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_fast.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+typedef __int128 pfp128_fast_s128;
+
+// The constants are generated with Python's decimal module. "Qn" means that
+// the value is scaled by 2^n.
+// 1/k!, for k = 0..12 (Q126).
+static const uint64_t pfp128_fast_exp_poly[13][2] = {
+    {0x4000000000000000ull, 0x0000000000000000ull},
+    {0x4000000000000000ull, 0x0000000000000000ull},
+    {0x2000000000000000ull, 0x0000000000000000ull},
+    {0x0aaaaaaaaaaaaaaaull, 0xaaaaaaaaaaaaaaabull},
+    {0x02aaaaaaaaaaaaaaull, 0xaaaaaaaaaaaaaaabull},
+    {0x0088888888888888ull, 0x8888888888888889ull},
+    {0x0016c16c16c16c16ull, 0xc16c16c16c16c16cull},
+    {0x0003403403403403ull, 0x4034034034034034ull},
+    {0x0000680680680680ull, 0x6806806806806807ull},
+    {0x00000b8ef1d2ab63ull, 0x99c7d560e4472801ull},
+    {0x00000127e4fb7789ull, 0xf5c72ef016d3ea66ull},
+    {0x0000001ae64567f5ull, 0x44e38fe747e4b838ull},
+    {0x000000023ddb1dffull, 0x1b12f6a89b530f5aull},
+};
+
+// 2^(j/64), for j = 0..63 (Q126).
+static const uint64_t pfp128_fast_exp2_table[64][2] = {
+    {0x4000000000000000ull, 0x0000000000000000ull},
+    {0x40b268f9de0183b9ull, 0xbdf2b293de8a6f7aull},
+    {0x4166c34c5615d0ebull, 0x9f1523ada3290600ull},
+    {0x421d1461d66f2023ull, 0x0d7c976509fe8ac1ull},
+    {0x42d561b3e6243d8aull, 0x62e4adc610aa60d9ull},
+    {0x438fb0cb4f468808ull, 0x1d0b93e2bda954abull},
+    {0x444c0740496d4293ull, 0xaefc6bb64c633ab1ull},
+    {0x450a6abaa4b77ecdull, 0x040650ec961b4061ull},
+    {0x45cae0f1f545eb73ull, 0x7df23143ac529e48ull},
+    {0x468d6fadbf2dd4f2ull, 0xda63da4b4720d69bull},
+    {0x47521cc5a2e6a9e0ull, 0x16e00a2643c1ea63ull},
+    {0x4818ee218a3358eeull, 0x3bac0a5424a743f1ull},
+    {0x48e1e9b9d588e19bull, 0x07eb6c70572d64ecull},
+    {0x49ad159789f37495ull, 0xe99cca074ec92774ull},
+    {0x4a7a77d47f7b84b0ull, 0x97457d6892a8ef2aull},
+    {0x4b4a169b900c2d00ull, 0x24754db41d4e1162ull},
+    {0x4c1bf828c6dc54b7ull, 0xa356918c17217b7bull},
+    {0x4cf022c9905bfd32ull, 0x721843659a5afe57ull},
+    {0x4dc69cdceaa72a9cull, 0x51540bd151e61f90ull},
+    {0x4e9f6cd3967fdba8ull, 0x6f24a6782874cd86ull},
+    {0x4f7a993048d088d6ull, 0xd0488f84f5dcfee9ull},
+    {0x50582887dcb8a7e1ull, 0x0c96e3cf6d87ecd5ull},
+    {0x513821818624b40cull, 0x4dbd0277c067ef54ull},
+    {0x521a8ad704f3404full, 0x068eda418bc0f0f7ull},
+    {0x52ff6b54d8a89c75ull, 0x0e5ebfb10b88380eull},
+    {0x53e6c9da74b29ab4ull, 0xcf62da6a81cfb958ull},
+    {0x54d0ad5a753e077cull, 0x2a0f12761a98fd3aull},
+    {0x55bd1cdad49f699bull, 0xb2c011d93acf003dull},
+    {0x56ac1f752150a563ull, 0x24c054647acd1762ull},
+    {0x579dbc56b48521baull, 0x6f93080e65d9a819ull},
+    {0x5891fac0e95612c7ull, 0xc3e81bf4b690aec7ull},
+    {0x5988e20954889244ull, 0x9f678a6e3cc528ceull},
+    {0x5a827999fcef3242ull, 0x2cbec4d9baa55f50ull},
+    {0x5b7ec8f19468bbc8ull, 0x838b2f86eeaa0d2dull},
+    {0x5c7dd7a3b17dcf74ull, 0x8dc3cbbc2b35b2d1ull},
+    {0x5d7fad59099f22fdull, 0xba6a8ce922c9c1c6ull},
+    {0x5e8451cfac061b5full, 0x54408fdb3687d7bdull},
+    {0x5f8bccdb3d398841ull, 0x740ae855e5f85c28ull},
+    {0x6096266533384a2bull, 0x3e22beacd28043dbull},
+    {0x61a3666d124bb203ull, 0x907642b0945c1d21ull},
+    {0x62b39508aa836d6eull, 0x9f156864b26ecf9cull},
+    {0x63c6ba6455dcd8aeull, 0x609d171cbb6013bfull},
+    {0x64dcdec3371793d1ull, 0x4070fc950288b4bfull},
+    {0x65f60a7f79393e2eull, 0x7a483e47a2f5fb6eull},
+    {0x6712460a8fc24071ull, 0xf11ac1c7caf96377ull},
+    {0x683199ed779592caull, 0x6b6a2e32acd26a81ull},
+    {0x69540ec8f895722dull, 0x0912472be1ef2014ull},
+    {0x6a79ad55e7f6fd0full, 0xac90ef7fd313162dull},
+    {0x6ba27e656b4eb57aull, 0x1cd345dcc8169fefull},
+    {0x6cce8ae13c57ebdaull, 0xff439ef651f095d6ull},
+    {0x6dfddbcbed791baaull, 0x9ec206ad4f14d532ull},
+    {0x6f307a412f074891ull, 0xee83d16cf423342dull},
+    {0x70666f76154a7088ull, 0x832c4a8246e999e5ull},
+    {0x719fc4b95f452d28ull, 0x84dff483cacc0776ull},
+    {0x72dc8373be41a454ull, 0x0f2f47a5276dd876ull},
+    {0x741cb5281e25ee34ull, 0x3c8bc868563863efull},
+    {0x75606373ee921c97ull, 0x6816bad9b8372a7dull},
+    {0x76a7980f6cca15c2ull, 0x300696db5325fd89ull},
+    {0x77f25ccdee6d7ae5ull, 0xa32b0e7b4a46dc89ull},
+    {0x7940bb9e2cffd89cull, 0xf44c054e647a3d26ull},
+    {0x7a92be8a92436616ull, 0x3dce863d76cc07e2ull},
+    {0x7be86fb985689ddcull, 0x7f486a4b6b07db75ull},
+    {0x7d41d96db915019dull, 0x3e12dd8a18aebfe6ull},
+    {0x7e9f06067a4360baull, 0x429f9d2c98f07702ull},
+};
+
+// ln(2)/64 * 2^134 = ln(2) * 2^128, as an integer and a 64 bit fraction.
+static const uint64_t pfp128_fast_ln2_128[2] = {
+    0xb17217f7d1cf79abull, 0xc9e3b39803f2f6afull,
+};
+
+static const uint64_t pfp128_fast_ln2_128_frac[1] = {0x40f343267298b62eull};
+
+// ln(2) (Q127).
+static const uint64_t pfp128_fast_ln2_q127[2] = {
+    0x58b90bfbe8e7bcd5ull, 0xe4f1d9cc01f97b58ull,
+};
+
+// c = round(2^14 / (1 + j/128)), for j = -37..53.
+static const uint16_t pfp128_fast_log_c[91] = {
+    23046, 22795, 22550, 22310, 22075, 21845, 21620, 21400, 21183,
+    20972, 20764, 20560, 20361, 20165, 19973, 19784, 19600, 19418,
+    19240, 19065, 18893, 18725, 18559, 18396, 18236, 18079, 17924,
+    17772, 17623, 17476, 17332, 17190, 17050, 16913, 16777, 16644,
+    16513, 16384, 16257, 16132, 16009, 15888, 15768, 15650, 15534,
+    15420, 15308, 15197, 15087, 14980, 14873, 14769, 14665, 14564,
+    14463, 14364, 14266, 14170, 14075, 13981, 13888, 13797, 13707,
+    13618, 13530, 13443, 13358, 13273, 13190, 13107, 13026, 12945,
+    12866, 12788, 12710, 12633, 12558, 12483, 12409, 12336, 12264,
+    12193, 12122, 12053, 11984, 11916, 11848, 11782, 11716, 11651,
+    11586,
+};
+
+// -ln(c / 2^14) (Q240, two's complement).
+static const uint64_t pfp128_fast_log_table[91][4] = {
+    {0xffffa8a7f8832b02ull, 0xdb0ae7f9dcbce678ull,
+     0xa9b1006599b34ea6ull, 0xd1db36d6618974baull},
+    {0xffffab75a7e32f70ull, 0xa547c0919cb47f1cull,
+     0x82389391e8d7e549ull, 0x0c72d5a1c92de9c1ull},
+    {0xffffae39d8f6396full, 0x93ec5a09808fe999ull,
+     0xc919ff02052891ccull, 0x7812dbdc853eafa1ull},
+    {0xffffb0f716234539ull, 0xf5aad3c2510a1fb4ull,
+     0x508d7be35cbd44c7ull, 0x57d6692ec47d8d71ull},
+    {0xffffb3ad10790dacull, 0xa47f8a00784157e0ull,
+     0x0dbecf901305da97ull, 0x5d00d86fac8c88c9ull},
+    {0xffffb65b77bbac92ull, 0x0b74a5a7aeadb088ull,
+     0xe71cd8859e7b0b2aull, 0xc0938bcf3eccaa2full},
+    {0xffffb901fa72a851ull, 0xb10958a02185c46cull,
+     0x186ed579c92fb63dull, 0xf9a10c69f77c3cb2ull},
+    {0xffffbba045f8806cull, 0xf08875d173434db6ull,
+     0xbacc0c501c2d2e2dull, 0xbcfc27899b3717afull},
+    {0xffffbe3c367f63beull, 0xe5d9ff7e1490e659ull,
+     0x96e73de245043e47ull, 0x6dc4ac1859eada11ull},
+    {0xffffc0cc4727b897ull, 0xed06117b43691424ull,
+     0x54d74770a40cf14cull, 0x4f4d5ee2e270b598ull},
+    {0xffffc359820043dfull, 0xd75bb2837bb66c68ull,
+     0x079e7d4efcd9b203ull, 0x1b74188378142fb8ull},
+    {0xffffc5e0901bb543ull, 0x5ea5640c67652622ull,
+     0x5fb5abccebae80dfull, 0xe629fd545dd74126ull},
+    {0xffffc85df990006eull, 0x584dba5d37011ea8ull,
+     0x8349482b335d038dull, 0x79f62a5d6a8db283ull},
+    {0xffffcad7e586f24cull, 0x37cc5315bb524dc4ull,
+     0xeece19dd58126476ull, 0x17964110c4c0b440ull},
+    {0xffffcd4ae246271cull, 0xfc024bff78d66345ull,
+     0x726da72bb79729ceull, 0xd940aa5e8e3cf004ull},
+    {0xffffcfb9fd367cb9ull, 0x9c8a5d68bd2deedaull,
+     0x7b6a794036e60a3cull, 0xb3a1e4461befbb2full},
+    {0xffffd21e5aea3529ull, 0x68c836cc8c25cc93ull,
+     0x7e635e7c2135ef00ull, 0x41b8fda18ebf9695ull},
+    {0xffffd481bf295f84ull, 0x9d5e506f7b691e18ull,
+     0x718254928a2c07b3ull, 0xed63ae4de5f7cacaull},
+    {0xffffd6dd44f9a095ull, 0x3cee006bcf61a2b3ull,
+     0x841a19333a6043f9ull, 0xb11cf8bb0fd3aa9dull},
+    {0xffffd934169fd55full, 0xd3a6050efe7045d5ull,
+     0xe6f12c7548658fd5ull, 0x9e4d35b5f82a5a0cull},
+    {0xffffdb8605abd59cull, 0x3c3a9c8bc0ca8329ull,
+     0x0989e4cdda9f4655ull, 0x42e3cfb8f7929f44ull},
+    {0xffffddcf62fcd035ull, 0xe844dce7f73c3373ull,
+     0xbe9382f4173c375bull, 0x9f8a174b968c47b9ull},
+    {0xffffe016f6c6404aull, 0x91a12ae78855ad41ull,
+     0x8ca9edcb5cb21aa5ull, 0x1076e88ab1a4ed11ull},
+    {0xffffe259189c83b9ull, 0x5f054dab8f9561c1ull,
+     0xd22170a04141edb0ull, 0xda3d91f24d0ca461ull},
+    {0xffffe495977264a4ull, 0xe8a00c41da9a7e8full,
+     0xc6ce5af7d34bf6f6ull, 0xce244692fd234e80ull},
+    {0xffffe6cc41a2b8b6ull, 0x72d1e3e55bb1ffc6ull,
+     0x242bd3df1a1d5c37ull, 0x5206464bd1d790cfull},
+    {0xffffe9008cf6073full, 0xfce1cccd61914a96ull,
+     0x95e028c29fc080baull, 0x068f1678bd6ec383ull},
+    {0xffffeb2eaea46783ull, 0x1cfa05c7ebd2ad49ull,
+     0x609b6ea75b1a9ee7ull, 0xb1bd576262a9a8a2ull},
+    {0xffffed56735bd508ull, 0x643e5a6539e731d0ull,
+     0x5415eaeaaf121a9cull, 0x9f51bf36de929086ull},
+    {0xffffef7b674ae1c6ull, 0x4eccf157ec93affcull,
+     0x2bb29feb88ef1cd8ull, 0x8244fcc072c20eefull},
+    {0xfffff199a6194326ull, 0x85674664afca8cdcull,
+     0xddf835043bf74be8ull, 0xcccb6195578f4132ull},
+    {0xfffff3b4caf61226ull, 0x253aeeefc4b1f971ull,
+     0xbf95e4b0517823daull, 0xe8494f96cfc2e75cull},
+    {0xfffff5ccb895e98eull, 0x0b3f103493e97f83ull,
+     0xac1cafbb7d3a6a57ull, 0xfc9cd8c05b3c7a8dull},
+    {0xfffff7dd713cce5bull, 0xab4b0b612296d1a1ull,
+     0x6d9596add71aae3dull, 0xd4f6c441feaf0f27ull},
+    {0xfffff9ee8eb628edull, 0x839f399cdfff147full,
+     0x20ed88ff7497fffeull, 0xfa31f9a515a07921ull},
+    {0xfffffbf82a69e329ull, 0xef82d906d14b3b05ull,
+     0xde63a1c0d2902bd6ull, 0xe940950e2a6f60cdull},
+    {0xfffffdfe05514f04ull, 0x31db9111f9a4b710ull,
+     0x425bd7ebfb3fad3dull, 0x5e15536ae1043c2eull},
+    {0x0000000000000000ull, 0x0000000000000000ull,
+     0x0000000000000000ull, 0x0000000000000000ull},
+    {0x000001fdfaa6b126ull, 0x788f18cbe98e72feull,
+     0x3e8f1a418e131702ull, 0x47c4d4b6124d1774ull},
+    {0x000003f7d5162780ull, 0x7b249ec5f9384d38ull,
+     0x3363e14342867623ull, 0xd947b201f8b61900ull},
+    {0x000005ed6ec2508cull, 0x13686a6d01375fa1ull,
+     0xd4a3f07399608b54ull, 0xda3f24db93f16413ull},
+    {0x000007dea6c59e0aull, 0x156c938df3eb88a9ull,
+     0xf043b612732c5b31ull, 0x0d1987426bde570cull},
+    {0x000009cf83dd075eull, 0xb129d642e5777eafull,
+     0x3f02bdce89a611d3ull, 0xd61a78b291843a63ull},
+    {0x00000bbbcc7c6b6full, 0xec4f836a3fca14abull,
+     0x450a8745c381ccf7ull, 0xc76e2ae2f02b3d4bull},
+    {0x00000da35eba6d3bull, 0x4c0a21c56f338507ull,
+     0xf662970fbff7bf95ull, 0xf7337b91ce72c567ull},
+    {0x00000f86186088b1ull, 0xa88653ba414028ccull,
+     0xd05e6f9f2f21ae30ull, 0xc494d3d69da40733ull},
+    {0x00001163d6ef957aull, 0x0313f1c9c64537bfull,
+     0xdf89df5f23dc55e6ull, 0x38381d8053ab6f3cull},
+    {0x00001340c796ac51ull, 0x6a384068c611a964ull,
+     0xbc346d7a8b01a3ecull, 0x9c35ac58cb4eefaaull},
+    {0x0000151cdf40b93aull, 0x5643607dc4a95ef2ull,
+     0x00a098bbb2d479c4ull, 0x7baa8fcecf51e046ull},
+    {0x000016ef528c056aull, 0x2b9d2898352232e7ull,
+     0x03294a5a01b04909ull, 0x613b883cca81ac79ull},
+    {0x000018c51dd7e4bdull, 0x37cfe5a386a51d0bull,
+     0xebabd15410798da8ull, 0x327372d5f1bc668cull},
+    {0x00001a90fd3b5354ull, 0x65eb726e85acbed8ull,
+     0x3ba46a0d268ef8ffull, 0xc252ffbb2703e70dull},
+    {0x00001c601c90f1e9ull, 0x255e5a6509a2aa3eull,
+     0x4b4ec0152a01270dull, 0xb4c763b41169beeeull},
+    {0x00001e2507702af0ull, 0x3b433fd6eedb9825ull,
+     0x65f2c0664e1f9534ull, 0xab9f84de8e107337ull},
+    {0x00001fed1932000aull, 0xc77588bff5792a4cull,
+     0x4f37943e34b749feull, 0x704933afa38a0ed3ull},
+    {0x000021af3cf9a91cull, 0xb422847849e3a781ull,
+     0xe915abcb0eec2093ull, 0xe16f288ea4891d5dull},
+    {0x0000236fe5ab9750ull, 0x85d8ded843f94808ull,
+     0xcb85bbf6a72426a0ull, 0xa91c4676974dca7eull},
+    {0x0000252a65f047eaull, 0x4542b6a38ca1cbd5ull,
+     0x5991f2088b05b671ull, 0x81bf16c4ecd7803full},
+    {0x000026e340407f3eull, 0xc8c856ecaf94e0beull,
+     0xeee0c0306ef04d60ull, 0x3f88f037e2213b3cull},
+    {0x0000289a66d9977aull, 0x3cd4fd08374654c4ull,
+     0xa135fe2f0dccdb86ull, 0xfe84a4434e51daf6ull},
+    {0x00002a4fcbc9436bull, 0x19f472b4bee35201ull,
+     0x52b7e7052ecb2f8cull, 0xe59cd6465c7d91e0ull},
+    {0x00002bfea0e15727ull, 0xa8e63d596970646cull,
+     0x42ca347284b51b01ull, 0xb8a868748cd96a6dull},
+    {0x00002dab87ce60c4ull, 0x273e06364e279185ull,
+     0x0f429722d5825536ull, 0x89f635a7fd8f3c70ull},
+    {0x00002f56720453b1ull, 0xfd627b45009cb945ull,
+     0xc0888c865f4eaa0full, 0x672e45f1be38f35eull},
+    {0x000030ff50ca4212ull, 0x212595679850ebb7ull,
+     0x7e588a3a330fd0cbull, 0x182f234ff900da6dull},
+    {0x000032a6153adaaeull, 0x46c2bc7b3b6c4d41ull,
+     0x0688ec94e333ae0aull, 0xe4f9ecfafd3b8990ull},
+    {0x00003445c84131e9ull, 0x2c24751ce457b5efull,
+     0x39cd8a80009e089full, 0x5f34a1c087f6c677ull},
+    {0x000035e8229d29ffull, 0xf4e1a3287551b812ull,
+     0x625b07ec33ccf3f4ull, 0x8faf9e0214065cb7ull},
+    {0x000037833ce9ff97ull, 0xb03bfba2bdf21e89ull,
+     0xe26b59330e118b03ull, 0x83f237be04e77529ull},
+    {0x00003920ef8fb534ull, 0x98ade105c66eb2a6ull,
+     0x9c5b63bdcc624a29ull, 0x60afd342b28ed4fcull},
+    {0x00003ab732d72ff6ull, 0xbc5cc9001bf3c652ull,
+     0x2915baa8d365c80full, 0x981293190fc685acull},
+    {0x00003c4ffede3668ull, 0x387cb04b0b0a86ddull,
+     0x37d34ccad536f330ull, 0x0d44be2b720c2645ull},
+    {0x00003de12b97bd32ull, 0x6c1431d0e86b06cbull,
+     0x09dbf7e914b0737eull, 0x8303415e7187c8f3ull},
+    {0x00003f6fb0dddc77ull, 0x1fcf1923fb4284a3ull,
+     0xb8b8994a54bc0920ull, 0x508636e48da8edc3ull},
+    {0x00004100a652d3c1ull, 0x0370df44d82d471eull,
+     0x6cf7a9964818d51dull, 0x760fe940cfb91faaull},
+    {0x0000428ee38c7ac7ull, 0xacca4b7d4fc00919ull,
+     0xf04b9f45ae688a8dull, 0x9569878bc50fc998ull},
+    {0x000044151fe749aaull, 0xee082567fd3428c5ull,
+     0x287f38f75c9764b8ull, 0xd7b8a961f8c4c080ull},
+    {0x0000459db2aeb698ull, 0x3963c8b4ab263db0ull,
+     0x4f0c659316035927ull, 0xc7ab6b906a3c26d9ull},
+    {0x000047235b061e88ull, 0x3983fd42af5af4c4ull,
+     0x4c49279905f27dacull, 0x0a2dbb048cf0eb03ull},
+    {0x000048a607efbde5ull, 0xebde9f6a7f262840ull,
+     0x14f437051995bfdeull, 0x864644c7d1996bf3ull},
+    {0x00004a25a84f821aull, 0x8ed027e16952630aull,
+     0x5827edc140f532f8ull, 0xb200457d249b69ffull},
+    {0x00004ba22aec7673ull, 0xe49c4292191b8506ull,
+     0xee97b2e38de8147dull, 0x1f9e328bef787a56ull},
+    {0x00004d20e66b6a76ull, 0x50d4d19164a99d03ull,
+     0x78f22e4cdb035adfull, 0x925b5d3c71e7314cull},
+    {0x00004e9701580994ull, 0x29e7cb96c6ac5c4aull,
+     0x19a83915d3d9bd97ull, 0x377169c2eacd802bull},
+    {0x0000500f421b3a9eull, 0x6ef574487308325aull,
+     0x47bf11bfec245ab7ull, 0x22ecf92dfe771139ull},
+    {0x000051842f0a7178ull, 0x5f4d833bcdc68b54ull,
+     0x60ec79e4b69f8881ull, 0xeb845dc4abab1d19ull},
+    {0x000052fb3e5765e4ull, 0x4cc4dffdc58fae91ull,
+     0xe6a1ebc85acde42full, 0x89800aed3a386e40ull},
+    {0x00005469561da9dfull, 0xd652b46332461060ull,
+     0x1ec6251ccdcde34cull, 0xf96d0533e47e33fcull},
+    {0x000055d97c5d2769ull, 0xacd26c1f27d52da8ull,
+     0x2dbbc1967d298d32ull, 0x2dcac15e7741b191ull},
+    {0x0000574616fdc226ull, 0xf017b11178da99bfull,
+     0xdeca36e6a97a10d0ull, 0x723bcbac0c69526cull},
+    {0x000058b4bbce83a4ull, 0xcd301d9a2a51b2b7ull,
+     0x0e8f309ed536cf66ull, 0x92060952589b43c5ull},
+};
+
+// (-1)^(k+1) / k, for k = 3..19 (Q126, two's complement).
+static const uint64_t pfp128_fast_log_poly[17][2] = {
+    {0x1555555555555555ull, 0x5555555555555555ull},
+    {0xf000000000000000ull, 0x0000000000000000ull},
+    {0x0cccccccccccccccull, 0xcccccccccccccccdull},
+    {0xf555555555555555ull, 0x5555555555555555ull},
+    {0x0924924924924924ull, 0x9249249249249249ull},
+    {0xf800000000000000ull, 0x0000000000000000ull},
+    {0x071c71c71c71c71cull, 0x71c71c71c71c71c7ull},
+    {0xf999999999999999ull, 0x999999999999999aull},
+    {0x05d1745d1745d174ull, 0x5d1745d1745d1746ull},
+    {0xfaaaaaaaaaaaaaaaull, 0xaaaaaaaaaaaaaaabull},
+    {0x04ec4ec4ec4ec4ecull, 0x4ec4ec4ec4ec4ec5ull},
+    {0xfb6db6db6db6db6dull, 0xb6db6db6db6db6dbull},
+    {0x0444444444444444ull, 0x4444444444444444ull},
+    {0xfc00000000000000ull, 0x0000000000000000ull},
+    {0x03c3c3c3c3c3c3c3ull, 0xc3c3c3c3c3c3c3c4ull},
+    {0xfc71c71c71c71c71ull, 0xc71c71c71c71c71cull},
+    {0x035e50d79435e50dull, 0x79435e50d79435e5ull},
+};
+
+// ln(2) (Q240), log10(2) (Q238), 1/ln(2) and 1/ln(10) (Q254).
+static const uint64_t pfp128_fast_ln2_q240[4] = {
+    0x0000b17217f7d1cfull, 0x79abc9e3b39803f2ull, 0xf6af40f343267298ull,
+    0xb62d8a0d175b8babull,
+};
+
+static const uint64_t pfp128_fast_log10_2_q238[4] = {
+    0x0000134413509f79ull, 0xfef311f12b35816full, 0x922f04d5a618a87aull,
+    0x3e69314bcde4d6faull,
+};
+
+static const uint64_t pfp128_fast_inv_ln2_q254[4] = {
+    0x5c551d94ae0bf85dull, 0xdf43ff68348e9f44ull, 0x75abbd546eb4ad2cull,
+    0x45928b3668d09924ull,
+};
+
+static const uint64_t pfp128_fast_inv_ln10_q254[4] = {
+    0x1bcb7b1526e50e32ull, 0xa6ab7555f5a67b86ull, 0x47dc68c048b93440ull,
+    0x4747e5a89ef1d4a8ull,
+};
+
+// (-1)^k / (2k+1)! and (-1)^k / (2k)!, for k = 0..6 (Q126, two's complement).
+static const uint64_t pfp128_fast_sin_poly[7][2] = {
+    {0x4000000000000000ull, 0x0000000000000000ull},
+    {0xf555555555555555ull, 0x5555555555555555ull},
+    {0x0088888888888888ull, 0x8888888888888889ull},
+    {0xfffcbfcbfcbfcbfcull, 0xbfcbfcbfcbfcbfccull},
+    {0x00000b8ef1d2ab63ull, 0x99c7d560e4472801ull},
+    {0xffffffe519ba980aull, 0xbb1c7018b81b47c8ull},
+    {0x000000002c248c27ull, 0x50da12f9470663a4ull},
+};
+
+static const uint64_t pfp128_fast_cos_poly[7][2] = {
+    {0x4000000000000000ull, 0x0000000000000000ull},
+    {0xe000000000000000ull, 0x0000000000000000ull},
+    {0x02aaaaaaaaaaaaaaull, 0xaaaaaaaaaaaaaaabull},
+    {0xffe93e93e93e93e9ull, 0x3e93e93e93e93e94ull},
+    {0x0000680680680680ull, 0x6806806806806807ull},
+    {0xfffffed81b048876ull, 0x0a38d10fe92c159aull},
+    {0x000000023ddb1dffull, 0x1b12f6a89b530f5aull},
+};
+
+// sin(j/64) and cos(j/64), for j = 1..50 (Q127).
+static const uint64_t pfp128_fast_sincos_table[50][4] = {
+    {0x01fffaaaaeeeed4eull, 0xd549c6560f889ee5ull,
+     0x7ffc000555527d28ull, 0xa28a03a5ef356723ull},
+    {0x03ffd555dddd0dd1ull, 0x95fc826eda8f232bull,
+     0x7ff00055549f4ac4ull, 0xabb6d2764a4a37ddull},
+    {0x05ff70040cbeea2aull, 0x66420b916686623bull,
+     0x7fdc01aff7e67b3aull, 0x6254fcdb950a0c1bull},
+    {0x07feaabbbb53b6adull, 0x2e92cd97b496a565ull,
+     0x7fc0055527d34d32ull, 0x8387b99426f10adcull},
+    {0x09fd658968baad4dull, 0xbcdd5acd72e93c65ull,
+     0x7f9c0d04a7bdbb8dull, 0x02f320da41a5f031ull},
+    {0x0bfb808192a8720dull, 0x7e168c00280d0804ull,
+     0x7f701afdf9ae6d31ull, 0x902b535f8db59470ull},
+    {0x0df8dbc2b41c8ebdull, 0x23083bd4998f94acull,
+     0x7f3c32003a66c47aull, 0x8f5e1b461ab08d95ull},
+    {0x0ff5577743771ae5ull, 0x034d43390fc4fc2dull,
+     0x7f005549f56f4db6ull, 0x8f35094efb78c673ull},
+    {0x11f0d3d7afceaea4ull, 0x41abd9a2596d28bdull,
+     0x7ebc8898f12f4bd5ull, 0xaa63d98bb12e9661ull},
+    {0x13eb312c5d66cb51ull, 0xf599ad9b2e43eacaull,
+     0x7e70d029f310a1c5ull, 0xb6b063b74622df85ull},
+    {0x15e44fcfa126f2a4ull, 0x2ef3e701d928a4a9ull,
+     0x7e1d30b87bb3d639ull, 0xaeb1eccd4ea1cf0full},
+    {0x17dc102fbaf2b515ull, 0xab50e23c97c2b12cull,
+     0x7dc1af7e7b386e96ull, 0x737f3c9234bf750aull},
+    {0x19d252d0cec31233ull, 0x887b016226fa7d29ull,
+     0x7d5e5233fd9e5c78ull, 0xe834f80ec7519d6full},
+    {0x1bc6f84edc619967ull, 0x0695a9ec32ac1723ull,
+     0x7cf31f0ecf45b7b7ull, 0x9714b5d72daf6ce1ull},
+    {0x1db9e15fb5a5cfb3ull, 0x477ca4ce40f86cb3ull,
+     0x7c801cc219927cdcull, 0xa020b60cc25b65f7ull},
+    {0x1faaeed4f31576baull, 0x89debdc7351e8b1bull,
+     0x7c05527df7ba85d3ull, 0xc1e99e5cafca7c52ull},
+    {0x219a019de6c86b30ull, 0x27af9b60ea5c2229ull,
+     0x7b82c7ef03c46fe4ull, 0x02dc7f443c4f27a1ull},
+    {0x2386fac98d70eca3ull, 0x03b7f06e7fa3ff19ull,
+     0x7af8853ddbbe9efdull, 0x060ed45abc213c19ull},
+    {0x2571bb887d693e45ull, 0x54e267cb601a8cddull,
+     0x7a66930e9f360addull, 0x9b4e43ac31869560ull},
+    {0x275a252ed3a7b001ull, 0x03d550487839a714ull,
+     0x79ccfa8064f4fe9bull, 0xd74cab931ed5c43cull},
+    {0x294019361e7a40c1ull, 0x1dd35d8475641610ull,
+     0x792bc52ca9126e97ull, 0x35fd17597cce633aull},
+    {0x2b23793f45eb2e5full, 0x1d2eb0ff832b9148ull,
+     0x7882fd26b35b03d3ull, 0x3ea2702139290222ull},
+    {0x2d04271471afed13ull, 0xbb6fedddaa98eba6ull,
+     0x77d2acfaf61d761dull, 0x2758198c93c516a1ull},
+    {0x2ee204aaec8427a4ull, 0x54a33ad124c6f2ecull,
+     0x771adfae65644829ull, 0x66c8eedb9a69d23full},
+    {0x30bcf42504d292c5ull, 0x2074dafd6701f293ull,
+     0x765ba0bdc6a771ffull, 0x61bd5d2039d52479ull},
+    {0x3294d7d3ea8d894bull, 0x18f60cbe05420509ull,
+     0x7594fc1cf900fe89ull, 0xdc9bcb413c8b53c8ull},
+    {0x346992398a1993cbull, 0x9de3895e62666ee2ull,
+     0x74c6fe3635f018f3ull, 0x06e9844e5ee8c53bull},
+    {0x363b060a642c2d28ull, 0xede9a33057362956ull,
+     0x73f1b3e94ab67d8bull, 0x5b5508f2a0ce6803ull},
+    {0x3809162f62814646ull, 0x7f99d5fa7e9a0666ull,
+     0x73152a8aca5cb853ull, 0xb858aea0ea607242ull},
+    {0x39d3a5c7a94a3db4ull, 0x0dd7b494759fd811ull,
+     0x72316fe3386a10d5ull, 0x9e8d0ac8091478a3ull},
+    {0x3b9a982a65393486ull, 0xa6370b8feccf359dull,
+     0x7146922e2c5d77b9ull, 0x112f11955e001e22ull},
+    {0x3d5dd0e8960bdfd0ull, 0xec9786c9fb06f6cdull,
+     0x7054a0196df53e76ull, 0xdeeeced17d7d6cc3ull},
+    {0x3f1d33ced5792e33ull, 0xb2a15e5a014684b2ull,
+     0x6f5ba8c40a53d498ull, 0xdde6446084e6a0e3ull},
+    {0x40d8a4e71a6552d2ull, 0x73287c684fea6b55ull,
+     0x6e5bbbbd62103828ull, 0xb4798f1f5bc0674eull},
+    {0x4290087a78400290ull, 0x9bc5ec6eb0a3a9e8ull,
+     0x6d54e90430413831ull, 0xfef28e04f42af4caull},
+    {0x44434312da70edd9ull, 0x1899880998112939ull,
+     0x6c4741058a93188eull, 0xeab0f7de060d4d2aull},
+    {0x45f2397cbbb6c04dull, 0x795c40b8921eb1ebull,
+     0x6b32d49bda77958full, 0xb6a8dd6b6cc45221ull},
+    {0x479cd0c8d95d3091ull, 0x51fd27a0ead1ffeaull,
+     0x6a17b50dcf80b466ull, 0xf818e17b1e46c982ull},
+    {0x4942ee4de22eecf5ull, 0x1e8122bde672ce21ull,
+     0x68f5f40d4af73a97ull, 0x245135e6996b7491ull},
+    {0x4ae477aa21087605ull, 0xc8e24de95504f429ull,
+     0x67cda3b644be12e2ull, 0xdff3a86e9f984758ull},
+    {0x4c8152c522f13df6ull, 0xb42095a135b3af6bull,
+     0x669ed68da9945172ull, 0x2cfcc9fa7a88440dull},
+    {0x4e1965d158a0ab77ull, 0x8292b627c2bcc8e5ull,
+     0x65699f8032c7f2f4ull, 0x1025de079d335073ull},
+    {0x4fac974db354e7c8ull, 0x351e3d51e080ccc2ull,
+     0x642e11e1376bdb78ull, 0x0a77aa3623c94b41ull},
+    {0x513ace073ce1aac1ull, 0x293e195aafaa02e1ull,
+     0x62ec416977240186ull, 0x3e03e9474c0f1a40ull},
+    {0x52c3f11aaadd8404ull, 0x36815ce33166e94aull,
+     0x61a44235de9b1899ull, 0xc7ff15ff4ee89c0dull},
+    {0x5447e7f5ecd46ea3ull, 0xf179e3b77cf121cdull,
+     0x605628c645b57388ull, 0x5d1bd1f75c8658adull},
+    {0x55c69a59b566cc39ull, 0x08769a1f632ebf1dull,
+     0x5f0209fc27953b8eull, 0x30a4a354465fa6d1ull},
+    {0x573ff05afe3c3596ull, 0xcb370eb578a05244ull,
+     0x5da7fb1954847b9full, 0x60a8c1ce5cecc9daull},
+    {0x58b3d26486b1e212ull, 0x267aa49dbe611deaull,
+     0x5c4811be9dd9e142ull, 0x5b0a5029c80b5fd1ull},
+    {0x5a2229384d2cba94ull, 0x82c89bb2a1a52ce9ull,
+     0x5ae263ea7bed748aull, 0xd63c3667a58d24c7ull},
+};
+
+// floor(2/pi * 2^384), and pi/2 (Q126).
+static const uint64_t pfp128_fast_2_over_pi[6] = {
+    0xa2f9836e4e441529ull, 0xfc2757d1f534ddc0ull, 0xdb6295993c439041ull,
+    0xfe5163abdebbc561ull, 0xb7246e3a424dd2e0ull, 0x06492eea09d1921cull,
+};
+
+static const uint64_t pfp128_fast_pi_2_q126[2] = {
+    0x6487ed5110b4611aull, 0x62633145c06e0e69ull,
+};
+
+// pi/4, rounded down to binary128.
+static const uint64_t pfp128_fast_pi_4_bits[2] = {
+    0x3ffe921fb54442d1ull, 0x8469898cc51701b8ull,
+};
+
+static inline sq_u128 pfp128_fast_u128(uint64_t const w[2]) {
+  return ((sq_u128)w[0] << 64) | w[1];
+}
+
+static inline sq_u256 pfp128_fast_u256(uint64_t const w[4]) {
+  sq_u256 r = {pfp128_fast_u128(w), pfp128_fast_u128(w + 2)};
+  return r;
+}
+
+// floor(a * b / 2^128).
+static inline sq_u128 pfp128_fast_mulhi(sq_u128 a, sq_u128 b) {
+  sq_u128 hi, lo;
+  sq_mul_wide(a, b, &hi, &lo);
+  return hi;
+}
+
+// The same for signed values.
+static inline pfp128_fast_s128 pfp128_fast_smulhi(pfp128_fast_s128 a,
+                                                   pfp128_fast_s128 b) {
+  sq_u128 hi = pfp128_fast_mulhi((sq_u128)a, (sq_u128)b);
+  hi -= a < 0 ? (sq_u128)b : 0;
+  hi -= b < 0 ? (sq_u128)a : 0;
+  return (pfp128_fast_s128)hi;
+}
+
+// 256 bit two's complement helpers.
+static inline sq_u256 pfp128_fast_neg256(sq_u256 a) {
+  sq_u256 zero = {0, 0};
+  return sq_sub256(zero, a);
+}
+
+static inline sq_u256 pfp128_fast_from_s128(pfp128_fast_s128 a) {
+  sq_u256 r = {a < 0 ? ~(sq_u128)0 : 0, (sq_u128)a};
+  return r;
+}
+
+static inline sq_u256 pfp128_fast_shr256(sq_u256 a, int n) {
+  if (n >= 128) {
+    a.lo = n >= 256 ? 0 : a.hi >> (n - 128);
+    a.hi = 0;
+  } else if (n > 0) {
+    a.lo = (a.lo >> n) | (a.hi << (128 - n));
+    a.hi >>= n;
+  }
+  return a;
+}
+
+// Arithmetic (flooring) shift right.
+static inline sq_u256 pfp128_fast_sar256(sq_u256 a, int n) {
+  sq_u128 fill = (pfp128_fast_s128)a.hi < 0 ? ~(sq_u128)0 : 0;
+  a.hi ^= fill;
+  a.lo ^= fill;
+  a = pfp128_fast_shr256(a, n);
+  a.hi ^= fill;
+  a.lo ^= fill;
+  return a;
+}
+
+// v * q for a small integer q.
+static inline sq_u256 pfp128_fast_mul256_int(sq_u256 v, int q) {
+  sq_u128 n = (sq_u128)(q < 0 ? -q : q), hi, lo;
+  sq_mul_wide(v.lo, n, &hi, &lo);
+  sq_u256 r = {v.hi * n + hi, lo};
+  return q < 0 ? pfp128_fast_neg256(r) : r;
+}
+
+// About v * k / 2^256, for signed v and unsigned k (the partial product of
+// the low halves is ignored, so it may be a few units low).
+static inline sq_u256 pfp128_fast_mul256(sq_u256 v, sq_u256 k) {
+  int negative = (pfp128_fast_s128)v.hi < 0;
+  if (negative)
+    v = pfp128_fast_neg256(v);
+  sq_u128 hh1, hh0, hl1, hl0, lh1, lh0;
+  sq_mul_wide(v.hi, k.hi, &hh1, &hh0);
+  sq_mul_wide(v.hi, k.lo, &hl1, &hl0);
+  sq_mul_wide(v.lo, k.hi, &lh1, &lh0);
+  sq_u256 r = {hh1, hh0}, a = {0, hl1}, b = {0, lh1};
+  r = sq_add256(sq_add256(r, a), b);
+  return negative ? pfp128_fast_neg256(r) : r;
+}
+
+// Round sign * v * 2^-scale, for a non-zero v.
+static inline FP128SQ pfp128_fast_pack(sq_u128 sign, sq_u256 v, int scale) {
+  sq_u128 sig;
+  int lead = sq_normalise256(v, &sig);
+  return sq_round_pack(sign, SQ_BIAS + lead - scale, sig);
+}
+
+static inline FP128SQ pfp128_fast_pack128(sq_u128 sign, sq_u128 v,
+                                          int scale) {
+  sq_u256 wide = {0, v};
+  return pfp128_fast_pack(sign, wide, scale);
+}
+
+// The same for a signed v, which may be zero.
+static inline FP128SQ pfp128_fast_pack_signed(sq_u256 v, int scale) {
+  sq_u128 sign = 0;
+  if ((pfp128_fast_s128)v.hi < 0) {
+    sign = SQ_SIGN_BIT;
+    v = pfp128_fast_neg256(v);
+  }
+  if (!(v.hi | v.lo))
+    return sq_make(0);
+  return pfp128_fast_pack(sign, v, scale);
+}
+
+// About v * 2^-scale, for a signed v, as a double.
+static inline double pfp128_fast_to_double(sq_u256 v, int scale) {
+  int negative = (pfp128_fast_s128)v.hi < 0;
+  if (negative)
+    v = pfp128_fast_neg256(v);
+  if (!(v.hi | v.lo))
+    return 0.0;
+  int shift = 192 - sq_clz256(v);
+  if (shift < 0)
+    shift = 0;
+  double d = ldexp((double)(uint64_t)pfp128_fast_shr256(v, shift).lo,
+                   shift - scale);
+  return negative ? -d : d;
+}
+
+//
+// exp and exp2.
+//
+// 2^(k/64) * e^r, where r = R * 2^-134, and |r| <= ln(2)/128 (or a little
+// more).
+static inline FP128SQ pfp128_fast_exp_kernel(int k, pfp128_fast_s128 r) {
+  // The Taylor series to r^12, whose next term is below 2^-130.
+  pfp128_fast_s128 p =
+      (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_exp_poly[12]);
+  for (int i = 11; i >= 0; i--)
+    p = (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_exp_poly[i]) +
+        (pfp128_fast_smulhi(p, r) >> 6);
+  // 2^((k mod 64)/64) (Q126) * e^r (Q126) is Q124.
+  sq_u128 v = pfp128_fast_mulhi(
+      pfp128_fast_u128(pfp128_fast_exp2_table[k & 63]), (sq_u128)p);
+  return pfp128_fast_pack128(0, v, 124 - (k >> 6));
+}
+
+// x * 2^134 (mod 2^256), for finite x with 2^-120 <= |x| < 2^15.
+static inline sq_u256 pfp128_fast_fixed134(FP128SQ x) {
+  int32_t e;
+  sq_u128 m = sq_unpack(x.bits & SQ_ABS_MASK, &e);
+  // |x| = m * 2^(e - SQ_BIAS - 112), and m has 113 bits.
+  int shift = e - SQ_BIAS - 112 + 134;
+  sq_u256 v = {0, m};
+  v = shift >= 0 ? sq_shl256(v, shift) : pfp128_fast_shr256(v, -shift);
+  return signbitsq(x) ? pfp128_fast_neg256(v) : v;
+}
+
+// 2^t, where t = v * 2^-134, and |t| < 2^15.
+static inline FP128SQ pfp128_fast_exp2_fixed(sq_u256 v) {
+  // t = k/64 + r, with k = floor(64t + 1/2), so -1/128 <= r < 1/128.
+  sq_u256 half = {0, (sq_u128)1 << 127};
+  v = sq_add256(v, half);
+  int k = (int)(pfp128_fast_s128)v.hi;
+  pfp128_fast_s128 r = (pfp128_fast_s128)(v.lo - half.lo);
+  // r * ln(2): Q134 * Q127 / 2^128 is Q133.
+  r = pfp128_fast_smulhi(
+          r, (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_ln2_q127))
+      << 1;
+  return pfp128_fast_exp_kernel(k, r);
+}
+
+// e^x for finite x.
+static inline FP128SQ pfp128_fast_exp(FP128SQ x) {
+  sq_u128 abs = x.bits & SQ_ABS_MASK;
+  if (abs < (sq_u128)(SQ_BIAS - 120) << 112)
+    return sq_from_double(1.0);
+  double d = sq_to_double(x);
+  if (d > 11357.0)
+    return sq_make(SQ_INF_BITS);
+  if (d < -11434.0)
+    return sq_make(0);
+  // x = k * ln(2)/64 + r. k only has to be close to x / (ln(2)/64), since
+  // r is computed exactly (mod 2^128, but it's small).
+  int k = (int)(d * 92.332482616893656 + (d < 0 ? -0.5 : 0.5));
+  sq_u128 kLn2 = (sq_u128)(pfp128_fast_s128)k *
+                 pfp128_fast_u128(pfp128_fast_ln2_128);
+  pfp128_fast_s128 kFrac =
+      ((pfp128_fast_s128)k * pfp128_fast_ln2_128_frac[0] +
+       ((pfp128_fast_s128)1 << 63)) >>
+      64;
+  sq_u128 r = pfp128_fast_fixed134(x).lo - kLn2 - (sq_u128)kFrac;
+  return pfp128_fast_exp_kernel(k, (pfp128_fast_s128)r);
+}
+
+// 2^x for finite x.
+static inline FP128SQ pfp128_fast_exp2(FP128SQ x) {
+  sq_u128 abs = x.bits & SQ_ABS_MASK;
+  if (abs < (sq_u128)(SQ_BIAS - 120) << 112)
+    return sq_from_double(1.0);
+  double d = sq_to_double(x);
+  if (d >= 16384.0)
+    return sq_make(SQ_INF_BITS);
+  if (d < -16500.0)
+    return sq_make(0);
+  return pfp128_fast_exp2_fixed(pfp128_fast_fixed134(x));
+}
+
+//
+// log, log2 and log10.
+//
+// ln(x) for finite x > 0, as q * ln(2) + v * 2^-*scale (with v signed). For
+// x close to 1 (when q is 0 and *scale isn't 240) v is scaled to keep its
+// relative accuracy, otherwise *scale is 240.
+static inline sq_u256 pfp128_fast_log_parts(sq_u128 abs, int *q, int *scale) {
+  int32_t e;
+  sq_u128 sig = sq_unpack(abs, &e);
+  // x = 2^q * m, with m in [sqrt(1/2), sqrt(2)) (Q113).
+  sq_u128 m = sig << 1;
+  *q = e - SQ_BIAS;
+  if (sig > (sq_u128)0x5a827999fcef3242ull << 50) {
+    m = sig;
+    ++*q;
+  }
+  // m * c is 1 + r, where c is about 1/(1 + j/128), so |r| < 2^-7.4, and r
+  // is exact (Q127).
+  int j = (int)(((pfp128_fast_s128)m - ((pfp128_fast_s128)1 << 113) +
+                 ((pfp128_fast_s128)1 << 105)) >>
+                106);
+  pfp128_fast_s128 r =
+      (pfp128_fast_s128)(m * pfp128_fast_log_c[j + 37] - ((sq_u128)1 << 127));
+  sq_u256 v = {0, 0};
+  if (r != 0) {
+    // ln(1 + r) = r - r^2/2 + r^3 * (1/3 - r/4 + r^2/5 ...), to r^19,
+    // which leaves an error below 2^-140 r. The series in brackets is Q126.
+    pfp128_fast_s128 r133 = r << 6;
+    pfp128_fast_s128 p =
+        (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_log_poly[16]);
+    for (int i = 15; i >= 0; i--)
+      p = (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_log_poly[i]) +
+          (pfp128_fast_smulhi(p, r133) >> 5);
+    // Scale |r| to n in [2^126, 2^127), so r = +-n * 2^-(127 + shift), and
+    // sum the terms with a scale of 2^(254 + shift).
+    int shift = sq_clz((sq_u128)(r < 0 ? -r : r)) - 1;
+    sq_u128 n = (sq_u128)(r < 0 ? -r : r) << shift;
+    sq_u256 term = {n >> 1, n << 127};
+    v = r < 0 ? pfp128_fast_neg256(term) : term;
+    sq_u256 square = {0, 0};
+    sq_mul_wide(n, n, &square.hi, &square.lo);
+    v = sq_sub256(v, pfp128_fast_shr256(square, 1 + shift));
+    // r^3 is cube * 2^-(125 + 3 shift), and r^3 * p is cubic *
+    // 2^-(123 + 3 shift).
+    pfp128_fast_s128 cube = (pfp128_fast_s128)pfp128_fast_mulhi(square.hi, n);
+    pfp128_fast_s128 cubic = pfp128_fast_smulhi(r < 0 ? -cube : cube, p);
+    int cubicShift = 2 * shift - 131;
+    term = pfp128_fast_from_s128(cubic);
+    term = cubicShift >= 0 ? pfp128_fast_sar256(term, cubicShift)
+                           : sq_shl256(term, -cubicShift);
+    v = sq_add256(v, term);
+    *scale = 254 + shift;
+    if (*q == 0 && j == 0)
+      return v;
+    v = pfp128_fast_sar256(v, *scale - 240);
+  }
+  *scale = 240;
+  return sq_add256(v, pfp128_fast_u256(pfp128_fast_log_table[j + 37]));
+}
+
+// log2(x) = v * 2^-*scale, for finite x > 0.
+static inline sq_u256 pfp128_fast_log2_fixed(sq_u128 abs, int *scale) {
+  int q;
+  sq_u256 v = pfp128_fast_mul256(pfp128_fast_log_parts(abs, &q, scale),
+                                 pfp128_fast_u256(pfp128_fast_inv_ln2_q254));
+  *scale -= 2;
+  // log2(x) = q + ln(m) / ln(2), and q is exact.
+  sq_u256 whole = {(sq_u128)(pfp128_fast_s128)q << 110, 0};
+  return sq_add256(v, whole);
+}
+
+static inline FP128SQ pfp128_fast_log(FP128SQ x) {
+  int q, scale;
+  sq_u256 v = pfp128_fast_log_parts(x.bits, &q, &scale);
+  if (scale == 240)
+    v = sq_add256(v, pfp128_fast_mul256_int(
+                         pfp128_fast_u256(pfp128_fast_ln2_q240), q));
+  return pfp128_fast_pack_signed(v, scale);
+}
+
+static inline FP128SQ pfp128_fast_log2(FP128SQ x) {
+  int scale;
+  sq_u256 v = pfp128_fast_log2_fixed(x.bits, &scale);
+  return pfp128_fast_pack_signed(v, scale);
+}
+
+static inline FP128SQ pfp128_fast_log10(FP128SQ x) {
+  int q, scale;
+  sq_u256 v = pfp128_fast_mul256(pfp128_fast_log_parts(x.bits, &q, &scale),
+                                 pfp128_fast_u256(pfp128_fast_inv_ln10_q254));
+  v = sq_add256(v, pfp128_fast_mul256_int(
+                       pfp128_fast_u256(pfp128_fast_log10_2_q238), q));
+  return pfp128_fast_pack_signed(v, scale - 2);
+}
+
+//
+// pow.
+//
+// 0 if finite non-zero y isn't an integer, 1 if it's odd, 2 if it's even.
+static inline int pfp128_fast_integer_kind(sq_u128 abs) {
+  int e = (int)(abs >> 112) - SQ_BIAS;
+  if (e < 0)
+    return 0;
+  if (e > 112)
+    return 2;
+  if (abs & (SQ_MANT_MASK >> e))
+    return 0;
+  if (e == 0)
+    return 1;
+  return (int)(abs >> (112 - e)) & 1 ? 1 : 2;
+}
+
+// Bits [pos, pos + 128) of the 384 bit number w[2]:w[1]:w[0].
+static inline sq_u128 pfp128_fast_bits384(sq_u128 const w[3], int pos) {
+  int i = pos >> 7, s = pos & 127;
+  sq_u128 lo = i < 3 ? w[i] >> s : 0;
+  sq_u128 hi = s && i + 1 < 3 ? w[i + 1] << (128 - s) : 0;
+  return lo | hi;
+}
+
+// |x|^y for finite non-zero x and y, with x != +-1.
+static inline FP128SQ pfp128_fast_pow(FP128SQ x, FP128SQ y) {
+  int scale;
+  sq_u256 l = pfp128_fast_log2_fixed(x.bits & SQ_ABS_MASK, &scale);
+  double t = sq_to_double(y) * pfp128_fast_to_double(l, scale);
+  if (t > 16400.0)
+    return sq_make(SQ_INF_BITS);
+  if (t < -16600.0)
+    return sq_make(0);
+  // t = y * log2(x), times 2^134, which is less than 2^149. |log2(x)| is at
+  // least 2^-113, so |y| < 2^128, and the product is shifted right.
+  int negative = signbitsq(y) ^ ((pfp128_fast_s128)l.hi < 0);
+  if ((pfp128_fast_s128)l.hi < 0)
+    l = pfp128_fast_neg256(l);
+  int32_t e;
+  sq_u128 m = sq_unpack(y.bits & SQ_ABS_MASK, &e);
+  sq_u128 w[3], hi0, hi1, lo1;
+  sq_mul_wide(m, l.lo, &hi0, &w[0]);
+  sq_mul_wide(m, l.hi, &hi1, &lo1);
+  w[1] = hi0 + lo1;
+  w[2] = hi1 + (w[1] < lo1);
+  int shift = scale - 134 - (e - SQ_BIAS - 112);
+  sq_u256 v = {pfp128_fast_bits384(w, shift + 128),
+               pfp128_fast_bits384(w, shift)};
+  return pfp128_fast_exp2_fixed(negative ? pfp128_fast_neg256(v) : v);
+}
+
+//
+// sin and cos.
+//
+// Bits [pos, pos + 64) of the 512 bit number in w[0..7] (least significant
+// first).
+static inline uint64_t pfp128_fast_bits64(uint64_t const w[8], int pos) {
+  int i = pos >> 6, s = pos & 63;
+  uint64_t lo = i < 8 ? w[i] >> s : 0;
+  uint64_t hi = s && i + 1 < 8 ? w[i + 1] << (64 - s) : 0;
+  return lo | hi;
+}
+
+// sin(r) and cos(r), where r = n * 2^-scale, with n < 2^127, and 0 < r <=
+// pi/4, as sinR * 2^-sinScale and cosR * 2^-cosScale.
+static inline void pfp128_fast_sincos_kernel(sq_u128 n, int scale,
+                                             sq_u128 *sinR, int *sinScale,
+                                             sq_u128 *cosR, int *cosScale) {
+  // r = j/64 + t, with |t| <= 1/128.
+  int j = scale - 7 >= 128 ? 0 : (int)((n >> (scale - 7)) + 1) >> 1;
+  pfp128_fast_s128 t = 0;
+  sq_u128 u = 0;
+  if (j == 0) {
+    // t = r, which may be tiny, so keep its scale. u = t^2 (Q140).
+    int shift = 2 * scale - 268;
+    sq_u128 square = pfp128_fast_mulhi(n, n);
+    u = shift >= 128 ? 0 : shift >= 0 ? square >> shift : square << -shift;
+  } else {
+    // t (Q133).
+    t = ((pfp128_fast_s128)(n >> (scale - 126)) -
+         ((pfp128_fast_s128)j << 120))
+        << 7;
+    sq_u128 a = (sq_u128)(t < 0 ? -t : t);
+    u = pfp128_fast_mulhi(a, a) << 2;
+  }
+  // sin(t) / t and cos(t) as series in t^2, to t^12, whose next terms are
+  // below 2^-134 (Q126).
+  pfp128_fast_s128 s =
+      (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_sin_poly[6]);
+  pfp128_fast_s128 c =
+      (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_cos_poly[6]);
+  for (int i = 5; i >= 0; i--) {
+    s = (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_sin_poly[i]) +
+        (pfp128_fast_smulhi(s, (pfp128_fast_s128)u) >> 12);
+    c = (pfp128_fast_s128)pfp128_fast_u128(pfp128_fast_cos_poly[i]) +
+        (pfp128_fast_smulhi(c, (pfp128_fast_s128)u) >> 12);
+  }
+  if (j == 0) {
+    *sinR = pfp128_fast_mulhi(n, (sq_u128)s);
+    *sinScale = scale - 2;
+    *cosR = (sq_u128)c;
+    *cosScale = 126;
+    return;
+  }
+  // sin(r) = sin(j/64) cos(t) + cos(j/64) sin(t), and
+  // cos(r) = cos(j/64) cos(t) - sin(j/64) sin(t) (Q125).
+  uint64_t const *entry = pfp128_fast_sincos_table[j - 1];
+  pfp128_fast_s128 sinJ = (pfp128_fast_s128)pfp128_fast_u128(entry);
+  pfp128_fast_s128 cosJ = (pfp128_fast_s128)pfp128_fast_u128(entry + 2);
+  pfp128_fast_s128 sinT = pfp128_fast_smulhi(t, s) >> 4;
+  *sinR = (sq_u128)(pfp128_fast_smulhi(sinJ, c) +
+                    (pfp128_fast_smulhi(cosJ, sinT) >> 1));
+  *cosR = (sq_u128)(pfp128_fast_smulhi(cosJ, c) -
+                    (pfp128_fast_smulhi(sinJ, sinT) >> 1));
+  *sinScale = *cosScale = 125;
+}
+
+// sin(x) and cos(x) for finite |x| < 2^64. The quadrant is sorted out
+// before the results are packed, so that when only one of them is used the
+// compiler can drop the packing of the other.
+static inline void pfp128_fast_sincos(FP128SQ x, FP128SQ *sinX,
+                                      FP128SQ *cosX) {
+  sq_u128 abs = x.bits & SQ_ABS_MASK;
+  if (abs == 0) {
+    *sinX = x;
+    *cosX = sq_from_double(1.0);
+    return;
+  }
+  int32_t e;
+  sq_u128 m = sq_unpack(abs, &e);
+  sq_u128 sinR, cosR;
+  int sinScale, cosScale;
+  sq_u128 sign = signbitsq(x) ? SQ_SIGN_BIT : 0;
+  if (abs < pfp128_fast_u128(pfp128_fast_pi_4_bits)) {
+    pfp128_fast_sincos_kernel(m << 14, SQ_BIAS + 126 - e, &sinR, &sinScale,
+                              &cosR, &cosScale);
+    *sinX = pfp128_fast_pack128(sign, sinR, sinScale);
+    *cosX = pfp128_fast_pack128(0, cosR, cosScale);
+    return;
+  }
+  // |x| * 2/pi = m * 2^(e - SQ_BIAS - 112) * floor(2/pi * 2^384) * 2^-384,
+  // so, with the product in p, the binary point is at bit 496 - (e -
+  // SQ_BIAS), which is between 433 and 497. The product's error is below
+  // 2^-320, and we keep 256 bits of the fraction.
+  uint64_t p[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  uint64_t const half[2] = {(uint64_t)m, (uint64_t)(m >> 64)};
+  for (int i = 0; i < 2; i++) {
+    sq_u128 carry = 0;
+    for (int k = 0; k < 6; k++) {
+      sq_u128 sum = (sq_u128)half[i] * pfp128_fast_2_over_pi[5 - k] +
+                    p[i + k] + carry;
+      p[i + k] = (uint64_t)sum;
+      carry = sum >> 64;
+    }
+    p[i + 6] = (uint64_t)carry;
+  }
+  int point = 496 - (e - SQ_BIAS);
+  sq_u256 f = {((sq_u128)pfp128_fast_bits64(p, point - 64) << 64) |
+                   pfp128_fast_bits64(p, point - 128),
+               ((sq_u128)pfp128_fast_bits64(p, point - 192) << 64) |
+                   pfp128_fast_bits64(p, point - 256)};
+  unsigned n = (unsigned)pfp128_fast_bits64(p, point);
+  // |x| = (n + f) * pi/2, and we want f in [-1/2, 1/2).
+  sq_u128 rSign = 0;
+  if ((pfp128_fast_s128)f.hi < 0) {
+    n++;
+    f = pfp128_fast_neg256(f);
+    rSign = SQ_SIGN_BIT;
+  }
+  int lz = sq_clz256(f);
+  sq_u128 top = sq_shl256(f, lz).hi;
+  // |r| = |f| * pi/2 = top * 2^-(128 + lz) * pi/2.
+  sq_u128 r = pfp128_fast_mulhi(top, pfp128_fast_u128(pfp128_fast_pi_2_q126));
+  pfp128_fast_sincos_kernel(r, 126 + lz, &sinR, &sinScale, &cosR, &cosScale);
+  // sin(n pi/2 + r) is sin(r), cos(r), -sin(r) or -cos(r), and cos(n pi/2 +
+  // r) is cos(r), -sin(r), -cos(r) or sin(r), for n mod 4 = 0, 1, 2 or 3.
+  // sin is odd and cos is even, in both r and x.
+  sq_u128 sinSign = (n & 2) ? SQ_SIGN_BIT : 0;
+  sq_u128 cosSign = ((n + 1) & 2) ? SQ_SIGN_BIT : 0;
+  if (n & 1) {
+    *sinX = pfp128_fast_pack128(sign ^ sinSign, cosR, cosScale);
+    *cosX = pfp128_fast_pack128(cosSign ^ rSign, sinR, sinScale);
+  } else {
+    *sinX = pfp128_fast_pack128(sign ^ sinSign ^ rSign, sinR, sinScale);
+    *cosX = pfp128_fast_pack128(cosSign, cosR, cosScale);
+  }
+}
+
+//
+// The FP128 functions.
+//
+static inline FP128 expFP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x);
+  if (SQ_UNLIKELY(!isfinitesq(a)))
+    return expFP128(x);
+  return FP128_from_sq(pfp128_fast_exp(a));
+}
+
+static inline FP128 exp2FP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x);
+  // (exp gives the same results as exp2 for NaNs and infinities.)
+  if (SQ_UNLIKELY(!isfinitesq(a)))
+    return expFP128(x);
+  return FP128_from_sq(pfp128_fast_exp2(a));
+}
+
+// Positive, finite and non-zero, as an unsigned integer compare.
+#define PFP128_FAST_LOG_DOMAIN(a) ((a).bits - 1 < SQ_INF_BITS - 1)
+
+static inline FP128 logFP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x);
+  if (SQ_UNLIKELY(!PFP128_FAST_LOG_DOMAIN(a)))
+    return logFP128(x);
+  return FP128_from_sq(pfp128_fast_log(a));
+}
+
+static inline FP128 log2FP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x);
+  if (SQ_UNLIKELY(!PFP128_FAST_LOG_DOMAIN(a)))
+    return log2FP128(x);
+  return FP128_from_sq(pfp128_fast_log2(a));
+}
+
+static inline FP128 log10FP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x);
+  if (SQ_UNLIKELY(!PFP128_FAST_LOG_DOMAIN(a)))
+    return log10FP128(x);
+  return FP128_from_sq(pfp128_fast_log10(a));
+}
+
+static inline FP128 powFP128_fast(FP128 x, FP128 y) {
+  FP128SQ a = FP128_to_sq(x), b = FP128_to_sq(y);
+  sq_u128 absX = a.bits & SQ_ABS_MASK, absY = b.bits & SQ_ABS_MASK;
+  if (SQ_UNLIKELY(absX - 1 >= SQ_INF_BITS - 1 || absY - 1 >= SQ_INF_BITS - 1))
+    return powFP128(x, y);
+  // A negative x needs an integer y, and an odd one changes the sign.
+  int kind = signbitsq(a) ? pfp128_fast_integer_kind(absY) : 2;
+  if (SQ_UNLIKELY(kind == 0))
+    return powFP128(x, y);
+  FP128SQ r = absX == (sq_u128)SQ_BIAS << 112 ? sq_from_double(1.0)
+                                              : pfp128_fast_pow(a, b);
+  if (signbitsq(a) && kind == 1)
+    r = negsq(r);
+  return FP128_from_sq(r);
+}
+
+// Below 2^64, as an unsigned integer compare.
+#define PFP128_FAST_SINCOS_DOMAIN(a)                                           \
+  (((a).bits & SQ_ABS_MASK) < (sq_u128)(SQ_BIAS + 64) << 112)
+
+static inline FP128 sinFP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x), s, c;
+  if (SQ_UNLIKELY(!PFP128_FAST_SINCOS_DOMAIN(a)))
+    return sinFP128(x);
+  pfp128_fast_sincos(a, &s, &c);
+  return FP128_from_sq(s);
+}
+
+static inline FP128 cosFP128_fast(FP128 x) {
+  FP128SQ a = FP128_to_sq(x), s, c;
+  if (SQ_UNLIKELY(!PFP128_FAST_SINCOS_DOMAIN(a)))
+    return cosFP128(x);
+  pfp128_fast_sincos(a, &s, &c);
+  return FP128_from_sq(c);
+}
+
+// Both from one argument reduction.
+static inline void sincosFP128_fast(FP128 x, FP128 *sinX, FP128 *cosX) {
+  FP128SQ a = FP128_to_sq(x), s, c;
+  if (SQ_UNLIKELY(!PFP128_FAST_SINCOS_DOMAIN(a))) {
+    *sinX = sinFP128(x);
+    *cosX = cosFP128(x);
+    return;
+  }
+  pfp128_fast_sincos(a, &s, &c);
+  *sinX = FP128_from_sq(s);
+  *cosX = FP128_from_sq(c);
+}
+
+#undef PFP128_FAST_LOG_DOMAIN
+#undef PFP128_FAST_SINCOS_DOMAIN
+
+#if (PFP128_FAST_MATH)
+#define expFP128 expFP128_fast
+#define logFP128 logFP128_fast
+#define log2FP128 log2FP128_fast
+#define log10FP128 log10FP128_fast
+#define powFP128 powFP128_fast
+#define sinFP128 sinFP128_fast
+#define cosFP128 cosFP128_fast
+#endif
+
+#endif // Header monotonicity
@@ -0,0 +1,419 @@
+//===-- pfp128_fft.h - Fast Fourier transforms of FP128 data --*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Discrete Fourier transforms of COMPLEX_FP128 (and FP128) arrays of any
+ * length, computed in FP128 throughout.
+ *
+ *   FP128_FFT_PLAN *p = FP128_fft_plan(n);
+ *   FP128_fft(p, in, out, FP128_FFT_FORWARD);   // out[k] = sum in[j] w^jk
+ *   FP128_fft(p, out, in, FP128_FFT_BACKWARD);  // in = n * original in
+ *   FP128_fft_destroy(p);
+ *
+ * where w = exp(-2 pi i / n) forwards, and exp(2 pi i / n) backwards. As
+ * with FFTW the transforms aren't normalised, so a forward and backward
+ * transform multiply by n. in and out may be the same array.
+ *
+ * A plan holds the factors of n and the table of the n twiddle factors
+ * w^k, computed once (in FP128, with sincosFP128) rather than in every
+ * transform; it's only read by the transforms, so one plan can be used by
+ * any number of threads at once, and for either direction.
+ *
+ * n is split into factors of 4, then 2, then odd primes, and each factor is
+ * one pass of a Stockham (self-sorting) transform, which reads and writes
+ * runs of consecutive values and needs no bit reversal. Radix 4 and 2 have
+ * their own butterflies; other primes p use a direct DFT, costing O(n p)
+ * for that pass, so the transform is only fast when n's prime factors are
+ * small. Each pass runs in parallel with OpenMP once n reaches
+ * PFP128_OMP_THRESHOLD.
+ *
+ * Real data has its own plans, which take n real values to the n / 2 + 1
+ * non-redundant complex ones (X[n - k] is the conjugate of X[k]) and back:
+ *
+ *   FP128_RFFT_PLAN *r = FP128_rfft_plan(n);
+ *   FP128_rfft(r, x, X);    // n FP128 -> n / 2 + 1 COMPLEX_FP128
+ *   FP128_irfft(r, X, x);   // and back (times n)
+ *   FP128_rfft_destroy(r);
+ *
+ * For even n this does a complex transform of half the length.
+ *
+ * FP128_fft_n, FP128_rfft_n and FP128_irfft_n do howmany transforms of
+ * consecutive arrays (of n, or n / 2 + 1, values), in parallel with OpenMP.
+ *
+ * The plans return NULL, and the transforms -1, if they can't allocate
+ * memory (the transforms need a work array of n values).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_FFT_H_INCLUDED_))
+#define _PFP128_FFT_H_INCLUDED_ 1
+
+#include "pfp128_complex.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FP128_FFT_FORWARD (-1)
+#define FP128_FFT_BACKWARD 1
+
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_FFT_PRAGMA(x) _Pragma(#x)
+#define PFP128_FFT_LOOP                                                        \
+  PFP128_FFT_PRAGMA(omp parallel for schedule(static)                          \
+                    if (total >= PFP128_OMP_THRESHOLD))
+#define PFP128_FFT_BATCH_LOOP                                                  \
+  PFP128_FFT_PRAGMA(omp parallel for schedule(static) reduction(| : failed)   \
+                    if (total >= PFP128_OMP_THRESHOLD))
+#else
+// (Without OpenMP the loops just use total, so that it isn't unused.)
+#define PFP128_FFT_LOOP (void)total;
+#define PFP128_FFT_BATCH_LOOP (void)total;
+#endif
+
+typedef struct {
+  size_t n;
+  int nfactors;
+  size_t factors[64];
+  COMPLEX_FP128 *twiddles; // exp(-2 pi i k / n), 0 <= k < n
+} FP128_FFT_PLAN;
+
+typedef struct {
+  size_t n;
+  FP128_FFT_PLAN *half; // Of length n / 2 if n is even, else n.
+  COMPLEX_FP128 *twiddles; // exp(-2 pi i k / n), 0 <= k <= n / 2
+} FP128_RFFT_PLAN;
+
+// exp(-2 pi i k / n) for 0 <= k < count (<= n), exact at multiples of pi/2.
+static inline void pfp128_fft_twiddles(COMPLEX_FP128 *w, size_t n,
+                                       size_t count) {
+  FP128 zero = FP128_from_double(0.0), one = FP128_from_double(1.0);
+  FP128 twoPi = mulFP128(FP128_from_double(2.0), M_PI_FP128);
+  for (size_t k = 0; k < count && k <= n / 2; k++) {
+    FP128 s, c;
+    if (k == 0) {
+      s = zero;
+      c = one;
+    } else if (4 * k == n) {
+      s = negFP128(one);
+      c = zero;
+    } else if (2 * k == n) {
+      s = zero;
+      c = negFP128(one);
+    } else {
+      FP128 angle = mulFP128(twoPi, divFP128(FP128_from_ll((long long)k),
+                                             FP128_from_ll((long long)n)));
+      sincosFP128(angle, &s, &c);
+      s = negFP128(s);
+    }
+    w[k] = CMPLXFP128(c, s);
+    // w^(n - k) is the conjugate of w^k.
+    if (k > 0 && n - k < count && n - k != k)
+      w[n - k] = CMPLXFP128(c, negFP128(s));
+  }
+}
+
+static inline void FP128_fft_destroy(FP128_FFT_PLAN *p) {
+  if (p) {
+    free(p->twiddles);
+    free(p);
+  }
+}
+
+static inline FP128_FFT_PLAN *FP128_fft_plan(size_t n) {
+  if (n == 0 || n > (size_t)-1 / sizeof(COMPLEX_FP128))
+    return NULL;
+  FP128_FFT_PLAN *p = (FP128_FFT_PLAN *)calloc(1, sizeof(FP128_FFT_PLAN));
+  if (!p)
+    return NULL;
+  p->n = n;
+  p->twiddles = (COMPLEX_FP128 *)malloc(n * sizeof(COMPLEX_FP128));
+  if (!p->twiddles) {
+    FP128_fft_destroy(p);
+    return NULL;
+  }
+  pfp128_fft_twiddles(p->twiddles, n, n);
+  size_t rest = n;
+  while (rest % 4 == 0) {
+    p->factors[p->nfactors++] = 4;
+    rest /= 4;
+  }
+  while (rest % 2 == 0) {
+    p->factors[p->nfactors++] = 2;
+    rest /= 2;
+  }
+  for (size_t f = 3; rest > 1; f += 2) {
+    if (f > rest / f)
+      f = rest; // What's left is prime.
+    while (rest % f == 0) {
+      p->factors[p->nfactors++] = f;
+      rest /= f;
+    }
+  }
+  return p;
+}
+
+// The arithmetic, with pfp128_complex.h's helpers (which are inline with
+// binary128).
+static inline COMPLEX_FP128 pfp128_fft_add(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  return CMPLXFP128(pfp128_complex_add(crealFP128(a), crealFP128(b)),
+                    pfp128_complex_add(cimagFP128(a), cimagFP128(b)));
+}
+
+static inline COMPLEX_FP128 pfp128_fft_sub(COMPLEX_FP128 a, COMPLEX_FP128 b) {
+  return CMPLXFP128(pfp128_complex_add(crealFP128(a), negFP128(crealFP128(b))),
+                    pfp128_complex_add(cimagFP128(a), negFP128(cimagFP128(b))));
+}
+
+// a * i * sign, which is exact.
+static inline COMPLEX_FP128 pfp128_fft_rotate(COMPLEX_FP128 a, int sign) {
+  return sign < 0 ? CMPLXFP128(cimagFP128(a), negFP128(crealFP128(a)))
+                  : CMPLXFP128(negFP128(cimagFP128(a)), crealFP128(a));
+}
+
+// w^k, or its conjugate backwards.
+static inline COMPLEX_FP128 pfp128_fft_twiddle(FP128_FFT_PLAN const *p,
+                                               size_t k, int sign) {
+  COMPLEX_FP128 w = p->twiddles[k];
+  return sign < 0 ? w : CMPLXFP128(crealFP128(w), negFP128(cimagFP128(w)));
+}
+
+// One pass of radix r on the s interleaved transforms of length l = n / s
+// in x, into y. With m = l / r, for each j < m and q < s the r values
+// x[q + s * (j + t * m)] go through a DFT of length r, and the results,
+// times w_l^(j u), go to y[q + s * (r * j + u)].
+static inline void pfp128_fft_pass(FP128_FFT_PLAN const *p, size_t r, size_t s,
+                                   COMPLEX_FP128 const *x, COMPLEX_FP128 *y,
+                                   int sign) {
+  size_t n = p->n, m = n / (s * r), count = m * s, total = n;
+  PFP128_FFT_LOOP
+  for (size_t i = 0; i < count; i++) {
+    size_t j = i / s, q = i % s;
+    COMPLEX_FP128 const *a = x + q + s * j;
+    COMPLEX_FP128 *b = y + q + s * r * j;
+    size_t step = s * m; // Between the inputs.
+    if (r == 4) {
+      COMPLEX_FP128 a02 = pfp128_fft_add(a[0], a[2 * step]);
+      COMPLEX_FP128 d02 = pfp128_fft_sub(a[0], a[2 * step]);
+      COMPLEX_FP128 a13 = pfp128_fft_add(a[step], a[3 * step]);
+      COMPLEX_FP128 d13 =
+          pfp128_fft_rotate(pfp128_fft_sub(a[step], a[3 * step]), sign);
+      b[0] = pfp128_fft_add(a02, a13);
+      b[s] = pfp128_fft_add(d02, d13);
+      b[2 * s] = pfp128_fft_sub(a02, a13);
+      b[3 * s] = pfp128_fft_sub(d02, d13);
+    } else if (r == 2) {
+      COMPLEX_FP128 a0 = a[0], a1 = a[step];
+      b[0] = pfp128_fft_add(a0, a1);
+      b[s] = pfp128_fft_sub(a0, a1);
+    } else {
+      // w_r = w_n^(n / r).
+      for (size_t u = 0; u < r; u++) {
+        COMPLEX_FP128 sum = a[0];
+        for (size_t t = 1, e = u; t < r; t++, e = (e + u) % r)
+          sum = e == 0 ? pfp128_fft_add(sum, a[t * step])
+                       : cfmaFP128(a[t * step],
+                                   pfp128_fft_twiddle(p, e * (n / r), sign),
+                                   sum);
+        b[u * s] = sum;
+      }
+    }
+    // w_l^(j u) = w_n^(j u s).
+    if (j > 0)
+      for (size_t u = 1; u < r; u++)
+        b[u * s] = cmulFP128(b[u * s], pfp128_fft_twiddle(p, j * u * s, sign));
+  }
+}
+
+// As FP128_fft, with work an array of n values.
+static inline void pfp128_fft_run(FP128_FFT_PLAN const *p,
+                                  COMPLEX_FP128 const *in, COMPLEX_FP128 *out,
+                                  COMPLEX_FP128 *work, int sign) {
+  int k = p->nfactors;
+  if (k == 0) {
+    out[0] = in[0];
+    return;
+  }
+  // The passes alternate between out and work, ending in out.
+  COMPLEX_FP128 *dest = k % 2 ? out : work;
+  if (in == dest) {
+    memcpy(work, in, p->n * sizeof(COMPLEX_FP128));
+    in = work;
+  }
+  size_t s = 1;
+  for (int i = 0; i < k; i++) {
+    pfp128_fft_pass(p, p->factors[i], s, in, dest, sign);
+    s *= p->factors[i];
+    in = dest;
+    dest = dest == out ? work : out;
+  }
+}
+
+static inline int FP128_fft(FP128_FFT_PLAN const *p, COMPLEX_FP128 const *in,
+                            COMPLEX_FP128 *out, int sign) {
+  COMPLEX_FP128 *work =
+      (COMPLEX_FP128 *)malloc(p->n * sizeof(COMPLEX_FP128));
+  if (!work)
+    return -1;
+  pfp128_fft_run(p, in, out, work, sign);
+  free(work);
+  return 0;
+}
+
+static inline void FP128_rfft_destroy(FP128_RFFT_PLAN *r) {
+  if (r) {
+    FP128_fft_destroy(r->half);
+    free(r->twiddles);
+    free(r);
+  }
+}
+
+static inline FP128_RFFT_PLAN *FP128_rfft_plan(size_t n) {
+  if (n == 0)
+    return NULL;
+  FP128_RFFT_PLAN *r = (FP128_RFFT_PLAN *)calloc(1, sizeof(FP128_RFFT_PLAN));
+  if (!r)
+    return NULL;
+  r->n = n;
+  r->half = FP128_fft_plan(n % 2 ? n : n / 2);
+  if (n % 2 == 0)
+    r->twiddles =
+        (COMPLEX_FP128 *)malloc((n / 2 + 1) * sizeof(COMPLEX_FP128));
+  if (!r->half || (n % 2 == 0 && !r->twiddles)) {
+    FP128_rfft_destroy(r);
+    return NULL;
+  }
+  if (r->twiddles)
+    pfp128_fft_twiddles(r->twiddles, n, n / 2 + 1);
+  return r;
+}
+
+// Forwards, from n real values to n / 2 + 1 complex ones.
+static inline int FP128_rfft(FP128_RFFT_PLAN const *r, FP128 const *in,
+                             COMPLEX_FP128 *out) {
+  size_t n = r->n, h = n / 2;
+  FP128 zero = FP128_from_double(0.0);
+  COMPLEX_FP128 *z =
+      (COMPLEX_FP128 *)malloc(2 * n * sizeof(COMPLEX_FP128));
+  if (!z)
+    return -1;
+  if (n % 2) {
+    for (size_t i = 0; i < n; i++)
+      z[i] = CMPLXFP128(in[i], zero);
+    pfp128_fft_run(r->half, z, z, z + n, FP128_FFT_FORWARD);
+    memcpy(out, z, (h + 1) * sizeof(COMPLEX_FP128));
+    free(z);
+    return 0;
+  }
+  // The even values are the real parts and the odd ones the imaginary parts
+  // of a transform of length h, Z, from which
+  //   X[k] = (Z[k] + conj(Z[h - k])) / 2 - i w^k (Z[k] - conj(Z[h - k])) / 2
+  for (size_t i = 0; i < h; i++)
+    z[i] = CMPLXFP128(in[2 * i], in[2 * i + 1]);
+  pfp128_fft_run(r->half, z, z, z + h, FP128_FFT_FORWARD);
+  FP128 half = FP128_from_double(0.5);
+  for (size_t k = 0; k <= h; k++) {
+    COMPLEX_FP128 a = z[k % h], b = z[(h - k) % h];
+    b = CMPLXFP128(crealFP128(b), negFP128(cimagFP128(b)));
+    COMPLEX_FP128 e = pfp128_fft_add(a, b);
+    COMPLEX_FP128 o =
+        pfp128_fft_rotate(cmulFP128(r->twiddles[k], pfp128_fft_sub(a, b)), -1);
+    COMPLEX_FP128 x = pfp128_fft_add(e, o);
+    out[k] = CMPLXFP128(pfp128_complex_mul(crealFP128(x), half),
+                        pfp128_complex_mul(cimagFP128(x), half));
+  }
+  free(z);
+  return 0;
+}
+
+// Backwards, from n / 2 + 1 complex values (the imaginary parts of in[0],
+// and of in[n / 2] for even n, are ignored) to n real ones.
+static inline int FP128_irfft(FP128_RFFT_PLAN const *r, COMPLEX_FP128 const *in,
+                              FP128 *out) {
+  size_t n = r->n, h = n / 2;
+  COMPLEX_FP128 *z =
+      (COMPLEX_FP128 *)malloc(2 * n * sizeof(COMPLEX_FP128));
+  if (!z)
+    return -1;
+  if (n % 2) {
+    z[0] = CMPLXFP128(crealFP128(in[0]), FP128_from_double(0.0));
+    for (size_t k = 1; k <= h; k++) {
+      z[k] = in[k];
+      z[n - k] = CMPLXFP128(crealFP128(in[k]), negFP128(cimagFP128(in[k])));
+    }
+    pfp128_fft_run(r->half, z, z, z + n, FP128_FFT_BACKWARD);
+    for (size_t i = 0; i < n; i++)
+      out[i] = crealFP128(z[i]);
+    free(z);
+    return 0;
+  }
+  // Undoing the above, 2 Z[k] = E + i conj(w^k) O, where
+  // E = X[k] + conj(X[h - k]) and O = X[k] - conj(X[h - k]).
+  for (size_t k = 0; k < h; k++) {
+    COMPLEX_FP128 a = in[k], b = in[h - k];
+    if (k == 0) {
+      a = CMPLXFP128(crealFP128(a), FP128_from_double(0.0));
+      b = CMPLXFP128(crealFP128(b), FP128_from_double(0.0));
+    }
+    b = CMPLXFP128(crealFP128(b), negFP128(cimagFP128(b)));
+    COMPLEX_FP128 w = r->twiddles[k];
+    w = CMPLXFP128(crealFP128(w), negFP128(cimagFP128(w)));
+    z[k] = pfp128_fft_add(
+        pfp128_fft_add(a, b),
+        pfp128_fft_rotate(cmulFP128(w, pfp128_fft_sub(a, b)), 1));
+  }
+  pfp128_fft_run(r->half, z, z, z + h, FP128_FFT_BACKWARD);
+  for (size_t i = 0; i < h; i++) {
+    out[2 * i] = crealFP128(z[i]);
+    out[2 * i + 1] = cimagFP128(z[i]);
+  }
+  free(z);
+  return 0;
+}
+
+// The batched versions, on howmany consecutive arrays.
+static inline int FP128_fft_n(FP128_FFT_PLAN const *p, COMPLEX_FP128 const *in,
+                              COMPLEX_FP128 *out, size_t howmany, int sign) {
+  size_t n = p->n, total = n * howmany;
+  int failed = 0;
+  PFP128_FFT_BATCH_LOOP
+  for (size_t i = 0; i < howmany; i++)
+    if (FP128_fft(p, in + i * n, out + i * n, sign) != 0)
+      failed = 1;
+  return failed ? -1 : 0;
+}
+
+static inline int FP128_rfft_n(FP128_RFFT_PLAN const *r, FP128 const *in,
+                               COMPLEX_FP128 *out, size_t howmany) {
+  size_t n = r->n, total = n * howmany;
+  int failed = 0;
+  PFP128_FFT_BATCH_LOOP
+  for (size_t i = 0; i < howmany; i++)
+    if (FP128_rfft(r, in + i * n, out + i * (n / 2 + 1)) != 0)
+      failed = 1;
+  return failed ? -1 : 0;
+}
+
+static inline int FP128_irfft_n(FP128_RFFT_PLAN const *r,
+                                COMPLEX_FP128 const *in, FP128 *out,
+                                size_t howmany) {
+  size_t n = r->n, total = n * howmany;
+  int failed = 0;
+  PFP128_FFT_BATCH_LOOP
+  for (size_t i = 0; i < howmany; i++)
+    if (FP128_irfft(r, in + i * (n / 2 + 1), out + i * n) != 0)
+      failed = 1;
+  return failed ? -1 : 0;
+}
+
+#undef PFP128_FFT_PRAGMA
+#undef PFP128_FFT_LOOP
+#undef PFP128_FFT_BATCH_LOOP
+
+#endif // Header monotonicity
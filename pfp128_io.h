@@ -0,0 +1,354 @@
+//===-- pfp128_io.h - Binary files of FP128 values -----------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * A simple binary file format for arrays of FP128 values, so that they can
+ * be saved and restored (e.g. for checkpoints) without converting them to
+ * and from text, which is slow and more than doubles the size.
+ *
+ * A file is a 64 byte header (FP128_FILE_HEADER) followed by the values,
+ * 16 bytes each, exactly as they are in the memory of the machine which
+ * wrote them. The header records that machine's byte order and whether the
+ * values are IEEE binary128 or double-double, and, optionally, a checksum
+ * of the values.
+ *
+ * When a file was written on a machine with the same byte order and FP128
+ * format as the one reading it, FP128_file_map gives you the values in the
+ * file in place, without copying them; otherwise, and with
+ * FP128_file_read, they are converted. Since x86_64's __float128 and
+ * AArch64's (and RISC-V's) long double are all binary128, files written
+ * with the native backend on any of those machines can be mapped on the
+ * others.
+ *
+ * The functions return zero (or a non-NULL pointer) on success, and -1 (or
+ * NULL) with errno set on failure; errno is EINVAL if the file isn't in this
+ * format, and EIO if the checksum doesn't match.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_IO_H_INCLUDED_))
+#define _PFP128_IO_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_soft.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_io.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+#if (defined(__unix__) || defined(__APPLE__))
+#define PFP128_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define PFP128_HAVE_MMAP 0
+#endif
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define PFP128_BIG_ENDIAN 1
+#else
+#define PFP128_BIG_ENDIAN 0
+#endif
+
+typedef enum {
+  FP128_FILE_BINARY128 = 1,    // IEEE binary128.
+  FP128_FILE_DOUBLE_DOUBLE = 2 // A pair of doubles, high part first.
+} FP128_FILE_ENCODING;
+
+#if (PFP128_IS_DD)
+#define FP128_FILE_HOST_ENCODING FP128_FILE_DOUBLE_DOUBLE
+#else
+#define FP128_FILE_HOST_ENCODING FP128_FILE_BINARY128
+#endif
+
+// Flags. When writing, FP128_FILE_CHECKSUM stores a checksum of the values;
+// when mapping a file it checks it (which means reading the whole file, so
+// isn't the default). FP128_file_read always checks it.
+#define FP128_FILE_CHECKSUM 1u
+
+#define FP128_FILE_MAGIC "PFP128\r\n"
+#define FP128_FILE_BYTE_ORDER 0x01020304u
+#define FP128_FILE_VERSION 1
+
+// The fields are in the byte order of the machine which wrote the file.
+typedef struct {
+  char magic[8];       // FP128_FILE_MAGIC.
+  uint32_t byteOrder;  // FP128_FILE_BYTE_ORDER.
+  uint16_t version;    // FP128_FILE_VERSION.
+  uint16_t encoding;   // An FP128_FILE_ENCODING.
+  uint64_t count;      // The number of values.
+  uint32_t flags;      // FP128_FILE_CHECKSUM if checksum is set.
+  uint32_t dataOffset; // Where the values start (sizeof(FP128_FILE_HEADER)).
+  uint64_t checksum;
+  uint8_t reserved[24];
+} FP128_FILE_HEADER;
+
+_Static_assert(sizeof(FP128_FILE_HEADER) == 64,
+               "FP128_FILE_HEADER should be 64 bytes");
+_Static_assert(sizeof(FP128) == 16, "pfp128_io.h needs a 16 byte FP128");
+
+static inline uint64_t pfp128_io_bswap64(uint64_t x) {
+  return __builtin_bswap64(x);
+}
+
+// A Fletcher style checksum of the data (whose length must be a multiple of
+// eight) as little endian 64 bit words. It's there to spot corruption, not
+// tampering, so needs to be cheap more than it needs to be strong.
+static inline uint64_t FP128_file_checksum(void const *data, size_t bytes) {
+  unsigned char const *p = (unsigned char const *)data;
+  uint64_t sum = 0, sumOfSums = 0;
+  for (size_t i = 0; i < bytes; i += 8) {
+    uint64_t w;
+    memcpy(&w, p + i, sizeof(w));
+#if (PFP128_BIG_ENDIAN)
+    w = pfp128_io_bswap64(w);
+#endif
+    sum += w;
+    sumOfSums += sum;
+  }
+  return sum ^ (sumOfSums * 0x9e3779b97f4a7c15ull);
+}
+
+// Convert n values in the given encoding (byte swapped if swap is set) at
+// in to FP128s at out, which may be the same place. You can use this to read
+// other binary data, e.g. a dump of an array of AArch64 long double, which
+// is FP128_FILE_BINARY128.
+static inline void FP128_file_convert(FP128 *out, void const *in, size_t n,
+                                      FP128_FILE_ENCODING encoding,
+                                      int swap) {
+  unsigned char const *p = (unsigned char const *)in;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t w[2];
+    memcpy(w, p + 16 * i, sizeof(w));
+    if (swap && encoding == FP128_FILE_BINARY128) {
+      uint64_t t = w[0];
+      w[0] = pfp128_io_bswap64(w[1]);
+      w[1] = pfp128_io_bswap64(t);
+    } else if (swap) {
+      w[0] = pfp128_io_bswap64(w[0]);
+      w[1] = pfp128_io_bswap64(w[1]);
+    }
+    FP128SQ b;
+    if (encoding == FP128_FILE_BINARY128) {
+      b = sq_from_halves(w[PFP128_BIG_ENDIAN ? 0 : 1],
+                         w[PFP128_BIG_ENDIAN ? 1 : 0]);
+    } else {
+#if (PFP128_IS_DD)
+      memcpy(&out[i], w, sizeof(w));
+      continue;
+#else
+      double hi, lo;
+      memcpy(&hi, &w[0], sizeof(hi));
+      memcpy(&lo, &w[1], sizeof(lo));
+      b = sq_from_double(hi);
+      if (lo != 0)
+        b = addsq(b, sq_from_double(lo));
+#endif
+    }
+    out[i] = FP128_from_sq(b);
+  }
+}
+
+// Check a header (and that the file, of fileSize bytes, is big enough for
+// it), converting it to our byte order, and setting *swap if the values need
+// to be byte swapped.
+static inline int pfp128_io_check_header(FP128_FILE_HEADER *h,
+                                         uint64_t fileSize, int *swap) {
+  *swap = h->byteOrder != FP128_FILE_BYTE_ORDER;
+  if (*swap) {
+    h->byteOrder = __builtin_bswap32(h->byteOrder);
+    h->version = __builtin_bswap16(h->version);
+    h->encoding = __builtin_bswap16(h->encoding);
+    h->count = pfp128_io_bswap64(h->count);
+    h->flags = __builtin_bswap32(h->flags);
+    h->dataOffset = __builtin_bswap32(h->dataOffset);
+    h->checksum = pfp128_io_bswap64(h->checksum);
+  }
+  if (memcmp(h->magic, FP128_FILE_MAGIC, sizeof(h->magic)) != 0 ||
+      h->byteOrder != FP128_FILE_BYTE_ORDER ||
+      h->version != FP128_FILE_VERSION ||
+      (h->encoding != FP128_FILE_BINARY128 &&
+       h->encoding != FP128_FILE_DOUBLE_DOUBLE) ||
+      h->dataOffset < sizeof(FP128_FILE_HEADER) || h->dataOffset % 16 != 0 ||
+      h->dataOffset > fileSize ||
+      h->count > (fileSize - h->dataOffset) / 16 ||
+      h->count > SIZE_MAX / 16) {
+    errno = EINVAL;
+    return -1;
+  }
+  return 0;
+}
+
+static inline int pfp128_io_verify(FP128_FILE_HEADER const *h,
+                                   void const *data) {
+  if ((h->flags & FP128_FILE_CHECKSUM) &&
+      FP128_file_checksum(data, h->count * 16) != h->checksum) {
+    errno = EIO;
+    return -1;
+  }
+  return 0;
+}
+
+// Write n values to the file at path, replacing anything already there.
+static inline int FP128_file_write(char const *path, FP128 const *values,
+                                   size_t n, unsigned flags) {
+  FP128_FILE_HEADER h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, FP128_FILE_MAGIC, sizeof(h.magic));
+  h.byteOrder = FP128_FILE_BYTE_ORDER;
+  h.version = FP128_FILE_VERSION;
+  h.encoding = FP128_FILE_HOST_ENCODING;
+  h.count = n;
+  h.flags = flags & FP128_FILE_CHECKSUM;
+  h.dataOffset = sizeof(h);
+  if (h.flags)
+    h.checksum = FP128_file_checksum(values, n * sizeof(FP128));
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return -1;
+  int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+           fwrite(values, sizeof(FP128), n, f) == n;
+  // (fclose must be called, and also reports write errors.)
+  ok = (fclose(f) == 0) && ok;
+  return ok ? 0 : -1;
+}
+
+// Read the values from the file at path into memory which the caller must
+// free, setting *n to how many there are.
+static inline FP128 *FP128_file_read(char const *path, size_t *n) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return NULL;
+  FP128_FILE_HEADER h;
+  FP128 *values = NULL;
+  int swap;
+  long fileSize = -1;
+  if (fseek(f, 0, SEEK_END) == 0)
+    fileSize = ftell(f);
+  if (fileSize < 0 || fseek(f, 0, SEEK_SET) != 0)
+    goto fail;
+  if (fread(&h, sizeof(h), 1, f) != 1) {
+    errno = EINVAL;
+    goto fail;
+  }
+  if (pfp128_io_check_header(&h, (uint64_t)fileSize, &swap) != 0 ||
+      fseek(f, (long)h.dataOffset, SEEK_SET) != 0)
+    goto fail;
+  values = (FP128 *)malloc(h.count ? h.count * sizeof(FP128) : 1);
+  if (!values)
+    goto fail;
+  if (fread(values, sizeof(FP128), h.count, f) != h.count) {
+    errno = EIO;
+    goto fail;
+  }
+  if (pfp128_io_verify(&h, values) != 0)
+    goto fail;
+  if (swap || h.encoding != FP128_FILE_HOST_ENCODING)
+    FP128_file_convert(values, values, h.count,
+                       (FP128_FILE_ENCODING)h.encoding, swap);
+  fclose(f);
+  *n = h.count;
+  return values;
+fail:
+  free(values);
+  fclose(f);
+  return NULL;
+}
+
+// The values in a file. If the file's format matches ours, values points
+// into a private (copy on write) mapping of it, so that nothing is read
+// until it's used; otherwise it points to a converted copy.
+typedef struct {
+  FP128 *values;
+  size_t n;
+  int copied; // Whether the values had to be converted.
+  void *base; // The mapping or copy, for FP128_file_unmap.
+  size_t length;
+} FP128_FILE_MAP;
+
+static inline void FP128_file_unmap(FP128_FILE_MAP *m) {
+#if (PFP128_HAVE_MMAP)
+  if (!m->copied && m->base)
+    munmap(m->base, m->length);
+  else
+#endif
+    free(m->base);
+  memset(m, 0, sizeof(*m));
+}
+
+static inline int FP128_file_map(char const *path, FP128_FILE_MAP *m,
+                                 unsigned flags) {
+  memset(m, 0, sizeof(*m));
+#if (PFP128_HAVE_MMAP)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  if ((uint64_t)st.st_size < sizeof(FP128_FILE_HEADER)) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  m->length = (size_t)st.st_size;
+  m->base = mmap(NULL, m->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m->base == MAP_FAILED) {
+    m->base = NULL;
+    return -1;
+  }
+  FP128_FILE_HEADER h;
+  int swap;
+  memcpy(&h, m->base, sizeof(h));
+  if (pfp128_io_check_header(&h, m->length, &swap) != 0 ||
+      ((flags & FP128_FILE_CHECKSUM) &&
+       pfp128_io_verify(&h, (char *)m->base + h.dataOffset) != 0)) {
+    int error = errno;
+    FP128_file_unmap(m);
+    errno = error;
+    return -1;
+  }
+  char *data = (char *)m->base + h.dataOffset;
+  m->n = h.count;
+  if (!swap && h.encoding == FP128_FILE_HOST_ENCODING) {
+    m->values = (FP128 *)data;
+    return 0;
+  }
+  FP128 *values = (FP128 *)malloc(h.count ? h.count * sizeof(FP128) : 1);
+  if (values)
+    FP128_file_convert(values, data, h.count,
+                       (FP128_FILE_ENCODING)h.encoding, swap);
+  munmap(m->base, m->length);
+  if (!values) {
+    memset(m, 0, sizeof(*m));
+    return -1;
+  }
+  m->values = values;
+  m->base = values;
+  m->copied = 1;
+  return 0;
+#else
+  (void)flags;
+  m->values = FP128_file_read(path, &m->n);
+  m->base = m->values;
+  m->copied = 1;
+  return m->values ? 0 : -1;
+#endif
+}
+
+#endif // Header monotonicity
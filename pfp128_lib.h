@@ -0,0 +1,205 @@
+//===-- pfp128_lib.h - Use the compiled libpfp128 -------------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Everything in pfp128.h and its companions is static inline, so it is
+ * compiled for whatever machine the program is built for. libpfp128 (made
+ * with "make lib") holds out of line copies of the functions which do the
+ * most work:
+ *
+ *   addFP128_n, subFP128_n, mulFP128_n, divFP128_n   (pfp128.h)
+ *   sumFP128_d, dotFP128_d, normFP128_d,
+ *   sumFP128_n, dotFP128_n, normFP128_n              (pfp128_reduce.h)
+ *   FP128_dot, FP128_axpy, FP128_gemv, FP128_gemm    (pfp128_blas.h)
+ *   polyEvalFP128_n, chebEvalFP128_n                 (pfp128_poly.h)
+ *   FP128_to_chars, FP128_to_chars_precision, FP128_to_chars_n,
+ *   FP128_from_chars, FP128_from_chars_n             (pfp128_charconv.h)
+ *
+ * On x86_64 Linux each is compiled three times over, for the baseline
+ * x86_64, x86-64-v3 (AVX2, FMA, BMI2) and x86-64-v4 (AVX-512), along with
+ * everything it uses, and each public name is an ifunc, so the dynamic
+ * loader picks the best version that the CPU can run when the program
+ * starts (see libpfp128.c). So one binary runs at full speed on every
+ * generation of machine. Elsewhere there is just the one version. The
+ * gain is in the functions which work on the bits with pfp128_soft.h (the
+ * reductions, BLAS, polynomials and conversions); the basic arithmetic is
+ * still the runtime library's, which pfp128_soft.h's, even compiled for
+ * the higher levels, is no faster than.
+ *
+ * To use it, include this header (which includes those above) and link
+ * with -lpfp128, or -lpfp128dd for the double-double backend; calls to the
+ * functions above then go to the library, and the rest stay inline. Code
+ * which doesn't include this is unchanged, so the header only mode still
+ * works as it always has. The library's functions have names which depend
+ * on the backend, so a program built for the other backend won't link.
+ * FP128_lib_isa() returns the name of the version in use ("x86-64-v4",
+ * "x86-64-v3" or "default").
+ *
+ * Code linked with the static library on x86_64 Linux can also call each
+ * level's version of a function f directly, whatever the CPU would choose,
+ * as the tests do: with PFP128_LIB_LEVELS defined to 1 this declares
+ * PFP128_LIB_LEVEL_NAME(f, default), (f, v3) and (f, v4), and
+ * FP128_lib_level(), the highest level the CPU can run (0, 3 or 4). They're
+ * hidden, so the shared library doesn't export them.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_LIB_H_INCLUDED_))
+#define _PFP128_LIB_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_blas.h"
+#include "pfp128_charconv.h"
+#include "pfp128_poly.h"
+#include "pfp128_reduce.h"
+
+#include <stddef.h>
+
+#if (PFP128_IS_DD)
+#define PFP128_LIB_NAME(name) pfp128dd_lib_##name
+#else
+#define PFP128_LIB_NAME(name) pfp128_lib_##name
+#endif
+
+// The library's functions: op(result type, name, parameters, arguments).
+// clang-format off
+#define FOREACH_LIB_FUNCTION(op)                                        \
+  op(FP128, sumFP128_d, (double const *x, size_t n), (x, n))            \
+  op(FP128, dotFP128_d, (double const *x, double const *y, size_t n),   \
+     (x, y, n))                                                         \
+  op(FP128, normFP128_d, (double const *x, size_t n), (x, n))           \
+  op(FP128, sumFP128_n, (FP128 const *x, size_t n), (x, n))             \
+  op(FP128, dotFP128_n, (FP128 const *x, FP128 const *y, size_t n),     \
+     (x, y, n))                                                         \
+  op(FP128, normFP128_n, (FP128 const *x, size_t n), (x, n))            \
+  op(FP128, FP128_dot, (size_t n, FP128 const *x, ptrdiff_t incx,       \
+                        FP128 const *y, ptrdiff_t incy),                \
+     (n, x, incx, y, incy))                                             \
+  op(int, FP128_gemm, (FP128_BLAS_TRANSPOSE transA,                     \
+                       FP128_BLAS_TRANSPOSE transB, size_t m, size_t n, \
+                       size_t k, FP128 alpha, FP128 const *A,           \
+                       size_t lda, FP128 const *B, size_t ldb,          \
+                       FP128 beta, FP128 *C, size_t ldc),               \
+     (transA, transB, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc))    \
+  op(char *, FP128_to_chars, (char *first, char *last, FP128 v,         \
+                              FP128_CHARS_FORMAT fmt),                  \
+     (first, last, v, fmt))                                             \
+  op(char *, FP128_to_chars_precision,                                  \
+     (char *first, char *last, FP128 v, FP128_CHARS_FORMAT fmt,         \
+      int precision),                                                   \
+     (first, last, v, fmt, precision))                                  \
+  op(char *, FP128_to_chars_n,                                          \
+     (char *first, char *last, FP128 const *v, size_t n,                \
+      FP128_CHARS_FORMAT fmt, char separator),                          \
+     (first, last, v, n, fmt, separator))                               \
+  op(char const *, FP128_from_chars,                                    \
+     (char const *first, char const *last, FP128 *out),                 \
+     (first, last, out))                                                \
+  op(size_t, FP128_from_chars_n,                                        \
+     (char const *first, char const *last, FP128 *out, size_t n,        \
+      char const **end),                                                \
+     (first, last, out, n, end))
+
+// And those which return nothing.
+#define FOREACH_LIB_VOID_FUNCTION(op)                                   \
+  op(void, addFP128_n, (FP128 const *a1, FP128 const *a2, FP128 *out,   \
+                        size_t n), (a1, a2, out, n))                    \
+  op(void, subFP128_n, (FP128 const *a1, FP128 const *a2, FP128 *out,   \
+                        size_t n), (a1, a2, out, n))                    \
+  op(void, mulFP128_n, (FP128 const *a1, FP128 const *a2, FP128 *out,   \
+                        size_t n), (a1, a2, out, n))                    \
+  op(void, divFP128_n, (FP128 const *a1, FP128 const *a2, FP128 *out,   \
+                        size_t n), (a1, a2, out, n))                    \
+  op(void, FP128_axpy, (size_t n, FP128 alpha, FP128 const *x,          \
+                        ptrdiff_t incx, FP128 *y, ptrdiff_t incy),      \
+     (n, alpha, x, incx, y, incy))                                      \
+  op(void, FP128_gemv, (FP128_BLAS_TRANSPOSE trans, size_t m, size_t n, \
+                        FP128 alpha, FP128 const *A, size_t lda,        \
+                        FP128 const *x, ptrdiff_t incx, FP128 beta,     \
+                        FP128 *y, ptrdiff_t incy),                      \
+     (trans, m, n, alpha, A, lda, x, incx, beta, y, incy))              \
+  op(void, polyEvalFP128_n, (FP128 const *c, size_t degree,             \
+                             FP128 const *x, FP128 *y, size_t n),       \
+     (c, degree, x, y, n))                                              \
+  op(void, chebEvalFP128_n, (FP128 const *c, size_t degree,             \
+                             FP128 const *x, FP128 *y, size_t n),       \
+     (c, degree, x, y, n))
+
+#define PFP128_LIB_DECLARE(restype, name, params, args)                 \
+  restype PFP128_LIB_NAME(name) params;
+// clang-format on
+
+#if (defined(__cplusplus))
+extern "C" {
+#endif
+FOREACH_LIB_FUNCTION(PFP128_LIB_DECLARE)
+FOREACH_LIB_VOID_FUNCTION(PFP128_LIB_DECLARE)
+char const *PFP128_LIB_NAME(FP128_lib_isa)(void);
+#if (defined(__cplusplus))
+}
+#endif
+#undef PFP128_LIB_DECLARE
+
+// The per level versions, e.g. pfp128_lib_dotFP128_n_v3.
+#define PFP128_LIB_LEVEL_NAME__(name, level) name##_##level
+#define PFP128_LIB_LEVEL_NAME_(name, level) PFP128_LIB_LEVEL_NAME__(name, level)
+#define PFP128_LIB_LEVEL_NAME(name, level)                                     \
+  PFP128_LIB_LEVEL_NAME_(PFP128_LIB_NAME(name), level)
+
+#if (PFP128_LIB_LEVELS)
+#define PFP128_LIB_HIDDEN __attribute__((visibility("hidden")))
+// clang-format off
+#define PFP128_LIB_DECLARE_LEVELS(restype, name, params, args)          \
+  PFP128_LIB_HIDDEN restype PFP128_LIB_LEVEL_NAME(name, default) params; \
+  PFP128_LIB_HIDDEN restype PFP128_LIB_LEVEL_NAME(name, v3) params;     \
+  PFP128_LIB_HIDDEN restype PFP128_LIB_LEVEL_NAME(name, v4) params;
+// clang-format on
+
+#if (defined(__cplusplus))
+extern "C" {
+#endif
+FOREACH_LIB_FUNCTION(PFP128_LIB_DECLARE_LEVELS)
+FOREACH_LIB_VOID_FUNCTION(PFP128_LIB_DECLARE_LEVELS)
+PFP128_LIB_HIDDEN int PFP128_LIB_NAME(FP128_lib_level)(void);
+#if (defined(__cplusplus))
+}
+#endif
+#undef PFP128_LIB_DECLARE_LEVELS
+#endif
+
+// Send the calls to the library (other than when we're building it). You
+// can still reach the inline version of f with (f)(...).
+#if (!PFP128_LIB_BUILD)
+#define addFP128_n(...) PFP128_LIB_NAME(addFP128_n)(__VA_ARGS__)
+#define subFP128_n(...) PFP128_LIB_NAME(subFP128_n)(__VA_ARGS__)
+#define mulFP128_n(...) PFP128_LIB_NAME(mulFP128_n)(__VA_ARGS__)
+#define divFP128_n(...) PFP128_LIB_NAME(divFP128_n)(__VA_ARGS__)
+#define sumFP128_d(...) PFP128_LIB_NAME(sumFP128_d)(__VA_ARGS__)
+#define dotFP128_d(...) PFP128_LIB_NAME(dotFP128_d)(__VA_ARGS__)
+#define normFP128_d(...) PFP128_LIB_NAME(normFP128_d)(__VA_ARGS__)
+#define sumFP128_n(...) PFP128_LIB_NAME(sumFP128_n)(__VA_ARGS__)
+#define dotFP128_n(...) PFP128_LIB_NAME(dotFP128_n)(__VA_ARGS__)
+#define normFP128_n(...) PFP128_LIB_NAME(normFP128_n)(__VA_ARGS__)
+#define FP128_dot(...) PFP128_LIB_NAME(FP128_dot)(__VA_ARGS__)
+#define FP128_axpy(...) PFP128_LIB_NAME(FP128_axpy)(__VA_ARGS__)
+#define FP128_gemv(...) PFP128_LIB_NAME(FP128_gemv)(__VA_ARGS__)
+#define FP128_gemm(...) PFP128_LIB_NAME(FP128_gemm)(__VA_ARGS__)
+#define polyEvalFP128_n(...) PFP128_LIB_NAME(polyEvalFP128_n)(__VA_ARGS__)
+#define chebEvalFP128_n(...) PFP128_LIB_NAME(chebEvalFP128_n)(__VA_ARGS__)
+#define FP128_to_chars(...) PFP128_LIB_NAME(FP128_to_chars)(__VA_ARGS__)
+#define FP128_to_chars_precision(...)                                          \
+  PFP128_LIB_NAME(FP128_to_chars_precision)(__VA_ARGS__)
+#define FP128_to_chars_n(...) PFP128_LIB_NAME(FP128_to_chars_n)(__VA_ARGS__)
+#define FP128_from_chars(...) PFP128_LIB_NAME(FP128_from_chars)(__VA_ARGS__)
+#define FP128_from_chars_n(...)                                                \
+  PFP128_LIB_NAME(FP128_from_chars_n)(__VA_ARGS__)
+#define FP128_lib_isa() PFP128_LIB_NAME(FP128_lib_isa)()
+#if (PFP128_LIB_LEVELS)
+#define FP128_lib_level() PFP128_LIB_NAME(FP128_lib_level)()
+#endif
+#endif
+
+#endif // Header monotonicity
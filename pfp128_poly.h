@@ -0,0 +1,251 @@
+//===-- pfp128_poly.h - Polynomials and series over FP128 arrays -*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Evaluate fixed polynomials, rational functions and Chebyshev series, at
+ * one x or over arrays:
+ *
+ *   polyEvalFP128(c, degree, x)   c[0] + c[1] x + ... + c[degree] x^degree
+ *   ratEvalFP128(p, pdegree, q, qdegree, x)
+ *                                 P(x) / Q(x), with P and Q given likewise
+ *   chebEvalFP128(c, degree, x)   c[0] + c[1] T1(x) + ... + c[degree] Tdegree(x)
+ *
+ * and polyEvalFP128_n(c, degree, x, y, n), ratEvalFP128_n(p, pdegree, q,
+ * qdegree, x, y, n) and chebEvalFP128_n(c, degree, x, y, n), which set
+ * y[i] to the value at x[i] (x and y may be the same array). Note that the
+ * Chebyshev series has the whole of c[0], not c[0] / 2, and that x should
+ * already have been mapped to [-1, 1].
+ *
+ * Horner's rule is a chain of multiply-adds, each waiting for the last,
+ * which with soft-float binary128 (or double-double) means the processor
+ * spends most of its time waiting. So polynomials are split into blocks of
+ * eight coefficients, each evaluated with Estrin's scheme,
+ *
+ *   (c0 + c1 x) + (c2 + c3 x) x^2 + ((c4 + c5 x) + (c6 + c7 x) x^2) x^4,
+ *
+ * whose first four multiply-adds are independent, and the blocks are
+ * combined by Horner's rule in x^8, which leaves the blocks themselves
+ * independent. That costs three squarings, which below degree 8 cost more
+ * than they save, so there we use Horner's rule. The array versions also
+ * work on PFP128_POLY_LANES values of x at once, whose chains are
+ * independent, and that's all that can be done for Clenshaw's recurrence
+ * for the Chebyshev series, which is inherently serial in the coefficients.
+ * (Soft-float binary128 gains less from any of this than double-double
+ * does, since its arithmetic keeps the processor busier.)
+ *
+ * Each multiply-add is fmasq from pfp128_soft.h when FP128 is binary128,
+ * so is rounded once (and is inline, unlike fmaFP128), or a double-double
+ * multiply and add. Estrin's scheme is about as accurate as Horner's rule
+ * where the terms decrease, as they do in approximations; for x much larger
+ * than one its powers can overflow sooner.
+ *
+ * The array versions run in parallel with OpenMP once n reaches
+ * PFP128_OMP_THRESHOLD.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_POLY_H_INCLUDED_))
+#define _PFP128_POLY_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_soft.h"
+
+#include <stddef.h>
+
+// The number of values of x the array versions evaluate together.
+#if (!defined(PFP128_POLY_LANES))
+#define PFP128_POLY_LANES 2
+#endif
+
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_POLY_PRAGMA(x) _Pragma(#x)
+#define PFP128_POLY_LOOP                                                       \
+  PFP128_POLY_PRAGMA(omp parallel for schedule(static)                         \
+                     if (n >= PFP128_OMP_THRESHOLD))
+#else
+#define PFP128_POLY_LOOP
+#endif
+
+// The arithmetic: pfp128_soft.h's with binary128, otherwise double-double's.
+static inline FP128 pfp128_poly_madd(FP128 c, FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return addFP128(c, mulFP128(a, b));
+#else
+  return FP128_from_sq(fmasq(FP128_to_sq(a), FP128_to_sq(b), FP128_to_sq(c)));
+#endif
+}
+
+static inline FP128 pfp128_poly_mul(FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return mulFP128(a, b);
+#else
+  return FP128_from_sq(mulsq(FP128_to_sq(a), FP128_to_sq(b)));
+#endif
+}
+
+static inline FP128 pfp128_poly_sub(FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return subFP128(a, b);
+#else
+  return FP128_from_sq(subsq(FP128_to_sq(a), FP128_to_sq(b)));
+#endif
+}
+
+static inline FP128 pfp128_poly_div(FP128 a, FP128 b) {
+#if (PFP128_IS_DD)
+  return divFP128(a, b);
+#else
+  return FP128_from_sq(divsq(FP128_to_sq(a), FP128_to_sq(b)));
+#endif
+}
+
+// One block of count (at most eight) coefficients, at lanes values of x,
+// with Estrin's scheme: pair off the terms, at each level multiplying the
+// second of each pair by the next power of x (x, x^2 and x^4 in turn).
+static inline void pfp128_poly_block(FP128 const *c, size_t count, int lanes,
+                                     FP128 const *const *powers, FP128 *out) {
+  for (int l = 0; l < lanes; l++) {
+    FP128 a[8];
+    size_t m = count;
+    for (size_t i = 0; i < m; i++)
+      a[i] = c[i];
+    for (int level = 0; m > 1; level++) {
+      FP128 p = powers[level][l];
+      for (size_t i = 0; i < m / 2; i++)
+        a[i] = pfp128_poly_madd(a[2 * i], a[2 * i + 1], p);
+      if (m & 1)
+        a[m / 2] = a[m - 1];
+      m = (m + 1) / 2;
+    }
+    out[l] = a[0];
+  }
+}
+
+// The polynomial at lanes (at most PFP128_POLY_LANES) values of x.
+static inline void pfp128_poly_eval(FP128 const *c, size_t degree, int lanes,
+                                    FP128 const *x, FP128 *y) {
+  FP128 x2[PFP128_POLY_LANES], x4[PFP128_POLY_LANES], x8[PFP128_POLY_LANES];
+  FP128 acc[PFP128_POLY_LANES], t[PFP128_POLY_LANES];
+  FP128 const *powers[3] = {x, x2, x4};
+  if (degree < 8) {
+    // Too short for the squarings to pay; the lanes are independent anyway.
+    for (int l = 0; l < lanes; l++)
+      acc[l] = c[degree];
+    for (size_t k = degree; k-- > 0;)
+      for (int l = 0; l < lanes; l++)
+        acc[l] = pfp128_poly_madd(c[k], acc[l], x[l]);
+    for (int l = 0; l < lanes; l++)
+      y[l] = acc[l];
+    return;
+  }
+  for (int l = 0; l < lanes; l++) {
+    x2[l] = pfp128_poly_mul(x[l], x[l]);
+    x4[l] = pfp128_poly_mul(x2[l], x2[l]);
+    x8[l] = pfp128_poly_mul(x4[l], x4[l]);
+  }
+  // The top block may be short; the rest are full, and combined from the
+  // top down.
+  size_t top = degree / 8 * 8;
+  pfp128_poly_block(c + top, degree - top + 1, lanes, powers, acc);
+  while (top > 0) {
+    top -= 8;
+    pfp128_poly_block(c + top, 8, lanes, powers, t);
+    for (int l = 0; l < lanes; l++)
+      acc[l] = pfp128_poly_madd(t[l], acc[l], x8[l]);
+  }
+  for (int l = 0; l < lanes; l++)
+    y[l] = acc[l];
+}
+
+// The Chebyshev series at lanes values of x, by Clenshaw's recurrence
+//   b_k = c_k + 2 x b_(k+1) - b_(k+2),  the value being c_0 + x b_1 - b_2.
+static inline void pfp128_poly_cheb(FP128 const *c, size_t degree, int lanes,
+                                    FP128 const *x, FP128 *y) {
+  FP128 b1[PFP128_POLY_LANES], b2[PFP128_POLY_LANES], x2[PFP128_POLY_LANES];
+  FP128 zero = FP128_from_double(0.0);
+  for (int l = 0; l < lanes; l++) {
+    b1[l] = zero;
+    b2[l] = zero;
+    x2[l] = addFP128(x[l], x[l]);
+  }
+  for (size_t k = degree; k > 0; k--)
+    for (int l = 0; l < lanes; l++) {
+      FP128 b0 = pfp128_poly_madd(pfp128_poly_sub(c[k], b2[l]), x2[l], b1[l]);
+      b2[l] = b1[l];
+      b1[l] = b0;
+    }
+  for (int l = 0; l < lanes; l++)
+    y[l] = pfp128_poly_madd(pfp128_poly_sub(c[0], b2[l]), x[l], b1[l]);
+}
+
+static inline FP128 polyEvalFP128(FP128 const *c, size_t degree, FP128 x) {
+  FP128 y;
+  pfp128_poly_eval(c, degree, 1, &x, &y);
+  return y;
+}
+
+static inline FP128 ratEvalFP128(FP128 const *p, size_t pdegree,
+                                 FP128 const *q, size_t qdegree, FP128 x) {
+  FP128 num, den;
+  pfp128_poly_eval(p, pdegree, 1, &x, &num);
+  pfp128_poly_eval(q, qdegree, 1, &x, &den);
+  return pfp128_poly_div(num, den);
+}
+
+static inline FP128 chebEvalFP128(FP128 const *c, size_t degree, FP128 x) {
+  FP128 y;
+  pfp128_poly_cheb(c, degree, 1, &x, &y);
+  return y;
+}
+
+// The array versions, PFP128_POLY_LANES values at a time (padding the last
+// few with zeros).
+// clang-format off
+#define CreatePolyBatch(basename, evaluate)                                  \
+static inline void basename ## FP128_n(FP128 const *c, size_t degree,        \
+                                       FP128 const *x, FP128 *y, size_t n) { \
+  size_t blocks = (n + PFP128_POLY_LANES - 1) / PFP128_POLY_LANES;           \
+  PFP128_POLY_LOOP                                                           \
+  for (size_t i = 0; i < blocks; i++) {                                      \
+    size_t first = i * PFP128_POLY_LANES;                                    \
+    FP128 s[PFP128_POLY_LANES], t[PFP128_POLY_LANES];                        \
+    for (int l = 0; l < PFP128_POLY_LANES; l++)                              \
+      s[l] = first + l < n ? x[first + l] : FP128_from_double(0.0);          \
+    evaluate(c, degree, PFP128_POLY_LANES, s, t);                            \
+    for (int l = 0; l < PFP128_POLY_LANES && first + l < n; l++)             \
+      y[first + l] = t[l];                                                   \
+  }                                                                          \
+}
+
+CreatePolyBatch(polyEval, pfp128_poly_eval)
+CreatePolyBatch(chebEval, pfp128_poly_cheb)
+#undef CreatePolyBatch
+// clang-format on
+
+static inline void ratEvalFP128_n(FP128 const *p, size_t pdegree,
+                                  FP128 const *q, size_t qdegree,
+                                  FP128 const *x, FP128 *y, size_t n) {
+  size_t blocks = (n + PFP128_POLY_LANES - 1) / PFP128_POLY_LANES;
+  PFP128_POLY_LOOP
+  for (size_t i = 0; i < blocks; i++) {
+    size_t first = i * PFP128_POLY_LANES;
+    FP128 s[PFP128_POLY_LANES], num[PFP128_POLY_LANES], den[PFP128_POLY_LANES];
+    for (int l = 0; l < PFP128_POLY_LANES; l++)
+      s[l] = first + l < n ? x[first + l] : FP128_from_double(0.0);
+    pfp128_poly_eval(p, pdegree, PFP128_POLY_LANES, s, num);
+    pfp128_poly_eval(q, qdegree, PFP128_POLY_LANES, s, den);
+    for (int l = 0; l < PFP128_POLY_LANES && first + l < n; l++)
+      y[first + l] = pfp128_poly_div(num[l], den[l]);
+  }
+}
+
+#undef PFP128_POLY_PRAGMA
+#undef PFP128_POLY_LOOP
+
+#endif // Header monotonicity
@@ -0,0 +1,295 @@
+//===-- pfp128_profile.h - Per-function profiling of the shims -*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Compiling with PFP128_PROFILE defined to 1 (before including pfp128.h)
+ * makes every function shim generated from the FOREACH lists (sinFP128,
+ * powFP128, fmaFP128 and so on, and so their batched versions) count its
+ * calls, the time they take, and the class of the first argument (zero,
+ * normal, subnormal, or infinity or NaN; the worse of the two parts of a
+ * complex argument). The arithmetic and comparison functions aren't
+ * profiled, since reading the clock would cost more than they do. Without
+ * PFP128_PROFILE the shims are exactly as before, so cost nothing.
+ *
+ * The time is in ticks of the cheapest clock there is: the time stamp
+ * counter on x86 (reference cycles), the virtual counter on AArch64, or
+ * otherwise nanoseconds from clock_gettime. It includes the clock reads,
+ * which take tens of cycles (or more in a virtual machine).
+ *
+ * Each thread counts into its own block of counters, so there's no
+ * contention; the blocks are linked together (and never freed, so the
+ * counts of threads which have finished are kept), and summed when asked:
+ *
+ *   FP128_profile_snapshot(entries, max)  fill in up to max
+ *                FP128_PROFILE_ENTRY, one per function, returning how many
+ *                functions there are (FP128_PROFILE_FUNCTIONS)
+ *   FP128_profile_report(f)               print those which have been
+ *                called to f, most time first
+ *   FP128_profile_reset()                 zero the counts
+ *
+ * At exit the report is printed to stderr, or to the file named by the
+ * environment variable PFP128_PROFILE_FILE (set it to an empty string to
+ * disable the report). The counts are shared by all of the translation
+ * units of a program (through a weak symbol), so they should all be
+ * compiled with PFP128_PROFILE if any are.
+ *
+ * pfp128.h includes this header itself; it can't be used alone.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_PROFILE_H_INCLUDED_))
+#define _PFP128_PROFILE_H_INCLUDED_ 1
+
+#if (!defined(FOREACH_UNARY_FUNCTION))
+#error Define PFP128_PROFILE to 1 and include pfp128.h, which includes this.
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#elif (!defined(__aarch64__))
+#include <time.h>
+#endif
+
+// The argument classes.
+enum {
+  FP128_PROFILE_ZERO,
+  FP128_PROFILE_NORMAL,
+  FP128_PROFILE_SUBNORMAL,
+  FP128_PROFILE_SPECIAL, // Infinity or NaN.
+  FP128_PROFILE_CLASSES
+};
+
+// clang-format off
+#define PFP128_PROFILE_ID(basename, ...) PFP128_PROFILE_ID_ ## basename,
+enum {
+  FOREACH_UNARY_FUNCTION(PFP128_PROFILE_ID)
+  FOREACH_BINARY_FUNCTION(PFP128_PROFILE_ID)
+  FOREACH_TERNARY_FUNCTION(PFP128_PROFILE_ID)
+  FP128_PROFILE_FUNCTIONS
+};
+#undef PFP128_PROFILE_ID
+// clang-format on
+
+typedef struct {
+  char const *name; // Without the FP128 suffix, so "sin".
+  uint64_t calls;
+  uint64_t ticks;
+  uint64_t classes[FP128_PROFILE_CLASSES];
+} FP128_PROFILE_ENTRY;
+
+typedef struct pfp128_profile_block {
+  struct pfp128_profile_block *next;
+  uint64_t calls[FP128_PROFILE_FUNCTIONS];
+  uint64_t ticks[FP128_PROFILE_FUNCTIONS];
+  uint64_t classes[FP128_PROFILE_FUNCTIONS][FP128_PROFILE_CLASSES];
+} pfp128_profile_block;
+
+// Shared by the whole program: the list of blocks, and whether the report
+// has been scheduled for exit.
+__attribute__((weak)) pfp128_profile_block *pfp128_profile_blocks = 0;
+__attribute__((weak)) int pfp128_profile_at_exit_set = 0;
+
+// This thread's block (for this translation unit; others have their own).
+static __thread pfp128_profile_block *pfp128_profile_mine;
+// Where the counts go if a block can't be allocated, so they're lost.
+static pfp128_profile_block pfp128_profile_lost;
+
+static inline uint64_t pfp128_profile_ticks(void) {
+#if (defined(__x86_64__) || defined(__i386__))
+  return __rdtsc();
+#elif (defined(__aarch64__))
+  uint64_t t;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+  return t;
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+#endif
+}
+
+static inline int pfp128_profile_class_real(FP128 x) {
+#if (PFP128_IS_DD)
+  double a = fabs(x.hi);
+  if (!(a <= DBL_MAX))
+    return FP128_PROFILE_SPECIAL;
+  if (a == 0.0)
+    return FP128_PROFILE_ZERO;
+  return a < DBL_MIN ? FP128_PROFILE_SUBNORMAL : FP128_PROFILE_NORMAL;
+#else
+#if (FP128_IS_LONGDOUBLE)
+  FP128 const smallest = LDBL_MIN;
+#else
+  FP128 const smallest =
+      FP128_CONST(3.36210314311209350626267781732175260e-4932);
+#endif
+  FP128 a = x < 0 ? -x : x;
+  if (!(a < (FP128)HUGE_VAL))
+    return FP128_PROFILE_SPECIAL;
+  if (a == 0)
+    return FP128_PROFILE_ZERO;
+  return a < smallest ? FP128_PROFILE_SUBNORMAL : FP128_PROFILE_NORMAL;
+#endif
+}
+
+static inline int pfp128_profile_class_complex(COMPLEX_FP128 z) {
+  int re = pfp128_profile_class_real(FP128Name(creal)(z));
+  int im = pfp128_profile_class_real(FP128Name(cimag)(z));
+  return re > im ? re : im;
+}
+
+// nan's string isn't classified.
+static inline int pfp128_profile_class_other(void const *p) {
+  (void)p;
+  return -1;
+}
+
+#if (defined(__cplusplus))
+static inline int pfp128_profile_class(FP128 x) {
+  return pfp128_profile_class_real(x);
+}
+static inline int pfp128_profile_class(COMPLEX_FP128 z) {
+  return pfp128_profile_class_complex(z);
+}
+static inline int pfp128_profile_class(void const *p) {
+  return pfp128_profile_class_other(p);
+}
+#define PFP128_PROFILE_CLASS(x) pfp128_profile_class(x)
+#else
+#define PFP128_PROFILE_CLASS(x)                                                \
+  _Generic((x), FP128: pfp128_profile_class_real,                              \
+           COMPLEX_FP128: pfp128_profile_class_complex,                        \
+           default: pfp128_profile_class_other)(x)
+#endif
+
+static inline FP128_PROFILE_ENTRY *
+pfp128_profile_sum(FP128_PROFILE_ENTRY *entries) {
+  // clang-format off
+#define PFP128_PROFILE_NAME(basename, ...) #basename,
+  static char const *const names[] = {
+    FOREACH_UNARY_FUNCTION(PFP128_PROFILE_NAME)
+    FOREACH_BINARY_FUNCTION(PFP128_PROFILE_NAME)
+    FOREACH_TERNARY_FUNCTION(PFP128_PROFILE_NAME)
+  };
+#undef PFP128_PROFILE_NAME
+  // clang-format on
+  memset(entries, 0, FP128_PROFILE_FUNCTIONS * sizeof(*entries));
+  for (int f = 0; f < FP128_PROFILE_FUNCTIONS; f++)
+    entries[f].name = names[f];
+  for (pfp128_profile_block *b =
+           __atomic_load_n(&pfp128_profile_blocks, __ATOMIC_ACQUIRE);
+       b; b = b->next)
+    for (int f = 0; f < FP128_PROFILE_FUNCTIONS; f++) {
+      entries[f].calls += __atomic_load_n(&b->calls[f], __ATOMIC_RELAXED);
+      entries[f].ticks += __atomic_load_n(&b->ticks[f], __ATOMIC_RELAXED);
+      for (int c = 0; c < FP128_PROFILE_CLASSES; c++)
+        entries[f].classes[c] +=
+            __atomic_load_n(&b->classes[f][c], __ATOMIC_RELAXED);
+    }
+  return entries;
+}
+
+static inline size_t FP128_profile_snapshot(FP128_PROFILE_ENTRY *entries,
+                                            size_t max) {
+  FP128_PROFILE_ENTRY all[FP128_PROFILE_FUNCTIONS];
+  pfp128_profile_sum(all);
+  size_t n = max < (size_t)FP128_PROFILE_FUNCTIONS
+                 ? max
+                 : (size_t)FP128_PROFILE_FUNCTIONS;
+  memcpy(entries, all, n * sizeof(*entries));
+  return FP128_PROFILE_FUNCTIONS;
+}
+
+static inline void FP128_profile_report(FILE *f) {
+  FP128_PROFILE_ENTRY e[FP128_PROFILE_FUNCTIONS];
+  pfp128_profile_sum(e);
+  uint64_t total = 0;
+  for (int i = 0; i < FP128_PROFILE_FUNCTIONS; i++)
+    total += e[i].ticks;
+  // Sort by time (there are only a few dozen).
+  for (int i = 1; i < FP128_PROFILE_FUNCTIONS; i++)
+    for (int j = i; j > 0 && e[j].ticks > e[j - 1].ticks; j--) {
+      FP128_PROFILE_ENTRY t = e[j];
+      e[j] = e[j - 1];
+      e[j - 1] = t;
+    }
+  fprintf(f, "%-10s %12s %14s %10s %6s %10s %10s %10s %10s\n", "function",
+          "calls", "ticks", "ticks/call", "%", "zero", "normal", "subnormal",
+          "special");
+  for (int i = 0; i < FP128_PROFILE_FUNCTIONS && e[i].calls; i++)
+    fprintf(f, "%-10s %12llu %14llu %10.1f %6.2f %10llu %10llu %10llu %10llu\n",
+            e[i].name, (unsigned long long)e[i].calls,
+            (unsigned long long)e[i].ticks,
+            (double)e[i].ticks / (double)e[i].calls,
+            total ? 100.0 * (double)e[i].ticks / (double)total : 0.0,
+            (unsigned long long)e[i].classes[FP128_PROFILE_ZERO],
+            (unsigned long long)e[i].classes[FP128_PROFILE_NORMAL],
+            (unsigned long long)e[i].classes[FP128_PROFILE_SUBNORMAL],
+            (unsigned long long)e[i].classes[FP128_PROFILE_SPECIAL]);
+}
+
+static inline void FP128_profile_reset(void) {
+  for (pfp128_profile_block *b =
+           __atomic_load_n(&pfp128_profile_blocks, __ATOMIC_ACQUIRE);
+       b; b = b->next)
+    for (int f = 0; f < FP128_PROFILE_FUNCTIONS; f++) {
+      __atomic_store_n(&b->calls[f], 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&b->ticks[f], 0, __ATOMIC_RELAXED);
+      for (int c = 0; c < FP128_PROFILE_CLASSES; c++)
+        __atomic_store_n(&b->classes[f][c], 0, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void pfp128_profile_at_exit(void) {
+  char const *name = getenv("PFP128_PROFILE_FILE");
+  if (!name) {
+    FP128_profile_report(stderr);
+  } else if (*name) {
+    FILE *f = fopen(name, "w");
+    if (f) {
+      FP128_profile_report(f);
+      fclose(f);
+    }
+  }
+}
+
+// The first call in each thread allocates its block, and links it in.
+static inline pfp128_profile_block *pfp128_profile_register(void) {
+  pfp128_profile_block *b =
+      (pfp128_profile_block *)calloc(1, sizeof(pfp128_profile_block));
+  if (!b)
+    return pfp128_profile_mine = &pfp128_profile_lost;
+  b->next = __atomic_load_n(&pfp128_profile_blocks, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&pfp128_profile_blocks, &b->next, b, 0,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+  if (!__atomic_exchange_n(&pfp128_profile_at_exit_set, 1, __ATOMIC_ACQ_REL))
+    atexit(pfp128_profile_at_exit);
+  return pfp128_profile_mine = b;
+}
+
+// Only this thread writes its block, but others may read it, hence the
+// atomics (which are just loads and stores).
+static inline void pfp128_profile_count(int function, int argClass,
+                                        uint64_t start) {
+  uint64_t ticks = pfp128_profile_ticks() - start;
+  pfp128_profile_block *b = pfp128_profile_mine;
+  if (__builtin_expect(!b, 0))
+    b = pfp128_profile_register();
+  __atomic_store_n(&b->calls[function], b->calls[function] + 1,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&b->ticks[function], b->ticks[function] + ticks,
+                   __ATOMIC_RELAXED);
+  if (argClass >= 0)
+    __atomic_store_n(&b->classes[function][argClass],
+                     b->classes[function][argClass] + 1, __ATOMIC_RELAXED);
+}
+
+#endif // Header monotonicity
@@ -0,0 +1,207 @@
+//===-- pfp128_random.h - Random FP128 numbers, in bulk -------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Uniform and normal random FP128 values, with every bit of the
+ * significand random:
+ *
+ *   FP128_RANDOM r;
+ *   FP128_random_init(&r, seed, stream);
+ *   FP128_random_uniform(&r)                 one value in [0, 1)
+ *   FP128_random_uniform_n(&r, out, n)       n values in [0, 1)
+ *   FP128_random_range_n(&r, a, b, out, n)   n values in [a, b)
+ *   FP128_random_normal_n(&r, out, n)        n values from N(0, 1)
+ *
+ * The generator is Philox4x32-10 (Salmon et al., "Parallel random numbers:
+ * as easy as 1, 2, 3", 2011), which is counter-based: the 128 random bits
+ * for position p of a stream are a function of the key (the seed), the
+ * stream and p alone. So a stream is just a position, and different
+ * streams (or seeds) are independent; give each thread its own stream
+ * number, and it can use its own FP128_RANDOM without any locking. The
+ * array versions use the next n positions (2 * ceil(n / 2) for normals),
+ * and with OpenMP run in parallel once n reaches PFP128_OMP_THRESHOLD,
+ * with the same results however many threads there are.
+ *
+ * A uniform value is built directly from one block of bits, with no
+ * floating point arithmetic: 112 bits are the fraction, and the number of
+ * leading zeros of the other 16 (continued into further blocks on the rare
+ * occasions that they're all zero) is how far below one half the exponent
+ * is. So every value is a full 113 bit binary128 number, each is returned
+ * with probability in proportion to the gap to the next one up (other than
+ * that we never go below 2^-16382, where the chance is far too small to
+ * matter), and 0 is never returned. With the double-double backend the
+ * value is built from the same bits, rounded down to 106 bits.
+ *
+ * FP128_random_range_n computes a + (b - a) u with one rounding (with
+ * binary128), replacing the very rare result which rounds up to b with a.
+ * It needs a < b with b - a finite, and otherwise returns -1 with errno
+ * EDOM, leaving out and the position alone (it returns 0 when it works). FP128_random_normal_n uses the Box-Muller
+ * transform, sqrt(-2 log u) times cos(2 pi v) and sin(2 pi v) for each two
+ * uniform values u and v, with logFP128_fast and sincosFP128_fast from
+ * pfp128_fast.h, so it's accurate to a few ulp.
+ *
+ * Like pfp128_fast.h this needs __int128, and binary128 or double-double.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_RANDOM_H_INCLUDED_))
+#define _PFP128_RANDOM_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_fast.h"
+#include "pfp128_soft.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_RANDOM_LOOP                                                     \
+  _Pragma("omp parallel for schedule(static) if (n >= PFP128_OMP_THRESHOLD)")
+#else
+#define PFP128_RANDOM_LOOP
+#endif
+
+typedef struct {
+  uint32_t key[2];
+  uint64_t stream;
+  uint64_t position; // Of the next value.
+} FP128_RANDOM;
+
+static inline void FP128_random_init(FP128_RANDOM *r, uint64_t seed,
+                                     uint64_t stream) {
+  r->key[0] = (uint32_t)seed;
+  r->key[1] = (uint32_t)(seed >> 32);
+  r->stream = stream;
+  r->position = 0;
+}
+
+// Philox4x32-10 of the counter (position, stream), with the key moved on
+// by extra for the blocks after the first for a value.
+static inline sq_u128 pfp128_random_block(FP128_RANDOM const *r,
+                                          uint64_t position, uint32_t extra) {
+  uint32_t c0 = (uint32_t)position, c1 = (uint32_t)(position >> 32);
+  uint32_t c2 = (uint32_t)r->stream, c3 = (uint32_t)(r->stream >> 32);
+  uint32_t k0 = r->key[0] + extra, k1 = r->key[1];
+  for (int round = 0; round < 10; round++) {
+    uint64_t p0 = (uint64_t)0xD2511F53u * c0, p1 = (uint64_t)0xCD9E8D57u * c2;
+    c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (uint32_t)p1;
+    c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (uint32_t)p0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  return (sq_u128)c3 << 96 | (sq_u128)c2 << 64 | (sq_u128)c1 << 32 | c0;
+}
+
+// The uniform value at position, as binary128 bits: an exponent of -1 - z,
+// where z is the number of leading zero bits, and 112 random fraction bits.
+static inline FP128SQ pfp128_random_unit(FP128_RANDOM const *r,
+                                         uint64_t position) {
+  sq_u128 bits = pfp128_random_block(r, position, 0);
+  sq_u128 fraction = bits & SQ_MANT_MASK;
+  uint32_t top = (uint32_t)(bits >> 112);
+  int32_t z = top ? __builtin_clz(top) - 16 : 16;
+  for (uint32_t extra = 1; !top && z < SQ_BIAS - 2; extra++) {
+    sq_u128 more = pfp128_random_block(r, position, extra);
+    uint64_t hi = (uint64_t)(more >> 64);
+    if (more) {
+      z += hi ? __builtin_clzll(hi) : 64 + __builtin_clzll((uint64_t)more);
+      break;
+    }
+    z += 128;
+  }
+  if (z > SQ_BIAS - 2)
+    z = SQ_BIAS - 2;
+  return sq_make((sq_u128)(SQ_BIAS - 1 - z) << 112 | fraction);
+}
+
+// As an FP128. With double-double we take the top 52 fraction bits for hi,
+// and the next 53 for lo, all in hardware.
+static inline FP128 pfp128_random_to_FP128(FP128SQ u) {
+#if (PFP128_IS_DD)
+  int32_t e = (int32_t)(u.bits >> 112) - SQ_BIAS; // -1 - z
+  if (e < -1021 + 105)
+    return FP128_from_sq(u);
+  uint64_t hiBits = (uint64_t)(e + 1023) << 52 |
+                    ((uint64_t)(u.bits >> 60) & ((1ull << 52) - 1));
+  uint64_t scaleBits = (uint64_t)(e - 105 + 1023) << 52;
+  double hi, scale;
+  memcpy(&hi, &hiBits, sizeof(hi));
+  memcpy(&scale, &scaleBits, sizeof(scale));
+  double lo = (double)((uint64_t)(u.bits >> 7) & ((1ull << 53) - 1)) * scale;
+  return dd_quick_two_sum(hi, lo);
+#else
+  return FP128_from_sq(u);
+#endif
+}
+
+static inline FP128 FP128_random_uniform(FP128_RANDOM *r) {
+  return pfp128_random_to_FP128(pfp128_random_unit(r, r->position++));
+}
+
+static inline void FP128_random_uniform_n(FP128_RANDOM *r, FP128 *out,
+                                          size_t n) {
+  uint64_t position = r->position;
+  PFP128_RANDOM_LOOP
+  for (size_t i = 0; i < n; i++)
+    out[i] = pfp128_random_to_FP128(pfp128_random_unit(r, position + i));
+  r->position += n;
+}
+
+static inline int FP128_random_range_n(FP128_RANDOM *r, FP128 a, FP128 b,
+                                       FP128 *out, size_t n) {
+  if (!ltFP128(a, b) || !isfiniteFP128(subFP128(b, a))) {
+    errno = EDOM;
+    return -1;
+  }
+  uint64_t position = r->position;
+  FP128 width = subFP128(b, a);
+#if (!PFP128_IS_DD)
+  FP128SQ aSq = FP128_to_sq(a), widthSq = FP128_to_sq(width);
+#endif
+  PFP128_RANDOM_LOOP
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ u = pfp128_random_unit(r, position + i);
+#if (PFP128_IS_DD)
+    FP128 v = addFP128(a, mulFP128(width, pfp128_random_to_FP128(u)));
+#else
+    FP128 v = FP128_from_sq(fmasq(widthSq, u, aSq));
+#endif
+    out[i] = ltFP128(v, b) ? v : a;
+  }
+  r->position += n;
+  return 0;
+}
+
+static inline void FP128_random_normal_n(FP128_RANDOM *r, FP128 *out,
+                                         size_t n) {
+  uint64_t position = r->position;
+  size_t pairs = (n + 1) / 2;
+  FP128SQ minusTwo = sq_from_double(-2.0);
+  FP128SQ twoPi = sq_from_halves(0x4001921FB54442D1ull, 0x8469898CC51701B8ull);
+  PFP128_RANDOM_LOOP
+  for (size_t i = 0; i < pairs; i++) {
+    FP128SQ u = pfp128_random_unit(r, position + 2 * i);
+    FP128SQ v = pfp128_random_unit(r, position + 2 * i + 1);
+    FP128SQ radius = sqrtsq(mulsq(minusTwo, pfp128_fast_log(u)));
+    FP128SQ s, c;
+    pfp128_fast_sincos(mulsq(twoPi, v), &s, &c);
+    out[2 * i] = FP128_from_sq(mulsq(radius, c));
+    if (2 * i + 1 < n)
+      out[2 * i + 1] = FP128_from_sq(mulsq(radius, s));
+  }
+  r->position += 2 * pairs;
+}
+
+#undef PFP128_RANDOM_LOOP
+
+#endif // Header monotonicity
@@ -0,0 +1,625 @@
+//===-- pfp128_reduce.h - Accurate sums and dot products -----*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Sums, dot products and Euclidean norms of arrays of double or FP128,
+ * accumulated to (better than) FP128 precision:
+ *
+ *   sumFP128_d(x, n),  dotFP128_d(x, y, n),  normFP128_d(x, n)
+ *   sumFP128_n(x, n),  dotFP128_n(x, y, n),  normFP128_n(x, n)
+ *
+ * Rather than converting each element to FP128 and using (soft-float)
+ * FP128 arithmetic, we accumulate in hardware double precision using error
+ * free transformations: each lane of the accumulator is an unevaluated sum
+ * of three doubles, a + b + c, where the rounding error of every addition
+ * into a (found with TwoSum) is added to b, and that of every addition into
+ * b to c; products are split into p + e with TwoProd (using a hardware fma
+ * where there is one). This is the cascaded summation of Ogita, Rump and
+ * Oishi ("Accurate sum and dot product", SIAM J. Sci. Comput. 26(6), 2005)
+ * with three levels. The inner loops work on PFP128_REDUCE_LANES independent
+ * lanes, so that the compiler can vectorise them.
+ *
+ * The arrays are processed in blocks of PFP128_REDUCE_BLOCK elements, and
+ * the result of each block is added (exactly, as a pair of binary128
+ * values) to the total in the order of the blocks. With OpenMP the blocks
+ * are shared between the threads (once n reaches PFP128_OMP_THRESHOLD), but
+ * since neither the blocks nor the order in which they're added depend on
+ * the number of threads, the result is always the same.
+ *
+ * The error of the accumulation is about 2^-130 times the sum of the
+ * magnitudes of the terms, so unless there is extreme cancellation the
+ * result is within about an ulp of the exact one (with the double-double
+ * backend, of the exact one rounded to binary128). If the products
+ * overflowed, or some underflowed and the result is so small that that
+ * matters, we do it again with the values scaled by powers of two, and if
+ * that doesn't work either (as with infinities, NaNs, or products of very
+ * different sizes which cancel) in binary128 arithmetic. A result which is
+ * exactly zero is -0 if all the terms were, as it would be if they were
+ * added up in order.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_REDUCE_H_INCLUDED_))
+#define _PFP128_REDUCE_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_dd.h"
+#include "pfp128_soft.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_reduce.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+#define PFP128_REDUCE_LANES 32
+#define PFP128_REDUCE_BLOCK 16384
+// How many blocks we give to the threads at once.
+#define PFP128_REDUCE_BATCH 64
+// Products (of doubles) smaller than this may not be exact as two doubles,
+// or may have underflowed altogether.
+#define PFP128_REDUCE_TINY 0x1p-860
+
+// The result of a block: a + b + c + s + e. s and e hold the (rare)
+// contributions which couldn't be computed in double.
+typedef struct {
+  double a, b, c;
+  FP128SQ s, e;
+  // The largest exponents of the x and y values, for scaling (INT_MIN if
+  // they were all zero, or we don't need to know).
+  int expX, expY;
+  // Whether any product of non-zero values was below PFP128_REDUCE_TINY.
+  int lost;
+} pfp128_reduce_part;
+
+// (a, b, c) += x.
+static inline void pfp128_reduce_add(double *a, double *b, double *c,
+                                     double x) {
+  FP128DD s = dd_two_sum(*a, x);
+  FP128DD t = dd_two_sum(*b, s.lo);
+  *a = s.hi;
+  *b = t.hi;
+  *c += t.lo;
+}
+
+// (b, c) += x, for an x which is already small compared with a.
+static inline void pfp128_reduce_add_low(double *b, double *c, double x) {
+  FP128DD t = dd_two_sum(*b, x);
+  *b = t.hi;
+  *c += t.lo;
+}
+
+// (a, b, c) += x * y.
+static inline void pfp128_reduce_add_product(double *a, double *b, double *c,
+                                             double x, double y) {
+  FP128DD p = dd_two_prod(x, y);
+  pfp128_reduce_add(a, b, c, p.hi);
+  pfp128_reduce_add_low(b, c, p.lo);
+}
+
+static inline double pfp128_reduce_max(double m, double x) {
+  x = fabs(x);
+  return x > m ? x : m;
+}
+
+static inline int pfp128_reduce_exp(double m) {
+  return m == 0.0 ? INT_MIN : ilogb(m);
+}
+
+// 1 if the product of x and y (originally) was lost, otherwise l. (As
+// doubles, so that it vectorises with the rest.)
+static inline double pfp128_reduce_lost(double l, double x, double y,
+                                        double product) {
+  return x != 0.0 && y != 0.0 && fabs(product) < PFP128_REDUCE_TINY ? 1.0 : l;
+}
+
+// Combine the lanes' largest values, and whether they lost anything.
+static inline void pfp128_reduce_extremes(pfp128_reduce_part *p, double *mx,
+                                          double *my, double const *lost) {
+  for (int k = 1; k < PFP128_REDUCE_LANES; k++) {
+    mx[0] = pfp128_reduce_max(mx[0], mx[k]);
+    my[0] = pfp128_reduce_max(my[0], my[k]);
+    p->lost = p->lost || lost[k] != 0.0;
+  }
+  p->lost = p->lost || lost[0] != 0.0;
+  p->expX = pfp128_reduce_exp(mx[0]);
+  p->expY = pfp128_reduce_exp(my[0]);
+}
+
+// Sum the lanes into the part.
+static inline void pfp128_reduce_lanes(pfp128_reduce_part *p,
+                                       double const *a, double const *b,
+                                       double const *c) {
+  p->a = p->b = p->c = 0.0;
+  for (int k = 0; k < PFP128_REDUCE_LANES; k++) {
+    pfp128_reduce_add(&p->a, &p->b, &p->c, a[k]);
+    pfp128_reduce_add(&p->a, &p->b, &p->c, b[k]);
+    pfp128_reduce_add(&p->a, &p->b, &p->c, c[k]);
+  }
+}
+
+// (*s, *e) += x, in binary128 (TwoSum again). Once *s isn't finite it's
+// the result, so we leave *e alone.
+static inline void pfp128_reduce_add_sq(FP128SQ *s, FP128SQ *e, FP128SQ x) {
+  FP128SQ sum = addsq(*s, x);
+  FP128SQ bb = subsq(sum, *s);
+  FP128SQ err = addsq(subsq(*s, subsq(sum, bb)), subsq(x, bb));
+  *s = sum;
+  if (isfinitesq(sum))
+    *e = addsq(*e, err);
+}
+
+// (*s, *e) += x * y exactly (unless it overflows or underflows).
+static inline void pfp128_reduce_add_product_sq(FP128SQ *s, FP128SQ *e,
+                                                FP128SQ x, FP128SQ y) {
+  FP128SQ p = mulsq(x, y);
+  pfp128_reduce_add_sq(s, e, p);
+  if (isfinitesq(p))
+    *e = addsq(*e, fmasq(x, y, negsq(p)));
+}
+
+// 2^k, for k in [-16382, 16383].
+static inline FP128SQ pfp128_reduce_pow2(int k) {
+  return sq_make((sq_u128)(k + SQ_BIAS) << 112);
+}
+
+// The kernels for a block of n elements. Products are of x * 2^-kx and
+// y * 2^-ky, so that they neither overflow nor underflow.
+static inline void pfp128_reduce_sum_d(pfp128_reduce_part *p, double const *x,
+                                       size_t n) {
+  double a[PFP128_REDUCE_LANES] = {0}, b[PFP128_REDUCE_LANES] = {0},
+         c[PFP128_REDUCE_LANES] = {0};
+  size_t i = 0;
+  for (; i + PFP128_REDUCE_LANES <= n; i += PFP128_REDUCE_LANES)
+    for (int k = 0; k < PFP128_REDUCE_LANES; k++)
+      pfp128_reduce_add(&a[k], &b[k], &c[k], x[i + k]);
+  for (int k = 0; k < PFP128_REDUCE_LANES && i < n; k++, i++)
+    pfp128_reduce_add(&a[k], &b[k], &c[k], x[i]);
+  pfp128_reduce_lanes(p, a, b, c);
+}
+
+static inline void pfp128_reduce_dot_d(pfp128_reduce_part *p, double const *x,
+                                       double const *y, size_t n, int kx,
+                                       int ky) {
+  double a[PFP128_REDUCE_LANES] = {0}, b[PFP128_REDUCE_LANES] = {0},
+         c[PFP128_REDUCE_LANES] = {0}, mx[PFP128_REDUCE_LANES] = {0},
+         my[PFP128_REDUCE_LANES] = {0}, lost[PFP128_REDUCE_LANES] = {0};
+  double sx = ldexp(1.0, -kx), sy = ldexp(1.0, -ky);
+  size_t i = 0;
+  for (; i + PFP128_REDUCE_LANES <= n; i += PFP128_REDUCE_LANES)
+    for (int k = 0; k < PFP128_REDUCE_LANES; k++) {
+      double xi = x[i + k] * sx, yi = y[i + k] * sy;
+      mx[k] = pfp128_reduce_max(mx[k], xi);
+      my[k] = pfp128_reduce_max(my[k], yi);
+      lost[k] = pfp128_reduce_lost(lost[k], x[i + k], y[i + k], xi * yi);
+      pfp128_reduce_add_product(&a[k], &b[k], &c[k], xi, yi);
+    }
+  for (int k = 0; k < PFP128_REDUCE_LANES && i < n; k++, i++) {
+    double xi = x[i] * sx, yi = y[i] * sy;
+    mx[k] = pfp128_reduce_max(mx[k], xi);
+    my[k] = pfp128_reduce_max(my[k], yi);
+    lost[k] = pfp128_reduce_lost(lost[k], x[i], y[i], xi * yi);
+    pfp128_reduce_add_product(&a[k], &b[k], &c[k], xi, yi);
+  }
+  pfp128_reduce_lanes(p, a, b, c);
+  pfp128_reduce_extremes(p, mx, my, lost);
+}
+
+#if (PFP128_IS_DD)
+// Each value is already a sum of two doubles.
+static inline void pfp128_reduce_sum_n(pfp128_reduce_part *p, FP128 const *x,
+                                       size_t n) {
+  double a[PFP128_REDUCE_LANES] = {0}, b[PFP128_REDUCE_LANES] = {0},
+         c[PFP128_REDUCE_LANES] = {0};
+  size_t i = 0;
+  for (; i + PFP128_REDUCE_LANES <= n; i += PFP128_REDUCE_LANES)
+    for (int k = 0; k < PFP128_REDUCE_LANES; k++) {
+      pfp128_reduce_add(&a[k], &b[k], &c[k], x[i + k].hi);
+      pfp128_reduce_add_low(&b[k], &c[k], x[i + k].lo);
+    }
+  for (int k = 0; k < PFP128_REDUCE_LANES && i < n; k++, i++) {
+    pfp128_reduce_add(&a[k], &b[k], &c[k], x[i].hi);
+    pfp128_reduce_add_low(&b[k], &c[k], x[i].lo);
+  }
+  pfp128_reduce_lanes(p, a, b, c);
+}
+
+// (xh + xl) * (yh + yl).
+static inline void pfp128_reduce_add_product_dd(double *a, double *b,
+                                                double *c, FP128 x, FP128 y) {
+  FP128DD p = dd_two_prod(x.hi, y.hi);
+  FP128DD q = dd_two_prod(x.hi, y.lo);
+  FP128DD r = dd_two_prod(x.lo, y.hi);
+  pfp128_reduce_add(a, b, c, p.hi);
+  pfp128_reduce_add_low(b, c, p.lo);
+  pfp128_reduce_add_low(b, c, q.hi);
+  pfp128_reduce_add_low(b, c, r.hi);
+  *c += q.lo + r.lo + x.lo * y.lo;
+}
+
+static inline void pfp128_reduce_dot_n(pfp128_reduce_part *p, FP128 const *x,
+                                       ptrdiff_t incx, FP128 const *y,
+                                       ptrdiff_t incy, size_t n, int kx,
+                                       int ky) {
+  double a[PFP128_REDUCE_LANES] = {0}, b[PFP128_REDUCE_LANES] = {0},
+         c[PFP128_REDUCE_LANES] = {0}, mx[PFP128_REDUCE_LANES] = {0},
+         my[PFP128_REDUCE_LANES] = {0}, lost[PFP128_REDUCE_LANES] = {0};
+  double sx = ldexp(1.0, -kx), sy = ldexp(1.0, -ky);
+  size_t i = 0;
+  for (; i + PFP128_REDUCE_LANES <= n; i += PFP128_REDUCE_LANES)
+    for (int k = 0; k < PFP128_REDUCE_LANES; k++) {
+      FP128 u = x[(ptrdiff_t)(i + k) * incx], v = y[(ptrdiff_t)(i + k) * incy];
+      FP128 xi = dd_make(u.hi * sx, u.lo * sx);
+      FP128 yi = dd_make(v.hi * sy, v.lo * sy);
+      mx[k] = pfp128_reduce_max(mx[k], xi.hi);
+      my[k] = pfp128_reduce_max(my[k], yi.hi);
+      lost[k] = pfp128_reduce_lost(lost[k], u.hi, v.hi, xi.hi * yi.hi);
+      pfp128_reduce_add_product_dd(&a[k], &b[k], &c[k], xi, yi);
+    }
+  for (int k = 0; k < PFP128_REDUCE_LANES && i < n; k++, i++) {
+    FP128 u = x[(ptrdiff_t)i * incx], v = y[(ptrdiff_t)i * incy];
+    FP128 xi = dd_make(u.hi * sx, u.lo * sx);
+    FP128 yi = dd_make(v.hi * sy, v.lo * sy);
+    mx[k] = pfp128_reduce_max(mx[k], xi.hi);
+    my[k] = pfp128_reduce_max(my[k], yi.hi);
+    lost[k] = pfp128_reduce_lost(lost[k], u.hi, v.hi, xi.hi * yi.hi);
+    pfp128_reduce_add_product_dd(&a[k], &b[k], &c[k], xi, yi);
+  }
+  pfp128_reduce_lanes(p, a, b, c);
+  pfp128_reduce_extremes(p, mx, my, lost);
+}
+#else
+// Split v * 2^-shift exactly into three doubles, h + m + l, with
+// |m| < ulp(h) and |l| < 2^-53 ulp(h), returning its exponent, or INT_MIN
+// if that isn't in [-910, 1023] (or v is zero or not finite).
+static inline int pfp128_reduce_split(FP128SQ v, int shift, double *h,
+                                      double *m, double *l) {
+  int exp = (int)((v.bits >> 112) & SQ_EXP_MAX) - SQ_BIAS - shift;
+  if (exp < -910 || exp > 1023 || (v.bits & SQ_ABS_MASK) < SQ_IMPLICIT_BIT ||
+      !isfinitesq(v))
+    return INT_MIN;
+  sq_u128 sig = (v.bits & SQ_MANT_MASK) | SQ_IMPLICIT_BIT;
+  // 2^(exp - 52), the weight of the last bit of h.
+  uint64_t scaleBits = (uint64_t)(exp - 52 + 1023) << 52;
+  double scale, sign = signbitsq(v) ? -1.0 : 1.0;
+  memcpy(&scale, &scaleBits, sizeof(scale));
+  *h = sign * (double)(uint64_t)(sig >> 60) * scale;
+  *m = sign * (double)((uint64_t)(sig >> 7) & ((1ull << 53) - 1)) *
+       (scale * 0x1p-53);
+  *l = sign * (double)((uint64_t)sig & 127) * (scale * 0x1p-60);
+  return exp;
+}
+
+// The unbiased exponent of v (roughly, if it's subnormal), or INT_MIN if
+// it's zero.
+static inline int pfp128_reduce_exp_sq(FP128SQ v) {
+  if ((v.bits & SQ_ABS_MASK) == 0)
+    return INT_MIN;
+  int exp = (int)((v.bits >> 112) & SQ_EXP_MAX) - SQ_BIAS;
+  return exp < 1 - SQ_BIAS ? 1 - SQ_BIAS : exp;
+}
+
+static inline void pfp128_reduce_sum_n(pfp128_reduce_part *p, FP128 const *x,
+                                       size_t n) {
+  double a[PFP128_REDUCE_LANES] = {0}, b[PFP128_REDUCE_LANES] = {0},
+         c[PFP128_REDUCE_LANES] = {0};
+  for (size_t i = 0, k = 0; i < n; i++, k = (k + 1) % PFP128_REDUCE_LANES) {
+    FP128SQ v = FP128_to_sq(x[i]);
+    double h, m, l;
+    if (pfp128_reduce_split(v, 0, &h, &m, &l) == INT_MIN) {
+      if ((v.bits & SQ_ABS_MASK) != 0)
+        pfp128_reduce_add_sq(&p->s, &p->e, v);
+      continue;
+    }
+    pfp128_reduce_add(&a[k], &b[k], &c[k], h);
+    pfp128_reduce_add_low(&b[k], &c[k], m);
+    c[k] += l;
+  }
+  pfp128_reduce_lanes(p, a, b, c);
+}
+
+// Products whose exponents are outside [-860, 1020] are computed in
+// binary128 instead.
+static inline void pfp128_reduce_dot_n(pfp128_reduce_part *p, FP128 const *x,
+                                       ptrdiff_t incx, FP128 const *y,
+                                       ptrdiff_t incy, size_t n, int kx,
+                                       int ky) {
+  double a[PFP128_REDUCE_LANES] = {0}, b[PFP128_REDUCE_LANES] = {0},
+         c[PFP128_REDUCE_LANES] = {0};
+  for (size_t i = 0, k = 0; i < n; i++, k = (k + 1) % PFP128_REDUCE_LANES) {
+    FP128SQ u = FP128_to_sq(x[(ptrdiff_t)i * incx]);
+    FP128SQ v = FP128_to_sq(y[(ptrdiff_t)i * incy]);
+    double xh = 0, xm = 0, xl = 0, yh = 0, ym = 0, yl = 0;
+    int ex = pfp128_reduce_split(u, kx, &xh, &xm, &xl);
+    int ey = pfp128_reduce_split(v, ky, &yh, &ym, &yl);
+    int eu = pfp128_reduce_exp_sq(u), ev = pfp128_reduce_exp_sq(v);
+    p->expX = eu > p->expX ? eu : p->expX;
+    p->expY = ev > p->expY ? ev : p->expY;
+    if (ex == INT_MIN || ey == INT_MIN || ex + ey < -860 || ex + ey > 1020) {
+      if (eu != INT_MIN && ev != INT_MIN)
+        pfp128_reduce_add_product_sq(&p->s, &p->e,
+                                     mulsq(u, pfp128_reduce_pow2(-kx)),
+                                     mulsq(v, pfp128_reduce_pow2(-ky)));
+      continue;
+    }
+    FP128DD hh = dd_two_prod(xh, yh);
+    FP128DD hm = dd_two_prod(xh, ym);
+    FP128DD mh = dd_two_prod(xm, yh);
+    pfp128_reduce_add(&a[k], &b[k], &c[k], hh.hi);
+    pfp128_reduce_add_low(&b[k], &c[k], hh.lo);
+    pfp128_reduce_add_low(&b[k], &c[k], hm.hi);
+    pfp128_reduce_add_low(&b[k], &c[k], mh.hi);
+    c[k] += hm.lo + mh.lo + xh * yl + xl * yh + xm * ym;
+  }
+  pfp128_reduce_lanes(p, a, b, c);
+}
+#endif
+
+typedef enum {
+  PFP128_REDUCE_SUM_D,
+  PFP128_REDUCE_DOT_D,
+  PFP128_REDUCE_SUM_N,
+  PFP128_REDUCE_DOT_N,
+  PFP128_REDUCE_DOT_STRIDED // DOT_N, with x and y every incx and incy.
+} pfp128_reduce_kind;
+
+// Add up the blocks, in binary128, returning zero if the double arithmetic
+// produced something which wasn't finite (in which case *s and *e are
+// meaningless). *expX and *expY are set to the largest exponents, and
+// *lost to whether any product was lost.
+static inline int pfp128_reduce_blocks(pfp128_reduce_kind kind,
+                                       void const *x, ptrdiff_t incx,
+                                       void const *y, ptrdiff_t incy,
+                                       size_t n, int kx, int ky, FP128SQ *s,
+                                       FP128SQ *e, int *expX, int *expY,
+                                       int *lost) {
+  pfp128_reduce_part part[PFP128_REDUCE_BATCH];
+  size_t blocks = (n + PFP128_REDUCE_BLOCK - 1) / PFP128_REDUCE_BLOCK;
+  int finite = 1;
+  *s = *e = sq_make(0);
+  *expX = *expY = INT_MIN;
+  *lost = 0;
+  for (size_t first = 0; first < blocks && finite;
+       first += PFP128_REDUCE_BATCH) {
+    size_t batch = blocks - first < PFP128_REDUCE_BATCH ? blocks - first
+                                                          : PFP128_REDUCE_BATCH;
+#if (defined(_OPENMP))
+    _Pragma("omp parallel for schedule(static) if (n >= PFP128_OMP_THRESHOLD)")
+#endif
+    for (size_t j = 0; j < batch; j++) {
+      size_t i = (first + j) * PFP128_REDUCE_BLOCK;
+      size_t len = n - i < PFP128_REDUCE_BLOCK ? n - i : PFP128_REDUCE_BLOCK;
+      pfp128_reduce_part *p = &part[j];
+      p->s = p->e = sq_make(0);
+      p->expX = p->expY = INT_MIN;
+      p->lost = 0;
+      switch (kind) {
+      case PFP128_REDUCE_SUM_D:
+        pfp128_reduce_sum_d(p, (double const *)x + i, len);
+        break;
+      case PFP128_REDUCE_DOT_D:
+        pfp128_reduce_dot_d(p, (double const *)x + i, (double const *)y + i,
+                            len, kx, ky);
+        break;
+      case PFP128_REDUCE_SUM_N:
+        pfp128_reduce_sum_n(p, (FP128 const *)x + i, len);
+        break;
+      case PFP128_REDUCE_DOT_N:
+        pfp128_reduce_dot_n(p, (FP128 const *)x + i, 1, (FP128 const *)y + i,
+                            1, len, kx, ky);
+        break;
+      case PFP128_REDUCE_DOT_STRIDED:
+        pfp128_reduce_dot_n(p, (FP128 const *)x + (ptrdiff_t)i * incx, incx,
+                            (FP128 const *)y + (ptrdiff_t)i * incy, incy, len,
+                            kx, ky);
+        break;
+      }
+    }
+    for (size_t j = 0; j < batch; j++) {
+      pfp128_reduce_part const *p = &part[j];
+      finite = finite && isfinite(p->a + p->b + p->c);
+      pfp128_reduce_add_sq(s, e, sq_from_double(p->a));
+      pfp128_reduce_add_sq(s, e, sq_from_double(p->b));
+      pfp128_reduce_add_sq(s, e, sq_from_double(p->c));
+      if ((p->s.bits | p->e.bits) != 0) {
+        pfp128_reduce_add_sq(s, e, p->s);
+        pfp128_reduce_add_sq(s, e, p->e);
+      }
+      *expX = p->expX > *expX ? p->expX : *expX;
+      *expY = p->expY > *expY ? p->expY : *expY;
+      *lost = *lost || p->lost;
+    }
+  }
+  return finite;
+}
+
+static inline int pfp128_reduce_is_sum(pfp128_reduce_kind kind) {
+  return kind == PFP128_REDUCE_SUM_D || kind == PFP128_REDUCE_SUM_N;
+}
+
+// Element i of x and y (or x again, for a sum), in binary128. (Only
+// PFP128_REDUCE_DOT_STRIDED uses the increments.)
+static inline void pfp128_reduce_element(pfp128_reduce_kind kind,
+                                         void const *x, ptrdiff_t incx,
+                                         void const *y, ptrdiff_t incy,
+                                         size_t i, FP128SQ *u, FP128SQ *v) {
+  if (kind == PFP128_REDUCE_SUM_D || kind == PFP128_REDUCE_DOT_D) {
+    *u = sq_from_double(((double const *)x)[i]);
+    *v = kind == PFP128_REDUCE_DOT_D ? sq_from_double(((double const *)y)[i])
+                                     : *u;
+  } else if (kind == PFP128_REDUCE_DOT_STRIDED) {
+    *u = FP128_to_sq(((FP128 const *)x)[(ptrdiff_t)i * incx]);
+    *v = FP128_to_sq(((FP128 const *)y)[(ptrdiff_t)i * incy]);
+  } else {
+    *u = FP128_to_sq(((FP128 const *)x)[i]);
+    *v = kind == PFP128_REDUCE_DOT_N ? FP128_to_sq(((FP128 const *)y)[i]) : *u;
+  }
+}
+
+// The same, but entirely in binary128, which is slow, but copes with
+// infinities and NaNs, and products of any size.
+static inline FP128SQ pfp128_reduce_slow(pfp128_reduce_kind kind,
+                                         void const *x, ptrdiff_t incx,
+                                         void const *y, ptrdiff_t incy,
+                                         size_t n) {
+  FP128SQ s = sq_make(0), e = sq_make(0);
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ u, v;
+    pfp128_reduce_element(kind, x, incx, y, incy, i, &u, &v);
+    if (pfp128_reduce_is_sum(kind))
+      pfp128_reduce_add_sq(&s, &e, u);
+    else
+      pfp128_reduce_add_product_sq(&s, &e, u, v);
+  }
+  return isfinitesq(s) ? addsq(s, e) : s;
+}
+
+// Whether every term is -0 (so that adding them up in order would give
+// -0, whereas any other exact zero is +0).
+static inline int pfp128_reduce_negative_zero(pfp128_reduce_kind kind,
+                                              void const *x, ptrdiff_t incx,
+                                              void const *y, ptrdiff_t incy,
+                                              size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ u, v;
+    pfp128_reduce_element(kind, x, incx, y, incy, i, &u, &v);
+    int zero = (u.bits & SQ_ABS_MASK) == 0 || (v.bits & SQ_ABS_MASK) == 0;
+    int negative = pfp128_reduce_is_sum(kind)
+                       ? u.bits == SQ_SIGN_BIT
+                       : zero && signbitsq(u) != signbitsq(v);
+    if (!negative)
+      return 0;
+  }
+  return n > 0;
+}
+
+static inline int pfp128_reduce_clamp(int k, int limit) {
+  return k < -limit ? -limit : k > limit ? limit : k;
+}
+
+// Whether the double arithmetic's result is no good: it overflowed, or it
+// lost products and is so small (below 2^-800) that they might matter.
+static inline int pfp128_reduce_failed(int finite, int lost, FP128SQ s) {
+  return !finite || (lost && (s.bits & SQ_ABS_MASK) <
+                                 (sq_u128)(SQ_BIAS - 800) << 112);
+}
+
+// The sum, or dot product, times 2^-*scale. If the double arithmetic
+// failed, we do it again with x and y scaled by powers of two so that the
+// largest of each is about one (which is exact, other than for values which
+// are too small to matter), and if that fails too, in binary128.
+static inline FP128SQ pfp128_reduce_strided(pfp128_reduce_kind kind,
+                                            void const *x, ptrdiff_t incx,
+                                            void const *y, ptrdiff_t incy,
+                                            size_t n, int *scale) {
+  FP128SQ s, e, r;
+  int ex, ey, lost;
+  *scale = 0;
+  int finite = pfp128_reduce_blocks(kind, x, incx, y, incy, n, 0, 0, &s, &e,
+                                    &ex, &ey, &lost);
+  if (pfp128_reduce_failed(finite, lost, s) && ex != INT_MIN &&
+      ey != INT_MIN) {
+    // Keep the scales representable (as doubles, or binary128).
+    int limit = (kind == PFP128_REDUCE_DOT_N ||
+                 kind == PFP128_REDUCE_DOT_STRIDED) &&
+                        !PFP128_IS_DD
+                    ? 16000
+                    : 1000;
+    int kx = pfp128_reduce_clamp(ex, limit);
+    int ky = pfp128_reduce_clamp(ey, limit);
+    finite = pfp128_reduce_blocks(kind, x, incx, y, incy, n, kx, ky, &s, &e,
+                                  &ex, &ey, &lost);
+    *scale = kx + ky;
+  }
+  if (pfp128_reduce_failed(finite, lost, s)) {
+    *scale = 0;
+    r = pfp128_reduce_slow(kind, x, incx, y, incy, n);
+  } else {
+    r = isfinitesq(s) ? addsq(s, e) : s;
+  }
+  if ((r.bits & SQ_ABS_MASK) == 0 &&
+      pfp128_reduce_negative_zero(kind, x, incx, y, incy, n))
+    r = sq_make(SQ_SIGN_BIT);
+  return r;
+}
+
+static inline FP128SQ pfp128_reduce(pfp128_reduce_kind kind, void const *x,
+                                    void const *y, size_t n, int *scale) {
+  return pfp128_reduce_strided(kind, x, 1, y, 1, n, scale);
+}
+
+// r * 2^scale, in steps small enough that the powers of two are
+// representable.
+static inline FP128SQ pfp128_reduce_unscale(FP128SQ r, int scale) {
+  while (scale != 0) {
+    int step = pfp128_reduce_clamp(scale, 16000);
+    r = mulsq(r, pfp128_reduce_pow2(step));
+    scale -= step;
+  }
+  return r;
+}
+
+static inline FP128 sumFP128_d(double const *x, size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce(PFP128_REDUCE_SUM_D, x, NULL, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(r, scale));
+}
+
+static inline FP128 dotFP128_d(double const *x, double const *y, size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce(PFP128_REDUCE_DOT_D, x, y, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(r, scale));
+}
+
+// (The scale is even, since x and y are the same.)
+static inline FP128 normFP128_d(double const *x, size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce(PFP128_REDUCE_DOT_D, x, x, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(sqrtsq(r), scale / 2));
+}
+
+static inline FP128 sumFP128_n(FP128 const *x, size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce(PFP128_REDUCE_SUM_N, x, NULL, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(r, scale));
+}
+
+static inline FP128 dotFP128_n(FP128 const *x, FP128 const *y, size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce(PFP128_REDUCE_DOT_N, x, y, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(r, scale));
+}
+
+static inline FP128 normFP128_n(FP128 const *x, size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce(PFP128_REDUCE_DOT_N, x, x, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(sqrtsq(r), scale / 2));
+}
+
+// The same for vectors whose elements are incx (and incy) apart, for
+// pfp128_blas.h. (x and y point at element 0, even if the increment is
+// negative.)
+static inline FP128 pfp128_reduce_dot_strided(FP128 const *x, ptrdiff_t incx,
+                                              FP128 const *y, ptrdiff_t incy,
+                                              size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce_strided(PFP128_REDUCE_DOT_STRIDED, x, incx, y,
+                                    incy, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(r, scale));
+}
+
+static inline FP128 pfp128_reduce_norm_strided(FP128 const *x, ptrdiff_t incx,
+                                               size_t n) {
+  int scale;
+  FP128SQ r = pfp128_reduce_strided(PFP128_REDUCE_DOT_STRIDED, x, incx, x,
+                                    incx, n, &scale);
+  return FP128_from_sq(pfp128_reduce_unscale(sqrtsq(r), scale / 2));
+}
+
+#endif // Header monotonicity
@@ -0,0 +1,297 @@
+//===-- pfp128_simd.h - Structure of arrays binary128 kernels
+//--------------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Bulk IEEE binary128 arithmetic on arrays stored as a "structure of arrays"
+ * (FP128_SOA), in which the high and low 64 bits of each value live in two
+ * separate arrays ("planes"). That lets us load the high (sign, exponent and
+ * top of the mantissa) and low words of four (AVX2) or eight (AVX-512) values
+ * into vector registers and operate on all of them at once, which an array of
+ * FP128 (where the two halves are interleaved) doesn't allow.
+ *
+ * We provide add, multiply, fused multiply-add and the conversions to and
+ * from double. The implementation to use is chosen at run time from the
+ * instructions which the CPU supports; there is always a scalar one, built on
+ * pfp128_soft.h, and the vector versions give results which are bit for bit
+ * identical to it (because they are all correctly rounded).
+ *
+ * The values in an FP128_SOA are always IEEE binary128 bit patterns. With the
+ * double-double backend FP128_soa_load and FP128_soa_store convert to and from
+ * that format (so the double-double values are rounded to 113 bits).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_SIMD_H_INCLUDED_))
+#define _PFP128_SIMD_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_soft.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_simd.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+typedef struct {
+  uint64_t *hi; // Sign, exponent and the top 48 bits of the mantissa.
+  uint64_t *lo; // The low 64 bits of the mantissa.
+  size_t n;
+} FP128_SOA;
+
+// Allocate space for n values (aligned for the vector loads). Returns zero
+// on success.
+static inline int FP128_soa_alloc(FP128_SOA *soa, size_t n) {
+  size_t bytes = ((n * sizeof(uint64_t) + 63) / 64) * 64;
+  if (bytes == 0)
+    bytes = 64;
+  soa->hi = (uint64_t *)aligned_alloc(64, bytes);
+  soa->lo = (uint64_t *)aligned_alloc(64, bytes);
+  soa->n = n;
+  if (soa->hi && soa->lo)
+    return 0;
+  free(soa->hi);
+  free(soa->lo);
+  soa->hi = soa->lo = 0;
+  soa->n = 0;
+  return -1;
+}
+
+static inline void FP128_soa_free(FP128_SOA *soa) {
+  free(soa->hi);
+  free(soa->lo);
+  soa->hi = soa->lo = 0;
+  soa->n = 0;
+}
+
+static inline FP128 FP128_soa_get(FP128_SOA const *soa, size_t i) {
+  return FP128_from_sq(sq_from_halves(soa->hi[i], soa->lo[i]));
+}
+
+static inline void FP128_soa_set(FP128_SOA *soa, size_t i, FP128 v) {
+  FP128SQ b = FP128_to_sq(v);
+  soa->hi[i] = sq_hi(b);
+  soa->lo[i] = sq_lo(b);
+}
+
+// Copy soa->n values from an array of FP128 into the planes, and back again.
+static inline void FP128_soa_load(FP128_SOA *soa, FP128 const *src) {
+  for (size_t i = 0; i < soa->n; i++)
+    FP128_soa_set(soa, i, src[i]);
+}
+
+static inline void FP128_soa_store(FP128 *dst, FP128_SOA const *soa) {
+  for (size_t i = 0; i < soa->n; i++)
+    dst[i] = FP128_soa_get(soa, i);
+}
+
+// The scalar kernels, which are also used by the vector ones for lanes they
+// can't handle and for the leftover elements at the end of an array.
+static inline void pfp128_soa_add_scalar(uint64_t *rh, uint64_t *rl,
+                                         uint64_t const *ah,
+                                         uint64_t const *al,
+                                         uint64_t const *bh,
+                                         uint64_t const *bl, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ r =
+        addsq(sq_from_halves(ah[i], al[i]), sq_from_halves(bh[i], bl[i]));
+    rh[i] = sq_hi(r);
+    rl[i] = sq_lo(r);
+  }
+}
+
+static inline void pfp128_soa_mul_scalar(uint64_t *rh, uint64_t *rl,
+                                         uint64_t const *ah,
+                                         uint64_t const *al,
+                                         uint64_t const *bh,
+                                         uint64_t const *bl, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ r =
+        mulsq(sq_from_halves(ah[i], al[i]), sq_from_halves(bh[i], bl[i]));
+    rh[i] = sq_hi(r);
+    rl[i] = sq_lo(r);
+  }
+}
+
+static inline void
+pfp128_soa_fma_scalar(uint64_t *rh, uint64_t *rl, uint64_t const *ah,
+                      uint64_t const *al, uint64_t const *bh,
+                      uint64_t const *bl, uint64_t const *ch,
+                      uint64_t const *cl, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ r =
+        fmasq(sq_from_halves(ah[i], al[i]), sq_from_halves(bh[i], bl[i]),
+              sq_from_halves(ch[i], cl[i]));
+    rh[i] = sq_hi(r);
+    rl[i] = sq_lo(r);
+  }
+}
+
+static inline void pfp128_soa_from_double_scalar(uint64_t *rh, uint64_t *rl,
+                                                 double const *d, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    FP128SQ r = sq_from_double(d[i]);
+    rh[i] = sq_hi(r);
+    rl[i] = sq_lo(r);
+  }
+}
+
+static inline void pfp128_soa_to_double_scalar(double *d, uint64_t const *ah,
+                                               uint64_t const *al, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    d[i] = sq_to_double(sq_from_halves(ah[i], al[i]));
+}
+
+// The vector kernels, generated from pfp128_simd_impl.h for each instruction
+// set. They need the GCC vector extensions, and target attributes so that we
+// can compile them without compiling everything else for the newer ISA.
+#if (defined(__x86_64__) && defined(__GNUC__))
+#define PFP128_SIMD_X86 1
+#include <immintrin.h>
+
+typedef uint64_t pfp128_v4u64 __attribute__((vector_size(32)));
+#define PFP128_SIMD_V pfp128_v4u64
+#define PFP128_SIMD_LANES 4
+#define PFP128_SIMD_TARGET __attribute__((target("avx2")))
+#define PFP128_SIMD_FN(name) pfp128_avx2_##name
+#define PFP128_SIMD_MUL32(a, b)                                                \
+  ((pfp128_v4u64)_mm256_mul_epu32((__m256i)(a), (__m256i)(b)))
+#include "pfp128_simd_impl.h"
+#undef PFP128_SIMD_V
+#undef PFP128_SIMD_LANES
+#undef PFP128_SIMD_TARGET
+#undef PFP128_SIMD_FN
+#undef PFP128_SIMD_MUL32
+
+typedef uint64_t pfp128_v8u64 __attribute__((vector_size(64)));
+#define PFP128_SIMD_V pfp128_v8u64
+#define PFP128_SIMD_LANES 8
+#define PFP128_SIMD_TARGET __attribute__((target("avx512f")))
+#define PFP128_SIMD_FN(name) pfp128_avx512_##name
+#define PFP128_SIMD_MUL32(a, b)                                                \
+  ((pfp128_v8u64)_mm512_mul_epu32((__m512i)(a), (__m512i)(b)))
+#include "pfp128_simd_impl.h"
+#undef PFP128_SIMD_V
+#undef PFP128_SIMD_LANES
+#undef PFP128_SIMD_TARGET
+#undef PFP128_SIMD_FN
+#undef PFP128_SIMD_MUL32
+#else
+#define PFP128_SIMD_X86 0
+#endif
+
+// Run time dispatch.
+typedef struct {
+  char const *name;
+  void (*add)(uint64_t *, uint64_t *, uint64_t const *, uint64_t const *,
+              uint64_t const *, uint64_t const *, size_t);
+  void (*mul)(uint64_t *, uint64_t *, uint64_t const *, uint64_t const *,
+              uint64_t const *, uint64_t const *, size_t);
+  void (*fma)(uint64_t *, uint64_t *, uint64_t const *, uint64_t const *,
+              uint64_t const *, uint64_t const *, uint64_t const *,
+              uint64_t const *, size_t);
+  void (*from_double)(uint64_t *, uint64_t *, double const *, size_t);
+  void (*to_double)(double *, uint64_t const *, uint64_t const *, size_t);
+} FP128_SOA_KERNELS;
+
+static FP128_SOA_KERNELS const pfp128_soa_kernel_table[] = {
+#if (PFP128_SIMD_X86)
+    {"avx512", pfp128_avx512_soa_add, pfp128_avx512_soa_mul,
+     pfp128_avx512_soa_fma, pfp128_avx512_soa_from_double,
+     pfp128_avx512_soa_to_double},
+    {"avx2", pfp128_avx2_soa_add, pfp128_avx2_soa_mul, pfp128_avx2_soa_fma,
+     pfp128_avx2_soa_from_double, pfp128_avx2_soa_to_double},
+#endif
+    {"scalar", pfp128_soa_add_scalar, pfp128_soa_mul_scalar,
+     pfp128_soa_fma_scalar, pfp128_soa_from_double_scalar,
+     pfp128_soa_to_double_scalar},
+};
+#define PFP128_SOA_NUM_KERNELS                                                 \
+  (sizeof(pfp128_soa_kernel_table) / sizeof(pfp128_soa_kernel_table[0]))
+
+// Can this machine run the kernels with the given index?
+static inline int pfp128_soa_supported(size_t k) {
+#if (PFP128_SIMD_X86)
+  __builtin_cpu_init();
+  if (strcmp(pfp128_soa_kernel_table[k].name, "avx512") == 0)
+    return __builtin_cpu_supports("avx512f");
+  if (strcmp(pfp128_soa_kernel_table[k].name, "avx2") == 0)
+    return __builtin_cpu_supports("avx2");
+#endif
+  return k < PFP128_SOA_NUM_KERNELS;
+}
+
+static inline FP128_SOA_KERNELS const **pfp128_soa_selected(void) {
+  static FP128_SOA_KERNELS const *selected = 0;
+  return &selected;
+}
+
+// The kernels we're using; the first in the table which the CPU supports,
+// unless FP128_soa_set_isa has chosen others.
+static inline FP128_SOA_KERNELS const *pfp128_soa_kernels(void) {
+  FP128_SOA_KERNELS const **selected = pfp128_soa_selected();
+  if (!*selected) {
+    size_t k = 0;
+    while (!pfp128_soa_supported(k))
+      k++;
+    *selected = &pfp128_soa_kernel_table[k];
+  }
+  return *selected;
+}
+
+// The name of the implementation in use ("avx512", "avx2" or "scalar").
+static inline char const *FP128_soa_isa(void) {
+  return pfp128_soa_kernels()->name;
+}
+
+// Choose an implementation by name (e.g. to compare them). Returns zero on
+// success, or -1 if there is no such implementation or the CPU can't run it.
+static inline int FP128_soa_set_isa(char const *name) {
+  for (size_t k = 0; k < PFP128_SOA_NUM_KERNELS; k++)
+    if (strcmp(pfp128_soa_kernel_table[k].name, name) == 0 &&
+        pfp128_soa_supported(k)) {
+      *pfp128_soa_selected() = &pfp128_soa_kernel_table[k];
+      return 0;
+    }
+  return -1;
+}
+
+// The operations, on the first r->n elements of each operand. The result may
+// be the same FP128_SOA as an operand.
+static inline void FP128_soa_add(FP128_SOA *r, FP128_SOA const *a,
+                                 FP128_SOA const *b) {
+  pfp128_soa_kernels()->add(r->hi, r->lo, a->hi, a->lo, b->hi, b->lo, r->n);
+}
+
+static inline void FP128_soa_mul(FP128_SOA *r, FP128_SOA const *a,
+                                 FP128_SOA const *b) {
+  pfp128_soa_kernels()->mul(r->hi, r->lo, a->hi, a->lo, b->hi, b->lo, r->n);
+}
+
+// r = a * b + c, with a single rounding.
+static inline void FP128_soa_fma(FP128_SOA *r, FP128_SOA const *a,
+                                 FP128_SOA const *b, FP128_SOA const *c) {
+  pfp128_soa_kernels()->fma(r->hi, r->lo, a->hi, a->lo, b->hi, b->lo, c->hi,
+                            c->lo, r->n);
+}
+
+static inline void FP128_soa_from_double(FP128_SOA *r, double const *d) {
+  pfp128_soa_kernels()->from_double(r->hi, r->lo, d, r->n);
+}
+
+static inline void FP128_soa_to_double(double *d, FP128_SOA const *a) {
+  pfp128_soa_kernels()->to_double(d, a->hi, a->lo, a->n);
+}
+
+// Cleanliness
+#undef PFP128_SIMD_X86
+#undef PFP128_SOA_NUM_KERNELS
+
+#endif // Header monotonicity
@@ -0,0 +1,478 @@
+//===-- pfp128_simd_impl.h - Vector kernels for pfp128_simd.h
+//--------------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * The vector implementation of the structure of arrays binary128 kernels.
+ * This is a template: pfp128_simd.h includes it once for each instruction
+ * set, having defined
+ *   PFP128_SIMD_V          the vector of uint64_t type (GCC vector extension)
+ *   PFP128_SIMD_LANES      the number of lanes in it
+ *   PFP128_SIMD_TARGET     the target attribute for the functions
+ *   PFP128_SIMD_FN(name)   how to decorate the names of the functions
+ *   PFP128_SIMD_MUL32(a,b) the 32x32 => 64 bit unsigned multiply of the low
+ *                          halves of each lane
+ * so there is deliberately no include guard.
+ *
+ * Each kernel handles the common case (normal operands and a normal result)
+ * in the vector registers, and notes the lanes which need anything else
+ * (zeros, subnormals, infinities, NaNs, overflow and underflow) so that they
+ * can then be recomputed with the scalar code from pfp128_soft.h. Since
+ * both are correctly rounded, the results are the same as the scalar
+ * fallback bit for bit.
+ */
+#define V PFP128_SIMD_V
+#define FN PFP128_SIMD_FN
+#define TGT PFP128_SIMD_TARGET
+
+// The constants we need, in the high 64 bits of a binary128.
+#define SIMD_SIGN UINT64_C(0x8000000000000000)
+#define SIMD_ABS UINT64_C(0x7fffffffffffffff)
+#define SIMD_MANT UINT64_C(0x0000ffffffffffff)
+#define SIMD_IMPLICIT UINT64_C(0x0001000000000000)
+#define SIMD_LOW32 UINT64_C(0xffffffff)
+
+typedef struct {
+  V w[4]; // Least significant first.
+} FN(u256);
+
+static inline TGT V FN(load)(uint64_t const *p) {
+  V v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+static inline TGT void FN(store)(uint64_t *p, V v) {
+  memcpy(p, &v, sizeof(v));
+}
+
+// All ones in the lanes where m is, otherwise zeros; i.e. a mask.
+static inline TGT V FN(mask)(V m) { return (V)(m != 0); }
+static inline TGT V FN(ltu)(V a, V b) { return (V)(a < b); }
+static inline TGT V FN(eq)(V a, V b) { return (V)(a == b); }
+static inline TGT V FN(sel)(V m, V a, V b) { return (a & m) | (b & ~m); }
+static inline TGT int FN(any)(V m) {
+  uint64_t lanes[PFP128_SIMD_LANES];
+  uint64_t r = 0;
+  memcpy(lanes, &m, sizeof(lanes));
+  for (int i = 0; i < PFP128_SIMD_LANES; i++)
+    r |= lanes[i];
+  return r != 0;
+}
+
+// Count leading zeros in each lane (64 for zero), by binary search.
+static inline TGT V FN(clz64)(V x) {
+  V zero = x - x, n = zero;
+  V isZero = FN(eq)(x, zero);
+  for (int k = 32; k > 0; k >>= 1) {
+    V m = FN(eq)(x >> (64 - k), zero);
+    n += m & (uint64_t)k;
+    x = FN(sel)(m, x << k, x);
+  }
+  return FN(sel)(isZero, isZero & 64, n);
+}
+
+// Shift a 256 bit value right, ORing any bits shifted out into bit 0.
+// Any count (including >= 256) is fine.
+static inline TGT FN(u256) FN(shr256_sticky)(FN(u256) a, V n) {
+  V zero = n - n;
+  V lost = zero;
+  V m = FN(mask)(n & 64);
+  lost |= a.w[0] & m;
+  a.w[0] = FN(sel)(m, a.w[1], a.w[0]);
+  a.w[1] = FN(sel)(m, a.w[2], a.w[1]);
+  a.w[2] = FN(sel)(m, a.w[3], a.w[2]);
+  a.w[3] = FN(sel)(m, zero, a.w[3]);
+  m = FN(mask)(n & 128);
+  lost |= (a.w[0] | a.w[1]) & m;
+  a.w[0] = FN(sel)(m, a.w[2], a.w[0]);
+  a.w[1] = FN(sel)(m, a.w[3], a.w[1]);
+  a.w[2] = FN(sel)(m, zero, a.w[2]);
+  a.w[3] = FN(sel)(m, zero, a.w[3]);
+  // (x << (63 - s)) << 1, rather than x << (64 - s), since s may be zero.
+  V s = n & 63, t = 63 - s;
+  lost |= (a.w[0] << t) << 1;
+  a.w[0] = (a.w[0] >> s) | ((a.w[1] << t) << 1);
+  a.w[1] = (a.w[1] >> s) | ((a.w[2] << t) << 1);
+  a.w[2] = (a.w[2] >> s) | ((a.w[3] << t) << 1);
+  a.w[3] = a.w[3] >> s;
+  m = ~FN(ltu)(n, zero + 256);
+  lost |= (a.w[0] | a.w[1] | a.w[2] | a.w[3]) & m;
+  for (int i = 0; i < 4; i++)
+    a.w[i] = FN(sel)(m, zero, a.w[i]);
+  a.w[0] |= FN(mask)(lost) & 1;
+  return a;
+}
+
+// Shift a 256 bit value left by n < 256.
+static inline TGT FN(u256) FN(shl256)(FN(u256) a, V n) {
+  V zero = n - n;
+  V m = FN(mask)(n & 64);
+  a.w[3] = FN(sel)(m, a.w[2], a.w[3]);
+  a.w[2] = FN(sel)(m, a.w[1], a.w[2]);
+  a.w[1] = FN(sel)(m, a.w[0], a.w[1]);
+  a.w[0] = FN(sel)(m, zero, a.w[0]);
+  m = FN(mask)(n & 128);
+  a.w[3] = FN(sel)(m, a.w[1], a.w[3]);
+  a.w[2] = FN(sel)(m, a.w[0], a.w[2]);
+  a.w[1] = FN(sel)(m, zero, a.w[1]);
+  a.w[0] = FN(sel)(m, zero, a.w[0]);
+  V s = n & 63, t = 63 - s;
+  a.w[3] = (a.w[3] << s) | ((a.w[2] >> t) >> 1);
+  a.w[2] = (a.w[2] << s) | ((a.w[1] >> t) >> 1);
+  a.w[1] = (a.w[1] << s) | ((a.w[0] >> t) >> 1);
+  a.w[0] = a.w[0] << s;
+  return a;
+}
+
+// Leading zeros of a (non-zero) 256 bit value.
+static inline TGT V FN(clz256)(FN(u256) a) {
+  V zero = a.w[0] - a.w[0];
+  V top = a.w[3], base = zero;
+  for (int i = 2; i >= 0; i--) {
+    V m = FN(eq)(top, zero);
+    top = FN(sel)(m, a.w[i], top);
+    base += m & 64;
+  }
+  return base + FN(clz64)(top);
+}
+
+static inline TGT FN(u256) FN(add256)(FN(u256) a, FN(u256) b) {
+  V carry = a.w[0] - a.w[0];
+  for (int i = 0; i < 4; i++) {
+    V s = a.w[i] + b.w[i];
+    V c = FN(ltu)(s, a.w[i]);
+    a.w[i] = s - carry; // carry is 0 or all ones
+    c |= FN(eq)(a.w[i], carry - carry) & carry;
+    carry = c;
+  }
+  return a;
+}
+
+static inline TGT FN(u256) FN(sub256)(FN(u256) a, FN(u256) b) {
+  V borrow = a.w[0] - a.w[0];
+  for (int i = 0; i < 4; i++) {
+    V d = a.w[i] - b.w[i];
+    V c = FN(ltu)(a.w[i], b.w[i]);
+    c |= FN(eq)(d, borrow - borrow) & borrow;
+    a.w[i] = d + borrow; // borrow is 0 or all ones
+    borrow = c;
+  }
+  return a;
+}
+
+static inline TGT V FN(lt256)(FN(u256) a, FN(u256) b) {
+  V lt = FN(ltu)(a.w[0], b.w[0]);
+  for (int i = 1; i < 4; i++)
+    lt = FN(ltu)(a.w[i], b.w[i]) | (FN(eq)(a.w[i], b.w[i]) & lt);
+  return lt;
+}
+
+// The exact 226 bit product of two 113 bit significands, each split into
+// the high (49 bit) and low (64 bit) words, using 32x32 bit multiplies.
+static inline TGT FN(u256) FN(mul_sig)(V ah, V al, V bh, V bl) {
+  V a[4] = {al & SIMD_LOW32, al >> 32, ah & SIMD_LOW32, ah >> 32};
+  V b[4] = {bl & SIMD_LOW32, bl >> 32, bh & SIMD_LOW32, bh >> 32};
+  V col[8];
+  for (int k = 0; k < 8; k++)
+    col[k] = al - al;
+  // Each column sums at most eight 32 bit values, so can't overflow.
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++) {
+      V p = PFP128_SIMD_MUL32(a[i], b[j]);
+      col[i + j] += p & SIMD_LOW32;
+      col[i + j + 1] += p >> 32;
+    }
+  FN(u256) r;
+  V carry = al - al;
+  for (int k = 0; k < 8; k += 2) {
+    V lo = col[k] + carry;
+    V hi = col[k + 1] + (lo >> 32);
+    r.w[k / 2] = (lo & SIMD_LOW32) | (hi << 32);
+    carry = hi >> 32;
+  }
+  return r;
+}
+
+// Round and pack, as sq_round_pack, for a sig (with its leading bit at bit
+// 115) and exponent which give a normal result. Lanes with an exponent out
+// of range are added to *bad.
+static inline TGT void FN(round_pack)(V sign, V exp, V sh, V sl, V *rh,
+                                       V *rl, V *bad) {
+  *bad |= ~FN(ltu)(exp - 1, exp - exp + 0x7ffe);
+  V rgs = sl & 7;
+  V lo = (sl >> 3) | (sh << 61);
+  V hi = sign | (exp << 48) | ((sh >> 3) & SIMD_MANT);
+  V four = rgs - rgs + 4;
+  V inc = (FN(ltu)(four, rgs) | (FN(eq)(rgs, four) & lo)) & 1;
+  lo += inc;
+  hi += FN(eq)(lo, lo - lo) & inc;
+  *rh = hi;
+  *rl = lo;
+}
+
+// Lanes whose biased exponent is zero or all ones, i.e. zeros, subnormals,
+// infinities and NaNs.
+static inline TGT V FN(special)(V hi) {
+  V e = (hi >> 48) & 0x7fff;
+  return ~FN(ltu)(e - 1, e - e + 0x7ffe);
+}
+
+static inline TGT void FN(add)(V ah, V al, V bh, V bl, V *rh, V *rl,
+                                V *bad) {
+  V zero = ah - ah;
+  *bad = FN(special)(ah) | FN(special)(bh);
+  // Order by magnitude.
+  V aAbs = ah & SIMD_ABS, bAbs = bh & SIMD_ABS;
+  V swap = FN(ltu)(aAbs, bAbs) | (FN(eq)(aAbs, bAbs) & FN(ltu)(al, bl));
+  V xh = FN(sel)(swap, bh, ah), xl = FN(sel)(swap, bl, al);
+  V yh = FN(sel)(swap, ah, bh), yl = FN(sel)(swap, al, bl);
+  V xExp = (xh >> 48) & 0x7fff, yExp = (yh >> 48) & 0x7fff;
+  // Significands, with three extra bits at the bottom, as 256 bit values
+  // so that we can use the shifts above.
+  FN(u256) x, y;
+  V mh = (xh & SIMD_MANT) | SIMD_IMPLICIT;
+  x.w[0] = xl << 3;
+  x.w[1] = (mh << 3) | (xl >> 61);
+  x.w[2] = x.w[3] = zero;
+  mh = (yh & SIMD_MANT) | SIMD_IMPLICIT;
+  y.w[0] = yl << 3;
+  y.w[1] = (mh << 3) | (yl >> 61);
+  y.w[2] = y.w[3] = zero;
+  y = FN(shr256_sticky)(y, xExp - yExp);
+
+  V subtract = FN(mask)((ah ^ bh) & SIMD_SIGN);
+  // Addition: at most one bit of carry.
+  FN(u256) s = FN(add256)(x, y);
+  V carry = (s.w[1] >> 52) & 1;
+  V sl = (s.w[0] >> carry) | (s.w[1] << (63 - carry) << 1) | (s.w[0] & carry);
+  V sh = s.w[1] >> carry;
+  V sExp = xExp + carry;
+  // Subtraction: exact, but may need normalising.
+  FN(u256) d = FN(sub256)(x, y);
+  V isZero = FN(eq)(d.w[0] | d.w[1], zero);
+  V shift = FN(clz256)(d) - 140;
+  shift = FN(sel)(isZero, zero, shift);
+  d = FN(shl256)(d, shift);
+  V dExp = xExp - shift;
+
+  V exp = FN(sel)(subtract, dExp, sExp);
+  sh = FN(sel)(subtract, d.w[1], sh);
+  sl = FN(sel)(subtract, d.w[0], sl);
+  V bad2 = zero;
+  FN(round_pack)(xh & SIMD_SIGN, exp, sh, sl, rh, rl, &bad2);
+  // Exact cancellation gives +0.
+  V cancelled = subtract & isZero;
+  *rh = FN(sel)(cancelled, zero, *rh);
+  *rl = FN(sel)(cancelled, zero, *rl);
+  *bad |= bad2 & ~cancelled;
+}
+
+static inline TGT void FN(mul)(V ah, V al, V bh, V bl, V *rh, V *rl,
+                                V *bad) {
+  *bad = FN(special)(ah) | FN(special)(bh);
+  V aExp = (ah >> 48) & 0x7fff, bExp = (bh >> 48) & 0x7fff;
+  FN(u256) p = FN(mul_sig)((ah & SIMD_MANT) | SIMD_IMPLICIT, al,
+                           (bh & SIMD_MANT) | SIMD_IMPLICIT, bl);
+  // The product is in [2^224, 2^226); keep 116 bits of it.
+  V top = (p.w[3] >> 33) & 1;
+  V s = 45 + top, t = 19 - top;
+  V sl = (p.w[1] >> s) | (p.w[2] << t);
+  V sh = (p.w[2] >> s) | (p.w[3] << t);
+  sl |= FN(mask)(p.w[0] | (p.w[1] << t)) & 1;
+  FN(round_pack)((ah ^ bh) & SIMD_SIGN, aExp + bExp - 16383 + top, sh, sl,
+                 rh, rl, bad);
+}
+
+static inline TGT void FN(fma)(V ah, V al, V bh, V bl, V ch, V cl, V *rh,
+                                V *rl, V *bad) {
+  V zero = ah - ah;
+  *bad = FN(special)(ah) | FN(special)(bh) | FN(special)(ch);
+  V aExp = (ah >> 48) & 0x7fff, bExp = (bh >> 48) & 0x7fff;
+  V cExp = (ch >> 48) & 0x7fff;
+  // As in fmasq: the product shifted left by three has its leading bit at
+  // 227 or 228, and we put c's at 227.
+  FN(u256) x = FN(mul_sig)((ah & SIMD_MANT) | SIMD_IMPLICIT, al,
+                           (bh & SIMD_MANT) | SIMD_IMPLICIT, bl);
+  x = FN(shl256)(x, zero + 3);
+  V xExp = aExp + bExp;
+  V xSign = (ah ^ bh) & SIMD_SIGN;
+  FN(u256) y;
+  V mh = (ch & SIMD_MANT) | SIMD_IMPLICIT;
+  y.w[0] = zero;
+  y.w[1] = cl << 51;
+  y.w[2] = (cl >> 13) | (mh << 51);
+  y.w[3] = mh >> 13;
+  V yExp = cExp + 16383;
+  V ySign = ch & SIMD_SIGN;
+
+  V swap = FN(ltu)(xExp, yExp) | (FN(eq)(xExp, yExp) & FN(lt256)(x, y));
+  FN(u256) t;
+  for (int i = 0; i < 4; i++) {
+    t.w[i] = FN(sel)(swap, y.w[i], x.w[i]);
+    y.w[i] = FN(sel)(swap, x.w[i], y.w[i]);
+  }
+  x = t;
+  V e = FN(sel)(swap, yExp, xExp);
+  yExp = FN(sel)(swap, xExp, yExp);
+  xExp = e;
+  V subtract = FN(mask)(xSign ^ ySign);
+  V sign = FN(sel)(swap, ySign, xSign);
+  ySign = FN(sel)(swap, xSign, ySign);
+  // Now x's exponent is at least as large as y's, and y only loses bits
+  // (into the sticky bit) if it is less than half x, so at most one bit
+  // cancels. (x may still be smaller than y, by less than a factor of two.)
+  y = FN(shr256_sticky)(y, xExp - yExp);
+  FN(u256) s = FN(add256)(x, y);
+  V less = FN(lt256)(x, y);
+  FN(u256) d = FN(sub256)(x, y);
+  FN(u256) dr = FN(sub256)(y, x);
+  for (int i = 0; i < 4; i++)
+    s.w[i] = FN(sel)(subtract, FN(sel)(less, dr.w[i], d.w[i]), s.w[i]);
+  sign = FN(sel)(subtract & less, ySign, sign);
+  V isZero = FN(eq)(s.w[0] | s.w[1] | s.w[2] | s.w[3], zero);
+  // Normalise so that the leading bit is at 115.
+  V lead = 255 - FN(clz256)(s);
+  V right = FN(ltu)(zero + 115, lead);
+  FN(u256) r = FN(shr256_sticky)(s, FN(sel)(right, lead - 115, zero));
+  r = FN(shl256)(r, FN(sel)(right, zero, (115 - lead) & 255));
+  V bad2 = zero;
+  FN(round_pack)(sign, xExp - 16383 - 227 + lead, r.w[1], r.w[0], rh, rl,
+                 &bad2);
+  *rh = FN(sel)(isZero, zero, *rh);
+  *rl = FN(sel)(isZero, zero, *rl);
+  *bad |= bad2 & ~isZero;
+}
+
+// Conversions. Zeros are handled here too, since they are common.
+static inline TGT void FN(from_double)(V d, V *rh, V *rl, V *bad) {
+  V zero = d - d;
+  V exp = (d >> 52) & 0x7ff;
+  V mant = d & UINT64_C(0x000fffffffffffff);
+  V sign = d & SIMD_SIGN;
+  V isZero = FN(eq)(d & SIMD_ABS, zero);
+  *bad = ~isZero & ~FN(ltu)(exp - 1, zero + 0x7fe);
+  *rh = FN(sel)(isZero, sign, sign | ((exp + 16383 - 1023) << 48) | (mant >> 4));
+  *rl = FN(sel)(isZero, zero, mant << 60);
+}
+
+static inline TGT void FN(to_double)(V ah, V al, V *r, V *bad) {
+  V zero = ah - ah;
+  V sign = ah & SIMD_SIGN;
+  V exp = ((ah >> 48) & 0x7fff) + 1023 - 16383; // Wraps if too small.
+  V isZero = FN(eq)((ah & SIMD_ABS) | al, zero);
+  *bad = ~isZero & ~FN(ltu)(exp - 1, zero + 0x7fe);
+  V mant = ((ah & SIMD_MANT) << 4) | (al >> 60);
+  V rest = al & UINT64_C(0x0fffffffffffffff);
+  V half = zero + UINT64_C(0x0800000000000000);
+  V inc = (FN(ltu)(half, rest) | (FN(eq)(rest, half) & mant)) & 1;
+  // A carry out of the mantissa correctly increments the exponent.
+  *r = FN(sel)(isZero, sign, (sign | (exp << 52) | mant) + inc);
+}
+
+// The array kernels. If the vector code can't handle any lane of a vector we
+// recompute the whole vector with the scalar code (before storing anything,
+// so that the output may be the same array as an input). The vector loop is
+// followed by a scalar loop for any leftover elements.
+static TGT void FN(soa_add)(uint64_t *rh, uint64_t *rl, uint64_t const *ah,
+                            uint64_t const *al, uint64_t const *bh,
+                            uint64_t const *bl, size_t n) {
+  size_t i = 0;
+  for (; i + PFP128_SIMD_LANES <= n; i += PFP128_SIMD_LANES) {
+    V h, l, bad;
+    FN(add)(FN(load)(ah + i), FN(load)(al + i), FN(load)(bh + i),
+            FN(load)(bl + i), &h, &l, &bad);
+    if (FN(any)(bad)) {
+      pfp128_soa_add_scalar(rh + i, rl + i, ah + i, al + i, bh + i, bl + i,
+                            PFP128_SIMD_LANES);
+    } else {
+      FN(store)(rh + i, h);
+      FN(store)(rl + i, l);
+    }
+  }
+  pfp128_soa_add_scalar(rh + i, rl + i, ah + i, al + i, bh + i, bl + i, n - i);
+}
+
+static TGT void FN(soa_mul)(uint64_t *rh, uint64_t *rl, uint64_t const *ah,
+                            uint64_t const *al, uint64_t const *bh,
+                            uint64_t const *bl, size_t n) {
+  size_t i = 0;
+  for (; i + PFP128_SIMD_LANES <= n; i += PFP128_SIMD_LANES) {
+    V h, l, bad;
+    FN(mul)(FN(load)(ah + i), FN(load)(al + i), FN(load)(bh + i),
+            FN(load)(bl + i), &h, &l, &bad);
+    if (FN(any)(bad)) {
+      pfp128_soa_mul_scalar(rh + i, rl + i, ah + i, al + i, bh + i, bl + i,
+                            PFP128_SIMD_LANES);
+    } else {
+      FN(store)(rh + i, h);
+      FN(store)(rl + i, l);
+    }
+  }
+  pfp128_soa_mul_scalar(rh + i, rl + i, ah + i, al + i, bh + i, bl + i, n - i);
+}
+
+static TGT void FN(soa_fma)(uint64_t *rh, uint64_t *rl, uint64_t const *ah,
+                            uint64_t const *al, uint64_t const *bh,
+                            uint64_t const *bl, uint64_t const *ch,
+                            uint64_t const *cl, size_t n) {
+  size_t i = 0;
+  for (; i + PFP128_SIMD_LANES <= n; i += PFP128_SIMD_LANES) {
+    V h, l, bad;
+    FN(fma)(FN(load)(ah + i), FN(load)(al + i), FN(load)(bh + i),
+            FN(load)(bl + i), FN(load)(ch + i), FN(load)(cl + i), &h, &l,
+            &bad);
+    if (FN(any)(bad)) {
+      pfp128_soa_fma_scalar(rh + i, rl + i, ah + i, al + i, bh + i, bl + i,
+                            ch + i, cl + i, PFP128_SIMD_LANES);
+    } else {
+      FN(store)(rh + i, h);
+      FN(store)(rl + i, l);
+    }
+  }
+  pfp128_soa_fma_scalar(rh + i, rl + i, ah + i, al + i, bh + i, bl + i, ch + i,
+                        cl + i, n - i);
+}
+
+static TGT void FN(soa_from_double)(uint64_t *rh, uint64_t *rl,
+                                    double const *d, size_t n) {
+  size_t i = 0;
+  for (; i + PFP128_SIMD_LANES <= n; i += PFP128_SIMD_LANES) {
+    V dv, h, l, bad;
+    memcpy(&dv, d + i, sizeof(dv));
+    FN(from_double)(dv, &h, &l, &bad);
+    if (FN(any)(bad)) {
+      pfp128_soa_from_double_scalar(rh + i, rl + i, d + i, PFP128_SIMD_LANES);
+    } else {
+      FN(store)(rh + i, h);
+      FN(store)(rl + i, l);
+    }
+  }
+  pfp128_soa_from_double_scalar(rh + i, rl + i, d + i, n - i);
+}
+
+static TGT void FN(soa_to_double)(double *d, uint64_t const *ah,
+                                  uint64_t const *al, size_t n) {
+  size_t i = 0;
+  for (; i + PFP128_SIMD_LANES <= n; i += PFP128_SIMD_LANES) {
+    V r, bad;
+    FN(to_double)(FN(load)(ah + i), FN(load)(al + i), &r, &bad);
+    if (FN(any)(bad))
+      pfp128_soa_to_double_scalar(d + i, ah + i, al + i, PFP128_SIMD_LANES);
+    else
+      memcpy(d + i, &r, sizeof(r));
+  }
+  pfp128_soa_to_double_scalar(d + i, ah + i, al + i, n - i);
+}
+
+#undef V
+#undef FN
+#undef TGT
+#undef SIMD_SIGN
+#undef SIMD_ABS
+#undef SIMD_MANT
+#undef SIMD_IMPLICIT
+#undef SIMD_LOW32
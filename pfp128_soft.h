@@ -0,0 +1,985 @@
+//===-- pfp128_soft.h - Inlinable software IEEE binary128 arithmetic
+//--------------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * A software implementation of IEEE binary128 arithmetic which works directly
+ * on the 128 bit representation. On machines without quad precision hardware
+ * the compiler turns each operator on a __float128 (or binary128 long double)
+ * into an out of line call to a runtime library routine (__addtf3, __multf3,
+ * ...) which handles every special case on every call, and which the
+ * optimiser can neither inline nor schedule around. Everything here is static
+ * inline, and the common case (finite, non-zero operands) is a short, mostly
+ * branch free, path, with zeros, infinities and NaNs handled separately.
+ *
+ * Results are correctly rounded (round to nearest, ties to even), so they are
+ * bit identical to those from any IEEE conforming implementation, other than
+ * the payload of NaN results. The floating point exception flags are not
+ * raised, and the dynamic rounding mode is ignored.
+ *
+ * The functions use an "sq" (software quad) suffix (addsq, sqrtsq, ...), in
+ * the same way as the q suffixed libquadmath functions. pfp128.h uses them for
+ * addFP128 and friends when compiled with PFP128_INLINE_ARITHMETIC, but this
+ * header can also be used on its own.
+ *
+ * We need a compiler which provides unsigned __int128 (GCC and LLVM do on all
+ * 64b targets).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_SOFT_H_INCLUDED_))
+#define _PFP128_SOFT_H_INCLUDED_ 1
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (!defined(__SIZEOF_INT128__))
+#error pfp128_soft.h needs a compiler which supports unsigned __int128.
+#endif
+
+__extension__ typedef unsigned __int128 sq_u128;
+
+// A struct, rather than the bare integer, so that we can't accidentally use
+// integer arithmetic on it.
+typedef struct {
+  sq_u128 bits;
+} FP128SQ;
+
+#define SQ_SIGN_BIT ((sq_u128)1 << 127)
+#define SQ_ABS_MASK (SQ_SIGN_BIT - 1)
+#define SQ_IMPLICIT_BIT ((sq_u128)1 << 112)
+#define SQ_MANT_MASK (SQ_IMPLICIT_BIT - 1)
+#define SQ_QUIET_BIT ((sq_u128)1 << 111)
+#define SQ_EXP_MAX 0x7fff
+#define SQ_BIAS 16383
+#define SQ_INF_BITS ((sq_u128)SQ_EXP_MAX << 112)
+// The NaN generated by invalid operations is negative on x86, and positive
+// elsewhere.
+#if (defined(__x86_64__) || defined(__i386__))
+#define SQ_DEFAULT_NAN_BITS (SQ_SIGN_BIT | SQ_INF_BITS | SQ_QUIET_BIT)
+#else
+#define SQ_DEFAULT_NAN_BITS (SQ_INF_BITS | SQ_QUIET_BIT)
+#endif
+
+#if (defined(__GNUC__))
+#define SQ_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define SQ_UNLIKELY(cond) (cond)
+#endif
+
+// In C++14 (or later) the functions are constexpr, so that constants can be
+// computed at compile time (see pfp128_constexpr.hpp), if the compiler has
+// the builtins we need for that.
+#if (defined(__cplusplus) && __cplusplus >= 201402L && defined(__has_builtin))
+#if (__has_builtin(__builtin_bit_cast) &&                                      \
+     __has_builtin(__builtin_is_constant_evaluated))
+#define SQ_HAVE_CONSTEXPR 1
+#define SQ_CONSTEXPR constexpr
+#define SQ_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if (!defined(SQ_CONSTEXPR))
+#define SQ_HAVE_CONSTEXPR 0
+#define SQ_CONSTEXPR
+#define SQ_IS_CONSTANT_EVALUATED() 0
+#endif
+
+static inline SQ_CONSTEXPR FP128SQ sq_make(sq_u128 bits) {
+  FP128SQ r = {bits};
+  return r;
+}
+
+// Access to the two 64 bit halves of the representation.
+static inline SQ_CONSTEXPR FP128SQ sq_from_halves(uint64_t hi, uint64_t lo) {
+  return sq_make(((sq_u128)hi << 64) | lo);
+}
+static inline SQ_CONSTEXPR uint64_t sq_hi(FP128SQ a) {
+  return (uint64_t)(a.bits >> 64);
+}
+static inline SQ_CONSTEXPR uint64_t sq_lo(FP128SQ a) {
+  return (uint64_t)a.bits;
+}
+
+// Integer helpers.
+// Count leading zeros of a non-zero value.
+static inline SQ_CONSTEXPR int sq_clz(sq_u128 x) {
+  uint64_t hi = (uint64_t)(x >> 64);
+  return hi ? __builtin_clzll(hi) : 64 + __builtin_clzll((uint64_t)x);
+}
+
+// Shift right, ORing any bits shifted out into the least significant bit.
+static inline SQ_CONSTEXPR sq_u128 sq_shr_sticky(sq_u128 x, int n) {
+  if (n <= 0)
+    return x;
+  if (n >= 128)
+    return x != 0;
+  return (x >> n) | ((x << (128 - n)) != 0);
+}
+
+// The full 256 bit product of two 128 bit values.
+static inline SQ_CONSTEXPR void sq_mul_wide(sq_u128 a, sq_u128 b,
+                                            sq_u128 *hi, sq_u128 *lo) {
+  uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+  uint64_t b0 = (uint64_t)b, b1 = (uint64_t)(b >> 64);
+  sq_u128 p00 = (sq_u128)a0 * b0;
+  sq_u128 p01 = (sq_u128)a0 * b1;
+  sq_u128 p10 = (sq_u128)a1 * b0;
+  sq_u128 p11 = (sq_u128)a1 * b1;
+  sq_u128 mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10;
+  *lo = (mid << 64) | (uint64_t)p00;
+  *hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+}
+
+// (hi:lo) / d, where hi < d, so that the quotient fits in 64 bits.
+#if (defined(__x86_64__) && defined(__GNUC__))
+// The compiler won't use the hardware's 128/64 bit divide for this.
+static inline uint64_t sq_div_128_64_hw(uint64_t hi, uint64_t lo, uint64_t d,
+                                        uint64_t *rem) {
+  uint64_t q, r;
+  __asm__("divq %4" : "=a"(q), "=d"(r) : "a"(lo), "d"(hi), "rm"(d));
+  *rem = r;
+  return q;
+}
+#endif
+
+static inline SQ_CONSTEXPR uint64_t sq_div_128_64(uint64_t hi, uint64_t lo,
+                                                  uint64_t d, uint64_t *rem) {
+#if (defined(__x86_64__) && defined(__GNUC__))
+  if (!SQ_IS_CONSTANT_EVALUATED())
+    return sq_div_128_64_hw(hi, lo, d, rem);
+#endif
+  sq_u128 n = ((sq_u128)hi << 64) | lo;
+  uint64_t q = (uint64_t)(n / d);
+  *rem = (uint64_t)(n - (sq_u128)q * d);
+  return q;
+}
+
+// Divide (*u : d) by v, where *u < v and v has its top bit set, returning the
+// 64 bit quotient and leaving the remainder in *u.
+// This is one step of Knuth's algorithm D, with 64 bit digits.
+static inline SQ_CONSTEXPR uint64_t sq_div_digit(sq_u128 *u, uint64_t d,
+                                                 sq_u128 v) {
+  uint64_t v1 = (uint64_t)(v >> 64), v0 = (uint64_t)v;
+  uint64_t u2 = (uint64_t)(*u >> 64), u1 = (uint64_t)*u;
+  uint64_t q = 0;
+  sq_u128 rhat = 0;
+  if (u2 >= v1) {
+    q = ~(uint64_t)0;
+    rhat = ((sq_u128)u2 << 64 | u1) - (sq_u128)q * v1;
+  } else {
+    uint64_t r = 0;
+    q = sq_div_128_64(u2, u1, v1, &r);
+    rhat = r;
+  }
+  while ((rhat >> 64) == 0 && (sq_u128)q * v0 > ((rhat << 64) | d)) {
+    q--;
+    rhat += v1;
+  }
+  // Subtract q * v from (*u : d); the result is in (-v, v).
+  sq_u128 plo = (sq_u128)q * v0;
+  sq_u128 phi = (sq_u128)q * v1 + (plo >> 64);
+  uint64_t rlo = d - (uint64_t)plo;
+  unsigned borrow = d < (uint64_t)plo;
+  int negative = *u < phi || (*u == phi && borrow);
+  sq_u128 rhi = *u - phi - borrow;
+  if (negative) {
+    q--;
+    uint64_t s = rlo + v0;
+    rhi += v1 + (sq_u128)(s < rlo);
+    rlo = s;
+  }
+  *u = (rhi << 64) | rlo;
+  return q;
+}
+
+// Round and pack a result.
+// The value is sig * 2^(exp - SQ_BIAS - 115); a normalised sig has its leading
+// bit at bit 115 (so there are three bits below the final mantissa, the last
+// of which is sticky). An exp <= 0 gives a subnormal (or zero) result.
+static inline SQ_CONSTEXPR FP128SQ sq_round_pack(sq_u128 sign, int32_t exp,
+                                                 sq_u128 sig) {
+  if (exp >= SQ_EXP_MAX)
+    return sq_make(sign | SQ_INF_BITS);
+  if (exp <= 0) {
+    sig = sq_shr_sticky(sig, 1 - exp);
+    exp = 0;
+  }
+  unsigned rgs = (unsigned)sig & 7;
+  sq_u128 r = ((sig >> 3) & SQ_MANT_MASK) | ((sq_u128)exp << 112);
+  // Round to nearest, ties to even. A carry out of the mantissa correctly
+  // increments the exponent (and can give infinity).
+  r += (rgs > 4) | ((rgs == 4) & (unsigned)r);
+  return sq_make(sign | r);
+}
+
+// Split a finite non-zero absolute value into exponent and mantissa (with
+// the implicit bit), normalising subnormals.
+static inline SQ_CONSTEXPR sq_u128 sq_unpack(sq_u128 abs, int32_t *exp) {
+  int32_t e = (int32_t)(abs >> 112);
+  sq_u128 m = abs & SQ_MANT_MASK;
+  if (SQ_UNLIKELY(e == 0)) {
+    int shift = sq_clz(m) - 15;
+    *exp = 1 - shift;
+    return m << shift;
+  }
+  *exp = e;
+  return m | SQ_IMPLICIT_BIT;
+}
+
+// Classification.
+static inline SQ_CONSTEXPR int isnansq(FP128SQ a) {
+  return (a.bits & SQ_ABS_MASK) > SQ_INF_BITS;
+}
+static inline SQ_CONSTEXPR int isinfsq(FP128SQ a) {
+  return (a.bits & SQ_ABS_MASK) == SQ_INF_BITS;
+}
+static inline SQ_CONSTEXPR int isfinitesq(FP128SQ a) {
+  return (a.bits & SQ_ABS_MASK) < SQ_INF_BITS;
+}
+static inline SQ_CONSTEXPR int signbitsq(FP128SQ a) {
+  return (int)(a.bits >> 127);
+}
+
+// Pick the NaN to return from an operation with (at least) one NaN operand.
+// Like libgcc we prefer the first, unless it is quiet and the second is
+// signalling. The result is always quiet.
+static inline SQ_CONSTEXPR FP128SQ sq_propagate_nan(sq_u128 a, sq_u128 b) {
+  int aNaN = (a & SQ_ABS_MASK) > SQ_INF_BITS;
+  int bNaN = (b & SQ_ABS_MASK) > SQ_INF_BITS;
+  sq_u128 r = a;
+  if (!aNaN || (bNaN && (a & SQ_QUIET_BIT) && !(b & SQ_QUIET_BIT)))
+    r = b;
+  return sq_make(r | SQ_QUIET_BIT);
+}
+
+// Basic arithmetic.
+static inline SQ_CONSTEXPR FP128SQ negsq(FP128SQ a) {
+  return sq_make(a.bits ^ SQ_SIGN_BIT);
+}
+static inline SQ_CONSTEXPR FP128SQ fabssq(FP128SQ a) {
+  return sq_make(a.bits & SQ_ABS_MASK);
+}
+
+static inline SQ_CONSTEXPR FP128SQ sq_add_special(FP128SQ a, FP128SQ b) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  if (aAbs > SQ_INF_BITS || bAbs > SQ_INF_BITS)
+    return sq_propagate_nan(a.bits, b.bits);
+  if (aAbs == SQ_INF_BITS) {
+    if (bAbs == SQ_INF_BITS && (a.bits ^ b.bits) & SQ_SIGN_BIT)
+      return sq_make(SQ_DEFAULT_NAN_BITS);
+    return a;
+  }
+  if (bAbs == SQ_INF_BITS)
+    return b;
+  if (aAbs == 0)
+    // -0 + -0 is the only way to get -0.
+    return bAbs == 0 ? sq_make(a.bits & b.bits) : b;
+  return a;
+}
+
+static inline SQ_CONSTEXPR FP128SQ addsq(FP128SQ a, FP128SQ b) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  // Zero, infinity or NaN? (Subnormals are fine here.)
+  if (SQ_UNLIKELY(aAbs - 1 >= SQ_INF_BITS - 1 || bAbs - 1 >= SQ_INF_BITS - 1))
+    return sq_add_special(a, b);
+  if (bAbs > aAbs) {
+    FP128SQ t = a;
+    a = b;
+    b = t;
+    sq_u128 u = aAbs;
+    aAbs = bAbs;
+    bAbs = u;
+  }
+  // Subnormals have an exponent of one, but no implicit bit.
+  int32_t aExp = (int32_t)(aAbs >> 112), bExp = (int32_t)(bAbs >> 112);
+  sq_u128 aSig = (aAbs & SQ_MANT_MASK) | ((sq_u128)(aExp != 0) << 112);
+  sq_u128 bSig = (bAbs & SQ_MANT_MASK) | ((sq_u128)(bExp != 0) << 112);
+  aExp += aExp == 0;
+  bExp += bExp == 0;
+  aSig <<= 3;
+  bSig = sq_shr_sticky(bSig << 3, aExp - bExp);
+
+  if ((a.bits ^ b.bits) & SQ_SIGN_BIT) {
+    aSig -= bSig;
+    if (aSig == 0)
+      return sq_make(0);
+  } else {
+    aSig += bSig;
+    if (aSig >> 116) {
+      aSig = (aSig >> 1) | (aSig & 1);
+      aExp++;
+    }
+  }
+  // Cancellation (or two subnormals); only exact bits are shifted in.
+  if (aSig < (SQ_IMPLICIT_BIT << 3)) {
+    int shift = sq_clz(aSig) - 12;
+    aSig <<= shift;
+    aExp -= shift;
+  }
+  return sq_round_pack(a.bits & SQ_SIGN_BIT, aExp, aSig);
+}
+
+static inline SQ_CONSTEXPR FP128SQ subsq(FP128SQ a, FP128SQ b) {
+  // Don't change the sign of a NaN.
+  if ((b.bits & SQ_ABS_MASK) <= SQ_INF_BITS)
+    b.bits ^= SQ_SIGN_BIT;
+  return addsq(a, b);
+}
+
+static inline SQ_CONSTEXPR FP128SQ sq_mul_special(FP128SQ a, FP128SQ b) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 sign = (a.bits ^ b.bits) & SQ_SIGN_BIT;
+  if (aAbs > SQ_INF_BITS || bAbs > SQ_INF_BITS)
+    return sq_propagate_nan(a.bits, b.bits);
+  if (aAbs == SQ_INF_BITS || bAbs == SQ_INF_BITS)
+    return sq_make(aAbs == 0 || bAbs == 0 ? SQ_DEFAULT_NAN_BITS
+                                          : sign | SQ_INF_BITS);
+  // At least one zero.
+  return sq_make(sign);
+}
+
+static inline SQ_CONSTEXPR FP128SQ mulsq(FP128SQ a, FP128SQ b) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 sign = (a.bits ^ b.bits) & SQ_SIGN_BIT;
+  if (SQ_UNLIKELY(aAbs - 1 >= SQ_INF_BITS - 1 || bAbs - 1 >= SQ_INF_BITS - 1))
+    return sq_mul_special(a, b);
+  int32_t aExp = 0, bExp = 0;
+  sq_u128 aSig = sq_unpack(aAbs, &aExp);
+  sq_u128 bSig = sq_unpack(bAbs, &bExp);
+
+  // The product is in [2^224, 2^226); keep 116 bits of it.
+  sq_u128 hi = 0, lo = 0;
+  sq_mul_wide(aSig, bSig, &hi, &lo);
+  int top = (int)(hi >> 97);
+  int shift = 109 + top;
+  sq_u128 sig =
+      (hi << (128 - shift)) | (lo >> shift) | ((lo << (128 - shift)) != 0);
+  return sq_round_pack(sign, aExp + bExp - SQ_BIAS + top, sig);
+}
+
+static inline SQ_CONSTEXPR FP128SQ sq_div_special(FP128SQ a, FP128SQ b) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 sign = (a.bits ^ b.bits) & SQ_SIGN_BIT;
+  if (aAbs > SQ_INF_BITS || bAbs > SQ_INF_BITS)
+    return sq_propagate_nan(a.bits, b.bits);
+  if (aAbs == SQ_INF_BITS)
+    return sq_make(bAbs == SQ_INF_BITS ? SQ_DEFAULT_NAN_BITS
+                                       : sign | SQ_INF_BITS);
+  if (bAbs == SQ_INF_BITS)
+    return sq_make(sign);
+  if (bAbs == 0)
+    return sq_make(aAbs == 0 ? SQ_DEFAULT_NAN_BITS : sign | SQ_INF_BITS);
+  // a is zero.
+  return sq_make(sign);
+}
+
+static inline SQ_CONSTEXPR FP128SQ divsq(FP128SQ a, FP128SQ b) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 sign = (a.bits ^ b.bits) & SQ_SIGN_BIT;
+  if (SQ_UNLIKELY(aAbs - 1 >= SQ_INF_BITS - 1 || bAbs - 1 >= SQ_INF_BITS - 1))
+    return sq_div_special(a, b);
+  int32_t aExp = 0, bExp = 0;
+  sq_u128 aSig = sq_unpack(aAbs, &aExp);
+  sq_u128 bSig = sq_unpack(bAbs, &bExp);
+
+  // q = floor(aSig * 2^116 / bSig), which is in (2^115, 2^117). We divide
+  // aSig * 2^131 by bSig * 2^15 so that the divisor is normalised.
+  sq_u128 rem = aSig << 3;
+  sq_u128 v = bSig << 15;
+  uint64_t q1 = sq_div_digit(&rem, 0, v);
+  uint64_t q0 = sq_div_digit(&rem, 0, v);
+  sq_u128 q = ((sq_u128)q1 << 64) | q0;
+  int top = (int)(q >> 116);
+  q = (q >> top) | (q & top) | (rem != 0);
+  return sq_round_pack(sign, aExp - bExp + SQ_BIAS - 1 + top, q);
+}
+
+// 256 bit helpers for fma and sqrt.
+typedef struct {
+  sq_u128 hi, lo;
+} sq_u256;
+
+static inline SQ_CONSTEXPR int sq_lt256(sq_u256 a, sq_u256 b) {
+  return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+static inline SQ_CONSTEXPR sq_u256 sq_add256(sq_u256 a, sq_u256 b) {
+  sq_u256 r = {0, 0};
+  r.lo = a.lo + b.lo;
+  r.hi = a.hi + b.hi + (r.lo < a.lo);
+  return r;
+}
+
+static inline SQ_CONSTEXPR sq_u256 sq_sub256(sq_u256 a, sq_u256 b) {
+  sq_u256 r = {0, 0};
+  r.lo = a.lo - b.lo;
+  r.hi = a.hi - b.hi - (a.lo < b.lo);
+  return r;
+}
+
+static inline SQ_CONSTEXPR sq_u256 sq_shl256(sq_u256 a, int n) {
+  if (n == 0)
+    return a;
+  if (n >= 128) {
+    a.hi = a.lo << (n - 128);
+    a.lo = 0;
+  } else {
+    a.hi = (a.hi << n) | (a.lo >> (128 - n));
+    a.lo <<= n;
+  }
+  return a;
+}
+
+static inline SQ_CONSTEXPR sq_u256 sq_shr256_sticky(sq_u256 a, int n) {
+  if (n <= 0)
+    return a;
+  if (n >= 256) {
+    a.lo = (a.hi | a.lo) != 0;
+    a.hi = 0;
+  } else if (n >= 128) {
+    a.lo = sq_shr_sticky(a.hi, n - 128) | (a.lo != 0);
+    a.hi = 0;
+  } else {
+    a.lo = (a.hi << (128 - n)) | (a.lo >> n) | ((a.lo << (128 - n)) != 0);
+    a.hi >>= n;
+  }
+  return a;
+}
+
+static inline SQ_CONSTEXPR int sq_clz256(sq_u256 a) {
+  return a.hi ? sq_clz(a.hi) : 128 + sq_clz(a.lo);
+}
+
+// Reduce a non-zero 256 bit value to a sig for sq_round_pack, returning the
+// position of its leading bit.
+static inline SQ_CONSTEXPR int sq_normalise256(sq_u256 a, sq_u128 *sig) {
+  int lead = 255 - sq_clz256(a);
+  if (lead > 115)
+    a = sq_shr256_sticky(a, lead - 115);
+  else
+    a = sq_shl256(a, 115 - lead);
+  *sig = a.lo;
+  return lead;
+}
+
+// x * 2^(xExp - 227) + y * 2^(yExp - 227) (with the signs), rounded once,
+// where x and y are exact, and have their leading bits at 227 or 228.
+static inline SQ_CONSTEXPR FP128SQ sq_add_wide(sq_u128 xSign, int32_t xExp,
+                                               sq_u256 x, sq_u128 ySign,
+                                               int32_t yExp, sq_u256 y) {
+  if (yExp > xExp || (yExp == xExp && sq_lt256(x, y))) {
+    sq_u256 t = x;
+    x = y;
+    y = t;
+    int32_t e = xExp;
+    xExp = yExp;
+    yExp = e;
+    sq_u128 s = xSign;
+    xSign = ySign;
+    ySign = s;
+  }
+  // Now x's exponent is at least as large as y's; since each has its leading
+  // bit at 227 or 228, if we shift y by more than three bits it is less than
+  // half of x, so at most one bit is lost to cancellation, and the sticky bit
+  // can't matter.
+  y = sq_shr256_sticky(y, xExp - yExp);
+  sq_u256 r = {0, 0};
+  if (xSign == ySign) {
+    r = sq_add256(x, y);
+  } else {
+    if (sq_lt256(x, y)) {
+      sq_u256 t = x;
+      x = y;
+      y = t;
+      xSign = ySign;
+    }
+    r = sq_sub256(x, y);
+    if ((r.hi | r.lo) == 0)
+      return sq_make(0);
+  }
+  sq_u128 sig = 0;
+  int lead = sq_normalise256(r, &sig);
+  return sq_round_pack(xSign, xExp - SQ_BIAS - 227 + lead, sig);
+}
+
+// The exact product of two finite non-zero values, as x * 2^(*exp - 227)
+// for sq_add_wide.
+static inline SQ_CONSTEXPR sq_u256 sq_mul_exact(sq_u128 aAbs, sq_u128 bAbs,
+                                                int32_t *exp) {
+  int32_t aExp = 0, bExp = 0;
+  sq_u128 aSig = sq_unpack(aAbs, &aExp);
+  sq_u128 bSig = sq_unpack(bAbs, &bExp);
+  // The product has its leading bit at 224 or 225.
+  sq_u256 x = {0, 0};
+  sq_mul_wide(aSig, bSig, &x.hi, &x.lo);
+  *exp = aExp + bExp;
+  return sq_shl256(x, 3);
+}
+
+static inline SQ_CONSTEXPR FP128SQ fmasq(FP128SQ a, FP128SQ b, FP128SQ c) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 cAbs = c.bits & SQ_ABS_MASK;
+  sq_u128 pSign = (a.bits ^ b.bits) & SQ_SIGN_BIT;
+  if (SQ_UNLIKELY(aAbs - 1 >= SQ_INF_BITS - 1 || bAbs - 1 >= SQ_INF_BITS - 1 ||
+                  cAbs - 1 >= SQ_INF_BITS - 1)) {
+    if (aAbs > SQ_INF_BITS || bAbs > SQ_INF_BITS)
+      return sq_propagate_nan(a.bits, b.bits);
+    if (cAbs > SQ_INF_BITS)
+      return sq_propagate_nan(c.bits, c.bits);
+    if (aAbs == SQ_INF_BITS || bAbs == SQ_INF_BITS) {
+      if (aAbs == 0 || bAbs == 0 ||
+          (cAbs == SQ_INF_BITS && (c.bits & SQ_SIGN_BIT) != pSign))
+        return sq_make(SQ_DEFAULT_NAN_BITS);
+      return sq_make(pSign | SQ_INF_BITS);
+    }
+    if (cAbs == SQ_INF_BITS)
+      return c;
+    if (aAbs == 0 || bAbs == 0)
+      // An exact zero product.
+      return cAbs == 0 ? sq_make(pSign & c.bits) : c;
+    // Only c is zero, so the product (rounded once) is the answer.
+    return mulsq(a, b);
+  }
+  // Put c's leading bit where the product's is, so that each value is
+  // x * 2^(e - 227), where e is the sum of the (biased) exponents for the
+  // product, and c's exponent plus SQ_BIAS for c.
+  int32_t xExp = 0, cExp = 0;
+  sq_u256 x = sq_mul_exact(aAbs, bAbs, &xExp);
+  sq_u128 cSig = sq_unpack(cAbs, &cExp);
+  sq_u256 y = {cSig >> 13, cSig << 115};
+  return sq_add_wide(pSign, xExp, x, c.bits & SQ_SIGN_BIT, cExp + SQ_BIAS, y);
+}
+
+// a * b + c * d, rounded once. (So, for instance, each part of a complex
+// product is correctly rounded.)
+static inline SQ_CONSTEXPR FP128SQ dot2sq(FP128SQ a, FP128SQ b, FP128SQ c,
+                                          FP128SQ d) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 cAbs = c.bits & SQ_ABS_MASK, dAbs = d.bits & SQ_ABS_MASK;
+  // If either product is exactly zero, infinite or NaN then rounding it
+  // first changes nothing.
+  if (SQ_UNLIKELY(aAbs - 1 >= SQ_INF_BITS - 1 || bAbs - 1 >= SQ_INF_BITS - 1))
+    return fmasq(c, d, mulsq(a, b));
+  if (SQ_UNLIKELY(cAbs - 1 >= SQ_INF_BITS - 1 || dAbs - 1 >= SQ_INF_BITS - 1))
+    return fmasq(a, b, mulsq(c, d));
+  int32_t xExp = 0, yExp = 0;
+  sq_u256 x = sq_mul_exact(aAbs, bAbs, &xExp);
+  sq_u256 y = sq_mul_exact(cAbs, dAbs, &yExp);
+  return sq_add_wide((a.bits ^ b.bits) & SQ_SIGN_BIT, xExp, x,
+                     (c.bits ^ d.bits) & SQ_SIGN_BIT, yExp, y);
+}
+
+// 512 bit two's complement helpers for dot2addsq, least significant word
+// first.
+typedef struct {
+  sq_u128 w[4];
+} sq_u512;
+
+static inline SQ_CONSTEXPR sq_u512 sq_add512(sq_u512 a, sq_u512 b) {
+  sq_u128 carry = 0;
+  for (int i = 0; i < 4; i++) {
+    sq_u128 s = a.w[i] + carry;
+    carry = s < carry;
+    a.w[i] = s + b.w[i];
+    carry += a.w[i] < s;
+  }
+  return a;
+}
+
+static inline SQ_CONSTEXPR sq_u512 sq_neg512(sq_u512 a) {
+  sq_u128 carry = 1;
+  for (int i = 0; i < 4; i++) {
+    a.w[i] = ~a.w[i] + carry;
+    carry = carry && a.w[i] == 0;
+  }
+  return a;
+}
+
+// x << n, for x below 2^256 and 0 <= n < 256.
+static inline SQ_CONSTEXPR sq_u512 sq_shl512(sq_u256 x, int n) {
+  sq_u512 r = {{0, 0, 0, 0}};
+  int q = n / 128, b = n % 128;
+  r.w[q] = x.lo << b;
+  r.w[q + 1] = x.hi << b;
+  if (b) {
+    r.w[q + 1] |= x.lo >> (128 - b);
+    r.w[q + 2] = x.hi >> (128 - b);
+  }
+  return r;
+}
+
+// Bits n to n + 127 of a non-negative a, ORing any below n into the least
+// significant bit.
+static inline SQ_CONSTEXPR sq_u128 sq_extract512(sq_u512 a, int n) {
+  int q = n / 128, b = n % 128;
+  sq_u128 r = a.w[q] >> b, sticky = 0;
+  if (b) {
+    if (q < 3)
+      r |= a.w[q + 1] << (128 - b);
+    sticky = a.w[q] << (128 - b);
+  }
+  for (int i = 0; i < q; i++)
+    sticky |= a.w[i];
+  return r | (sticky != 0);
+}
+
+// One of the values which dot2addsq adds: x * 2^(exp - 227), on the scale of
+// sq_add_wide's exponents, with x's leading bit at 228, so that the larger
+// of two is the one with the larger (exp, x).
+typedef struct {
+  sq_u128 sign;
+  int32_t exp;
+  sq_u256 x;
+} sq_term;
+
+static inline SQ_CONSTEXPR sq_term sq_make_term(sq_u128 sign, int32_t exp,
+                                                sq_u256 x) {
+  sq_term t = {sign, exp, x};
+  if (x.hi >> 100 == 0) {
+    t.x = sq_shl256(x, 1);
+    t.exp--;
+  }
+  return t;
+}
+
+static inline SQ_CONSTEXPR int sq_term_lt(sq_term a, sq_term b) {
+  return a.exp < b.exp || (a.exp == b.exp && sq_lt256(a.x, b.x));
+}
+
+// The term at bit shift (so with its leading bit at 228 + shift) of a 512
+// bit total. Below bit 1 it is shifted right, with anything lost ORed into
+// bit 0.
+static inline SQ_CONSTEXPR sq_u512 sq_place_term(sq_term t, int shift) {
+  sq_u512 r = shift >= 0 ? sq_shl512(t.x, shift)
+                         : sq_shl512(sq_shr256_sticky(t.x, -shift), 0);
+  return t.sign ? sq_neg512(r) : r;
+}
+
+// a * b + c * d + e, rounded once. (So, for instance, each part of a complex
+// multiply-add is correctly rounded.)
+static inline SQ_CONSTEXPR FP128SQ dot2addsq(FP128SQ a, FP128SQ b, FP128SQ c,
+                                             FP128SQ d, FP128SQ e) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK, bAbs = b.bits & SQ_ABS_MASK;
+  sq_u128 cAbs = c.bits & SQ_ABS_MASK, dAbs = d.bits & SQ_ABS_MASK;
+  sq_u128 eAbs = e.bits & SQ_ABS_MASK;
+  // A product which is exactly zero, infinite or NaN can be added to e first
+  // without rounding; and a zero e changes nothing.
+  if (SQ_UNLIKELY(aAbs - 1 >= SQ_INF_BITS - 1 || bAbs - 1 >= SQ_INF_BITS - 1))
+    return fmasq(c, d, addsq(mulsq(a, b), e));
+  if (SQ_UNLIKELY(cAbs - 1 >= SQ_INF_BITS - 1 || dAbs - 1 >= SQ_INF_BITS - 1))
+    return fmasq(a, b, addsq(mulsq(c, d), e));
+  if (SQ_UNLIKELY(eAbs - 1 >= SQ_INF_BITS - 1))
+    return eAbs == 0 ? addsq(dot2sq(a, b, c, d), e) : addsq(e, e);
+
+  int32_t xExp = 0, yExp = 0, eExp = 0;
+  sq_u256 x = sq_mul_exact(aAbs, bAbs, &xExp);
+  sq_u256 y = sq_mul_exact(cAbs, dAbs, &yExp);
+  sq_u128 eSig = sq_unpack(eAbs, &eExp);
+  sq_u256 z = {eSig >> 13, eSig << 115};
+  sq_term t[3] = {
+      sq_make_term((a.bits ^ b.bits) & SQ_SIGN_BIT, xExp, x),
+      sq_make_term((c.bits ^ d.bits) & SQ_SIGN_BIT, yExp, y),
+      sq_make_term(e.bits & SQ_SIGN_BIT, eExp + SQ_BIAS, z)};
+  // Largest first.
+  for (int i = 0; i < 2; i++)
+    for (int j = 2; j > i; j--)
+      if (sq_term_lt(t[j - 1], t[j])) {
+        sq_term s = t[j];
+        t[j] = t[j - 1];
+        t[j - 1] = s;
+      }
+
+  // The total is exact, other than that bit 0 stands for anything below bit
+  // 1 (the terms' own bits below 3 are zero). The largest term goes at bit
+  // 480, so that if two of them cancel, what is left (at least the smaller
+  // one's last bit, about bit 250) still has room below it for the third.
+  int32_t shift1 = 252 - (t[0].exp - t[1].exp);
+  int32_t shift2 = 252 - (t[0].exp - t[2].exp);
+  sq_u512 total = sq_place_term(t[0], 252);
+  if (shift1 < 0) {
+    // The others are both below t[0]'s last bit, so all that matters is the
+    // sign of their sum (and whether it's zero).
+    if (t[1].sign == t[2].sign || sq_term_lt(t[2], t[1])) {
+      sq_u512 one = {{1, 0, 0, 0}};
+      total = sq_add512(total, t[1].sign ? sq_neg512(one) : one);
+    }
+  } else {
+    total = sq_add512(total, sq_place_term(t[1], shift1));
+    if ((total.w[0] | total.w[1] | total.w[2] | total.w[3]) == 0) {
+      // The two largest cancel, leaving the third, which needs no room.
+      sq_u128 sig = 0;
+      sq_normalise256(t[2].x, &sig);
+      return sq_round_pack(t[2].sign, t[2].exp - SQ_BIAS + 1, sig);
+    }
+    total = sq_add512(total, sq_place_term(t[2], shift2));
+  }
+
+  sq_u128 sign = 0;
+  if (total.w[3] >> 127) {
+    sign = SQ_SIGN_BIT;
+    total = sq_neg512(total);
+  }
+  int word = 3;
+  while (word > 0 && total.w[word] == 0)
+    word--;
+  if (total.w[word] == 0)
+    return sq_make(0);
+  int lead = 128 * word + 127 - sq_clz(total.w[word]);
+  sq_u128 sig = lead > 115 ? sq_extract512(total, lead - 115)
+                           : total.w[0] << (115 - lead);
+  return sq_round_pack(sign, t[0].exp - SQ_BIAS - 227 - 252 + lead, sig);
+}
+
+// floor(sqrt(x)).
+static inline SQ_CONSTEXPR uint64_t sq_isqrt64(uint64_t x) {
+  uint64_t r = 0;
+  for (int bit = 31; bit >= 0; bit--) {
+    uint64_t t = r | (UINT64_C(1) << bit);
+    if (t * t <= x)
+      r = t;
+  }
+  return r;
+}
+
+static inline SQ_CONSTEXPR FP128SQ sqrtsq(FP128SQ a) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK;
+  if (SQ_UNLIKELY(a.bits - 1 >= SQ_INF_BITS - 1)) {
+    // Zero, negative, infinity or NaN.
+    if (aAbs > SQ_INF_BITS)
+      return sq_propagate_nan(a.bits, a.bits);
+    if (aAbs == 0 || a.bits == SQ_INF_BITS)
+      return a;
+    return sq_make(SQ_DEFAULT_NAN_BITS);
+  }
+  int32_t aExp = 0;
+  sq_u128 m = sq_unpack(aAbs, &aExp);
+  // Make the exponent even, so that m * 2^118 is in [2^230, 2^232) and its
+  // square root is in [2^115, 2^116), as sq_round_pack wants.
+  int32_t e = aExp - SQ_BIAS;
+  if (e & 1) {
+    m <<= 1;
+    e--;
+  }
+  sq_u256 n = {m >> 10, m << 118};
+
+  // Start from the double precision square root, then two Newton steps,
+  // r = (r + n / r) / 2, give us (nearly) all of the bits. (At compile time
+  // we start from the 32 bit integer square root instead, which is still
+  // close enough.)
+  sq_u128 r = 0;
+  if (SQ_IS_CONSTANT_EVALUATED()) {
+    r = (sq_u128)sq_isqrt64((uint64_t)(m >> 50)) << 84;
+  } else {
+    double d = sqrt((double)(uint64_t)(m >> 50) * 1125899906842624.0); // 2^50
+    r = (sq_u128)(uint64_t)d << 59;
+  }
+  for (int i = 0; i < 2; i++) {
+    int shift = sq_clz(r);
+    sq_u256 nn = sq_shl256(n, shift);
+    sq_u128 rem = nn.hi;
+    uint64_t q1 = sq_div_digit(&rem, (uint64_t)(nn.lo >> 64), r << shift);
+    uint64_t q0 = sq_div_digit(&rem, (uint64_t)nn.lo, r << shift);
+    r = (r + (((sq_u128)q1 << 64) | q0)) >> 1;
+  }
+  // Then fix up the last bit.
+  sq_u256 sq = {0, 0};
+  sq_mul_wide(r, r, &sq.hi, &sq.lo);
+  while (sq_lt256(n, sq)) {
+    r--;
+    sq_mul_wide(r, r, &sq.hi, &sq.lo);
+  }
+  for (;;) {
+    sq_u256 next = {0, 0};
+    sq_mul_wide(r + 1, r + 1, &next.hi, &next.lo);
+    if (sq_lt256(n, next))
+      break;
+    r++;
+    sq = next;
+  }
+  r |= (sq.hi != n.hi || sq.lo != n.lo);
+  return sq_round_pack(0, e / 2 + SQ_BIAS, r);
+}
+
+// Comparison.
+// NaNs are unordered, so all comparisons with them are false (except !=).
+static inline SQ_CONSTEXPR int sq_either_nan(FP128SQ a, FP128SQ b) {
+  return (a.bits & SQ_ABS_MASK) > SQ_INF_BITS ||
+         (b.bits & SQ_ABS_MASK) > SQ_INF_BITS;
+}
+
+// Map the representation onto an unsigned integer with the same ordering
+// (apart from -0 < +0).
+static inline SQ_CONSTEXPR sq_u128 sq_order_key(sq_u128 x) {
+  return (x & SQ_SIGN_BIT) ? ~x : x | SQ_SIGN_BIT;
+}
+
+static inline SQ_CONSTEXPR int eqsq(FP128SQ a, FP128SQ b) {
+  return !sq_either_nan(a, b) &&
+         (a.bits == b.bits || ((a.bits | b.bits) & SQ_ABS_MASK) == 0);
+}
+static inline SQ_CONSTEXPR int nesq(FP128SQ a, FP128SQ b) {
+  return !eqsq(a, b);
+}
+static inline SQ_CONSTEXPR int ltsq(FP128SQ a, FP128SQ b) {
+  return !sq_either_nan(a, b) && ((a.bits | b.bits) & SQ_ABS_MASK) != 0 &&
+         sq_order_key(a.bits) < sq_order_key(b.bits);
+}
+static inline SQ_CONSTEXPR int lesq(FP128SQ a, FP128SQ b) {
+  return !sq_either_nan(a, b) && (((a.bits | b.bits) & SQ_ABS_MASK) == 0 ||
+                                  sq_order_key(a.bits) <= sq_order_key(b.bits));
+}
+static inline SQ_CONSTEXPR int gtsq(FP128SQ a, FP128SQ b) { return ltsq(b, a); }
+static inline SQ_CONSTEXPR int gesq(FP128SQ a, FP128SQ b) { return lesq(b, a); }
+static inline SQ_CONSTEXPR int unorderedsq(FP128SQ a, FP128SQ b) {
+  return sq_either_nan(a, b);
+}
+
+// Conversions.
+static inline SQ_CONSTEXPR uint64_t sq_double_to_bits(double d) {
+#if (SQ_HAVE_CONSTEXPR)
+  return __builtin_bit_cast(uint64_t, d);
+#else
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  return bits;
+#endif
+}
+
+static inline SQ_CONSTEXPR double sq_bits_to_double(uint64_t bits) {
+#if (SQ_HAVE_CONSTEXPR)
+  return __builtin_bit_cast(double, bits);
+#else
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+#endif
+}
+
+// From double is always exact.
+static inline SQ_CONSTEXPR FP128SQ sq_from_double(double d) {
+  uint64_t bits = sq_double_to_bits(d);
+  sq_u128 sign = (sq_u128)(bits >> 63) << 127;
+  int32_t exp = (int32_t)(bits >> 52) & 0x7ff;
+  uint64_t mant = bits & ((UINT64_C(1) << 52) - 1);
+  if (exp == 0x7ff) // Infinity or (quietened) NaN, preserving the payload.
+    return sq_make(sign | SQ_INF_BITS | ((sq_u128)mant << 60) |
+                   (mant ? SQ_QUIET_BIT : 0));
+  if (exp == 0) {
+    if (mant == 0)
+      return sq_make(sign);
+    int shift = __builtin_clzll(mant) - 11;
+    mant = (mant << shift) & ((UINT64_C(1) << 52) - 1);
+    exp = 1 - shift;
+  }
+  return sq_make(sign | ((sq_u128)(exp - 1023 + SQ_BIAS) << 112) |
+                 ((sq_u128)mant << 60));
+}
+
+static inline SQ_CONSTEXPR double sq_to_double(FP128SQ a) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK;
+  uint64_t sign = (uint64_t)(a.bits >> 127) << 63;
+  uint64_t bits = 0;
+  if (aAbs >= SQ_INF_BITS) {
+    bits = sign | (UINT64_C(0x7ff) << 52);
+    if (aAbs > SQ_INF_BITS)
+      bits |= (UINT64_C(1) << 51) | (uint64_t)((aAbs & SQ_MANT_MASK) >> 60);
+  } else if (aAbs == 0) {
+    bits = sign;
+  } else {
+    int32_t exp = 0;
+    sq_u128 m = sq_unpack(aAbs, &exp);
+    exp += 1023 - SQ_BIAS;
+    // Keep 53 bits plus three more for rounding.
+    uint64_t sig = (uint64_t)sq_shr_sticky(m, 57);
+    if (exp >= 0x7ff) {
+      bits = sign | (UINT64_C(0x7ff) << 52);
+    } else {
+      if (exp <= 0) {
+        sig = (uint64_t)sq_shr_sticky(sig, 1 - exp);
+        exp = 0;
+      }
+      unsigned rgs = (unsigned)sig & 7;
+      bits = ((sig >> 3) & ((UINT64_C(1) << 52) - 1)) | ((uint64_t)exp << 52);
+      bits += (rgs > 4) | ((rgs == 4) & (unsigned)bits);
+      bits |= sign;
+    }
+  }
+  return sq_bits_to_double(bits);
+}
+
+// From integers is exact.
+static inline SQ_CONSTEXPR FP128SQ sq_from_ull(unsigned long long v) {
+  if (v == 0)
+    return sq_make(0);
+  int lead = 63 - __builtin_clzll(v);
+  return sq_make(((sq_u128)(lead + SQ_BIAS) << 112) |
+                 (((sq_u128)v << (112 - lead)) & SQ_MANT_MASK));
+}
+
+static inline SQ_CONSTEXPR FP128SQ sq_from_ll(long long v) {
+  FP128SQ r =
+      sq_from_ull(v < 0 ? -(unsigned long long)v : (unsigned long long)v);
+  if (v < 0)
+    r.bits |= SQ_SIGN_BIT;
+  return r;
+}
+
+// Convert with truncation, as a cast would. Out of range values (and NaNs)
+// saturate according to their sign, as the libgcc routines do.
+static inline SQ_CONSTEXPR long long sq_to_ll(FP128SQ a) {
+  sq_u128 aAbs = a.bits & SQ_ABS_MASK;
+  int negative = (int)(a.bits >> 127);
+  int32_t exp = (int32_t)(aAbs >> 112) - SQ_BIAS;
+  if (exp < 0)
+    return 0;
+  if (exp >= 63) {
+    // Only -2^63 itself is representable.
+    return negative ? LLONG_MIN : LLONG_MAX;
+  }
+  unsigned long long m =
+      (unsigned long long)(((aAbs & SQ_MANT_MASK) | SQ_IMPLICIT_BIT) >>
+                           (112 - exp));
+  return negative ? -(long long)m : (long long)m;
+}
+
+#endif // Header monotonicity
+
+// Conversion between pfp128.h's FP128 and FP128SQ, when pfp128.h has been
+// included (before this header, or by including this one again after it).
+// With the double-double backend the value is rounded to binary128, which
+// is exact unless the two doubles are more than 113 bits apart.
+#if (defined(_PFP128_H_INCLUDED_) && !defined(_PFP128_SOFT_FP128_INCLUDED_) &&  \
+     (PFP128_IS_DD || defined(__x86_64__) || LDBL_MANT_DIG == 113))
+#define _PFP128_SOFT_FP128_INCLUDED_ 1
+
+static inline FP128SQ FP128_to_sq(FP128 arg) {
+#if (PFP128_IS_DD)
+  // (Adding a zero lo would turn -0 into +0.)
+  FP128SQ hi = sq_from_double(arg.hi);
+  return arg.lo == 0 ? hi : addsq(hi, sq_from_double(arg.lo));
+#else
+  FP128SQ r;
+  memcpy(&r, &arg, sizeof(r));
+  return r;
+#endif
+}
+
+static inline FP128 FP128_from_sq(FP128SQ arg) {
+#if (PFP128_IS_DD)
+  double hi = sq_to_double(arg);
+  // (Subtracting an infinite hi would give a NaN lo.)
+  if (!isfinitesq(sq_from_double(hi)))
+    return dd_make(hi, 0.0);
+  return dd_make(hi, sq_to_double(subsq(arg, sq_from_double(hi))));
+#else
+  FP128 r;
+  memcpy(&r, &arg, sizeof(r));
+  return r;
+#endif
+}
+#endif
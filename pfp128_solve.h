@@ -0,0 +1,304 @@
+//===-- pfp128_solve.h - FP128 linear systems via double LU -------*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Solve A X = B to FP128 accuracy, where A is an n by n FP128 matrix, with
+ * the factorisation done in double precision, by mixed precision iterative
+ * refinement:
+ *
+ *   FP128_SOLVER s;
+ *   FP128_solver_lu(&s, A, n, lda);         // or FP128_solver_cholesky
+ *   FP128_solver_solve(&s, B, ldb, X, ldx, nrhs);  // as often as you like
+ *   FP128_solver_free(&s);
+ *
+ * The matrices are row-major (element (i, j) of A is A[i * lda + j]), and B
+ * and X are n by nrhs. FP128_solver_lu factors A, rounded to double, into
+ * P L U with partial pivoting; FP128_solver_cholesky factors a symmetric
+ * positive definite A into U^T U (using only its lower triangle). Then for
+ * each right hand side b we solve for x in double, and repeatedly
+ *
+ *   r = b - A x      in FP128 (with dotFP128_n from pfp128_reduce.h,
+ *                    so each A x is accurate to about an ulp),
+ *   solve A d = r    with the double factorisation,
+ *   x = x + d        in FP128,
+ *
+ * until r is within a few ulp of ||A|| ||x|| (so that x solves a system
+ * within a few ulp of A; its error is then about cond(A) ulp). Each
+ * step gains about 53 - log2(cond(A)) bits, so as long as A is not too
+ * ill-conditioned for double (cond(A) well below 2^53) a few steps give x
+ * to FP128 accuracy, for O(n^2) FP128 work per step, while the O(n^3)
+ * factorisation is all in hardware double. The residuals are scaled by a
+ * power of two before they're rounded to double, so they don't underflow,
+ * but A itself has to be within double's range.
+ *
+ * The solver keeps a copy of A (in FP128, for the residuals) as well as the
+ * factors, so A may be changed or freed once it's been factored, and the
+ * solver may be used by several threads at once. The functions return 0, or
+ * -1 if they can't allocate memory, if the factorisation breaks down (A is
+ * singular, or not positive definite, in double), or if the refinement of
+ * any of the right hand sides doesn't converge in PFP128_SOLVE_MAX_STEPS
+ * steps (in which case X holds the best we managed). With OpenMP the
+ * factorisation's updates, and the right hand sides, run in parallel.
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_SOLVE_H_INCLUDED_))
+#define _PFP128_SOLVE_H_INCLUDED_ 1
+
+#include "pfp128.h"
+#include "pfp128_reduce.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#if (!defined(PFP128_SOLVE_MAX_STEPS))
+#define PFP128_SOLVE_MAX_STEPS 30
+#endif
+
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_SOLVE_PRAGMA(x) _Pragma(#x)
+#define PFP128_SOLVE_LOOP                                                      \
+  PFP128_SOLVE_PRAGMA(omp parallel for schedule(static)                        \
+                      if (total >= PFP128_OMP_THRESHOLD))
+#define PFP128_SOLVE_RHS_LOOP                                                  \
+  PFP128_SOLVE_PRAGMA(omp parallel for schedule(dynamic)                       \
+                      reduction(| : failed) if (total >= PFP128_OMP_THRESHOLD))
+#else
+// (Without OpenMP the loops just use total, so that it isn't unused.)
+#define PFP128_SOLVE_LOOP (void)total;
+#define PFP128_SOLVE_RHS_LOOP (void)total;
+#endif
+
+typedef struct {
+  size_t n;
+  int cholesky;
+  FP128 *A;      // n by n.
+  FP128 norm;    // Of A, the largest sum of the magnitudes of a row.
+  double *f;     // The factors, n by n: L (unit) and U, or U.
+  size_t *pivot; // Row i of P A is row pivot[i] of A (for LU).
+} FP128_SOLVER;
+
+static inline void FP128_solver_free(FP128_SOLVER *s) {
+  free(s->A);
+  free(s->f);
+  free(s->pivot);
+  s->A = NULL;
+  s->f = NULL;
+  s->pivot = NULL;
+  s->n = 0;
+}
+
+// Copy A, and round it to double. For Cholesky the upper triangle is filled
+// in from the lower.
+static inline int pfp128_solve_init(FP128_SOLVER *s, FP128 const *A, size_t n,
+                                    size_t lda, int cholesky) {
+  s->n = n;
+  s->cholesky = cholesky;
+  s->A = (FP128 *)malloc((n ? n * n : 1) * sizeof(FP128));
+  s->f = (double *)malloc((n ? n * n : 1) * sizeof(double));
+  s->pivot = (size_t *)malloc((n ? n : 1) * sizeof(size_t));
+  if (!s->A || !s->f || !s->pivot) {
+    FP128_solver_free(s);
+    return -1;
+  }
+  s->norm = FP128_from_double(0.0);
+  for (size_t i = 0; i < n; i++) {
+    FP128 sum = FP128_from_double(0.0);
+    s->pivot[i] = i;
+    for (size_t j = 0; j < n; j++) {
+      FP128 a = cholesky && j > i ? A[j * lda + i] : A[i * lda + j];
+      s->A[i * n + j] = a;
+      s->f[i * n + j] = FP128_to_double(a);
+      sum = addFP128(sum, fabsFP128(a));
+    }
+    if (gtFP128(sum, s->norm))
+      s->norm = sum;
+  }
+  return 0;
+}
+
+static inline int FP128_solver_lu(FP128_SOLVER *s, FP128 const *A, size_t n,
+                                  size_t lda) {
+  if (pfp128_solve_init(s, A, n, lda, 0) != 0)
+    return -1;
+  double *f = s->f;
+  for (size_t k = 0; k < n; k++) {
+    size_t p = k;
+    for (size_t i = k + 1; i < n; i++)
+      if (fabs(f[i * n + k]) > fabs(f[p * n + k]))
+        p = i;
+    if (!(f[p * n + k] != 0.0)) {
+      FP128_solver_free(s);
+      return -1;
+    }
+    if (p != k) {
+      for (size_t j = 0; j < n; j++) {
+        double t = f[k * n + j];
+        f[k * n + j] = f[p * n + j];
+        f[p * n + j] = t;
+      }
+      size_t t = s->pivot[k];
+      s->pivot[k] = s->pivot[p];
+      s->pivot[p] = t;
+    }
+    // The rows below are independent, and each is a contiguous update.
+    double const *rowK = f + k * n;
+    size_t total = (n - k) * (n - k);
+    PFP128_SOLVE_LOOP
+    for (size_t i = k + 1; i < n; i++) {
+      double *row = f + i * n;
+      double l = row[k] /= rowK[k];
+      for (size_t j = k + 1; j < n; j++)
+        row[j] -= l * rowK[j];
+    }
+  }
+  return 0;
+}
+
+static inline int FP128_solver_cholesky(FP128_SOLVER *s, FP128 const *A,
+                                        size_t n, size_t lda) {
+  if (pfp128_solve_init(s, A, n, lda, 1) != 0)
+    return -1;
+  double *f = s->f;
+  // A = U^T U, with U overwriting the upper triangle a row at a time, so
+  // that the updates are contiguous.
+  for (size_t k = 0; k < n; k++) {
+    double *rowK = f + k * n;
+    if (!(rowK[k] > 0.0)) {
+      FP128_solver_free(s);
+      return -1;
+    }
+    double u = rowK[k] = sqrt(rowK[k]);
+    for (size_t j = k + 1; j < n; j++)
+      rowK[j] /= u;
+    size_t total = (n - k) * (n - k) / 2;
+    PFP128_SOLVE_LOOP
+    for (size_t i = k + 1; i < n; i++) {
+      double *row = f + i * n;
+      double l = rowK[i];
+      for (size_t j = i; j < n; j++)
+        row[j] -= l * rowK[j];
+    }
+  }
+  return 0;
+}
+
+// Solve A d = r in place, in double.
+static inline void pfp128_solve_double(FP128_SOLVER const *s, double *r,
+                                       double *t) {
+  size_t n = s->n;
+  double const *f = s->f;
+  if (s->cholesky) {
+    // U^T t = r, a column of U^T (a row of U) at a time.
+    for (size_t i = 0; i < n; i++) {
+      double ti = t[i] = r[i] / f[i * n + i];
+      for (size_t j = i + 1; j < n; j++)
+        r[j] -= f[i * n + j] * ti;
+    }
+  } else {
+    // L t = P r.
+    for (size_t i = 0; i < n; i++) {
+      double sum = r[s->pivot[i]];
+      for (size_t k = 0; k < i; k++)
+        sum -= f[i * n + k] * t[k];
+      t[i] = sum;
+    }
+  }
+  // Then U d = t.
+  for (size_t i = n; i-- > 0;) {
+    double sum = t[i];
+    for (size_t k = i + 1; k < n; k++)
+      sum -= f[i * n + k] * t[k];
+    t[i] = sum / f[i * n + i];
+  }
+  for (size_t i = 0; i < n; i++)
+    r[i] = t[i];
+}
+
+// The refinement for one right hand side, b and x being n values apart
+// incb and incx. work is 2 n FP128 and 2 n doubles.
+static inline int pfp128_solve_one(FP128_SOLVER const *s, FP128 const *b,
+                                   size_t incb, FP128 *x, size_t incx,
+                                   FP128 *work, double *dwork) {
+  size_t n = s->n;
+  FP128 *xs = work, *r = work + n;
+  double *d = dwork, *t = dwork + n;
+  FP128 zero = FP128_from_double(0.0);
+  for (size_t i = 0; i < n; i++)
+    xs[i] = zero;
+  FP128 xMax = zero, previous = zero;
+  int converged = 0, stalled = 0;
+  for (int step = 0;; step++) {
+    // r = b - A x.
+    FP128 rMax = zero;
+    for (size_t i = 0; i < n; i++) {
+      r[i] = subFP128(b[i * incb], dotFP128_n(s->A + i * n, xs, n));
+      if (gtFP128(fabsFP128(r[i]), rMax))
+        rMax = fabsFP128(r[i]);
+    }
+    // Done once x is within a few ulp of a solution of a matrix within a
+    // few ulp of A, which is as close as we can get.
+    if (leFP128(rMax, mulFP128(mulFP128(FP128_from_double(4.0), FP128_EPSILON),
+                               mulFP128(s->norm, xMax)))) {
+      converged = 1;
+      break;
+    }
+    if (stalled || step == PFP128_SOLVE_MAX_STEPS || !isfiniteFP128(rMax))
+      break;
+    // Scale r so that its largest element is about one.
+    int e = ilogbFP128(rMax);
+    FP128 down = ldexpFP128(FP128_from_double(1.0), -e);
+    FP128 up = ldexpFP128(FP128_from_double(1.0), e);
+    for (size_t i = 0; i < n; i++)
+      d[i] = FP128_to_double(mulFP128(r[i], down));
+    pfp128_solve_double(s, d, t);
+    FP128 dMax = zero;
+    xMax = zero;
+    for (size_t i = 0; i < n; i++) {
+      FP128 di = mulFP128(FP128_from_double(d[i]), up);
+      xs[i] = addFP128(xs[i], di);
+      if (gtFP128(fabsFP128(di), dMax))
+        dMax = fabsFP128(di);
+      if (gtFP128(fabsFP128(xs[i]), xMax))
+        xMax = fabsFP128(xs[i]);
+    }
+    // If the corrections stop shrinking we're as close as we'll get.
+    stalled = step > 0 &&
+              geFP128(dMax, mulFP128(FP128_from_double(0.5), previous));
+    previous = dMax;
+  }
+  for (size_t i = 0; i < n; i++)
+    x[i * incx] = xs[i];
+  return converged ? 0 : -1;
+}
+
+static inline int FP128_solver_solve(FP128_SOLVER const *s, FP128 const *B,
+                                     size_t ldb, FP128 *X, size_t ldx,
+                                     size_t nrhs) {
+  size_t n = s->n, total = n * n * nrhs;
+  int failed = 0;
+  PFP128_SOLVE_RHS_LOOP
+  for (size_t j = 0; j < nrhs; j++) {
+    FP128 *work = (FP128 *)malloc((2 * n + 1) * sizeof(FP128));
+    double *dwork = (double *)malloc((2 * n + 1) * sizeof(double));
+    if (!work || !dwork ||
+        pfp128_solve_one(s, B + j, ldb, X + j, ldx, work, dwork) != 0)
+      failed = 1;
+    free(work);
+    free(dwork);
+  }
+  return failed ? -1 : 0;
+}
+
+#undef PFP128_SOLVE_PRAGMA
+#undef PFP128_SOLVE_LOOP
+#undef PFP128_SOLVE_RHS_LOOP
+
+#endif // Header monotonicity
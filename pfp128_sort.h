@@ -0,0 +1,327 @@
+//===-- pfp128_sort.h - Sorting and selecting FP128 arrays -----*- C -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/*
+ * Sort, select and find the extremes of arrays of FP128 values, without
+ * any floating point comparisons:
+ *
+ *   sortFP128(x, n)                 sort x into increasing order
+ *   sortFP128_kv(x, values, n)      likewise, moving values[i] with x[i]
+ *   nthElementFP128(x, n, k)        put the k-th smallest (from 0) in x[k],
+ *                                   with no larger values before it and no
+ *                                   smaller ones after it
+ *   partialSortFP128(x, n, k)       put the k smallest in x[0] to x[k - 1],
+ *                                   in order, and the rest after them
+ *   topkFP128(x, n, k, index)       set index[0] to index[k - 1] to the
+ *                                   positions of the k largest values in x,
+ *                                   largest first, leaving x as it is
+ *   minFP128_n(x, n), maxFP128_n(x, n)
+ *   argminFP128_n(x, n), argmaxFP128_n(x, n)
+ *
+ * FP128_sort_key(x) maps each value to an unsigned 128 bit key, in the same
+ * order as the values: for binary128, the bits with the sign bit flipped if
+ * it's clear and all of them flipped if it's set. So the order is IEEE 754's
+ * totalOrder, -NaN < -Inf < ... < -0 < +0 < ... < +Inf < +NaN (with NaNs
+ * ordered by payload). With the double-double backend the key is that of
+ * hi followed by that of lo, which is in the order of hi + lo for the
+ * normalised values the arithmetic produces. FP128_from_sort_key maps keys
+ * back to values.
+ *
+ * The sorts are most significant digit first radix sorts, on the keys one
+ * byte at a time: each range of keys is counted by its next byte and
+ * scattered into the 256 buckets (a byte which is the same throughout the
+ * range is skipped), and only buckets of more than PFP128_SORT_SMALL keys
+ * go on to the next byte, the rest being finished by insertion sort. With
+ * varied data that's after two or three bytes, rather than the sixteen
+ * passes least significant digit first would take, and each step is a
+ * handful of integer operations rather than a soft-float comparison. All
+ * the steps are stable, so sortFP128_kv keeps values with equal keys in
+ * their original order. Selection is the same, except that only the
+ * buckets holding the positions wanted are finished, which takes time in
+ * proportion to n. With OpenMP the buckets are finished in parallel once n
+ * reaches PFP128_OMP_THRESHOLD, with the same results whatever the number
+ * of threads.
+ *
+ * The sorts work on an array of keys (and one of values) which they
+ * allocate, with space to scatter them into, so take 32 bytes per element,
+ * or 48 with values (sortFP128_kv and topkFP128); they return 0 on success,
+ * or -1 with errno set if the memory couldn't be allocated. The extremes
+ * are also in totalOrder (so a positive NaN is the maximum), and the arg
+ * versions return the first position of the extreme, or 0 if n is 0 (when
+ * minFP128_n and maxFP128_n return NaN).
+ */
+// Header monotonicity.
+#if (!defined(_PFP128_SORT_H_INCLUDED_))
+#define _PFP128_SORT_H_INCLUDED_ 1
+
+#include "pfp128.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (!defined(__SIZEOF_INT128__))
+#error pfp128_sort.h needs a compiler with unsigned __int128.
+#endif
+#if (!PFP128_IS_DD && !defined(__x86_64__) && LDBL_MANT_DIG != 113)
+#error pfp128_sort.h needs FP128 to be IEEE binary128 (or double-double).
+#endif
+
+// Ranges of at most this many keys are finished by insertion sort.
+#if (!defined(PFP128_SORT_SMALL))
+#define PFP128_SORT_SMALL 32
+#endif
+
+#if (defined(_OPENMP))
+#if (!defined(PFP128_OMP_THRESHOLD))
+#define PFP128_OMP_THRESHOLD 1024
+#endif
+#define PFP128_SORT_PRAGMA(x) _Pragma(#x)
+#else
+#define PFP128_SORT_PRAGMA(x)
+#endif
+
+typedef unsigned __int128 FP128_SORT_KEY;
+
+#if (PFP128_IS_DD)
+static inline uint64_t pfp128_sort_key64(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits ^ (((uint64_t)0 - (bits >> 63)) | (uint64_t)1 << 63);
+}
+
+static inline double pfp128_sort_value64(uint64_t key) {
+  uint64_t bits = key ^ (((uint64_t)0 - (~key >> 63)) | (uint64_t)1 << 63);
+  double x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+#endif
+
+static inline FP128_SORT_KEY FP128_sort_key(FP128 x) {
+#if (PFP128_IS_DD)
+  return (FP128_SORT_KEY)pfp128_sort_key64(x.hi) << 64 |
+         pfp128_sort_key64(x.lo);
+#else
+  FP128_SORT_KEY bits, top = (FP128_SORT_KEY)1 << 127;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits ^ (((FP128_SORT_KEY)0 - (bits >> 127)) | top);
+#endif
+}
+
+static inline FP128 FP128_from_sort_key(FP128_SORT_KEY key) {
+#if (PFP128_IS_DD)
+  return dd_make(pfp128_sort_value64((uint64_t)(key >> 64)),
+                 pfp128_sort_value64((uint64_t)key));
+#else
+  FP128_SORT_KEY top = (FP128_SORT_KEY)1 << 127;
+  FP128_SORT_KEY bits = key ^ (((FP128_SORT_KEY)0 - (~key >> 127)) | top);
+  FP128 x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+#endif
+}
+
+// Stable insertion sort of n keys (and values, unless that's NULL).
+static inline void pfp128_sort_insertion(FP128_SORT_KEY *k, size_t *v,
+                                         size_t n) {
+  for (size_t i = 1; i < n; i++) {
+    FP128_SORT_KEY key = k[i];
+    size_t value = v ? v[i] : 0, j = i;
+    for (; j > 0 && k[j - 1] > key; j--) {
+      k[j] = k[j - 1];
+      if (v)
+        v[j] = v[j - 1];
+    }
+    k[j] = key;
+    if (v)
+      v[j] = value;
+  }
+}
+
+// Sort n keys (and values) from the byte at shift down, well enough that
+// positions first to last - 1 hold what they would if it were all sorted,
+// using tk and tv to scatter into. Buckets are finished in parallel if
+// parallel is set.
+static inline void pfp128_sort_msd(FP128_SORT_KEY *k, size_t *v,
+                                   FP128_SORT_KEY *tk, size_t *tv, size_t n,
+                                   int shift, size_t first, size_t last,
+                                   int parallel) {
+  size_t start[257], count[256];
+  for (;;) {
+    if (n <= PFP128_SORT_SMALL) {
+      pfp128_sort_insertion(k, v, n);
+      return;
+    }
+    memset(count, 0, sizeof(count));
+    for (size_t i = 0; i < n; i++)
+      count[(unsigned)(k[i] >> shift) & 255]++;
+    if (count[(unsigned)(k[0] >> shift) & 255] < n)
+      break;
+    // The same byte throughout.
+    if (shift == 0)
+      return;
+    shift -= 8;
+  }
+  start[0] = 0;
+  for (int b = 0; b < 256; b++) {
+    start[b + 1] = start[b] + count[b];
+    count[b] = start[b]; // Where the next key in bucket b goes.
+  }
+  for (size_t i = 0; i < n; i++) {
+    size_t to = count[(unsigned)(k[i] >> shift) & 255]++;
+    tk[to] = k[i];
+    if (v)
+      tv[to] = v[i];
+  }
+  memcpy(k, tk, n * sizeof(*k));
+  if (v)
+    memcpy(v, tv, n * sizeof(*v));
+  if (shift == 0)
+    return;
+#if (!defined(_OPENMP))
+  (void)parallel;
+#endif
+  PFP128_SORT_PRAGMA(omp parallel for schedule(dynamic)
+                     if (parallel && n >= PFP128_OMP_THRESHOLD))
+  for (int b = 0; b < 256; b++) {
+    size_t s = start[b], e = start[b + 1];
+    if (e - s > 1 && s < last && e > first)
+      pfp128_sort_msd(k + s, v ? v + s : NULL, tk + s, v ? tv + s : NULL,
+                      e - s, shift - 8, first > s ? first - s : 0,
+                      last < e ? last - s : e - s, 0);
+  }
+}
+
+// Sort x (and values) well enough for positions first to last - 1.
+static inline int pfp128_sort_range(FP128 *x, size_t *values, size_t n,
+                                    size_t first, size_t last) {
+  if (n < 2 || first >= last)
+    return 0;
+  FP128_SORT_KEY *k = (FP128_SORT_KEY *)malloc(2 * n * sizeof(*k));
+  size_t *v = values ? (size_t *)malloc(2 * n * sizeof(*v)) : NULL;
+  if (!k || (values && !v)) {
+    free(k);
+    free(v);
+    errno = ENOMEM;
+    return -1;
+  }
+  PFP128_SORT_PRAGMA(omp parallel for schedule(static)
+                     if (n >= PFP128_OMP_THRESHOLD))
+  for (size_t i = 0; i < n; i++) {
+    k[i] = FP128_sort_key(x[i]);
+    if (v)
+      v[i] = values[i];
+  }
+  pfp128_sort_msd(k, v, k + n, v ? v + n : NULL, n, 120, first, last, 1);
+  PFP128_SORT_PRAGMA(omp parallel for schedule(static)
+                     if (n >= PFP128_OMP_THRESHOLD))
+  for (size_t i = 0; i < n; i++) {
+    x[i] = FP128_from_sort_key(k[i]);
+    if (v)
+      values[i] = v[i];
+  }
+  free(k);
+  free(v);
+  return 0;
+}
+
+static inline int sortFP128(FP128 *x, size_t n) {
+  return pfp128_sort_range(x, NULL, n, 0, n);
+}
+
+static inline int sortFP128_kv(FP128 *x, size_t *values, size_t n) {
+  return pfp128_sort_range(x, values, n, 0, n);
+}
+
+static inline int nthElementFP128(FP128 *x, size_t n, size_t k) {
+  return k < n ? pfp128_sort_range(x, NULL, n, k, k + 1) : 0;
+}
+
+static inline int partialSortFP128(FP128 *x, size_t n, size_t k) {
+  return pfp128_sort_range(x, NULL, n, 0, k < n ? k : n);
+}
+
+// The positions are carried through the sort of the complemented keys, so
+// equal values come in the order of their positions.
+static inline int topkFP128(FP128 const *x, size_t n, size_t k,
+                            size_t *index) {
+  if (k > n)
+    k = n;
+  if (k == 0)
+    return 0;
+  FP128_SORT_KEY *keys = (FP128_SORT_KEY *)malloc(2 * n * sizeof(*keys));
+  size_t *v = (size_t *)malloc(2 * n * sizeof(*v));
+  if (!keys || !v) {
+    free(keys);
+    free(v);
+    errno = ENOMEM;
+    return -1;
+  }
+  PFP128_SORT_PRAGMA(omp parallel for schedule(static)
+                     if (n >= PFP128_OMP_THRESHOLD))
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = ~FP128_sort_key(x[i]);
+    v[i] = i;
+  }
+  pfp128_sort_msd(keys, v, keys + n, v + n, n, 120, 0, k, 1);
+  memcpy(index, v, k * sizeof(*index));
+  free(keys);
+  free(v);
+  return 0;
+}
+
+// The first position of the largest key, after complementing them all for
+// the smallest. Each thread finds the first largest in its part, and the
+// parts are merged preferring the earlier position.
+static inline size_t pfp128_sort_arg(FP128 const *x, size_t n,
+                                     FP128_SORT_KEY flip) {
+  size_t best = 0;
+  FP128_SORT_KEY const firstKey = n ? FP128_sort_key(x[0]) ^ flip : 0;
+  FP128_SORT_KEY bestKey = firstKey;
+  PFP128_SORT_PRAGMA(omp parallel if (n >= PFP128_OMP_THRESHOLD))
+  {
+    size_t mine = 0;
+    FP128_SORT_KEY mineKey = firstKey;
+    PFP128_SORT_PRAGMA(omp for schedule(static) nowait)
+    for (size_t i = 0; i < n; i++) {
+      FP128_SORT_KEY key = FP128_sort_key(x[i]) ^ flip;
+      if (key > mineKey) {
+        mine = i;
+        mineKey = key;
+      }
+    }
+    PFP128_SORT_PRAGMA(omp critical(pfp128_sort_arg))
+    if (mineKey > bestKey || (mineKey == bestKey && mine < best)) {
+      best = mine;
+      bestKey = mineKey;
+    }
+  }
+  return best;
+}
+
+static inline size_t argminFP128_n(FP128 const *x, size_t n) {
+  return pfp128_sort_arg(x, n, ~(FP128_SORT_KEY)0);
+}
+
+static inline size_t argmaxFP128_n(FP128 const *x, size_t n) {
+  return pfp128_sort_arg(x, n, 0);
+}
+
+static inline FP128 minFP128_n(FP128 const *x, size_t n) {
+  return n ? x[argminFP128_n(x, n)] : nanFP128("");
+}
+
+static inline FP128 maxFP128_n(FP128 const *x, size_t n) {
+  return n ? x[argmaxFP128_n(x, n)] : nanFP128("");
+}
+
+#undef PFP128_SORT_PRAGMA
+
+#endif // Header monotonicity
@@ -0,0 +1,727 @@
+//===-- sweepPFP128.c - measure the accuracy of the pfp128.h functions ----===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+//
+// Measure the error of each of the functions which pfp128.h shims, and of
+// those in pfp128_fast.h (as exp_fast and so on), at many random arguments
+// in each of several regions. The functions come from the FOREACH lists in
+// pfp128.h, so anything added there is swept too (other than nan, whose
+// argument is a string).
+//
+// The reference values come from MPFR, with 256 bits, when it's installed
+// (mpfr.h is found; the Makefile then links with -lmpfr), for the real
+// functions it has (those in mpfrFunctions below, which include all of
+// the pfp128_fast.h ones). They are kept to about 226 bits, as the nearest
+// binary128 value and what is left over, so errors well below an ulp are
+// resolved. The others are compared with libquadmath's binary128 functions,
+// which are exact for the likes of floor and fmod, but elsewhere only good
+// to about an ulp, so errors below that aren't resolved. With the native
+// backend on x86_64 the shims are the libquadmath functions, so a shim
+// whose reference would be libquadmath too isn't swept (it would only show
+// zeros). The CSV's reference column says which each row used.
+//
+// The arguments are rounded to FP128 before the reference is computed, so
+// both see exactly the same ones. Errors are in units in the last place of
+// binary128 (2^-112 relative, at the reference's exponent; for complex
+// results, at the exponent of the larger part; but never less than
+// FP128_DENORM_MIN, the least the backend can do), so with the double-double
+// backend, whose precision is about 106 bits, around 2^6 of them is the
+// best there can be. A result which is a NaN or infinity when the
+// reference isn't (or the other way round) is a mismatch, and makes the
+// maximum error infinite; so is an integer result (of ilogb, lrint and so
+// on) which isn't exactly right. The second result of frexp, modf and
+// remquo (returned through a pointer) counts too: the integral part of
+// modf in ulps like the first, and the exponent of frexp and quotient of
+// remquo as a mismatch unless they're right (for remquo, that's the sign
+// and the bottom three bits, which are all C promises).
+//
+// The regions are
+//   typical:    uniform over a range which suits the function (see
+//               typicalRanges below; (-10, 10) otherwise),
+//   wide:       magnitudes from 2^-64 to 2^64, logarithmically, either sign,
+//   subnormal:  magnitudes below FP128_MIN (2^-16382, or 2^-969 with
+//               double-double, below which it has less precision),
+//   huge:       magnitudes from 2^64 to the largest FP128,
+// with every argument of the function drawn from the region (integer ones
+// always from the typical range, and for integer results, magnitudes below
+// 2^62), or one given on the command line.
+//
+// Each sample's arguments are a function of the seed, the function, the
+// region and the sample's number alone, and the partial sums are added in
+// a fixed order, so the output is the same however many threads (with
+// OpenMP, all of the machine's) do the work. It's CSV,
+//   backend,function,region,reference,samples,max_ulp,mean_ulp,mismatches,
+//   worst
+// where worst is the (first) arguments giving the maximum error, as exact
+// hexadecimal floating point, so two runs can be compared with diff.
+//
+// Usage: sweepPFP128 [-n samples] [-s seed] [function[=spans]] ...
+//   -n samples  arguments per function and region (default 1000000)
+//   -s seed     choose other arguments (default 0)
+//   function    only sweep these functions (e.g. "sin pow exp_fast")
+//   =spans      in the one region given by spans, one per argument,
+//               separated by '/', each lin:lo:hi (uniform in [lo, hi)),
+//               log:lo:hi (magnitudes from 2^lo to 2^hi) or slog:lo:hi
+//               (likewise, either sign), e.g. "pow=lin:0:4/lin:-40:40"
+//
+
+#include <math.h>
+#include <quadmath.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define PFP128_KEEP_FUNCTION_LISTS 1
+#include "pfp128.h"
+#include "pfp128_fast.h"
+
+#if (!defined(__x86_64__))
+#error sweepPFP128.c needs libquadmath, for its reference values.
+#endif
+
+// Use MPFR if it's there (or say -DSWEEP_MPFR=0 not to).
+#if (!defined(SWEEP_MPFR) && defined(__has_include))
+#if (__has_include(<mpfr.h>))
+#define SWEEP_MPFR 1
+#endif
+#endif
+#if (SWEEP_MPFR)
+#define MPFR_WANT_FLOAT128 1
+#include <mpfr.h>
+#endif
+
+// Conversion between FP128 and binary128.
+static FP128 fromQuad(__float128 q) {
+#if (PFP128_IS_DD)
+  double hi = (double)q;
+  if (!isfinite(hi))
+    return dd_make(hi, 0.0);
+  return dd_make(hi, (double)(q - hi));
+#else
+  return q;
+#endif
+}
+
+static __float128 toQuad(FP128 x) {
+#if (PFP128_IS_DD)
+  // (Adding a zero lo would turn -0 into +0.)
+  return x.lo == 0 ? (__float128)x.hi : (__float128)x.hi + x.lo;
+#else
+  return x;
+#endif
+}
+
+// The arguments of one sample, argument k being q[2 * k] (and q[2 * k + 1]
+// for the imaginary part of a complex one), and somewhere for results
+// returned through pointers, by the function and by the reference.
+typedef struct {
+  __float128 q[6];
+  FP128 realOut;
+  __float128 quadOut;
+  int intOut, quadIntOut;
+} SweepArgs;
+
+// Argument k as type T, for the FP128 function and for the reference.
+static FP128 argReal(SweepArgs *a, int k) { return fromQuad(a->q[2 * k]); }
+static COMPLEX_FP128 argComplex(SweepArgs *a, int k) {
+  return CMPLXFP128(fromQuad(a->q[2 * k]), fromQuad(a->q[2 * k + 1]));
+}
+static int argInt(SweepArgs *a, int k) { return (int)a->q[2 * k]; }
+static char const *argString(SweepArgs *a, int k) {
+  (void)a;
+  (void)k;
+  return "";
+}
+static FP128 *argRealPtr(SweepArgs *a, int k) {
+  (void)k;
+  return &a->realOut;
+}
+static int *argIntPtr(SweepArgs *a, int k) {
+  (void)k;
+  return &a->intOut;
+}
+static __float128 quadReal(SweepArgs *a, int k) { return a->q[2 * k]; }
+static __complex128 quadComplex(SweepArgs *a, int k) {
+  __complex128 z;
+  __real__ z = a->q[2 * k];
+  __imag__ z = a->q[2 * k + 1];
+  return z;
+}
+static __float128 *quadRealPtr(SweepArgs *a, int k) {
+  (void)k;
+  return &a->quadOut;
+}
+static int *quadIntPtr(SweepArgs *a, int k) {
+  (void)k;
+  return &a->quadIntOut;
+}
+#define SWEEP_ARG(T, a, k)                                                     \
+  _Generic((T *)0,                                                             \
+      FP128 *: argReal,                                                        \
+      COMPLEX_FP128 *: argComplex,                                             \
+      int *: argInt,                                                           \
+      char const **: argString,                                                \
+      FP128 **: argRealPtr,                                                    \
+      int **: argIntPtr)(a, k)
+#define SWEEP_QUAD_ARG(T, a, k)                                                \
+  _Generic((T *)0,                                                             \
+      FP128 *: quadReal,                                                       \
+      COMPLEX_FP128 *: quadComplex,                                            \
+      int *: argInt,                                                           \
+      char const **: argString,                                                \
+      FP128 **: quadRealPtr,                                                   \
+      int **: quadIntPtr)(a, k)
+
+// How each argument is chosen: 'r'eal, 'c'omplex, 'i'nteger, or not at all
+// ('s'tring, which we skip, and 'p'ointer or i'n'teger pointer, for a
+// second result).
+#define SWEEP_KIND(T)                                                          \
+  _Generic((T *)0,                                                             \
+      FP128 *: 'r',                                                            \
+      COMPLEX_FP128 *: 'c',                                                    \
+      int *: 'i',                                                              \
+      char const **: 's',                                                      \
+      FP128 **: 'p',                                                           \
+      int **: 'n')
+// And for the result, 'i' for the integer types.
+#define SWEEP_RESULT_KIND(T)                                                   \
+  _Generic((T *)0, FP128 *: 'r', COMPLEX_FP128 *: 'c', default: 'i')
+
+// A result as the real and imaginary parts of a binary128 value.
+static void resultReal(FP128 x, __float128 *out) {
+  out[0] = toQuad(x);
+  out[1] = 0;
+}
+static void resultComplex(COMPLEX_FP128 z, __float128 *out) {
+  out[0] = toQuad(crealFP128(z));
+  out[1] = toQuad(cimagFP128(z));
+}
+static void resultQuad(__float128 x, __float128 *out) {
+  out[0] = x;
+  out[1] = 0;
+}
+static void resultQuadComplex(__complex128 z, __float128 *out) {
+  out[0] = __real__ z;
+  out[1] = __imag__ z;
+}
+static void resultInt(int x, __float128 *out) { resultQuad(x, out); }
+static void resultLong(long x, __float128 *out) { resultQuad(x, out); }
+static void resultLongLong(long long x, __float128 *out) {
+  resultQuad(x, out);
+}
+#define SWEEP_RESULT(x, out)                                                   \
+  _Generic((x),                                                                \
+      FP128: resultReal,                                                       \
+      COMPLEX_FP128: resultComplex,                                            \
+      int: resultInt,                                                          \
+      long: resultLong,                                                        \
+      long long: resultLongLong)(x, out)
+#define SWEEP_QUAD_RESULT(x, out)                                              \
+  _Generic((x),                                                                \
+      __float128: resultQuad,                                                  \
+      __complex128: resultQuadComplex,                                         \
+      int: resultInt,                                                          \
+      long: resultLong,                                                        \
+      long long: resultLongLong)(x, out)
+
+// Each function, and its reference, at one sample.
+typedef void (*Evaluate)(SweepArgs *a, __float128 *got, __float128 *want);
+
+// clang-format off
+#define SweepUnary(basename, restype, argtype)                          \
+static void basename##Evaluate(SweepArgs *a, __float128 *got,           \
+                               __float128 *want) {                      \
+  SWEEP_RESULT(basename##FP128(SWEEP_ARG(argtype, a, 0)), got);         \
+  SWEEP_QUAD_RESULT(basename##q(SWEEP_QUAD_ARG(argtype, a, 0)), want);  \
+}
+
+#define SweepBinary(basename, restype, at1, at2)                        \
+static void basename##Evaluate(SweepArgs *a, __float128 *got,           \
+                               __float128 *want) {                      \
+  SWEEP_RESULT(basename##FP128(SWEEP_ARG(at1, a, 0),                    \
+                               SWEEP_ARG(at2, a, 1)), got);             \
+  SWEEP_QUAD_RESULT(basename##q(SWEEP_QUAD_ARG(at1, a, 0),              \
+                                SWEEP_QUAD_ARG(at2, a, 1)), want);      \
+}
+
+#define SweepTernary(basename, restype, at1, at2, at3)                  \
+static void basename##Evaluate(SweepArgs *a, __float128 *got,           \
+                               __float128 *want) {                      \
+  SWEEP_RESULT(basename##FP128(SWEEP_ARG(at1, a, 0),                    \
+                               SWEEP_ARG(at2, a, 1),                    \
+                               SWEEP_ARG(at3, a, 2)), got);             \
+  SWEEP_QUAD_RESULT(basename##q(SWEEP_QUAD_ARG(at1, a, 0),              \
+                                SWEEP_QUAD_ARG(at2, a, 1),              \
+                                SWEEP_QUAD_ARG(at3, a, 2)), want);      \
+}
+
+// The pfp128_fast.h functions, against the same references.
+#define FOREACH_FAST_UNARY_FUNCTION(op)                                 \
+  op(exp) op(exp2) op(log) op(log2) op(log10) op(sin) op(cos)
+#define FOREACH_FAST_BINARY_FUNCTION(op) op(pow)
+
+#define SweepFastUnary(basename)                                        \
+static void basename##FastEvaluate(SweepArgs *a, __float128 *got,       \
+                                   __float128 *want) {                  \
+  resultReal(basename##FP128_fast(argReal(a, 0)), got);                 \
+  resultQuad(basename##q(quadReal(a, 0)), want);                        \
+}
+
+#define SweepFastBinary(basename)                                       \
+static void basename##FastEvaluate(SweepArgs *a, __float128 *got,       \
+                                   __float128 *want) {                  \
+  resultReal(basename##FP128_fast(argReal(a, 0), argReal(a, 1)), got);  \
+  resultQuad(basename##q(quadReal(a, 0), quadReal(a, 1)), want);        \
+}
+
+FOREACH_UNARY_FUNCTION(SweepUnary)
+FOREACH_BINARY_FUNCTION(SweepBinary)
+FOREACH_TERNARY_FUNCTION(SweepTernary)
+FOREACH_FAST_UNARY_FUNCTION(SweepFastUnary)
+FOREACH_FAST_BINARY_FUNCTION(SweepFastBinary)
+
+typedef struct {
+  char const *name;
+  char const *reference; // For the ranges, if it's not the same.
+  Evaluate evaluate;
+  char result;
+  char kind[3];
+} Function;
+
+#define UnaryEntry(basename, restype, argtype)                          \
+  {#basename, #basename, basename##Evaluate, SWEEP_RESULT_KIND(restype), \
+   {SWEEP_KIND(argtype)}},
+#define BinaryEntry(basename, restype, at1, at2)                        \
+  {#basename, #basename, basename##Evaluate, SWEEP_RESULT_KIND(restype), \
+   {SWEEP_KIND(at1), SWEEP_KIND(at2)}},
+#define TernaryEntry(basename, restype, at1, at2, at3)                  \
+  {#basename, #basename, basename##Evaluate, SWEEP_RESULT_KIND(restype), \
+   {SWEEP_KIND(at1), SWEEP_KIND(at2), SWEEP_KIND(at3)}},
+#define FastUnaryEntry(basename)                                        \
+  {#basename "_fast", #basename, basename##FastEvaluate, 'r', {'r'}},
+#define FastBinaryEntry(basename)                                       \
+  {#basename "_fast", #basename, basename##FastEvaluate, 'r', {'r', 'r'}},
+
+static Function const functions[] = {
+  FOREACH_UNARY_FUNCTION(UnaryEntry)
+  FOREACH_BINARY_FUNCTION(BinaryEntry)
+  FOREACH_TERNARY_FUNCTION(TernaryEntry)
+  FOREACH_FAST_UNARY_FUNCTION(FastUnaryEntry)
+  FOREACH_FAST_BINARY_FUNCTION(FastBinaryEntry)
+};
+// clang-format on
+
+// The MPFR reference functions, for the functions of that name (and their
+// _fast versions), which are all real.
+#if (SWEEP_MPFR)
+#define SWEEP_MPFR_PRECISION 256
+
+typedef int (*MpfrUnary)(mpfr_ptr, mpfr_srcptr, mpfr_rnd_t);
+typedef int (*MpfrBinary)(mpfr_ptr, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t);
+
+// (lgamma's sign isn't needed.)
+static int mpfrLgamma(mpfr_ptr r, mpfr_srcptr x, mpfr_rnd_t rnd) {
+  int sign;
+  return mpfr_lgamma(r, &sign, x, rnd);
+}
+
+typedef struct {
+  char const *name;
+  MpfrUnary unary;
+  MpfrBinary binary;
+} MpfrFunction;
+
+static MpfrFunction const mpfrFunctions[] = {
+    {"acos", mpfr_acos, NULL},   {"acosh", mpfr_acosh, NULL},
+    {"asin", mpfr_asin, NULL},   {"asinh", mpfr_asinh, NULL},
+    {"atan", mpfr_atan, NULL},   {"atanh", mpfr_atanh, NULL},
+    {"cbrt", mpfr_cbrt, NULL},   {"cosh", mpfr_cosh, NULL},
+    {"cos", mpfr_cos, NULL},     {"erf", mpfr_erf, NULL},
+    {"erfc", mpfr_erfc, NULL},   {"exp", mpfr_exp, NULL},
+    {"exp2", mpfr_exp2, NULL},   {"expm1", mpfr_expm1, NULL},
+    {"lgamma", mpfrLgamma, NULL}, {"log", mpfr_log, NULL},
+    {"log10", mpfr_log10, NULL}, {"log2", mpfr_log2, NULL},
+    {"log1p", mpfr_log1p, NULL}, {"sinh", mpfr_sinh, NULL},
+    {"sin", mpfr_sin, NULL},     {"sqrt", mpfr_sqrt, NULL},
+    {"tan", mpfr_tan, NULL},     {"tanh", mpfr_tanh, NULL},
+    {"tgamma", mpfr_gamma, NULL}, {"pow", NULL, mpfr_pow},
+    {"atan2", NULL, mpfr_atan2}, {"hypot", NULL, mpfr_hypot},
+};
+
+// The reference value at a's arguments, as want[0] + *lo, using the
+// variables v[0] to v[2].
+static void mpfrEvaluate(MpfrFunction const *m, SweepArgs const *a,
+                         mpfr_t *v, __float128 *want, __float128 *lo) {
+  mpfr_set_float128(v[0], a->q[0], MPFR_RNDN);
+  if (m->binary) {
+    mpfr_set_float128(v[1], a->q[2], MPFR_RNDN);
+    m->binary(v[2], v[0], v[1], MPFR_RNDN);
+  } else {
+    m->unary(v[2], v[0], MPFR_RNDN);
+  }
+  want[0] = mpfr_get_float128(v[2], MPFR_RNDN);
+  want[1] = 0;
+  *lo = 0;
+  if (finiteq(want[0])) {
+    mpfr_set_float128(v[1], want[0], MPFR_RNDN);
+    mpfr_sub(v[1], v[2], v[1], MPFR_RNDN);
+    *lo = mpfr_get_float128(v[1], MPFR_RNDN);
+  }
+}
+#else
+typedef struct MpfrFunction MpfrFunction;
+#endif
+
+// The MPFR reference for f, or NULL if it's compared with libquadmath.
+static MpfrFunction const *mpfrReference(Function const *f) {
+#if (SWEEP_MPFR)
+  size_t count = sizeof(mpfrFunctions) / sizeof(mpfrFunctions[0]);
+  for (MpfrFunction const *m = mpfrFunctions; m < mpfrFunctions + count; m++)
+    if (strcmp(m->name, f->reference) == 0)
+      return m;
+#else
+  (void)f;
+#endif
+  return NULL;
+}
+
+// How one argument is chosen: 'l'inear, uniform in [lo, hi); lo'g'arithmic,
+// magnitude 2^e with e from lo to hi; or 's'igned logarithmic.
+typedef struct {
+  char mode;
+  double lo, hi;
+} Span;
+
+// The typical ranges, where the default (-10, 10) isn't sensible. Complex
+// arguments use the range for both parts.
+typedef struct {
+  char const *name;
+  int arg;
+  double lo, hi;
+} Range;
+
+static Range const typicalRanges[] = {
+    {"acos", 0, -1.0, 1.0},      {"asin", 0, -1.0, 1.0},
+    {"atanh", 0, -1.0, 1.0},     {"acosh", 0, 1.0, 1000.0},
+    {"cosh", 0, -40.0, 40.0},    {"sinh", 0, -40.0, 40.0},
+    {"exp", 0, -40.0, 40.0},     {"exp2", 0, -60.0, 60.0},
+    {"expm1", 0, -40.0, 40.0},   {"log", 0, 0.0, 1000.0},
+    {"log10", 0, 0.0, 1000.0},   {"log2", 0, 0.0, 1000.0},
+    {"log1p", 0, -1.0, 1000.0},  {"sqrt", 0, 0.0, 1.0e6},
+    {"cbrt", 0, -1.0e6, 1.0e6},  {"lgamma", 0, -50.0, 100.0},
+    {"tgamma", 0, -50.0, 50.0},  {"pow", 0, 0.0, 4.0},
+    {"pow", 1, -40.0, 40.0},     {"cpow", 0, -2.0, 2.0},
+    {"cpow", 1, -2.0, 2.0},      {"ldexp", 1, -100.0, 100.0},
+    {"fmod", 1, 0.5, 3.0},       {"remainder", 1, 0.5, 3.0},
+    {"remquo", 1, 0.5, 3.0},
+};
+
+static Span typicalSpan(char const *name, int arg) {
+  Span s = {'l', -10.0, 10.0};
+  size_t count = sizeof(typicalRanges) / sizeof(typicalRanges[0]);
+  for (Range const *r = typicalRanges; r < typicalRanges + count; r++)
+    if (r->arg == arg && strcmp(r->name, name) == 0) {
+      s.lo = r->lo;
+      s.hi = r->hi;
+    }
+  return s;
+}
+
+static struct {
+  char const *name;
+  Span span;
+} const regions[] = {
+    {"typical", {'l', 0.0, 0.0}}, // From typicalRanges.
+    {"wide", {'s', -64.0, 64.0}},
+    {"subnormal",
+     {'s', FP128_MIN_EXP - FP128_MANT_DIG, FP128_MIN_EXP - 2}},
+    {"huge", {'s', 64.0, FP128_MAX_EXP - 1}},
+};
+
+// A stateless pseudo-random function (the SplitMix64 finaliser), so that
+// each sample's arguments depend only on its number, not on which thread
+// draws them.
+static uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static uint64_t hashName(uint64_t h, char const *s) {
+  for (; *s; s++)
+    h = (h ^ (unsigned char)*s) * 0x100000001b3ull;
+  return h;
+}
+
+// A value from the span, from three random words.
+static __float128 sample(Span const *s, uint64_t r0, uint64_t r1,
+                         uint64_t r2) {
+  // 113 random bits, in [0, 1).
+  __float128 u = ((__float128)(r0 >> 11) + (__float128)(r1 >> 4) * 0x1p-60Q) *
+                 0x1p-53Q;
+  if (s->mode == 'l')
+    return s->lo + (s->hi - s->lo) * u;
+  long lo = (long)s->lo, span = (long)s->hi - lo + 1;
+  int e = (int)(lo + (long)(r2 % (uint64_t)span));
+  __float128 x = scalbnq(1 + u, e);
+  return s->mode == 's' && (r2 >> 63) ? -x : x;
+}
+
+// The arguments of sample i, rounded to FP128.
+static void arguments(SweepArgs *a, uint64_t key, Span const *spans,
+                      char const *kind, uint64_t i) {
+  for (int j = 0; j < 6; j++) {
+    int k = j / 2;
+    if (!kind[k] || strchr("pn", kind[k]) || (kind[k] != 'c' && (j & 1))) {
+      a->q[j] = 0;
+      continue;
+    }
+    uint64_t base = mix(key ^ mix(i * 8 + (uint64_t)j));
+    a->q[j] = sample(&spans[k], base, mix(base), mix(base + 1));
+    a->q[j] = kind[k] == 'i' ? floorq(a->q[j]) : toQuad(fromQuad(a->q[j]));
+  }
+}
+
+// The error in ulps of got, given the exact(ish) want + lo and the value
+// whose ulp we measure in, infinite if only one of them is a NaN or
+// infinity.
+static double ulps(__float128 got, __float128 want, __float128 lo,
+                   __float128 scale) {
+  if (isnanq(got) || isnanq(want))
+    return isnanq(got) && isnanq(want) ? 0.0 : INFINITY;
+  if (isinfq(got) || isinfq(want))
+    return got == want ? 0.0 : INFINITY;
+  int least = FP128_MIN_EXP - FP128_MANT_DIG;
+  int e = scale == 0 ? least : ilogbq(scale) - 112;
+  // (got - want is exact when they're close.)
+  return (double)scalbnq(fabsq(got - want - lo), -(e < least ? least : e));
+}
+
+// Whether the integer second result got is right, given the reference's.
+static int secondIntMatches(Function const *f, int got, int want) {
+  if (strcmp(f->reference, "remquo") != 0)
+    return got == want;
+  int g = got < 0 ? -got : got, w = want < 0 ? -want : want;
+  return (g & 7) == (w & 7) && (g == 0 || w == 0 || (got < 0) == (want < 0));
+}
+
+typedef struct {
+  double sum, max;
+  uint64_t count, worst, mismatches;
+} Stats;
+
+enum { BLOCK = 4096 };
+
+// Sweep one function over one region, printing a line of results.
+static void sweep(Function const *f, char const *label, Span const *spans,
+                  uint64_t samples, uint64_t seed) {
+  uint64_t key = hashName(hashName(0xcbf29ce484222325ull ^ seed, f->name),
+                          label);
+  uint64_t blocks = (samples + BLOCK - 1) / BLOCK;
+#if (SWEEP_MPFR)
+  MpfrFunction const *reference = mpfrReference(f);
+#endif
+  Stats *part = (Stats *)calloc(blocks, sizeof(*part));
+  if (!part) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+#if (defined(_OPENMP))
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (uint64_t b = 0; b < blocks; b++) {
+    Stats s = {0.0, -1.0, 0, 0, 0};
+    uint64_t end = (b + 1) * BLOCK < samples ? (b + 1) * BLOCK : samples;
+#if (SWEEP_MPFR)
+    mpfr_t v[3];
+    for (int k = 0; k < 3; k++)
+      mpfr_init2(v[k], SWEEP_MPFR_PRECISION);
+#endif
+    for (uint64_t i = b * BLOCK; i < end; i++) {
+      SweepArgs a;
+      __float128 got[2], want[2], lo = 0;
+      arguments(&a, key, spans, f->kind, i);
+      f->evaluate(&a, got, want);
+#if (SWEEP_MPFR)
+      if (reference)
+        mpfrEvaluate(reference, &a, v, want, &lo);
+#endif
+      __float128 scale = fmaxq(fabsq(want[0]), fabsq(want[1]));
+      double err = fmax(ulps(got[0], want[0], lo, scale),
+                        ulps(got[1], want[1], 0, scale));
+      if (f->result == 'i')
+        err = got[0] == want[0] ? 0.0 : INFINITY;
+      // And the second result, if there is one.
+      if (memchr(f->kind, 'p', sizeof(f->kind)))
+        err = fmax(err, ulps(toQuad(a.realOut), a.quadOut, 0,
+                             fabsq(a.quadOut)));
+      if (memchr(f->kind, 'n', sizeof(f->kind)) &&
+          !secondIntMatches(f, a.intOut, a.quadIntOut))
+        err = INFINITY;
+      if (isinf(err)) {
+        s.mismatches++;
+      } else {
+        s.sum += err;
+        s.count++;
+      }
+      if (err > s.max) {
+        s.max = err;
+        s.worst = i;
+      }
+    }
+#if (SWEEP_MPFR)
+    for (int k = 0; k < 3; k++)
+      mpfr_clear(v[k]);
+#endif
+    part[b] = s;
+  }
+
+  // Combine the blocks in order, keeping the first of equal maxima.
+  Stats total = {0.0, -1.0, 0, 0, 0};
+  for (uint64_t b = 0; b < blocks; b++) {
+    total.sum += part[b].sum;
+    total.count += part[b].count;
+    total.mismatches += part[b].mismatches;
+    if (part[b].max > total.max) {
+      total.max = part[b].max;
+      total.worst = part[b].worst;
+    }
+  }
+  free(part);
+
+  char worst[256] = "";
+  if (samples) {
+    SweepArgs a;
+    arguments(&a, key, spans, f->kind, total.worst);
+    size_t used = 0;
+    for (int j = 0; j < 6; j++) {
+      int k = j / 2;
+      if (!f->kind[k] || strchr("pn", f->kind[k]) ||
+          (f->kind[k] != 'c' && (j & 1)))
+        continue;
+      // quadmath_snprintf takes only one conversion, so each value is
+      // formatted on its own, then appended.
+      char value[64];
+      int length = quadmath_snprintf(value, sizeof(value), "%.28Qa", a.q[j]);
+      if (length < 0 || (size_t)length >= sizeof(value))
+        continue;
+      length = snprintf(worst + used, sizeof(worst) - used, "%s%s",
+                        used ? " " : "", value);
+      if (length > 0 && (size_t)length < sizeof(worst) - used)
+        used += (size_t)length;
+    }
+  }
+  printf("%s,%s,%s,%s,%llu,%.3g,%.3g,%llu,%s\n", PFP128_BACKEND_NAME, f->name,
+         label, mpfrReference(f) ? "mpfr" : "libquadmath",
+         (unsigned long long)samples, samples ? total.max : 0.0,
+         total.count ? total.sum / (double)total.count : 0.0,
+         (unsigned long long)total.mismatches, worst);
+  fflush(stdout);
+}
+
+// Parse spans given as lin:lo:hi/log:lo:hi/..., returning the number.
+static int parseSpans(char const *text, Span *spans) {
+  int n = 0;
+  while (*text && n < 3) {
+    char mode[8];
+    int used = 0;
+    if (sscanf(text, "%7[a-z]:%lf:%lf%n", mode, &spans[n].lo, &spans[n].hi,
+               &used) != 3)
+      return 0;
+    if (strcmp(mode, "lin") == 0)
+      spans[n].mode = 'l';
+    else if (strcmp(mode, "log") == 0)
+      spans[n].mode = 'g';
+    else if (strcmp(mode, "slog") == 0)
+      spans[n].mode = 's';
+    else
+      return 0;
+    n++;
+    text += used;
+    if (*text == '/')
+      text++;
+    else if (*text)
+      return 0;
+  }
+  return *text ? 0 : n;
+}
+
+// The command line argument naming f (if any are given), or NULL.
+static char const *selected(Function const *f, int argc, char **argv,
+                            int *any) {
+  size_t length = strlen(f->name);
+  *any = 0;
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') {
+      i++;
+      continue;
+    }
+    *any = 1;
+    if (strncmp(argv[i], f->name, length) == 0 &&
+        (argv[i][length] == 0 || argv[i][length] == '='))
+      return argv[i];
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  uint64_t samples = 1000000, seed = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      samples = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Usage: %s [-n samples] [-s seed] [function[=spans]] "
+                      "...\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  printf("backend,function,region,reference,samples,max_ulp,mean_ulp,"
+         "mismatches,worst\n");
+  for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++) {
+    Function const *f = &functions[i];
+    int any;
+    char const *arg = selected(f, argc, argv, &any);
+    if ((any && !arg) || memchr(f->kind, 's', sizeof(f->kind)))
+      continue;
+    // A native shim is the libquadmath function.
+    if (!PFP128_IS_DD && strcmp(f->name, f->reference) == 0 &&
+        !mpfrReference(f))
+      continue;
+    Span spans[3];
+    char const *equals = arg ? strchr(arg, '=') : NULL;
+    if (equals) {
+      int n = parseSpans(equals + 1, spans);
+      if (n == 0) {
+        fprintf(stderr, "Can't understand the spans in %s\n", arg);
+        return 1;
+      }
+      for (int k = n; k < 3; k++)
+        spans[k] = spans[n - 1];
+      sweep(f, "custom", spans, samples, seed);
+      continue;
+    }
+    for (size_t r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+      for (int k = 0; k < 3; k++) {
+        spans[k] = r == 0 || f->kind[k] == 'i' ? typicalSpan(f->reference, k)
+                                               : regions[r].span;
+        // Integer results must fit in a long.
+        if (f->result == 'i' && spans[k].mode != 'l' && spans[k].hi > 61)
+          spans[k].hi = 61;
+      }
+      if (f->result == 'i' && spans[0].lo > spans[0].hi)
+        continue;
+      sweep(f, regions[r].name, spans, samples, seed);
+    }
+  }
+  return 0;
+}
@@ -19,9 +19,14 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #define PFP128_SHOW_CONFIG 1
 #include "pfp128.h"
+#if (PFP128_LIB)
+// Everything below then uses libpfp128 for the functions it provides.
+#include "pfp128_lib.h"
+#endif
 
 // Expand a macro and convert the result into a string
 #define STRINGIFY1(...) #__VA_ARGS__
@@ -79,7 +84,10 @@
 #endif
 #endif
 
-#if (defined(__LONG_DOUBLE_IEEE128__))
+#if (PFP128_IS_DD)
+// With the double-double backend the underlying functions are in pfp128_dd.h
+#define FP128Name(base) base##dd
+#elif (defined(__LONG_DOUBLE_IEEE128__))
 #define FP128Name(base) base##l
 #define FP128ConstName(base) base##L
 #else
@@ -88,6 +96,33 @@
 #define FP128ConstName(base) base##Q
 #endif // end of architecture spcific setup.
 
+// Since the double-double FP128 is a struct we can't use the C operators on it,
+// so the tests only use the portable arithmetic and comparison functions.
+#define QUARTER_PI divFP128(M_PI_FP128, FP128_CONST(4.0))
+
+// Within n ulp (at expected's exponent).
+static int withinUlpsFP128(FP128 x, FP128 expected, int n) {
+  FP128 error = fabsFP128(subFP128(x, expected));
+  FP128 ulp = ldexpFP128(FP128_EPSILON, ilogbFP128(expected));
+  return leFP128(error, mulFP128(FP128_from_ll(n), ulp));
+}
+
+// A shim's result should be the underlying function's, other than those
+// which PFP128_FAST_MATH replaces with pfp128_fast.h's, which are within 4
+// ulp of it.
+static int shimMatches(char const *name, FP128 baseResult, FP128 ourResult) {
+#if (PFP128_FAST_MATH)
+  static char const *const fast[] = {"exp", "log", "log2", "log10",
+                                     "pow", "sin", "cos"};
+  for (size_t i = 0; i < sizeof(fast) / sizeof(fast[0]); i++)
+    if (strcmp(name, fast[i]) == 0)
+      return withinUlpsFP128(ourResult, baseResult, 4);
+#else
+  (void)name;
+#endif
+  return eqFP128(baseResult, ourResult);
+}
+
 // From here on the code is common no matter what the underlying implementation.
 // clang-format really messes up the multiple line macro definitions :-(
 // clang-format off
@@ -105,6 +140,21 @@ static void printError(char const * baseName,
   printf("*** %s FAILED: %sFP128 => %s %s => %s\n",
 	 baseName, baseName, orstr, underlyingName, brstr);				
 }
+
+static void printComplexError(char const * baseName,
+                              COMPLEX_FP128 baseResult,
+                              COMPLEX_FP128 ourResult) {
+  char brstr[100];
+  char orstr[100];
+
+  FP128_snprintf(&brstr[0], sizeof(brstr),
+                 "(%12.10" FP128_FMT_TAG "f,%12.10" FP128_FMT_TAG "f)",
+                 crealFP128(baseResult), cimagFP128(baseResult));
+  FP128_snprintf(&orstr[0], sizeof(orstr),
+                 "(%12.10" FP128_FMT_TAG "f,%12.10" FP128_FMT_TAG "f)",
+                 crealFP128(ourResult), cimagFP128(ourResult));
+  printf("*** %s FAILED: base=%s ours=%s\n", baseName, brstr, orstr);
+}
 		       
 // These functions are all happy with pi/4 as an argument:-)
 #define FOREACH_128TO128_UNARY_FUNCTION(op)     \
@@ -179,10 +229,10 @@ static void printError(char const * baseName,
 
 #define TestUnary128to128Function(basename, restype, argtype)           \
   {                                                                     \
-    restype baseResult = FP128Name(basename)(M_PI_FP128/4.0);           \
-    restype ourResult  = basename##FP128(M_PI_FP128/4.0);               \
+    restype baseResult = FP128Name(basename)(QUARTER_PI);               \
+    restype ourResult  = basename##FP128(QUARTER_PI);                   \
                                                                         \
-    if (baseResult == ourResult) {                                      \
+    if (shimMatches(STRINGIFY(basename), baseResult, ourResult)) {      \
       if (verbose)                                                      \
         printf ("%-9s passed\n", STRINGIFY(basename));                  \
       passes++;                                                         \
@@ -203,7 +253,7 @@ static void test128to128UnaryFunctions() {
     FP128 baseResult = FP128Name(acosh)(M_PI_FP128);
     FP128 ourResult  = acoshFP128(M_PI_FP128);
 
-    if (baseResult == ourResult) {
+    if (eqFP128(baseResult, ourResult)) {
       if (verbose)
         printf ("acosh     passed\n");
       passes++;
@@ -216,8 +266,8 @@ static void test128to128UnaryFunctions() {
 
 #define TestUnary128toIntFunction(basename, restype, argtype,fmt)       \
   {                                                                     \
-    restype baseResult = FP128Name(basename)(M_PI_FP128/4.0);           \
-    restype ourResult  = basename##FP128(M_PI_FP128/4.0);               \
+    restype baseResult = FP128Name(basename)(QUARTER_PI);               \
+    restype ourResult  = basename##FP128(QUARTER_PI);                   \
                                                                         \
     if (baseResult == ourResult) {                                      \
       if (verbose)                                                      \
@@ -235,19 +285,16 @@ static void test128toIntUnaryFunctions() {
 }
 
 #define TestComplexTo128Function(basename,restype, argtype) {           \
-    argtype arg = 1.0 + 2.0 * _Complex_I;                               \
+    argtype arg = CMPLXFP128(FP128_CONST(1.0), FP128_CONST(2.0));       \
     restype baseResult = FP128Name(basename)(arg);                      \
     restype ourResult  = basename##FP128(arg);                          \
                                                                         \
-    if (baseResult == ourResult) {                                      \
+    if (eqFP128(baseResult, ourResult)) {                               \
       if (verbose)                                                      \
         printf ("%-9s passed\n", STRINGIFY(basename));                  \
       passes++;                                                         \
     } else {                                                            \
-      printf("*** " #basename " FAILED: base=%12.10" FP128_FMT_TAG      \
-             "f ours=%12.10" FP128_FMT_TAG "f\n",                       \
-             baseResult,                                                \
-             ourResult);                                                \
+      printError(STRINGIFY(basename), STRINGIFY(FP128Name(basename)), baseResult, ourResult); \
       failures++;                                                       \
     }                                                                   \
   }
@@ -258,22 +305,17 @@ static void testComplexTo128UnaryFunctions() {
 
 
 #define TestComplexToComplexFunction(basename,restype, argtype) {       \
-    argtype arg = 1.0 + 2.0 * _Complex_I;                               \
+    argtype arg = CMPLXFP128(FP128_CONST(1.0), FP128_CONST(2.0));       \
     restype baseResult = FP128Name(basename)(arg);                      \
     restype ourResult  = basename##FP128(arg);                          \
                                                                         \
-    if (baseResult == ourResult) {                                      \
+    if (eqFP128(crealFP128(baseResult), crealFP128(ourResult)) &&       \
+        eqFP128(cimagFP128(baseResult), cimagFP128(ourResult))) {       \
       if (verbose)                                                      \
         printf ("%-9s passed\n", STRINGIFY(basename));                  \
       passes++;                                                         \
     } else {                                                            \
-      printf("*** " #basename " FAILED: base=(%12.10" FP128_FMT_TAG     \
-             "f,%12.10" FP128_FMT_TAG "f) ours=(%12.10" FP128_FMT_TAG   \
-             "f,%12.10" FP128_FMT_TAG "f)\n",                           \
-             FP128Name(creal)(baseResult),                              \
-             FP128Name(cimag)(baseResult),                              \
-             FP128Name(creal)(ourResult),                               \
-             FP128Name(cimag)(ourResult));                              \
+      printComplexError(STRINGIFY(basename), baseResult, ourResult);    \
       failures++;                                                       \
     }                                                                   \
   }
@@ -298,10 +340,10 @@ static void testComplexToComplexUnaryFunctions() {
 
 #define Test128BinaryFunction(basename, restype, at1, at2)              \
   {                                                                     \
-    restype baseResult = FP128Name(basename)(M_PI_FP128/4.0, 1.0);      \
-    restype ourResult  = basename##FP128(M_PI_FP128/4.0, 1.0);          \
+    restype baseResult = FP128Name(basename)(QUARTER_PI, FP128_CONST(1.0)); \
+    restype ourResult  = basename##FP128(QUARTER_PI, FP128_CONST(1.0));     \
                                                                         \
-    if (baseResult == ourResult) {                                      \
+    if (shimMatches(STRINGIFY(basename), baseResult, ourResult)) {      \
       if (verbose)                                                      \
          printf ("%-9s passed\n", STRINGIFY(basename));                 \
       passes++;                                                         \
@@ -319,9 +361,688 @@ static void test128BinaryFunctions() {
   FOREACH_128BINARY_FUNCTION(Test128BinaryFunction)
 }
 
+// Check that the batched forms agree with the scalar ones, including the
+// strided and broadcast variants.
+static void testBatched() {
+  enum { N = 7 };
+  FP128 x[N], y[N], z[N], out[N], strided[2 * N];
+  int ok = 1;
+
+  for (int i = 0; i < N; i++) {
+    x[i] = divFP128(M_PI_FP128, FP128_from_ll(i + 2));
+    y[i] = addFP128(FP128_CONST(1.0), FP128_from_ll(i));
+    z[i] = mulFP128(FP128_CONST(0.5), FP128_from_ll(i));
+  }
+
+  expFP128_n(x, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], expFP128(x[i]));
+
+  sinFP128_ns(x, 1, strided, 2, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(strided[2 * i], sinFP128(x[i]));
+
+  powFP128_nvs(x, FP128_CONST(3.0), out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], powFP128(x[i], FP128_CONST(3.0)));
+
+  atan2FP128_n(x, y, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], atan2FP128(x[i], y[i]));
+
+  fmaFP128_nsvv(M_E_FP128, x, z, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], fmaFP128(M_E_FP128, x[i], z[i]));
+
+  mulFP128_n(x, y, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], mulFP128(x[i], y[i]));
+
+  // Each second result goes to its own element.
+  int ints[N], expected;
+  FP128 parts[N], part;
+  frexpFP128_n(y, ints, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], frexpFP128(y[i], &expected)) &&
+         ints[i] == expected;
+  modfFP128_n(z, parts, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], modfFP128(z[i], &part)) &&
+         eqFP128(parts[i], part);
+  remquoFP128_n(y, x, ints, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && eqFP128(out[i], remquoFP128(y[i], x[i], &expected)) &&
+         ints[i] == expected;
+
+  if (ok) {
+    if (verbose)
+      printf("batched   passed\n");
+    passes++;
+  } else {
+    printf("*** batched FAILED\n");
+    failures++;
+  }
+}
+
+// Within a few ulp.
+static int closeFP128(FP128 x, FP128 expected) {
+  FP128 error = fabsFP128(subFP128(x, expected));
+  return leFP128(error, mulFP128(fabsFP128(expected),
+                                 mulFP128(FP128_from_double(8.0), FP128_EPSILON)));
+}
+
+// The fused functions should agree with the separate ones (to a few ulp,
+// since they don't compute them in quite the same way).
+static void testFused() {
+  enum { N = 6 };
+  FP128 x[N] = {FP128_CONST(0.5), FP128_CONST(-3.75), FP128_CONST(1.0e-20),
+                FP128_CONST(40.0), FP128_CONST(-200.0), FP128_CONST(1.0e6)};
+  FP128 s[N], c[N];
+  COMPLEX_FP128 z[N], cs[N], cc[N];
+  int ok = 1;
+
+  sincosFP128_n(x, s, c, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && closeFP128(s[i], sinFP128(x[i])) &&
+         closeFP128(c[i], cosFP128(x[i]));
+
+  sinhcoshFP128_n(x, s, c, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && (isinfFP128(s[i]) ? eqFP128(s[i], sinhFP128(x[i]))
+                                 : closeFP128(s[i], sinhFP128(x[i]))) &&
+         (isinfFP128(c[i]) ? eqFP128(c[i], coshFP128(x[i]))
+                           : closeFP128(c[i], coshFP128(x[i])));
+
+  for (int i = 0; i < N; i++)
+    z[i] = CMPLXFP128(x[i], divFP128(FP128_from_ll(i - 2), FP128_CONST(3.0)));
+  csincosFP128_n(z, cs, cc, N);
+  for (int i = 0; i < N; i++) {
+    COMPLEX_FP128 es = csinFP128(z[i]), ec = ccosFP128(z[i]);
+    ok = ok && closeFP128(crealFP128(cs[i]), crealFP128(es)) &&
+         closeFP128(cimagFP128(cs[i]), cimagFP128(es)) &&
+         closeFP128(crealFP128(cc[i]), crealFP128(ec)) &&
+         closeFP128(cimagFP128(cc[i]), cimagFP128(ec));
+  }
+
+  if (ok) {
+    if (verbose)
+      printf("fused     passed\n");
+    passes++;
+  } else {
+    printf("*** fused FAILED\n");
+    failures++;
+  }
+}
+
+#include "pfp128_complex.h"
+#include "pfp128_fft.h"
+#include "pfp128_poly.h"
+#include "pfp128_blas.h"
+#include "pfp128_solve.h"
+
+static int closeComplex(COMPLEX_FP128 z, COMPLEX_FP128 expected) {
+  return closeFP128(crealFP128(z), crealFP128(expected)) &&
+         closeFP128(cimagFP128(z), cimagFP128(expected));
+}
+
+// The limited range complex arithmetic, and the scaled division, which
+// should manage when |b|^2 overflows.
+static void testComplexArithmetic() {
+  enum { N = 3 };
+  COMPLEX_FP128 a = CMPLXFP128(FP128_CONST(1.0), FP128_CONST(2.0));
+  COMPLEX_FP128 b = CMPLXFP128(FP128_CONST(3.0), FP128_CONST(-4.0));
+  COMPLEX_FP128 ab = CMPLXFP128(FP128_CONST(11.0), FP128_CONST(2.0));
+  COMPLEX_FP128 one = CMPLXFP128(FP128_CONST(1.0), FP128_CONST(0.0));
+  int ok = closeComplex(cmulFP128(a, b), ab) &&
+           closeComplex(cfmaFP128(a, b, one),
+                        CMPLXFP128(FP128_CONST(12.0), FP128_CONST(2.0))) &&
+           closeComplex(cdivFP128(ab, b), a) &&
+           closeComplex(cdivScaledFP128(ab, b), a);
+
+#if (!PFP128_IS_DD)
+  // Fused: (1 + 2^-60)(1 - 2^-60) - 1 is -2^-120, where rounding the
+  // product first would give 0.
+  FP128 tiny = ldexpFP128(FP128_CONST(1.0), -60);
+  COMPLEX_FP128 fused = cfmaFP128(
+      CMPLXFP128(addFP128(FP128_CONST(1.0), tiny), FP128_CONST(0.0)),
+      CMPLXFP128(subFP128(FP128_CONST(1.0), tiny), FP128_CONST(0.0)),
+      CMPLXFP128(FP128_CONST(-1.0), FP128_CONST(1.0)));
+  ok = ok && eqFP128(crealFP128(fused), negFP128(mulFP128(tiny, tiny))) &&
+       eqFP128(cimagFP128(fused), FP128_CONST(1.0));
+#endif
+
+  FP128 big = ldexpFP128(FP128_CONST(1.0), FP128_MAX_EXP / 2 + 10);
+  COMPLEX_FP128 huge = CMPLXFP128(big, big);
+  COMPLEX_FP128 q = cdivScaledFP128(cmulFP128(a, huge), huge);
+  ok = ok && closeComplex(q, a) && !closeComplex(cdivFP128(a, huge),
+                                                 cdivScaledFP128(a, huge));
+
+  COMPLEX_FP128 x[N], y[N], out[N];
+  for (int i = 0; i < N; i++) {
+    x[i] = CMPLXFP128(FP128_from_ll(i + 1), FP128_from_ll(i + 2));
+    y[i] = CMPLXFP128(FP128_from_ll(2 - i), FP128_CONST(0.5));
+  }
+  cfmaFP128_nsvv(a, x, y, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && closeComplex(out[i], cfmaFP128(a, x[i], y[i]));
+  cdivFP128_n(x, y, out, N);
+  for (int i = 0; i < N; i++)
+    ok = ok && closeComplex(cmulFP128(out[i], y[i]), x[i]);
+
+  if (ok) {
+    if (verbose)
+      printf("complex arithmetic passed\n");
+    passes++;
+  } else {
+    printf("*** complex arithmetic FAILED\n");
+    failures++;
+  }
+}
+
+// The transforms should match the DFT computed directly, to within a few
+// ulp of the largest value, for lengths with factors of 4, 2 and odd primes.
+static int nearComplex(COMPLEX_FP128 z, COMPLEX_FP128 expected, FP128 tol) {
+  return leFP128(fabsFP128(subFP128(crealFP128(z), crealFP128(expected))),
+                 tol) &&
+         leFP128(fabsFP128(subFP128(cimagFP128(z), cimagFP128(expected))),
+                 tol);
+}
+
+static void testFFT() {
+  enum { MAXN = 48 };
+  static const size_t lengths[] = {1, 2, 7, 12, 16, 45, 48};
+  int ok = 1;
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    size_t n = lengths[l];
+    COMPLEX_FP128 x[2 * MAXN], X[2 * MAXN], y[MAXN], direct[MAXN];
+    FP128 r[MAXN], rr[MAXN];
+    for (size_t i = 0; i < n; i++) {
+      r[i] = FP128_from_ll((long long)(i * i % 7) - 3);
+      x[i] = CMPLXFP128(FP128_from_ll((long long)i + 1), r[i]);
+      x[n + i] = CMPLXFP128(r[i], FP128_CONST(0.0));
+    }
+    FP128 twoPi = mulFP128(FP128_CONST(2.0), M_PI_FP128);
+    FP128 fn = FP128_from_ll((long long)n);
+    for (size_t k = 0; k < n; k++) {
+      FP128 re = FP128_CONST(0.0), im = FP128_CONST(0.0);
+      for (size_t j = 0; j < n; j++) {
+        FP128 s, c;
+        FP128 angle = divFP128(FP128_from_ll((long long)(j * k % n)), fn);
+        sincosFP128(mulFP128(twoPi, angle), &s, &c);
+        // x[j] * (c - i s)
+        re = addFP128(re, addFP128(mulFP128(crealFP128(x[j]), c),
+                                   mulFP128(cimagFP128(x[j]), s)));
+        im = addFP128(im, subFP128(mulFP128(cimagFP128(x[j]), c),
+                                   mulFP128(crealFP128(x[j]), s)));
+      }
+      direct[k] = CMPLXFP128(re, im);
+    }
+    FP128 tol = mulFP128(mulFP128(FP128_from_ll(64), mulFP128(fn, fn)),
+                         FP128_EPSILON);
+    FP128_FFT_PLAN *p = FP128_fft_plan(n);
+    FP128_RFFT_PLAN *rp = FP128_rfft_plan(n);
+    ok = ok && p && rp && FP128_fft(p, x, X, FP128_FFT_FORWARD) == 0;
+    for (size_t k = 0; ok && k < n; k++)
+      ok = nearComplex(X[k], direct[k], tol);
+    // Backwards, in place, gives n x.
+    ok = ok && FP128_fft(p, X, X, FP128_FFT_BACKWARD) == 0;
+    for (size_t i = 0; ok && i < n; i++)
+      ok = nearComplex(X[i],
+                       CMPLXFP128(mulFP128(crealFP128(x[i]), fn),
+                                  mulFP128(cimagFP128(x[i]), fn)),
+                       tol);
+    // Both halves of x together, then the real part on its own.
+    ok = ok && FP128_fft_n(p, x, X, 2, FP128_FFT_FORWARD) == 0 &&
+         FP128_fft(p, x + n, y, FP128_FFT_FORWARD) == 0;
+    for (size_t k = 0; ok && k < n; k++)
+      ok = nearComplex(X[k], direct[k], tol) &&
+           nearComplex(X[n + k], y[k], tol);
+    ok = ok && FP128_rfft(rp, r, direct) == 0;
+    for (size_t k = 0; ok && k <= n / 2; k++)
+      ok = nearComplex(direct[k], y[k], tol);
+    ok = ok && FP128_irfft(rp, direct, rr) == 0;
+    for (size_t i = 0; ok && i < n; i++)
+      ok = leFP128(fabsFP128(subFP128(rr[i], mulFP128(r[i], fn))), tol);
+    FP128_fft_destroy(p);
+    FP128_rfft_destroy(rp);
+  }
+
+  if (ok) {
+    if (verbose)
+      printf("fft passed\n");
+    passes++;
+  } else {
+    printf("*** fft FAILED\n");
+    failures++;
+  }
+}
+
+// With small integers (and powers of two on the diagonals) everything is
+// exact, so we can compare the results with those of the obvious loops.
+// The sizes cross the blocking (and the gemm is done with every transpose).
+static void testPoly() {
+  // With small integer coefficients, and x and its powers dyadic, all the
+  // arithmetic is exact, so the schemes should agree exactly with the
+  // obvious loops.
+  enum { D = 20, N = 7 };
+  FP128 c[D + 1], q[4], x[N], y[N];
+  for (int k = 0; k <= D; k++)
+    c[k] = FP128_from_ll(k % 5 - 2);
+  for (int k = 0; k < 4; k++)
+    q[k] = FP128_from_ll(k + 1);
+  for (int i = 0; i < N; i++)
+    x[i] = ldexpFP128(FP128_from_ll(i - 3), -(i % 3));
+  int ok = 1;
+  for (size_t degree = 0; ok && degree <= D; degree++) {
+    for (int i = 0; ok && i < N; i++) {
+      // Horner's rule, Q (for the rational function) and the Chebyshev
+      // polynomials by their recurrence.
+      FP128 p = c[degree], den = q[3], cheb = c[0];
+      FP128 t0 = FP128_CONST(1.0), t1 = x[i];
+      for (size_t k = degree; k-- > 0;)
+        p = addFP128(mulFP128(p, x[i]), c[k]);
+      for (int k = 2; k >= 0; k--)
+        den = addFP128(mulFP128(den, x[i]), q[k]);
+      for (size_t k = 1; k <= degree; k++) {
+        cheb = addFP128(cheb, mulFP128(c[k], t1));
+        FP128 t2 = subFP128(mulFP128(FP128_CONST(2.0), mulFP128(x[i], t1)), t0);
+        t0 = t1;
+        t1 = t2;
+      }
+      ok = eqFP128(polyEvalFP128(c, degree, x[i]), p) &&
+           eqFP128(ratEvalFP128(c, degree, q, 3, x[i]), divFP128(p, den)) &&
+           eqFP128(chebEvalFP128(c, degree, x[i]), cheb);
+    }
+    // The array versions, in place, over a length that isn't a multiple of
+    // the lanes.
+    for (int i = 0; i < N; i++)
+      y[i] = x[i];
+    polyEvalFP128_n(c, degree, y, y, N);
+    for (int i = 0; ok && i < N; i++)
+      ok = eqFP128(y[i], polyEvalFP128(c, degree, x[i]));
+    ratEvalFP128_n(c, degree, q, 3, x, y, N);
+    for (int i = 0; ok && i < N; i++)
+      ok = eqFP128(y[i], ratEvalFP128(c, degree, q, 3, x[i]));
+    chebEvalFP128_n(c, degree, x, y, N);
+    for (int i = 0; ok && i < N; i++)
+      ok = eqFP128(y[i], chebEvalFP128(c, degree, x[i]));
+  }
+
+  if (ok) {
+    if (verbose)
+      printf("poly passed\n");
+    passes++;
+  } else {
+    printf("*** poly FAILED\n");
+    failures++;
+  }
+}
+
+static void testBLAS() {
+  enum { M = 261, S = 5, K = 300 };
+  static FP128 A[M * K], B[K * S], C[M * M], D[M * S], T[M * M], X[M * S];
+  FP128 zero = FP128_CONST(0.0);
+  for (int i = 0; i < M * K; i++)
+    A[i] = FP128_from_ll(i * 7 % 11 - 5);
+  for (int i = 0; i < K * S; i++)
+    B[i] = FP128_from_ll(i * 5 % 13 - 6);
+  int ok = 1;
+
+  // Level 1, with strides.
+  FP128 x[9], y[9];
+  for (int i = 0; i < 9; i++) {
+    x[i] = FP128_from_ll(i - 4);
+    y[i] = FP128_from_ll(2 * i + 1);
+  }
+  // x[8], x[5], x[2] . y[0], y[4], y[8] = 4 + 1 * 9 - 2 * 17 = -21
+  ok = ok && eqFP128(FP128_dot(3, x + 2, -3, y, 4), FP128_CONST(-21.0)) &&
+       eqFP128(FP128_dot(9, x, 1, x, 1), FP128_CONST(60.0)) &&
+       eqFP128(FP128_nrm2(2, x + 1, 7), FP128_CONST(5.0));
+  FP128_axpy(3, FP128_CONST(2.0), x, 4, y, 1);
+  FP128_scal(2, FP128_CONST(-0.5), y + 4, 2);
+  ok = ok && eqFP128(y[0], FP128_CONST(-7.0)) &&
+       eqFP128(y[2], FP128_CONST(13.0)) && eqFP128(y[4], FP128_CONST(-4.5)) &&
+       eqFP128(y[6], FP128_CONST(-6.5));
+
+  // A strided dot product has to cancel as well as a contiguous one: 1e40
+  // + 1 - 1e40, with the terms 256 elements apart.
+  for (int i = 0; i < 2 * 512; i++)
+    X[i] = FP128_CONST(0.0);
+  X[0] = FP128_CONST(1e40);
+  X[2] = FP128_CONST(1.0);
+  X[512] = FP128_CONST(-1e40);
+  for (int i = 0; i < 512; i++)
+    D[i] = FP128_CONST(1.0);
+  ok = ok && eqFP128(FP128_dot(512, X, 2, D, 1), FP128_CONST(1.0)) &&
+       eqFP128(FP128_dot(512, D, 1, X, -2), FP128_CONST(1.0));
+
+  for (int ta = 0; ta < 2; ta++) {
+    // y = 2 op(A) x - y, where A is M by K.
+    FP128 *v = X, *w = X + K, *r = X + 2 * K;
+    size_t rows = ta ? K : M, cols = ta ? M : K;
+    for (size_t i = 0; i < cols; i++)
+      v[i] = FP128_from_ll((long long)(i % 5) - 2);
+    for (size_t i = 0; i < rows; i++) {
+      FP128 sum = zero;
+      for (size_t j = 0; j < cols; j++)
+        sum = addFP128(sum, mulFP128(ta ? A[j * K + i] : A[i * K + j], v[j]));
+      w[i] = FP128_from_ll((long long)i);
+      r[i] = subFP128(mulFP128(FP128_CONST(2.0), sum), w[i]);
+    }
+    FP128_gemv((FP128_BLAS_TRANSPOSE)ta, M, K, FP128_CONST(2.0), A, K, v, 1,
+               FP128_CONST(-1.0), w, 1);
+    for (size_t i = 0; i < rows; i++)
+      ok = ok && eqFP128(w[i], r[i]);
+
+    for (int tb = 0; tb < 2; tb++) {
+      // C = 2 op(A) op(B) - C, where op(A) is M by K and op(B) K by S.
+      size_t lda = ta ? M : K, ldb = tb ? K : S;
+      for (size_t i = 0; i < M; i++)
+        for (size_t j = 0; j < S; j++) {
+          FP128 sum = zero;
+          for (size_t p = 0; p < K; p++)
+            sum = addFP128(sum, mulFP128(ta ? A[p * lda + i] : A[i * lda + p],
+                                         tb ? B[j * ldb + p] : B[p * ldb + j]));
+          C[i * S + j] = FP128_from_ll((long long)(i + j));
+          D[i * S + j] =
+              subFP128(mulFP128(FP128_CONST(2.0), sum), C[i * S + j]);
+        }
+      ok = ok && FP128_gemm((FP128_BLAS_TRANSPOSE)ta, (FP128_BLAS_TRANSPOSE)tb,
+                            M, S, K, FP128_CONST(2.0), A, lda, B, ldb,
+                            FP128_CONST(-1.0), C, S) == 0;
+      for (int i = 0; ok && i < M * S; i++)
+        ok = eqFP128(C[i], D[i]);
+    }
+  }
+
+  // Triangular solves. T is A's lower triangle, with 1, 2 or 4 on the
+  // diagonal, or its upper one; the other triangle is filled with rubbish,
+  // which shouldn't be read.
+  for (int k = 0; k < 16; k++) {
+    int side = k & 1, lower = (k >> 1) & 1, trans = (k >> 2) & 1;
+    int unit = (k >> 3) & 1;
+    for (size_t i = 0; i < M; i++)
+      for (size_t j = 0; j < M; j++) {
+        FP128 a = A[i * K + j];
+        if (i == j)
+          a = unit ? FP128_CONST(1.0) : FP128_from_ll(1 << (i % 3));
+        else if ((i > j) != lower)
+          a = zero;
+        T[i * M + j] = a;
+        C[i * M + j] = a;
+        if (i != j && (i > j) != lower)
+          C[i * M + j] = FP128_CONST(99.0);
+        else if (i == j && unit)
+          C[i * M + j] = FP128_CONST(99.0);
+      }
+    // B = op(T) X or X op(T), with X M by S or S by M.
+    size_t m = side ? S : M, n = side ? M : S;
+    for (size_t i = 0; i < M * S; i++)
+      X[i] = FP128_from_ll((long long)(i % 7) - 3);
+    if (side)
+      ok = ok && FP128_gemm(FP128_BLAS_NO_TRANS, (FP128_BLAS_TRANSPOSE)trans,
+                            m, n, n, FP128_CONST(1.0), X, n, T, M, zero, D,
+                            n) == 0;
+    else
+      ok = ok && FP128_gemm((FP128_BLAS_TRANSPOSE)trans, FP128_BLAS_NO_TRANS,
+                            m, n, m, FP128_CONST(1.0), T, M, X, n, zero, D,
+                            n) == 0;
+    // Solve with alpha = 2, for 2 X.
+    ok = ok && FP128_trsm((FP128_BLAS_SIDE)side,
+                          lower ? FP128_BLAS_LOWER : FP128_BLAS_UPPER,
+                          (FP128_BLAS_TRANSPOSE)trans,
+                          unit ? FP128_BLAS_UNIT : FP128_BLAS_NON_UNIT, m, n,
+                          FP128_CONST(2.0), C, M, D, n) == 0;
+    for (size_t i = 0; ok && i < M * S; i++)
+      ok = eqFP128(D[i], mulFP128(FP128_CONST(2.0), X[i]));
+  }
+
+  if (ok) {
+    if (verbose)
+      printf("blas passed\n");
+    passes++;
+  } else {
+    printf("*** blas FAILED\n");
+    failures++;
+  }
+}
+
+// Check that each row of A X = B holds to within a few ulp of the sum of
+// the magnitudes of its products.
+static int solvedFP128(FP128 const *A, FP128 const *B, FP128 const *X,
+                       size_t n, size_t nrhs) {
+  FP128 a[16], x[16];
+  for (size_t j = 0; j < nrhs; j++)
+    for (size_t i = 0; i < n; i++) {
+      FP128 scale = FP128_CONST(0.0);
+      for (size_t k = 0; k < n; k++) {
+        a[k] = A[i * n + k];
+        x[k] = X[k * nrhs + j];
+        scale = addFP128(scale, fabsFP128(mulFP128(a[k], x[k])));
+      }
+      FP128 r = subFP128(B[i * nrhs + j], dotFP128_n(a, x, n));
+      if (gtFP128(fabsFP128(r),
+                  mulFP128(mulFP128(FP128_CONST(8.0), FP128_EPSILON), scale)))
+        return 0;
+    }
+  return 1;
+}
+
+static void testSolve() {
+  enum { N = 8, NRHS = 2 };
+  FP128 A[N * N], L[N * N], B[N * NRHS], X[N * NRHS];
+  FP128_SOLVER s;
+  int ok = 1;
+
+  // The Hilbert matrix, cond(A) about 1.5e10, by Cholesky (with rubbish in
+  // the upper triangle, which shouldn't be read) and LU.
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = 0; j < N; j++) {
+      A[i * N + j] =
+          divFP128(FP128_CONST(1.0), FP128_from_ll((long long)(i + j + 1)));
+      L[i * N + j] = j > i ? FP128_CONST(99.0) : A[i * N + j];
+    }
+    B[i * NRHS] = FP128_CONST(1.0);
+    B[i * NRHS + 1] = divFP128(FP128_from_ll((long long)i), FP128_CONST(3.0));
+  }
+  ok = ok && FP128_solver_cholesky(&s, L, N, N) == 0 &&
+       FP128_solver_solve(&s, B, NRHS, X, NRHS, NRHS) == 0 &&
+       solvedFP128(A, B, X, N, NRHS);
+  FP128_solver_free(&s);
+  ok = ok && FP128_solver_lu(&s, A, N, N) == 0 &&
+       FP128_solver_solve(&s, B, NRHS, X, NRHS, NRHS) == 0 &&
+       solvedFP128(A, B, X, N, NRHS);
+  FP128_solver_free(&s);
+
+  // A well-conditioned matrix which needs pivoting, with the exact solution
+  // X = i - j, which we should get to within a modest number of ulp of one.
+  for (size_t i = 0; i < N; i++)
+    for (size_t j = 0; j < N; j++)
+      A[i * N + j] =
+          FP128_from_ll(i == j ? 0 : (long long)((i * 5 + j * 3) % 7) - 3);
+  for (size_t i = 0; i < N; i++)
+    for (size_t j = 0; j < NRHS; j++) {
+      FP128 sum = FP128_CONST(0.0);
+      for (size_t k = 0; k < N; k++)
+        sum = addFP128(sum, mulFP128(A[i * N + k], FP128_from_ll((long long)k -
+                                                                (long long)j)));
+      B[i * NRHS + j] = sum;
+    }
+  ok = ok && FP128_solver_lu(&s, A, N, N) == 0 &&
+       FP128_solver_solve(&s, B, NRHS, X, NRHS, NRHS) == 0;
+  for (size_t i = 0; ok && i < N * NRHS; i++) {
+    FP128 x = FP128_from_ll((long long)(i / NRHS) - (long long)(i % NRHS));
+    ok = ltFP128(fabsFP128(subFP128(X[i], x)),
+                 mulFP128(FP128_CONST(1024.0), FP128_EPSILON));
+  }
+  FP128_solver_free(&s);
+
+  // A singular matrix.
+  for (size_t i = 0; i < N * N; i++)
+    A[i] = FP128_from_ll((long long)(i % N));
+  ok = ok && FP128_solver_lu(&s, A, N, N) != 0;
+
+  if (ok) {
+    if (verbose)
+      printf("solve passed\n");
+    passes++;
+  } else {
+    printf("*** solve FAILED\n");
+    failures++;
+  }
+}
+
+#if (!PFP128_IS_DD && defined(__SIZEOF_INT128__) &&                           \
+     (__x86_64__ || LDBL_MANT_DIG == 113))
+#define TEST_SOFT_ARITHMETIC 1
+#include "pfp128_soft.h"
+
+static FP128SQ toSQ(FP128 x) {
+  FP128SQ r;
+  memcpy(&r, &x, sizeof(r));
+  return r;
+}
+
+// Results must be bit identical, except that any NaN will do.
+static int sameResult(FP128 expected, FP128SQ ours) {
+  if (expected != expected)
+    return isnansq(ours);
+  return toSQ(expected).bits == ours.bits;
+}
+
+// Check the inline software arithmetic against the compiler's, on values
+// which cover the special cases, subnormals, overflow and cancellation.
+static void testSoftArithmetic() {
+  FP128 values[] = {
+      FP128_CONST(0.0), -FP128_CONST(0.0), FP128_CONST(1.0), -FP128_CONST(3.0),
+      M_PI_FP128, -M_E_FP128, M_PI_FP128 + FP128_EPSILON, FP128_MAX,
+      -FP128_MAX, FP128_MIN, FP128_DENORM_MIN, FP128_MIN / FP128_CONST(3.0),
+      -FP128_MIN * FP128_EPSILON * FP128_CONST(5.0), HUGE_VALFP128,
+      -HUGE_VALFP128, FP128Name(nan)(""), FP128_CONST(1.0) / M_PI_FP128,
+      FP128_CONST(1e4000), FP128_CONST(-1e-4000), FP128_CONST(0.1)};
+  int const n = sizeof(values) / sizeof(values[0]);
+  int ok = 1;
+
+  for (int i = 0; i < n; i++) {
+    FP128 a = values[i];
+    FP128SQ sa = toSQ(a);
+    ok = ok && sameResult(FP128_to_double(a), sq_from_double(sq_to_double(sa)));
+    for (int j = 0; j < n; j++) {
+      FP128 b = values[j];
+      FP128SQ sb = toSQ(b);
+      ok = ok && sameResult(a + b, addsq(sa, sb));
+      ok = ok && sameResult(a - b, subsq(sa, sb));
+      ok = ok && sameResult(a * b, mulsq(sa, sb));
+      ok = ok && sameResult(a / b, divsq(sa, sb));
+      ok = ok && (a < b) == ltsq(sa, sb) && (a <= b) == lesq(sa, sb);
+      ok = ok && (a == b) == eqsq(sa, sb);
+      for (int k = 0; k < n; k++) {
+        FP128SQ sc = toSQ(values[k]);
+        ok = ok && sameResult(fmaFP128(a, b, values[k]), fmasq(sa, sb, sc));
+        // Adding c and then -c leaves a * b, rounded once.
+        if (isfinitesq(sc) && (sc.bits & SQ_ABS_MASK) && a * b != 0)
+          ok = ok && sameResult(a * b, dot2addsq(sa, sb, sc,
+                                                 sq_from_double(1.0),
+                                                 negsq(sc)));
+      }
+    }
+  }
+
+  if (ok) {
+    if (verbose)
+      printf("soft arithmetic passed\n");
+    passes++;
+  } else {
+    printf("*** soft arithmetic FAILED\n");
+    failures++;
+  }
+}
+
+#include "pfp128_simd.h"
+
+// Check each of the structure of arrays implementations which this machine
+// can run against the operators, both on the awkward values above (which
+// the vector code hands to the scalar code) and on ordinary ones.
+static void testSoA() {
+  FP128 values[] = {
+      FP128_CONST(0.0), -FP128_CONST(0.0), FP128_CONST(1.0), -FP128_CONST(3.0),
+      M_PI_FP128, -M_E_FP128, M_PI_FP128 + FP128_EPSILON, FP128_MAX,
+      -FP128_MAX, FP128_MIN, FP128_DENORM_MIN, FP128_MIN / FP128_CONST(3.0),
+      HUGE_VALFP128, -HUGE_VALFP128, FP128Name(nan)(""),
+      FP128_CONST(1.0) / M_PI_FP128, FP128_CONST(1e4000), FP128_CONST(0.1)};
+  int const nv = sizeof(values) / sizeof(values[0]);
+  enum { NORMAL = 61 };
+  size_t const n = nv * nv + NORMAL;
+  char const *isas[] = {"scalar", "avx2", "avx512"};
+  FP128 a[nv * nv + NORMAL], b[nv * nv + NORMAL], c[nv * nv + NORMAL];
+  FP128 out[nv * nv + NORMAL];
+  double d[nv * nv + NORMAL];
+  FP128_SOA sa, sb, sc, sr;
+  int ok = FP128_soa_alloc(&sa, n) == 0 && FP128_soa_alloc(&sb, n) == 0 &&
+           FP128_soa_alloc(&sc, n) == 0 && FP128_soa_alloc(&sr, n) == 0;
+
+  for (size_t i = 0; i < n; i++) {
+    if (i < (size_t)(nv * nv)) {
+      a[i] = values[i / nv];
+      b[i] = values[i % nv];
+      c[i] = values[(i * 7) % nv];
+    } else {
+      a[i] = M_PI_FP128 * (FP128)(i + 1) / FP128_CONST(7.0);
+      b[i] = -M_E_FP128 / (FP128)(i - 3);
+      // Nearly cancels the product in some cases.
+      c[i] = (i & 1) ? -a[i] * b[i] * (FP128_CONST(1.0) + FP128_EPSILON)
+                     : FP128_CONST(1.0) / (FP128)i;
+    }
+    d[i] = FP128_to_double(a[i]);
+  }
+  if (ok) {
+    FP128_soa_load(&sa, a);
+    FP128_soa_load(&sb, b);
+    FP128_soa_load(&sc, c);
+  }
+
+  for (size_t k = 0; ok && k < sizeof(isas) / sizeof(isas[0]); k++) {
+    if (FP128_soa_set_isa(isas[k]) != 0)
+      continue;
+    if (verbose)
+      printf("SoA testing %s\n", FP128_soa_isa());
+    FP128_soa_add(&sr, &sa, &sb);
+    for (size_t i = 0; i < n; i++)
+      ok = ok && sameResult(a[i] + b[i], toSQ(FP128_soa_get(&sr, i)));
+    FP128_soa_mul(&sr, &sa, &sb);
+    for (size_t i = 0; i < n; i++)
+      ok = ok && sameResult(a[i] * b[i], toSQ(FP128_soa_get(&sr, i)));
+    FP128_soa_fma(&sr, &sa, &sb, &sc);
+    FP128_soa_store(out, &sr);
+    for (size_t i = 0; i < n; i++)
+      ok = ok && sameResult(fmaFP128(a[i], b[i], c[i]), toSQ(out[i]));
+    double r[nv * nv + NORMAL];
+    FP128_soa_to_double(r, &sa);
+    for (size_t i = 0; i < n; i++)
+      ok = ok && (r[i] == d[i] || (r[i] != r[i] && d[i] != d[i]));
+    FP128_soa_from_double(&sr, d);
+    for (size_t i = 0; i < n; i++)
+      ok = ok && sameResult((FP128)d[i], toSQ(FP128_soa_get(&sr, i)));
+  }
+  FP128_soa_free(&sa);
+  FP128_soa_free(&sb);
+  FP128_soa_free(&sc);
+  FP128_soa_free(&sr);
+
+  if (ok) {
+    if (verbose)
+      printf("SoA arithmetic passed\n");
+    passes++;
+  } else {
+    printf("*** SoA arithmetic FAILED\n");
+    failures++;
+  }
+}
+#endif
+
 static void testInput() {
   FP128 value = strtoFP128("2.718281828459045235360287471352662498", (void *)0);
-  if (value == M_E_FP128) {
+  if (eqFP128(value, M_E_FP128)) {
     if (verbose)
       printf("strtoFP128 passed\n");
     passes++;
@@ -334,9 +1055,16 @@ static void testInput() {
 // Does snprintf work with the tag we believe should be used?
 static void testPrintf() {
   char line[64];
+#if (PFP128_IS_DD)
+  // Double-double only has ~32 significant decimal digits.
+  char const * correct = "2.718281828459045235360287471353";
+  char const * format = "%32.30" FP128_FMT_TAG "f";
+#else
   char const * correct = "2.718281828459045235360287471352662";
+  char const * format = "%35.33" FP128_FMT_TAG "f";
+#endif
   
-  (void)FP128_snprintf(&line[0], sizeof(line),"%35.33" FP128_FMT_TAG "f", M_E_FP128);
+  (void)FP128_snprintf(&line[0], sizeof(line), format, M_E_FP128);
   if (!strcmp(&line[0],correct)) {
     if (verbose)
       printf("FP128_snprintf passed\n");
@@ -348,8 +1076,10 @@ static void testPrintf() {
     failures++;
   }
 
+#if (!PFP128_IS_DD)
   // And what about the system version?
-  (void)snprintf(&line[0], sizeof(line),"%35.33" FP128_FMT_TAG "f", M_E_FP128);
+  // (Which can't be expected to know about our double-double struct.)
+  (void)snprintf(&line[0], sizeof(line), format, M_E_FP128);
   if (!strcmp(&line[0],correct)) {
     if (verbose)
       printf("snprintf  passed\n");
@@ -360,12 +1090,909 @@ static void testPrintf() {
 	   "*** not     '%s'\n",&line[0],correct);
     failures++;
   }
+#endif
 
   if (sizeof(FP128) != 16) {
     printf ("*** These failures are expected, since the notional FP128 type is not really that long!\n");
   }
 }
 
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define TEST_TO_CHARS 1
+#include "pfp128_charconv.h"
+
+// Check FP128_to_chars on values (exactly representable in both backends)
+// whose text we know, including ties and rounding which carries into a new
+// digit, and that the shortest forms read back as the same value.
+static void testToChars() {
+  static struct {
+    double value;
+    FP128_CHARS_FORMAT fmt;
+    int precision; // Negative for the shortest form.
+    char const *text;
+  } const cases[] = {
+      {0.0, FP128_CHARS_SCIENTIFIC, -1, "0e+00"},
+      {-0.0, FP128_CHARS_FIXED, -1, "-0"},
+      {1.5, FP128_CHARS_GENERAL, -1, "1.5"},
+      {-1024.0, FP128_CHARS_SCIENTIFIC, -1, "-1.024e+03"},
+      {0.0009765625, FP128_CHARS_GENERAL, -1, "0.0009765625"},
+      {1e22, FP128_CHARS_GENERAL, -1, "1e+22"},
+      {1e22, FP128_CHARS_FIXED, -1, "10000000000000000000000"},
+      {2.5, FP128_CHARS_FIXED, 0, "2"},
+      {3.5, FP128_CHARS_FIXED, 0, "4"},
+      {0.125, FP128_CHARS_FIXED, 2, "0.12"},
+      {-1234.5, FP128_CHARS_SCIENTIFIC, 2, "-1.23e+03"},
+      {999.96875, FP128_CHARS_FIXED, 1, "1000.0"},
+      {99999.5, FP128_CHARS_GENERAL, 5, "1e+05"},
+      {0.00006103515625, FP128_CHARS_GENERAL, 3, "6.1e-05"},
+      {0.099999904632568359375, FP128_CHARS_GENERAL, 4, "0.1"},
+      {100000.0, FP128_CHARS_GENERAL, 6, "100000"},
+      {1e300, FP128_CHARS_SCIENTIFIC, 0, "1e+300"},
+      {HUGE_VAL, FP128_CHARS_GENERAL, -1, "inf"},
+      {-HUGE_VAL, FP128_CHARS_FIXED, 3, "-inf"}};
+  int const n = sizeof(cases) / sizeof(cases[0]);
+  char line[64];
+  int ok = 1;
+
+  for (int i = 0; i < n; i++) {
+    FP128 value = FP128_from_double(cases[i].value);
+    char *end = cases[i].precision < 0
+                    ? FP128_to_chars(line, line + sizeof(line) - 1, value,
+                                     cases[i].fmt)
+                    : FP128_to_chars_precision(line, line + sizeof(line) - 1,
+                                               value, cases[i].fmt,
+                                               cases[i].precision);
+    // It must also fail cleanly if the buffer is one character too short.
+    char *shortEnd = line + strlen(cases[i].text) - 1;
+    int good = end && (*end = 0, !strcmp(line, cases[i].text)) &&
+               !(cases[i].precision < 0
+                     ? FP128_to_chars(line, shortEnd, value, cases[i].fmt)
+                     : FP128_to_chars_precision(line, shortEnd, value,
+                                                cases[i].fmt,
+                                                cases[i].precision));
+    if (!good)
+      printf("*** FP128_to_chars gave '%s' not '%s'\n", end ? line : "NULL",
+             cases[i].text);
+    ok = ok && good;
+  }
+
+  FP128 values[] = {M_PI_FP128, negFP128(M_E_FP128), FP128_MAX, FP128_MIN,
+                    divFP128(FP128_from_double(1.0), FP128_from_double(3.0))};
+  int const nv = sizeof(values) / sizeof(values[0]);
+  char text[nv * FP128_CHARS_MAX];
+  char *end = FP128_to_chars_n(text, text + sizeof(text) - 1, values, nv,
+                               FP128_CHARS_GENERAL, ' ');
+  ok = ok && end;
+#if (!PFP128_IS_DD)
+  // (A double-double value needn't be the nearest to the binary128 value
+  // which the digits describe, so this only holds for binary128.)
+  char *next = text;
+  for (int i = 0; end && i < nv; i++) {
+    ok = ok && eqFP128(strtoFP128(next, &next), values[i]);
+  }
+#endif
+
+  if (ok) {
+    if (verbose)
+      printf("FP128_to_chars passed\n");
+    passes++;
+  } else {
+    printf("*** FP128_to_chars FAILED\n");
+    failures++;
+  }
+}
+
+// Check FP128_from_chars on strings whose values we know, and that it reads
+// back what FP128_to_chars writes.
+static void testFromChars() {
+  static struct {
+    char const *text;
+    int length; // How much of it should be read, or -1 if none.
+    double value;
+  } const cases[] = {
+      {"1.5", 3, 1.5},
+      {"-0.0009765625e+3x", 16, -0.9765625},
+      {".25E1,", 5, 2.5},
+      {"1e", 1, 1.0},
+      {"+0001024.", 9, 1024.0},
+      {"-0", 2, -0.0},
+      {"1e99999", 7, HUGE_VAL},
+      {"-1e-99999", 9, -0.0},
+      {"-Infinity", 9, -HUGE_VAL},
+      {"infinite", 3, HUGE_VAL},
+      {"1.000000000000000000000000000000000000000000001", 47, 1.0},
+      {".", -1, 0.0},
+      {"-e5", -1, 0.0},
+      {"0x10", 1, 0.0}};
+  int const n = sizeof(cases) / sizeof(cases[0]);
+  int ok = 1;
+
+  for (int i = 0; i < n; i++) {
+    char const *text = cases[i].text;
+    FP128 value = FP128_from_double(-1.0);
+    FP128 expected = FP128_from_double(cases[i].value);
+    char const *end = FP128_from_chars(text, text + strlen(text), &value);
+    int good = cases[i].length < 0
+                   ? !end
+                   : end == text + cases[i].length &&
+                         !memcmp(&value, &expected, sizeof(value));
+    if (!good)
+      printf("*** FP128_from_chars misread '%s'\n", text);
+    ok = ok && good;
+  }
+  FP128 value;
+  char const *nan = "nan(123)";
+  ok = ok && FP128_from_chars(nan, nan + 8, &value) == nan + 8 &&
+       isnanFP128(value);
+
+  FP128 values[] = {M_PI_FP128, negFP128(M_E_FP128), FP128_MAX, FP128_MIN,
+                    divFP128(FP128_from_double(1.0), FP128_from_double(3.0))};
+  size_t const nv = sizeof(values) / sizeof(values[0]);
+  char text[nv * FP128_CHARS_MAX];
+  char *last = FP128_to_chars_n(text, text + sizeof(text), values, nv,
+                                FP128_CHARS_SCIENTIFIC, ',');
+  FP128 read[nv + 1];
+  char const *end;
+  ok = ok && last &&
+       FP128_from_chars_n(text, last, read, nv + 1, &end) == nv &&
+       end == last && !memcmp(read, values, sizeof(values));
+
+  if (ok) {
+    if (verbose)
+      printf("FP128_from_chars passed\n");
+    passes++;
+  } else {
+    printf("*** FP128_from_chars FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define TEST_FILE_IO 1
+#include "pfp128_io.h"
+
+// Check that values written to a file read back (and map) as the same
+// values, that corruption is caught, and the conversion from other byte
+// orders and encodings.
+static void testFileIO() {
+  FP128 values[] = {M_PI_FP128, negFP128(M_E_FP128), FP128_MAX, FP128_MIN,
+                    divFP128(FP128_from_double(1.0), FP128_from_double(3.0))};
+  size_t const nv = sizeof(values) / sizeof(values[0]);
+  char const *path = "testPFP128.tmp";
+  size_t n = 0;
+  int ok = FP128_file_write(path, values, nv, FP128_FILE_CHECKSUM) == 0;
+  FP128 *read = ok ? FP128_file_read(path, &n) : NULL;
+  ok = ok && read && n == nv && !memcmp(read, values, sizeof(values));
+  free(read);
+
+  FP128_FILE_MAP map;
+  ok = ok && FP128_file_map(path, &map, FP128_FILE_CHECKSUM) == 0 &&
+       map.n == nv && !memcmp(map.values, values, sizeof(values)) &&
+       (!PFP128_HAVE_MMAP || !map.copied);
+  FP128_file_unmap(&map);
+
+  FILE *f = fopen(path, "r+b");
+  ok = ok && f && fseek(f, sizeof(FP128_FILE_HEADER) + 20, SEEK_SET) == 0 &&
+       fputc(0x55, f) != EOF;
+  if (f)
+    fclose(f);
+  ok = ok && !FP128_file_read(path, &n) && errno == EIO;
+  remove(path);
+
+  // 1 + 2^-100 in each encoding, with the bytes of each word reversed.
+  uint64_t binary128[2] = {PFP128_BIG_ENDIAN ? 0x3fff000000000000ull : 0x1000,
+                           PFP128_BIG_ENDIAN ? 0x1000 : 0x3fff000000000000ull};
+  double doubleDouble[2] = {1.0, 0x1p-100};
+  uint64_t swapped[2][2];
+  memcpy(swapped[1], doubleDouble, sizeof(doubleDouble));
+  for (int i = 0; i < 2; i++) {
+    swapped[0][i] = __builtin_bswap64(binary128[1 - i]);
+    swapped[1][i] = __builtin_bswap64(swapped[1][i]);
+  }
+  FP128 expected = addFP128(FP128_from_double(1.0),
+                            FP128_from_double(0x1p-100));
+  FP128 converted[2];
+  FP128_file_convert(&converted[0], swapped[0], 1, FP128_FILE_BINARY128, 1);
+  FP128_file_convert(&converted[1], swapped[1], 1, FP128_FILE_DOUBLE_DOUBLE,
+                     1);
+  ok = ok && eqFP128(converted[0], expected) &&
+       eqFP128(converted[1], expected);
+
+  if (ok) {
+    if (verbose)
+      printf("FP128 file I/O passed\n");
+    passes++;
+  } else {
+    printf("*** FP128 file I/O FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define TEST_REDUCE 1
+#include "pfp128_reduce.h"
+
+// Check the accurate reductions on sums which lose everything in double,
+// spread over several blocks, and on norms which overflow or underflow if
+// the squares aren't scaled.
+static void testReduce() {
+  size_t const groups = 10000, n = 4 * groups;
+  double *x = (double *)malloc(n * sizeof(double));
+  double *y = (double *)malloc(n * sizeof(double));
+  for (size_t i = 0; i < n; i += 4) {
+    x[i] = 1e20, x[i + 1] = 1.0, x[i + 2] = -1e20, x[i + 3] = 0x1p-70;
+    y[i] = 1.0, y[i + 1] = 3.0, y[i + 2] = 1.0, y[i + 3] = 1.0;
+  }
+  FP128 count = FP128_from_double((double)groups);
+  FP128 tiny = FP128_from_double(0x1p-70);
+  FP128 sum = mulFP128(count, addFP128(FP128_from_double(1.0), tiny));
+  FP128 dot = mulFP128(count, addFP128(FP128_from_double(3.0), tiny));
+  int ok = eqFP128(sumFP128_d(x, n), sum) && eqFP128(dotFP128_d(x, y, n), dot);
+
+  double big[2] = {0x3p600, 0x4p600}, small[2] = {0x3p-600, 0x4p-600};
+  ok = ok && eqFP128(normFP128_d(big, 2), FP128_from_double(0x5p600)) &&
+       eqFP128(normFP128_d(small, 2), FP128_from_double(0x5p-600));
+  x[7] = HUGE_VAL;
+  ok = ok && isinfFP128(sumFP128_d(x, n));
+  x[9] = -HUGE_VAL;
+  ok = ok && isnanFP128(sumFP128_d(x, n));
+  free(x);
+  free(y);
+
+  // 1 + 2^-100, which isn't a double.
+  FP128 one = FP128_from_double(1.0);
+  FP128 a = addFP128(one, FP128_from_double(0x1p-100));
+  FP128 values[4] = {a, FP128_from_double(1e30), a, FP128_from_double(-1e30)};
+  FP128 as[2] = {a, a}, others[2] = {a, negFP128(one)};
+  FP128 scaled[2] = {FP128_from_double(0x3p600), FP128_from_double(0x4p600)};
+  ok = ok && eqFP128(sumFP128_n(values, 4), addFP128(a, a)) &&
+       eqFP128(dotFP128_n(as, others, 2), mulFP128(a, subFP128(a, one))) &&
+       eqFP128(normFP128_n(scaled, 2), FP128_from_double(0x5p600));
+
+  // Values of very different sizes whose products are all ordinary, a zero
+  // made of negative zeros, and (with binary128) products which overflow
+  // and cancel, leaving one which underflows in double.
+  double wide[2] = {0x1p-996, 0x3p995}, flip[2] = {0x1p996, 0x1p-996};
+  double minusZero[2] = {-0.0, -0.0}, plusZero[2] = {0.0, -0.0};
+  FP128 wideN[2] = {FP128_from_double(wide[0]), FP128_from_double(wide[1])};
+  FP128 flipN[2] = {FP128_from_double(flip[0]), FP128_from_double(flip[1])};
+  FP128 twoHalf = FP128_from_double(2.5);
+  ok = ok && eqFP128(dotFP128_d(wide, flip, 2), twoHalf) &&
+       eqFP128(dotFP128_n(wideN, flipN, 2), twoHalf) &&
+       signbitFP128(sumFP128_d(minusZero, 2)) &&
+       !signbitFP128(sumFP128_d(plusZero, 2)) &&
+       signbitFP128(dotFP128_d(minusZero, flip, 2)) &&
+       !signbitFP128(normFP128_d(minusZero, 2));
+#if (!PFP128_IS_DD)
+  double big3[3] = {1e300, -1e300, 1e-300}, other3[3] = {1e300, 1e300, 1e-300};
+  FP128 tinyProduct = mulFP128(FP128_from_double(1e-300),
+                               FP128_from_double(1e-300));
+  ok = ok && eqFP128(dotFP128_d(big3, other3, 3), tinyProduct);
+#endif
+
+  if (ok) {
+    if (verbose)
+      printf("Accurate reductions passed\n");
+    passes++;
+  } else {
+    printf("*** Accurate reductions FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define TEST_ACC 1
+#include "pfp128_acc.h"
+
+// Check that the accumulator is exact, so the result doesn't depend on how
+// the values are split between accumulators, and that it doesn't overflow
+// when the partial sums would.
+static void testAcc() {
+  size_t const n = 1000;
+  FP128 *x = (FP128 *)malloc(n * sizeof(FP128));
+  FP128 tiny = FP128_from_double(0x1p-100);
+  for (size_t i = 0; i < n; i += 4) {
+    x[i] = FP128_from_double(1e30), x[i + 1] = tiny;
+    x[i + 2] = FP128_from_double(-1e30), x[i + 3] = FP128_from_double(1.0);
+  }
+  FP128 expected = mulFP128(FP128_from_double((double)(n / 4)),
+                            addFP128(tiny, FP128_from_double(1.0)));
+  FP128_ACC all, part;
+  FP128_acc_init(&all);
+  FP128_acc_add_n(&all, x, n);
+  int ok = eqFP128(FP128_acc_round(&all), expected);
+  // The same values, split unevenly, merged in the other order.
+  FP128_acc_init(&all);
+  FP128_acc_add_n(&all, x + 333, n - 333);
+  FP128_acc_init(&part);
+  FP128_acc_add_n(&part, x, 333);
+  FP128_acc_merge(&all, &part);
+  ok = ok && eqFP128(FP128_acc_round(&all), expected);
+  free(x);
+
+  FP128_acc_init(&all);
+  FP128_acc_add(&all, FP128_MAX);
+  FP128_acc_add(&all, FP128_MAX);
+  FP128_acc_add(&all, negFP128(FP128_MAX));
+  ok = ok && eqFP128(FP128_acc_round(&all), FP128_MAX);
+  FP128_acc_add(&all, FP128_MAX);
+  ok = ok && isinfFP128(FP128_acc_round(&all));
+  FP128_acc_init(&all);
+  FP128_acc_add(&all, FP128_from_double(1.0));
+  FP128_acc_add(&all, negFP128(FP128_from_double(1.0)));
+  ok = ok && eqFP128(FP128_acc_round(&all), FP128_from_double(0.0)) &&
+       !signbitFP128(FP128_acc_round(&all));
+  FP128_acc_add_d(&all, -HUGE_VAL);
+  ok = ok && isinfFP128(FP128_acc_round(&all)) &&
+       signbitFP128(FP128_acc_round(&all));
+  FP128_acc_add_d(&all, HUGE_VAL);
+  ok = ok && isnanFP128(FP128_acc_round(&all));
+
+  if (ok) {
+    if (verbose)
+      printf("Exact accumulation passed\n");
+    passes++;
+  } else {
+    printf("*** Exact accumulation FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (defined(__SIZEOF_INT128__))
+#define TEST_ATOMIC 1
+#include "pfp128_atomic.h"
+#include <pthread.h>
+
+// Many threads updating the same values at once: each adds 1 to shared,
+// ATOMIC_ADDS times, raises maximum to its own number, and adds 1 into a
+// striped total, so if any update were lost the totals would be short.
+enum { ATOMIC_THREADS = 8, ATOMIC_ADDS = 100000 };
+
+static struct {
+  FP128 PFP128_ATOMIC_ALIGN shared;
+  FP128 PFP128_ATOMIC_ALIGN maximum;
+  FP128_STRIPED striped;
+} atomicTarget;
+
+static void *atomicWorker(void *arg) {
+  unsigned thread = (unsigned)(size_t)arg;
+  FP128 one = FP128_from_double(1.0);
+  for (int i = 0; i < ATOMIC_ADDS; i++) {
+    atomicAddFP128(&atomicTarget.shared, one);
+    FP128_striped_add(&atomicTarget.striped, thread, one);
+  }
+  atomicMaxFP128(&atomicTarget.maximum, FP128_from_ll(thread));
+  return NULL;
+}
+
+static int testAtomicThreads() {
+  pthread_t threads[ATOMIC_THREADS];
+  atomicTarget.shared = FP128_from_double(0.0);
+  atomicTarget.maximum = FP128_from_double(-1.0);
+  FP128_striped_init(&atomicTarget.striped);
+  int started = 0;
+  for (; started < ATOMIC_THREADS; started++)
+    if (pthread_create(&threads[started], NULL, atomicWorker,
+                       (void *)(size_t)started) != 0)
+      break;
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  FP128 total = FP128_from_ll((long long)started * ATOMIC_ADDS);
+  return started == ATOMIC_THREADS && eqFP128(atomicTarget.shared, total) &&
+         eqFP128(FP128_striped_sum(&atomicTarget.striped), total) &&
+         eqFP128(atomicTarget.maximum, FP128_from_ll(ATOMIC_THREADS - 1));
+}
+
+// Check the atomic operations' results from one thread, then under
+// contention.
+static void testAtomic() {
+  FP128 one = FP128_from_double(1.0), two = FP128_from_double(2.0);
+  FP128 PFP128_ATOMIC_ALIGN slot[2] = {one, FP128_from_double(NAN)};
+  int ok = eqFP128(atomicAddFP128(&slot[0], two), one) &&
+           eqFP128(atomicLoadFP128(&slot[0]), FP128_from_double(3.0));
+  ok = ok && eqFP128(atomicMinFP128(&slot[0], two), FP128_from_double(3.0)) &&
+       eqFP128(atomicMaxFP128(&slot[0], one), two) &&
+       eqFP128(atomicMinFP128(&slot[0], FP128_from_double(NAN)), two) &&
+       eqFP128(slot[0], two);
+  // A NaN is replaced by any number, as with fmin.
+  ok = ok && isnanFP128(atomicMinFP128(&slot[1], one)) && eqFP128(slot[1], one);
+  FP128 expected = one;
+  ok = ok && !atomicCompareExchangeFP128(&slot[0], &expected, one) &&
+       eqFP128(expected, two) &&
+       atomicCompareExchangeFP128(&slot[0], &expected, one) &&
+       eqFP128(slot[0], one);
+  atomicStoreFP128(&slot[1], two);
+  ok = ok && eqFP128(slot[1], two);
+
+  FP128_STRIPED total;
+  FP128_striped_init(&total);
+  for (unsigned i = 0; i < 100; i++)
+    FP128_striped_add(&total, i, one);
+  ok = ok && eqFP128(FP128_striped_sum(&total), FP128_from_double(100.0));
+  ok = ok && testAtomicThreads();
+
+  if (ok) {
+    if (verbose)
+      printf("Atomic operations passed\n");
+    passes++;
+  } else {
+    printf("*** Atomic operations FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (PFP128_IS_DD && __x86_64__)
+// libquadmath is available to compare the double-double functions against.
+// (The DD test binary is linked with it, even though pfp128.h doesn't use
+// it in that case.)
+#include <quadmath.h>
+
+static __float128 toQuad(FP128 x) { return (__float128)x.hi + x.lo; }
+static FP128 fromQuad(__float128 q) {
+  double hi = (double)q;
+  return dd_make(hi, (double)(q - hi));
+}
+#endif
+
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#define TEST_FAST 1
+#include "pfp128_fast.h"
+
+// What the fast functions should be within 4 ulp of. The double-double
+// functions are themselves several of its ulp out (pow by about 8 at
+// 12.345^12.345), so there we use libquadmath's, where we have it.
+#if (PFP128_IS_DD && __x86_64__)
+#define FAST_REFERENCE(name, x) fromQuad(name##q(toQuad(x)))
+#define FAST_REFERENCE2(name, x, y) fromQuad(name##q(toQuad(x), toQuad(y)))
+#else
+#define FAST_REFERENCE(name, x) FP128Name(name)(x)
+#define FAST_REFERENCE2(name, x, y) FP128Name(name)(x, y)
+#endif
+
+// The fast functions should be within 4 ulp of the usual ones, exact where
+// the result is, and fall back to them for awkward arguments.
+static void testFast() {
+  FP128 x[] = {QUARTER_PI, FP128_from_double(-3.75), FP128_from_double(1e-3),
+               FP128_from_double(12.345), M_E_FP128};
+  int ok = 1;
+  for (int i = 0; i < 5; i++) {
+    FP128 a = fabsFP128(x[i]);
+    ok = ok &&
+         withinUlpsFP128(expFP128_fast(x[i]), FAST_REFERENCE(exp, x[i]), 4) &&
+         withinUlpsFP128(logFP128_fast(a), FAST_REFERENCE(log, a), 4) &&
+         withinUlpsFP128(log10FP128_fast(a), FAST_REFERENCE(log10, a), 4) &&
+         withinUlpsFP128(sinFP128_fast(x[i]), FAST_REFERENCE(sin, x[i]), 4) &&
+         withinUlpsFP128(cosFP128_fast(x[i]), FAST_REFERENCE(cos, x[i]), 4) &&
+         withinUlpsFP128(powFP128_fast(a, x[i]),
+                         FAST_REFERENCE2(pow, a, x[i]), 4);
+  }
+  for (int i = 0; i < 5; i++) {
+    FP128 s, c;
+    sincosFP128_fast(x[i], &s, &c);
+    ok = ok && eqFP128(s, sinFP128_fast(x[i])) &&
+         eqFP128(c, cosFP128_fast(x[i]));
+  }
+  FP128 two = FP128_from_double(2.0), eight = FP128_from_double(8.0);
+  ok = ok && eqFP128(powFP128_fast(two, FP128_from_double(10.0)),
+                     FP128_from_double(1024.0)) &&
+       eqFP128(powFP128_fast(FP128_from_double(-2.0), FP128_from_double(3.0)),
+               FP128_from_double(-8.0)) &&
+       eqFP128(log2FP128_fast(eight), FP128_from_double(3.0)) &&
+       eqFP128(exp2FP128_fast(FP128_from_double(-3.0)),
+               FP128_from_double(0.125)) &&
+       eqFP128(expFP128_fast(FP128_from_double(0.0)), FP128_from_double(1.0)) &&
+       eqFP128(logFP128_fast(FP128_from_double(1.0)), FP128_from_double(0.0));
+  FP128 huge = FP128_from_double(0x1p70);
+  ok = ok && isnanFP128(logFP128_fast(FP128_from_double(-1.0))) &&
+       isinfFP128(expFP128_fast(FP128_from_double(12000.0))) &&
+       eqFP128(sinFP128_fast(huge), FP128Name(sin)(huge));
+
+  if (ok) {
+    if (verbose)
+      printf("Fast functions passed\n");
+    passes++;
+  } else {
+    printf("*** Fast functions FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (TEST_FAST)
+#define TEST_RANDOM 1
+#include "pfp128_random.h"
+
+static void testRandom() {
+  enum { N = 4000 };
+  static FP128 u[N], v[N];
+  FP128_RANDOM r, s;
+  // The Philox4x32-10 known answer for a zero key and counter.
+  FP128_random_init(&r, 0, 0);
+  sq_u128 bits = pfp128_random_block(&r, 0, 0);
+  int ok = (uint32_t)bits == 0x6627e8d5u &&
+           (uint32_t)(bits >> 96) == 0x9b00dbd8u;
+
+  // The array and scalar versions give the same values, all in [0, 1),
+  // and the same seed and stream give the same values again.
+  FP128_random_init(&r, 12345, 7);
+  FP128_random_uniform_n(&r, u, N);
+  FP128_random_init(&s, 12345, 7);
+  FP128 sum = FP128_from_double(0.0);
+  for (int i = 0; ok && i < N; i++) {
+    ok = eqFP128(u[i], FP128_random_uniform(&s)) &&
+         gtFP128(u[i], FP128_from_double(0.0)) &&
+         ltFP128(u[i], FP128_from_double(1.0));
+    sum = addFP128(sum, u[i]);
+  }
+  double mean = FP128_to_double(sum) / N;
+  ok = ok && r.position == N && fabs(mean - 0.5) < 0.02;
+  // Another stream is different.
+  FP128_random_init(&s, 12345, 8);
+  ok = ok && !eqFP128(FP128_random_uniform(&s), u[0]);
+
+  FP128 a = FP128_from_double(-3.0), b = FP128_from_double(5.0);
+  ok = ok && FP128_random_range_n(&r, a, b, v, N) == 0;
+  for (int i = 0; ok && i < N; i++)
+    ok = geFP128(v[i], a) && ltFP128(v[i], b);
+  // The bounds the wrong way round, or equal, are refused.
+  FP128 untouched = v[0];
+  errno = 0;
+  ok = ok && FP128_random_range_n(&r, b, a, v, N) == -1 && errno == EDOM &&
+       FP128_random_range_n(&r, a, a, v, N) == -1 &&
+       eqFP128(v[0], untouched) && r.position == 2 * N;
+
+  // N(0, 1): the mean within about four standard errors, and the variance
+  // (whose standard error is sqrt(2 / N)) likewise.
+  FP128_random_normal_n(&r, v, N - 1);
+  double m1 = 0.0, m2 = 0.0;
+  for (int i = 0; i < N - 1; i++) {
+    double x = FP128_to_double(v[i]);
+    m1 += x;
+    m2 += x * x;
+  }
+  m1 /= N - 1;
+  m2 /= N - 1;
+  ok = ok && r.position == 3 * N && fabs(m1) < 0.07 && fabs(m2 - 1.0) < 0.1;
+
+  if (ok) {
+    if (verbose)
+      printf("Random numbers passed\n");
+    passes++;
+  } else {
+    printf("*** Random numbers FAILED\n");
+    failures++;
+  }
+}
+
+#define TEST_SORT 1
+#include "pfp128_sort.h"
+
+static int compareSortKeys(void const *a, void const *b) {
+  FP128_SORT_KEY ka = FP128_sort_key(*(FP128 const *)a);
+  FP128_SORT_KEY kb = FP128_sort_key(*(FP128 const *)b);
+  return ka < kb ? -1 : ka > kb;
+}
+
+// The keys should be in totalOrder, and the radix sorts should agree with
+// qsort on the keys, on random values with runs of duplicates.
+static void testSort() {
+  enum { N = 4000, K = 25 };
+  static FP128 x[N], y[N], z[N];
+  static size_t values[N], index[K];
+  FP128 order[] = {FP128_from_double(-NAN), FP128_from_double(-INFINITY),
+                   FP128_from_double(-2.0), FP128_from_double(-0.0),
+                   FP128_from_double(0.0), FP128_DENORM_MIN,
+                   FP128_from_double(1.0), FP128_from_double(INFINITY),
+                   FP128_from_double(NAN)};
+  int ok = 1, count = (int)(sizeof(order) / sizeof(order[0]));
+  for (int i = 0; i < count; i++) {
+    FP128_SORT_KEY key = FP128_sort_key(order[i]);
+    ok = ok && memcmp(&order[i], (FP128[]){FP128_from_sort_key(key)},
+                      sizeof(FP128)) == 0;
+    ok = ok && (i == 0 || FP128_sort_key(order[i - 1]) < key);
+  }
+
+  FP128_RANDOM r;
+  FP128_random_init(&r, 2024, 0);
+  FP128_random_range_n(&r, FP128_from_double(-3.0), FP128_from_double(5.0),
+                       x, N);
+  for (int i = N / 2; i < N; i++)
+    x[i] = x[i % 300];
+  for (int i = 0; i < count; i++)
+    x[7 * i] = order[i];
+  memcpy(y, x, sizeof(x));
+  memcpy(z, x, sizeof(x));
+  qsort(z, N, sizeof(z[0]), compareSortKeys);
+  ok = ok && sortFP128(y, N) == 0 && memcmp(y, z, sizeof(z)) == 0;
+
+  // sortFP128_kv is stable, so equal values keep their positions' order.
+  memcpy(y, x, sizeof(x));
+  for (size_t i = 0; i < N; i++)
+    values[i] = i;
+  ok = ok && sortFP128_kv(y, values, N) == 0 && memcmp(y, z, sizeof(z)) == 0;
+  for (int i = 0; ok && i < N; i++)
+    ok = memcmp(&y[i], &x[values[i]], sizeof(FP128)) == 0 &&
+         (i == 0 || FP128_sort_key(y[i - 1]) < FP128_sort_key(y[i]) ||
+          values[i - 1] < values[i]);
+
+  memcpy(y, x, sizeof(x));
+  ok = ok && nthElementFP128(y, N, N / 3) == 0 &&
+       memcmp(&y[N / 3], &z[N / 3], sizeof(FP128)) == 0;
+  for (int i = 0; ok && i < N; i++)
+    ok = i < N / 3 ? FP128_sort_key(y[i]) <= FP128_sort_key(z[N / 3])
+                   : FP128_sort_key(y[i]) >= FP128_sort_key(z[N / 3]);
+  memcpy(y, x, sizeof(x));
+  ok = ok && partialSortFP128(y, N, K) == 0 &&
+       memcmp(y, z, K * sizeof(FP128)) == 0;
+
+  ok = ok && topkFP128(x, N, K, index) == 0;
+  for (int i = 0; ok && i < K; i++)
+    ok = memcmp(&x[index[i]], &z[N - 1 - i], sizeof(FP128)) == 0;
+  // The first of equal extremes (past the special values, which include
+  // both NaNs).
+  ok = ok && argminFP128_n(x, N) == 0 && argmaxFP128_n(x, N) == 7 * 8 &&
+       isnanFP128(maxFP128_n(x, N));
+  size_t lo = 64, hi = 64;
+  for (size_t i = 64; i < N; i++) {
+    lo = ltFP128(x[i], x[lo]) ? i : lo;
+    hi = gtFP128(x[i], x[hi]) ? i : hi;
+  }
+  ok = ok && argminFP128_n(x + 64, N - 64) + 64 == lo &&
+       argmaxFP128_n(x + 64, N - 64) + 64 == hi &&
+       eqFP128(minFP128_n(x + 64, N - 64), x[lo]) &&
+       eqFP128(maxFP128_n(x + 64, N - 64), x[hi]);
+
+  if (ok) {
+    if (verbose)
+      printf("Sorting passed\n");
+    passes++;
+  } else {
+    printf("*** Sorting FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (PFP128_PROFILE)
+// The counts of calls and argument classes should match what we do (after
+// a reset, since the other tests call the functions too).
+static FP128_PROFILE_ENTRY const *profileEntry(FP128_PROFILE_ENTRY const *e,
+                                               char const *name) {
+  for (int i = 0; i < FP128_PROFILE_FUNCTIONS; i++)
+    if (strcmp(e[i].name, name) == 0)
+      return &e[i];
+  return &e[0];
+}
+
+static void testProfile() {
+  FP128_PROFILE_ENTRY e[FP128_PROFILE_FUNCTIONS];
+  FP128 x[4] = {FP128_from_double(0.0), FP128_from_double(1.5),
+                FP128_DENORM_MIN, FP128_from_double(-2.0)};
+  FP128 y[4];
+  FP128_profile_reset();
+  sinFP128_n(x, y, 4);
+  y[0] = powFP128(FP128_from_double(INFINITY), FP128_from_double(2.0));
+  int ok = FP128_profile_snapshot(e, FP128_PROFILE_FUNCTIONS) ==
+           FP128_PROFILE_FUNCTIONS;
+  FP128_PROFILE_ENTRY const *sin = profileEntry(e, "sin");
+  FP128_PROFILE_ENTRY const *pow = profileEntry(e, "pow");
+  ok = ok && sin->calls == 4 && sin->ticks > 0 &&
+       sin->classes[FP128_PROFILE_ZERO] == 1 &&
+       sin->classes[FP128_PROFILE_NORMAL] == 2 &&
+       sin->classes[FP128_PROFILE_SUBNORMAL] == 1 && pow->calls == 1 &&
+       pow->classes[FP128_PROFILE_SPECIAL] == 1 &&
+       profileEntry(e, "cos")->calls == 0;
+  FP128_profile_reset();
+  FP128_profile_snapshot(e, FP128_PROFILE_FUNCTIONS);
+  ok = ok && profileEntry(e, "sin")->calls == 0;
+
+  if (ok) {
+    if (verbose)
+      printf("Profiling passed\n");
+    passes++;
+  } else {
+    printf("*** Profiling FAILED\n");
+    failures++;
+  }
+}
+#endif
+
+#if (PFP128_LIB)
+// One version of the library's functions: those which pfp128_lib.h sends
+// calls to, or those for one level.
+typedef struct {
+  char const *isa;
+  __typeof__(PFP128_LIB_NAME(addFP128_n)) *add;
+  __typeof__(PFP128_LIB_NAME(divFP128_n)) *div;
+  __typeof__(PFP128_LIB_NAME(polyEvalFP128_n)) *polyEval;
+  __typeof__(PFP128_LIB_NAME(sumFP128_d)) *sum;
+  __typeof__(PFP128_LIB_NAME(dotFP128_n)) *dot;
+  __typeof__(PFP128_LIB_NAME(normFP128_n)) *norm;
+  __typeof__(PFP128_LIB_NAME(FP128_gemm)) *gemm;
+  __typeof__(PFP128_LIB_NAME(FP128_to_chars_n)) *toChars;
+  __typeof__(PFP128_LIB_NAME(FP128_from_chars_n)) *fromChars;
+} LibVersion;
+
+#define LIB_VERSION(isa, F)                                                    \
+  {isa,          F(addFP128_n),       F(divFP128_n),                           \
+   F(polyEvalFP128_n), F(sumFP128_d), F(dotFP128_n),                           \
+   F(normFP128_n), F(FP128_gemm),     F(FP128_to_chars_n),                     \
+   F(FP128_from_chars_n)}
+#define LIB_PUBLIC(name) PFP128_LIB_NAME(name)
+#if (PFP128_LIB_LEVELS)
+#define LIB_DEFAULT(name) PFP128_LIB_LEVEL_NAME(name, default)
+#define LIB_V3(name) PFP128_LIB_LEVEL_NAME(name, v3)
+#define LIB_V4(name) PFP128_LIB_LEVEL_NAME(name, v4)
+#endif
+
+// The library's versions should give exactly the same results as the inline
+// ones, (f)(...), which pfp128_lib.h leaves alone.
+static int checkLibVersion(LibVersion const *v) {
+  enum { N = 37, M = 5 };
+  FP128 a[N], b[N], lib[N], inl[N], C[M * M], D[M * M];
+  double d[N];
+  for (int i = 0; i < N; i++) {
+    d[i] = (i - 18) * 0.37 + 1e-3;
+    a[i] = FP128_from_double(d[i]);
+    b[i] = divFP128(FP128_CONST(1.0), FP128_from_ll(i + 3));
+  }
+  int ok = 1;
+  v->add(a, b, lib, N);
+  (addFP128_n)(a, b, inl, N);
+  ok = ok && memcmp(lib, inl, sizeof(lib)) == 0;
+  v->div(a, b, lib, N);
+  (divFP128_n)(a, b, inl, N);
+  ok = ok && memcmp(lib, inl, sizeof(lib)) == 0;
+  v->polyEval(b, 9, a, lib, N);
+  (polyEvalFP128_n)(b, 9, a, inl, N);
+  ok = ok && memcmp(lib, inl, sizeof(lib)) == 0;
+  ok = ok && eqFP128(v->sum(d, N), (sumFP128_d)(d, N)) &&
+       eqFP128(v->dot(a, b, N), (dotFP128_n)(a, b, N)) &&
+       eqFP128(v->norm(b, N), (normFP128_n)(b, N));
+  ok = ok &&
+       v->gemm(FP128_BLAS_NO_TRANS, FP128_BLAS_TRANS, M, M, 7, b[1], a, 7, b,
+               7, FP128_CONST(0.0), C, M) == 0 &&
+       (FP128_gemm)(FP128_BLAS_NO_TRANS, FP128_BLAS_TRANS, M, M, 7, b[1], a,
+                    7, b, 7, FP128_CONST(0.0), D, M) == 0 &&
+       memcmp(C, D, sizeof(C)) == 0;
+
+  char text[N * (FP128_CHARS_MAX + 1)], inlText[sizeof(text)];
+  char *end =
+      v->toChars(text, text + sizeof(text), b, N, FP128_CHARS_GENERAL, ' ');
+  char *inlEnd = (FP128_to_chars_n)(inlText, inlText + sizeof(inlText), b, N,
+                                    FP128_CHARS_GENERAL, ' ');
+  ok = ok && end && end - text == inlEnd - inlText &&
+       memcmp(text, inlText, (size_t)(end - text)) == 0 &&
+       v->fromChars(text, end, lib, N, NULL) == N &&
+       memcmp(lib, b, sizeof(lib)) == 0;
+  if (!ok)
+    printf("*** Library (%s) FAILED\n", v->isa);
+  return ok;
+}
+
+// Check the version in use, then every level's version the CPU can run.
+static void testLib() {
+  LibVersion versions[] = {
+    LIB_VERSION(FP128_lib_isa(), LIB_PUBLIC),
+#if (PFP128_LIB_LEVELS)
+    LIB_VERSION("default", LIB_DEFAULT),
+    LIB_VERSION("x86-64-v3", LIB_V3),
+    LIB_VERSION("x86-64-v4", LIB_V4),
+#endif
+  };
+  int count = 1, ok = FP128_lib_isa() != NULL;
+#if (PFP128_LIB_LEVELS)
+  int level = FP128_lib_level();
+  count = level == 4 ? 4 : level == 3 ? 3 : 2;
+#if (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12)
+  // GCC's own view of the levels should agree with ours.
+  __builtin_cpu_init();
+  if ((level >= 3) != !!__builtin_cpu_supports("x86-64-v3") ||
+      (level >= 4) != !!__builtin_cpu_supports("x86-64-v4")) {
+    printf("*** Library level %d FAILED\n", level);
+    ok = 0;
+  }
+#endif
+#endif
+  for (int i = 0; i < count; i++)
+    ok = checkLibVersion(&versions[i]) && ok;
+
+  if (ok) {
+    if (verbose)
+      printf("Library (%s, and %d levels) passed\n", FP128_lib_isa(),
+             count - 1);
+    passes++;
+  } else {
+    failures++;
+  }
+}
+#endif
+
+#if (PFP128_IS_DD && __x86_64__)
+// Here we can also check that the double-double functions are accurate,
+// against libquadmath.
+#define FOREACH_ACCURACY_CHECK(op)              \
+  op(exp, expq)                                 \
+  op(log, logq)                                 \
+  op(sin, sinq)                                 \
+  op(tan, tanq)                                 \
+  op(atan, atanq)                               \
+  op(sqrt, sqrtq)                               \
+  op(erfc, erfcq)                               \
+  op(tgamma, tgammaq)
+
+#define CheckAccuracy(basename, quadname)                               \
+  {                                                                     \
+    __float128 expected = quadname(toQuad(QUARTER_PI));                 \
+    __float128 error = fabsq(toQuad(basename##FP128(QUARTER_PI)) -      \
+                             expected);                                 \
+    if (error <= fabsq(expected) * 0x1p-100Q) {                         \
+      if (verbose)                                                      \
+        printf("%-9s accurate\n", STRINGIFY(basename));                 \
+      passes++;                                                         \
+    } else {                                                            \
+      printf("*** " #basename " INACCURATE: relative error %g\n",       \
+             (double)(error / fabsq(expected)));                        \
+      failures++;                                                       \
+    }                                                                   \
+  }
+
+// As CheckAccuracy, but at a given argument.
+static void checkAccuracyAt(char const *name, __float128 x, FP128 result,
+                            __float128 expected) {
+  __float128 error = fabsq(toQuad(result) - expected);
+  if (error <= fabsq(expected) * 0x1p-100Q) {
+    passes++;
+    return;
+  }
+  char buffer[64];
+  quadmath_snprintf(buffer, sizeof(buffer), "%.28Qa", x);
+  printf("*** %s INACCURATE at %s: relative error %g\n", name, buffer,
+         (double)(error / fabsq(expected)));
+  failures++;
+}
+
+static void testAccuracy() {
+  FOREACH_ACCURACY_CHECK(CheckAccuracy)
+
+  // Arguments close to multiples of pi/2, where the argument reduction has to
+  // keep its accuracy relative to the reduced argument rather than to pi/2.
+  int const before = failures;
+  for (int e = 8; e <= 104; e += 8) {
+    FP128 x = fromQuad(rintq(ldexpq(1.0Q, e) / M_PI_2q) * M_PI_2q);
+    __float128 xq = toQuad(x);
+    checkAccuracyAt("sin", xq, sinFP128(x), sinq(xq));
+    checkAccuracyAt("cos", xq, cosFP128(x), cosq(xq));
+    checkAccuracyAt("tan", xq, tanFP128(x), tanq(xq));
+  }
+  FP128 x = fromQuad(-0x1.fd619f61569973cff0628eea68a0p+74Q);
+  checkAccuracyAt("cos", toQuad(x), cosFP128(x), cosq(toQuad(x)));
+  // Where pow, erfc and tgamma take exp of something large.
+  FP128 y = fromQuad(-0x1.194c531942c9336cb97467cb48c0p+5Q);
+  x = fromQuad(0x1.22c1cf71f10f4e80b397a5d9b800p-8Q);
+  checkAccuracyAt("pow", toQuad(x), powFP128(x, y),
+                  powq(toQuad(x), toQuad(y)));
+  x = fromQuad(0x1.0539581f26cb54eb6f2b96e168c0p+3Q);
+  checkAccuracyAt("erfc", toQuad(x), erfcFP128(x), erfcq(toQuad(x)));
+  x = fromQuad(-0x1.fdf5a5f6a1802bd6b5f9a88d8380p+4Q);
+  checkAccuracyAt("tgamma", toQuad(x), tgammaFP128(x), tgammaq(toQuad(x)));
+  x = fromQuad(0x1.8db1d6b2092e99839b32ee692cc0p+5Q);
+  checkAccuracyAt("tgamma", toQuad(x), tgammaFP128(x), tgammaq(toQuad(x)));
+  if (verbose && failures == before)
+    printf("Reduction and large exponents accurate\n");
+}
+#endif
+
 static int bytesUsed(uint8_t const *p) {
   // Assume little endian and 64B allocation
   // Assume little-endian byte layout.
@@ -416,6 +2043,7 @@ int main(int argc, char **argv) {
 
   printf(COMPILER_NAME " targeting " TARGET_OS_NAME
                        " running on " TARGET_ARCH_NAME "\n");
+  printf("FP128 backend is " PFP128_BACKEND_NAME "\n");
   checkSize();
 
   test128to128UnaryFunctions();
@@ -423,8 +2051,53 @@ int main(int argc, char **argv) {
   testComplexTo128UnaryFunctions();
   testComplexToComplexUnaryFunctions();
   test128BinaryFunctions();
+  testBatched();
+  testFused();
+  testComplexArithmetic();
+  testFFT();
+  testPoly();
+  testBLAS();
+  testSolve();
+#if (TEST_SOFT_ARITHMETIC)
+  testSoftArithmetic();
+  testSoA();
+#endif
   testInput();
   testPrintf();
+#if (TEST_TO_CHARS)
+  testToChars();
+  testFromChars();
+#endif
+#if (TEST_FILE_IO)
+  testFileIO();
+#endif
+#if (TEST_REDUCE)
+  testReduce();
+#endif
+#if (TEST_ACC)
+  testAcc();
+#endif
+#if (TEST_ATOMIC)
+  testAtomic();
+#endif
+#if (TEST_FAST)
+  testFast();
+#endif
+#if (TEST_RANDOM)
+  testRandom();
+#endif
+#if (TEST_SORT)
+  testSort();
+#endif
+#if (PFP128_PROFILE)
+  testProfile();
+#endif
+#if (PFP128_LIB)
+  testLib();
+#endif
+#if (PFP128_IS_DD && __x86_64__)
+  testAccuracy();
+#endif
   printf("(Not tested: exp2, ldexp, modf, remquo, fma)\n");
 
   printf("*** %d pass%s, %d failure%s ***\n", passes, passes == 1 ? "" : "es",
@@ -0,0 +1,149 @@
+//===-- testPFP128.cpp - test the pfp128.hpp header ---------*- C++ -*-===//
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+//
+// Checks that the C++ wrapper compiles, finds the functions, and fuses
+// products into additions.
+//
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include "pfp128.hpp"
+
+#if (defined(__SIZEOF_INT128__) &&                                           \
+     (PFP128_IS_DD || __x86_64__ || LDBL_MANT_DIG == 113))
+#include "pfp128_soft.h"
+#if (SQ_HAVE_CONSTEXPR)
+#define TEST_CONSTEXPR 1
+#include "pfp128_constexpr.hpp"
+#endif
+#endif
+
+using pfp128::fp128;
+
+static int verbose = 0;
+static int passes = 0;
+static int failures = 0;
+
+static void check(char const *what, bool ok) {
+  if (ok) {
+    if (verbose)
+      printf("%-32s passed\n", what);
+    passes++;
+  } else {
+    printf("*** %s FAILED\n", what);
+    failures++;
+  }
+}
+
+// (1 + 2^-60)(1 - 2^-60) - 1 is exactly -2^-120, but the product on its own
+// rounds to 1, so these are only right if the products are fused.
+static void testFusion() {
+  fp128 tiny = FP128_from_double(0x1p-60), one = 1;
+  fp128 a = one + tiny, b = one - tiny;
+  fp128 exact = FP128_from_double(-0x1p-120);
+  fp128 rounded = a * b;
+  check("Unfused product", rounded - one == fp128(0));
+  check("a * b - c", a * b - one == exact);
+  check("c - a * b", one - a * b == -exact);
+  check("a * b + c", a * b + -one == exact);
+  check("c + a * b", -one + a * b == exact);
+  check("a * b - c * d", a * b - one * one == exact);
+  fp128 sum = -one;
+  sum += a * b;
+  check("sum += a * b", sum == exact);
+  fp128 x[4] = {1, 2, 3, 4}, dot = 0;
+  for (int i = 0; i < 4; i++)
+    dot += x[i] * x[i];
+  check("Dot product", dot == 30 && 2 * x[1] * x[2] - 3 * x[3] == 0);
+}
+
+static void testFunctions() {
+  fp128 two = 2.0;
+  check("sqrt", sqrt(two) * sqrt(two) - two < 1e-30);
+  check("pfp128::sin", pfp128::sin(fp128(0)) == 0 && cos(fp128(0)) == 1);
+  fp128 s, c, half = 0.5;
+  sincos(half, &s, &c);
+  check("sincos", abs(s - sin(half)) < 1e-32 && abs(c - cos(half)) < 1e-32);
+  int e;
+  fp128 whole;
+  check("frexp and modf", frexp(fp128(8), &e) == 0.5 && e == 4 &&
+                              modf(fp128(2.5), &whole) == 0.5 && whole == 2);
+  check("fma", fma(two, two, two) == 6 && pow(two, fp128(10)) == 1024);
+  check("Conversions", (double)fp128(0.1) == 0.1 &&
+                           (long long)fp128(-7) == -7 && fp128(2.5L) == 2.5);
+  // Unsigned values from 2^63 up don't fit in a long long.
+  check("Unsigned conversions",
+        fp128(ULLONG_MAX) == fp128(0x1p64) - 1 &&
+            fp128(1ull << 63) == 0x1p63 && fp128(42u) == 42 &&
+            fp128((unsigned char)200) == 200 && fp128(-1LL) == -1);
+  std::ostringstream os;
+  os.precision(10);
+  os << fp128(1) / 3;
+  check("operator<<", os.str() == "0.3333333333");
+}
+
+static void testLimits() {
+  typedef std::numeric_limits<fp128> limits;
+  check("numeric_limits",
+        limits::is_specialized && limits::digits == FP128_MANT_DIG &&
+            limits::epsilon() == FP128_EPSILON && isinf(limits::infinity()) &&
+            isnan(limits::quiet_NaN()) && limits::lowest() == -limits::max() &&
+            fp128(1) + limits::epsilon() != 1);
+}
+
+#if (TEST_CONSTEXPR)
+using namespace pfp128::literals;
+
+static_assert(1_q + 2_q == 3_q && 0.5_q * 4_q == 2_q && 1_q / 4_q == 0.25_q,
+              "constexpr arithmetic");
+static_assert(sqrt(0x1p-200_q) == 0x1p-100_q && 0.1_q != 0.1,
+              "constexpr sqrt and literals");
+static_assert(1e5000_q > 1e4932_q && 1e4932_q * 10_q == 1e5000_q &&
+                  -1e-5000_q == 0_q,
+              "constexpr overflow and underflow");
+
+// The literals should be the same as FP128_CONST, and the arithmetic the
+// same as at run time (other than sqrt, since libquadmath's sqrtq isn't
+// always correctly rounded).
+static void testConstexpr() {
+  static constexpr fp128 table[] = {
+      0.1_q, 3.141592653589793238462643383279502884_q, -1.5e300_q, 0x1.8p-3_q};
+  fp128 expected[] = {FP128_CONST(0.1), M_PI_FP128, FP128_CONST(-1.5e300),
+                      FP128_CONST(0.1875)};
+  bool ok = true;
+  for (int i = 0; i < 4; i++)
+    ok = ok && memcmp(&table[i], &expected[i], sizeof(fp128)) == 0;
+#if (!PFP128_IS_DD)
+  static constexpr fp128 third = 1_q / 3_q;
+  fp128 runtime = fp128(1) / 3;
+  ok = ok && memcmp(&third, &runtime, sizeof(fp128)) == 0;
+#endif
+  check("constexpr literals", ok);
+}
+#endif
+
+int main(int argc, char **argv) {
+  (void)argv;
+  verbose = argc > 1;
+  printf("FP128 backend is " PFP128_BACKEND_NAME " (C++)\n");
+
+  testFusion();
+  testFunctions();
+  testLimits();
+#if (TEST_CONSTEXPR)
+  testConstexpr();
+#endif
+
+  printf("*** %d pass%s, %d failure%s ***\n", passes, passes == 1 ? "" : "es",
+         failures, failures == 1 ? "" : "s");
+  return failures != 0;
+}